@@ -0,0 +1,1830 @@
+/**
+ * @file   bench.c
+ * @author Armin Zare Zadeh ali.a.zarezadeh@gmail.com
+ * @date   15 October 2026
+ * @version 0.1
+ * @brief   bench.c is a small benchmark harness for the building blocks of the Inter SoC
+ *          Communication (ISC) system. Each benchmark is selected with -t and prints
+ *          a short table to stdout.
+ *
+ * - notify: ping-pong between two processes over a pair of shared memory rings, once
+ *   woken by the futex based shm_notify and once by the SysV binary semaphore. It
+ *   reports the one way handoff latency and the CPU burnt by a waiter on an idle ring.
+ * - wait: the same ping-pong for each wait strategy of the ring consumer (block, spin,
+ *   spin_yield, adaptive).
+ * - mpsc: 1, 2 and 4 producer processes claim slots of one ring concurrently while a
+ *   single consumer drains it. It reports the aggregate throughput and checks that
+ *   every producer's messages arrive complete and in order.
+ * - broadcast: one producer feeds 1, 2 and 4 reader processes which each see every
+ *   message, then once more with a slow reader which gets dropped as a laggard.
+ * - record: records of 16 bytes to 64 KB streamed through one ring from a producer
+ *   process, each taking only the slots its length needs.
+ * - batch: 512 byte chunks pushed through a local stream socket one send per chunk,
+ *   and in batches of 4, 16 and 64 chunks per sendmsg, as shmem_xmit forwards them.
+ * - zerocopy: chunks of 4 KB to 256 KB sent over TCP with plain send and with
+ *   MSG_ZEROCOPY, to find the size above which zero-copy pays (sckt_zerocopy_min).
+ *   The sink is a child process on loopback, where the kernel copies anyway, or the
+ *   one given with -a on the far end of a real link.
+ * - uring: a stream of framed messages of 64 bytes to 16 KB received over loopback
+ *   TCP, once with epoll and recv until EAGAIN as sckt_server reads, and once with a
+ *   multishot receive into provided buffers as uring_server reads. It reports the
+ *   message rate and the system calls and CPU time of the receiver per message.
+ * - udp: datagrams of 64 bytes up to a 1500 byte MTU sent and read over loopback
+ *   with one system call each, and in batches with sendmmsg and recvmmsg as the sckt
+ *   modules do with udp. It reports the rate and the system calls and CPU time per
+ *   datagram.
+ * - unix: framed messages of 64 bytes to 64 KB streamed and ping-ponged between two
+ *   processes over loopback TCP, over a Unix SOCK_SEQPACKET socket pair, and over the
+ *   pair with the payload in a shared memfd, as the unix modules do. It reports the
+ *   message rate, the receiver system calls per message and the round trip times.
+ * - profile: the same stream and round trips over loopback TCP for each socket tuning
+ *   profile of the sckt modules (default, latency, throughput, lowmem), set on both
+ *   ends as sckt_client and sckt_server set it. It reports the rates, the round trip
+ *   times and the socket buffers the kernel granted.
+ * - crc: the CRC32C of messages of 64 bytes to 64 KB, computed with the crc32
+ *   instructions and with tables, then framed messages streamed over loopback TCP
+ *   from a child process without a CRC and with one computed by the sender and
+ *   checked by the receiver, as the sckt modules do under sckt_crc. It reports the
+ *   rates and what the CRC costs of the throughput.
+ */
+
+#define _GNU_SOURCE   // sendmmsg, recvmmsg, memfd_create
+
+#include <errno.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ipc.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/sem.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <linux/errqueue.h>
+#include <sys/epoll.h>
+#include <netinet/tcp.h>
+#include "isc.h"
+#include "uring.h"
+
+
+/***********************************************************************************
+ * C o n s t a n t s ,   v a r i a b l e s ,  f u n c t i o n s
+************************************************************************************/
+
+// The bench doesn't keep a log file, but common.c expects these symbols.
+const char* main_log_filename = "bench.log";
+FILE *main_log_fd = NULL;
+
+#define BENCH_RING_SLOTS 64
+// Slots of the ring of the record benchmark, enough for records of SHM_MAX_RECORD bytes
+#define BENCH_RECORD_SLOTS 4096
+#define BENCH_PAYLOAD_SIZE 64
+
+// How long an idle waiter is observed for its CPU usage, in seconds
+#define BENCH_IDLE_TIME 1.0
+
+// Description of long options for getopt_long.
+static const struct option long_options[] = {
+  { "help", 0, NULL, 'h' },
+  { "test", 1, NULL, 't' },
+  { "iterations", 1, NULL, 'n' },
+  { "spin-us", 1, NULL, 's' },
+  { "address", 1, NULL, 'a' },
+  { NULL, 0, NULL, 0 },
+};
+
+// Description of short options for getopt_long.
+static const char* const short_options = "ht:n:s:a:";
+
+// Chunk size of the batch benchmark
+#define BENCH_CHUNK_SIZE 512
+
+// Usage summary text.
+static const char* const usage_template =
+  "Usage: %s [ options ]\n"
+  " -h, --help Print this information.\n"
+  " -t, --test NAME benchmark to run: notify, wait, mpsc, broadcast, record,\n batch, zerocopy, uring, udp, unix, profile, crc.\n"
+  " (by default, run all of them).\n"
+  " -n, --iterations N number of round trips (or messages per producer) per measurement.\n"
+  " (by default, 100000).\n"
+  " -s, --spin-us US spin budget of the wait strategies.\n"
+  " (by default, 50).\n"
+  " -a, --address IP:PORT TCP sink of the zerocopy benchmark, which reads and\n discards what it gets (e.g. nc -lk PORT > /dev/null).\n"
+  " (by default, a child process on loopback).\n";
+
+// Number of round trips per measurement
+static int iterations = 100000;
+
+// Spin budget of the wait benchmark, in microseconds
+static uint32_t spin_us = 50;
+
+// Sink of the zerocopy benchmark, IP:PORT, or NULL for a local child
+static const char* sink_address = NULL;
+
+// Buffers the zerocopy benchmark sends from in turn; one is reused only once the
+// kernel is done with its last send. At most this many bytes go out per row.
+#define BENCH_ZC_BUFFERS 64
+#define BENCH_ZC_BYTES (1ULL << 30)
+
+// Receive buffers of the uring benchmark, as many and as large as uring_server's,
+// and the bytes the sender writes at a time
+#define BENCH_URING_BUFS 256
+#define BENCH_URING_BUF_SIZE 16384
+#define BENCH_URING_WRITE (64 * 1024)
+
+// Datagrams per sendmmsg and recvmmsg of the udp benchmark
+#define BENCH_UDP_BATCH 32
+
+// Bytes checksummed per row of the crc benchmark
+#define BENCH_CRC_BYTES (256ULL << 20)
+
+// Shared state of a ping-pong run: two rings plus the two semaphores used by the
+// SysV variant and the idle CPU time reported back by the child.
+struct pingpong {
+  struct shm_ring ping;
+  struct shm_ring pong;
+  int ping_semid;
+  int pong_semid;
+  double idle_cpu;
+};
+
+
+// Print usage information and exit.
+static void print_usage (int is_error)
+{
+  fprintf (is_error ? stderr : stdout, usage_template, program_name);
+  exit (is_error ? 1 : 0);
+}
+
+
+// Current monotonic time in nanoseconds
+static uint64_t now_ns ()
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+
+// CPU time (user + system) consumed so far by the calling process, in seconds
+static double cpu_time ()
+{
+  struct rusage ru;
+
+  getrusage (RUSAGE_SELF, &ru);
+  return ru.ru_utime.tv_sec + ru.ru_stime.tv_sec
+         + (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+}
+
+
+// Sort helper for the latency samples
+static int cmp_u64 (const void* a, const void* b)
+{
+  uint64_t x = *(const uint64_t*) a, y = *(const uint64_t*) b;
+
+  return (x > y) - (x < y);
+}
+
+
+// Print avg/p50/p99 of the N samples in ns.
+static void print_latency (const char* name, uint64_t* samples, int n, double idle_cpu)
+{
+  double sum = 0;
+  int i;
+
+  qsort (samples, n, sizeof (uint64_t), cmp_u64);
+  for (i = 0; i < n; i++)
+    sum += samples[i];
+
+  printf ("%-22s %10.0f %10llu %10llu %14.2f\n", name, sum / n,
+          (unsigned long long) samples[n / 2], (unsigned long long) samples[(n * 99) / 100],
+          idle_cpu * 1000);
+}
+
+
+// Map anonymous shared memory for a ring of SLOTS slots and attach to it.
+static void map_ring_slots (struct shm_ring* ring, uint32_t slots)
+{
+  size_t size = shm_ring_segment_size (slots, BENCH_PAYLOAD_SIZE);
+  void* base = mmap (NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+
+  if (base == MAP_FAILED)
+    system_error ("bench - mmap");
+  if (shm_ring_attach (ring, base, slots, BENCH_PAYLOAD_SIZE) == -1)
+    system_error ("bench - shm_ring_attach");
+}
+
+
+// Map anonymous shared memory for a ring and attach to it.
+static void map_ring (struct shm_ring* ring)
+{
+  map_ring_slots (ring, BENCH_RING_SLOTS);
+}
+
+
+// Allocate a private semaphore whose count starts at zero.
+static int alloc_semaphore ()
+{
+  int semid = binary_semaphore_allocation (IPC_PRIVATE, 0600 | IPC_CREAT);
+
+  if (semid == -1)
+    system_error ("bench - binary_semaphore_allocation");
+  // binary_semaphore_initialize leaves a count of one behind; consume it.
+  binary_semaphore_initialize (semid);
+  binary_semaphore_wait (semid);
+  return semid;
+}
+
+
+// Block on RING until data arrives, using the futex or the semaphore SEMID.
+static uint8_t* pp_receive (struct shm_ring* ring, int use_sem, int semid, uint32_t* len)
+{
+  uint8_t* slot;
+
+  while ((slot = shm_ring_read (ring, len)) == NULL) {
+    if (use_sem)
+      binary_semaphore_wait (semid);
+    else
+      shm_ring_await_data (ring, SHM_WAIT_TIMEOUT);
+  }
+  return slot;
+}
+
+
+// Publish VALUE on RING and wake the peer through the futex or the semaphore SEMID.
+static void pp_send (struct shm_ring* ring, int use_sem, int semid, uint64_t value)
+{
+  uint8_t* slot;
+
+  while ((slot = shm_ring_reserve (ring, sizeof (value))) == NULL)
+    shm_ring_wait_space (ring, SHM_WAIT_TIMEOUT);
+  memcpy (slot, &value, sizeof (value));
+  shm_ring_publish (ring, sizeof (value), SHM_RECORD_DATA);
+  if (use_sem)
+    binary_semaphore_post (semid);
+}
+
+
+// Child side of the ping-pong: first idle on an empty ring to measure the CPU
+// that costs, then echo every ping back until a zero arrives.
+static void pp_child (struct pingpong* pp, int use_sem)
+{
+  uint64_t value;
+  uint32_t len;
+  uint8_t* slot;
+  double start_cpu = cpu_time ();
+  uint64_t start = now_ns ();
+
+  while (now_ns () - start < BENCH_IDLE_TIME * 1e9) {
+    if (use_sem)
+      binary_semaphore_wait (pp->ping_semid);
+    else
+      shm_ring_await_data (&pp->ping, SHM_WAIT_TIMEOUT);
+  }
+  pp->idle_cpu = cpu_time () - start_cpu;
+
+  do {
+    slot = pp_receive (&pp->ping, use_sem, pp->ping_semid, &len);
+    memcpy (&value, slot, sizeof (value));
+    shm_ring_release (&pp->ping);
+    pp_send (&pp->pong, use_sem, pp->pong_semid, value);
+  } while (value != 0);
+}
+
+
+// Run one ping-pong measurement and print its row. Without USE_SEM the rings are
+// waited on with the strategy MODE.
+static void run_pingpong (const char* name, int use_sem, enum shm_wait_mode mode)
+{
+  struct pingpong* pp;
+  uint64_t* samples = (uint64_t*) xmalloc (iterations * sizeof (uint64_t));
+  uint32_t len;
+  pid_t child;
+  int i;
+
+  pp = mmap (NULL, sizeof (*pp), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (pp == MAP_FAILED)
+    system_error ("bench - mmap");
+  map_ring (&pp->ping);
+  map_ring (&pp->pong);
+  pp->ping.wait.mode = pp->pong.wait.mode = mode;
+  pp->ping.wait.spin_us = pp->pong.wait.spin_us = spin_us;
+  pp->ping.wait.pause = pp->pong.wait.pause = true;
+  pp->ping_semid = alloc_semaphore ();
+  pp->pong_semid = alloc_semaphore ();
+
+  child = fork ();
+  if (child == -1)
+    system_error ("bench - fork");
+  if (child == 0) {
+    pp_child (pp, use_sem);
+    _exit (0);
+  }
+
+  // Let the child finish its idle phase before the first ping.
+  better_sleep (BENCH_IDLE_TIME + 0.05);
+
+  for (i = 0; i <= iterations; i++) {
+    uint64_t start = now_ns ();
+
+    pp_send (&pp->ping, use_sem, pp->ping_semid, i < iterations ? start : 0);
+    pp_receive (&pp->pong, use_sem, pp->pong_semid, &len);
+    shm_ring_release (&pp->pong);
+    if (i < iterations)
+      samples[i] = (now_ns () - start) / 2;
+  }
+  waitpid (child, NULL, 0);
+
+  print_latency (name, samples, iterations, pp->idle_cpu);
+
+  binary_semaphore_deallocate (pp->ping_semid);
+  binary_semaphore_deallocate (pp->pong_semid);
+  munmap (pp->ping.hdr, shm_ring_segment_size (BENCH_RING_SLOTS, BENCH_PAYLOAD_SIZE));
+  munmap (pp->pong.hdr, shm_ring_segment_size (BENCH_RING_SLOTS, BENCH_PAYLOAD_SIZE));
+  munmap (pp, sizeof (*pp));
+  free (samples);
+}
+
+
+// Compare the futex and semaphore wakeups.
+static void bench_notify ()
+{
+  printf ("\nnotify: one way handoff latency (ns) and idle waiter CPU (ms per %.0f s)\n", BENCH_IDLE_TIME);
+  printf ("%-22s %10s %10s %10s %14s\n", "wakeup", "avg", "p50", "p99", "idle cpu ms");
+  run_pingpong ("futex shm_notify", 0, SHM_WAIT_BLOCK);
+  run_pingpong ("sysv semaphore", 1, SHM_WAIT_BLOCK);
+}
+
+
+// Compare the wait strategies of the ring consumer.
+static void bench_wait ()
+{
+  printf ("\nwait: one way handoff latency (ns) and idle waiter CPU (ms per %.0f s), spin budget %u us\n",
+          BENCH_IDLE_TIME, spin_us);
+  printf ("%-22s %10s %10s %10s %14s\n", "strategy", "avg", "p50", "p99", "idle cpu ms");
+  run_pingpong ("block", 0, SHM_WAIT_BLOCK);
+  run_pingpong ("spin", 0, SHM_WAIT_SPIN);
+  run_pingpong ("spin_yield", 0, SHM_WAIT_SPIN_YIELD);
+  run_pingpong ("adaptive", 0, SHM_WAIT_ADAPTIVE);
+}
+
+
+// One message of the mpsc benchmark
+struct mpsc_msg {
+  uint32_t producer;
+  uint32_t seq;
+};
+
+
+// Producer side of the mpsc benchmark: push ITERATIONS numbered messages.
+static void mpsc_producer (struct shm_ring* ring, uint32_t id)
+{
+  struct mpsc_msg msg = { id, 0 };
+  uint64_t pos;
+  uint8_t* slot;
+
+  for (msg.seq = 0; msg.seq < iterations; msg.seq++) {
+    while ((slot = shm_ring_claim (ring, sizeof (msg), &pos)) == NULL)
+      shm_ring_wait_space (ring, SHM_WAIT_TIMEOUT);
+    memcpy (slot, &msg, sizeof (msg));
+    shm_ring_commit (ring, pos, sizeof (msg), SHM_RECORD_DATA);
+  }
+}
+
+
+// Run the mpsc benchmark with N_PRODUCERS producers and print its row.
+static void run_mpsc (int n_producers)
+{
+  struct shm_ring ring;
+  uint32_t next[n_producers];
+  struct mpsc_msg msg;
+  uint64_t start, total = (uint64_t) n_producers * iterations, received;
+  uint32_t len, errors = 0;
+  uint8_t* slot;
+  pid_t child;
+  int i;
+
+  map_ring (&ring);
+  memset (next, 0, sizeof (next));
+
+  start = now_ns ();
+  for (i = 0; i < n_producers; i++) {
+    child = fork ();
+    if (child == -1)
+      system_error ("bench - fork");
+    if (child == 0) {
+      mpsc_producer (&ring, i);
+      _exit (0);
+    }
+  }
+
+  for (received = 0; received < total; ) {
+    if ((slot = shm_ring_read (&ring, &len)) == NULL) {
+      shm_ring_wait_data (&ring, SHM_WAIT_TIMEOUT);
+      continue;
+    }
+    memcpy (&msg, slot, sizeof (msg));
+    shm_ring_release (&ring);
+    if (len != sizeof (msg) || msg.producer >= n_producers || msg.seq != next[msg.producer]++)
+      errors++;
+    received++;
+  }
+
+  while (wait (NULL) > 0)
+    ;
+
+  printf ("%-22d %14.0f %10u\n", n_producers, total / ((now_ns () - start) / 1e9), errors);
+  munmap (ring.hdr, shm_ring_segment_size (BENCH_RING_SLOTS, BENCH_PAYLOAD_SIZE));
+}
+
+
+// Aggregate throughput of one ring fed by several producer processes.
+static void bench_mpsc ()
+{
+  printf ("\nmpsc: messages per second through one ring, %d messages per producer\n", iterations);
+  printf ("%-22s %14s %10s\n", "producers", "msgs/s", "errors");
+  run_mpsc (1);
+  run_mpsc (2);
+  run_mpsc (4);
+}
+
+
+// What a broadcast reader reports back
+struct bcast_result {
+  uint32_t received;
+  uint32_t errors;
+  uint64_t lost;
+};
+
+
+// Reader side of the broadcast benchmark: read until the zero length end marker
+// and check the messages arrive in order, apart from those lost while dropped.
+// A SLOW reader naps for 20 ms every 64 messages.
+static void bcast_reader (struct shm_ring* ring, struct bcast_result* result, int slow)
+{
+  const struct shm_record_hdr* rec;
+  uint32_t len, seq, next = 0;
+  uint64_t overwritten = 0;
+
+  if (shm_ring_join (ring) == -1)
+    system_error ("bench - shm_ring_join");
+
+  for ( ;; ) {
+    if ((rec = shm_ring_read_record (ring)) == NULL) {
+      shm_ring_wait_data (ring, SHM_WAIT_TIMEOUT);
+      continue;
+    }
+    len = rec->len;
+    memcpy (&seq, shm_ring_record_payload (ring, rec), sizeof (seq));
+    // A record the producer wrote over while we read it counts as lost.
+    if (!shm_ring_valid (ring, rec)) {
+      shm_ring_release (ring);
+      overwritten++;
+      continue;
+    }
+    shm_ring_release (ring);
+    if (len == 0)
+      break;
+    if (seq < next || (ring->lost + overwritten == 0 && seq != next))
+      result->errors++;
+    next = seq + 1;
+    result->received++;
+    if (slow && result->received % 64 == 0)
+      better_sleep (0.02);
+  }
+  result->lost = ring->lost + overwritten;
+  shm_ring_leave (ring);
+}
+
+
+// Run the broadcast benchmark with N_READERS readers, plus a slow one if WITH_LAGGARD.
+static void run_broadcast (int n_readers, int with_laggard)
+{
+  struct shm_ring ring;
+  struct bcast_result* results;
+  int n = n_readers + with_laggard, joined, i;
+  uint64_t start;
+  uint32_t seq;
+  uint8_t* slot;
+  pid_t child;
+
+  map_ring (&ring);
+  ring.drop_laggards = with_laggard;
+  results = mmap (NULL, n * sizeof (*results), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (results == MAP_FAILED)
+    system_error ("bench - mmap");
+  memset (results, 0, n * sizeof (*results));
+
+  for (i = 0; i < n; i++) {
+    child = fork ();
+    if (child == -1)
+      system_error ("bench - fork");
+    if (child == 0) {
+      bcast_reader (&ring, &results[i], i >= n_readers);
+      _exit (0);
+    }
+  }
+
+  // Start once every reader has joined, so each one sees the whole stream.
+  for ( ;; ) {
+    for (i = 0, joined = 0; i < SHM_RING_MAX_READERS; i++)
+      joined += ring.hdr->readers[i].state != 0;
+    if (joined == n)
+      break;
+    better_sleep (0.001);
+  }
+
+  start = now_ns ();
+  for (seq = 0; seq <= iterations; seq++) {
+    while ((slot = shm_ring_reserve (&ring, sizeof (seq))) == NULL)
+      shm_ring_wait_space (&ring, SHM_WAIT_TIMEOUT);
+    memcpy (slot, &seq, sizeof (seq));
+    // The last message is the zero length end marker.
+    shm_ring_publish (&ring, seq < iterations ? sizeof (seq) : 0, SHM_RECORD_DATA);
+  }
+  while (wait (NULL) > 0)
+    ;
+
+  for (i = 0; i < n; i++) {
+    printf ("%-10d %-10s %14.0f %10u %10llu\n", n_readers, i < n_readers ? "reader" : "laggard",
+            results[i].received / ((now_ns () - start) / 1e9), results[i].errors,
+            (unsigned long long) results[i].lost);
+  }
+  munmap (results, n * sizeof (*results));
+  munmap (ring.hdr, shm_ring_segment_size (BENCH_RING_SLOTS, BENCH_PAYLOAD_SIZE));
+}
+
+
+// One writer, many readers which each see every message.
+static void bench_broadcast ()
+{
+  printf ("\nbroadcast: messages per second seen by each reader, %d messages\n", iterations);
+  printf ("%-10s %-10s %14s %10s %10s\n", "readers", "role", "msgs/s", "errors", "lost");
+  run_broadcast (1, 0);
+  run_broadcast (2, 0);
+  run_broadcast (4, 0);
+  run_broadcast (2, 1);
+}
+
+
+// Stream ITERATIONS records of SIZE bytes from a child process through one ring and
+// print the row. Every record carries its number in its first and last bytes. Sizes
+// which don't divide the ring make records wrap around its end.
+static void run_record (uint32_t size)
+{
+  struct shm_ring ring;
+  const struct shm_record_hdr* rec;
+  uint64_t start, seq, got;
+  uint32_t errors = 0, first, last;
+  uint8_t* payload;
+  double elapsed;
+  pid_t child;
+
+  map_ring_slots (&ring, BENCH_RECORD_SLOTS);
+
+  start = now_ns ();
+  child = fork ();
+  if (child == -1)
+    system_error ("bench - fork");
+  if (child == 0) {
+    for (seq = 0; seq < iterations; seq++) {
+      while ((payload = shm_ring_reserve (&ring, size)) == NULL)
+        shm_ring_wait_space (&ring, SHM_WAIT_TIMEOUT);
+      first = seq;
+      memset (payload, (int) seq, size);
+      memcpy (payload, &first, sizeof (first));
+      memcpy (payload + size - sizeof (first), &first, sizeof (first));
+      shm_ring_publish (&ring, size, SHM_RECORD_DATA + (seq & 1));
+    }
+    _exit (0);
+  }
+
+  for (got = 0; got < iterations; ) {
+    if ((rec = shm_ring_read_record (&ring)) == NULL) {
+      shm_ring_wait_data (&ring, SHM_WAIT_TIMEOUT);
+      continue;
+    }
+    payload = shm_ring_record_payload (&ring, rec);
+    memcpy (&first, payload, sizeof (first));
+    memcpy (&last, payload + rec->len - sizeof (last), sizeof (last));
+    if (rec->len != size || rec->type != SHM_RECORD_DATA + (got & 1) || first != got || last != got)
+      errors++;
+    shm_ring_release (&ring);
+    got++;
+  }
+  waitpid (child, NULL, 0);
+  elapsed = (now_ns () - start) / 1e9;
+
+  printf ("%-22u %14.0f %14.1f %10u %10u\n", size, iterations / elapsed,
+          iterations * (double) size / elapsed / 1e6,
+          (size + BENCH_PAYLOAD_SIZE - 1) / BENCH_PAYLOAD_SIZE, errors);
+  munmap (ring.hdr, shm_ring_segment_size (BENCH_RECORD_SLOTS, BENCH_PAYLOAD_SIZE));
+}
+
+
+// Throughput of variable length records, from a few bytes up to the largest.
+static void bench_record ()
+{
+  printf ("\nrecord: records per second through one ring of %d slots of %d bytes, %d records\n",
+          BENCH_RECORD_SLOTS, BENCH_PAYLOAD_SIZE, iterations);
+  printf ("%-22s %14s %14s %10s %10s\n", "record bytes", "records/s", "MB/s", "slots", "errors");
+  run_record (16);
+  run_record (300);
+  run_record (5000);
+  run_record (SHM_MAX_RECORD);
+}
+
+
+// Send ITERATIONS chunks over a stream socket, BATCH chunks per call, and print the row.
+static void run_batch (int batch)
+{
+  static uint8_t chunks[64][BENCH_CHUNK_SIZE];
+  static uint8_t sink[64 * BENCH_CHUNK_SIZE];
+  struct iovec iov[64];
+  struct msghdr msg;
+  uint64_t start, total = (uint64_t) iterations * BENCH_CHUNK_SIZE, got;
+  double elapsed, cpu;
+  ssize_t n;
+  int sv[2], i, sent;
+  pid_t child;
+
+  if (socketpair (AF_UNIX, SOCK_STREAM, 0, sv) == -1)
+    system_error ("bench - socketpair");
+
+  child = fork ();
+  if (child == -1)
+    system_error ("bench - fork");
+  if (child == 0) {
+    close (sv[0]);
+    for (got = 0; got < total; got += n)
+      if ((n = read (sv[1], sink, sizeof (sink))) <= 0)
+        _exit (1);
+    _exit (0);
+  }
+  close (sv[1]);
+
+  for (i = 0; i < batch; i++) {
+    iov[i].iov_base = chunks[i];
+    iov[i].iov_len = BENCH_CHUNK_SIZE;
+  }
+  memset (&msg, 0, sizeof (msg));
+  msg.msg_iov = iov;
+
+  cpu = cpu_time ();
+  start = now_ns ();
+  for (sent = 0; sent < iterations; sent += msg.msg_iovlen) {
+    msg.msg_iovlen = iterations - sent < batch ? iterations - sent : batch;
+    if (batch == 1)
+      n = send (sv[0], chunks[0], BENCH_CHUNK_SIZE, 0);
+    else
+      n = sendmsg (sv[0], &msg, 0);
+    // A blocking stream socket only sends short when interrupted.
+    if (n != (ssize_t) msg.msg_iovlen * BENCH_CHUNK_SIZE)
+      system_error ("bench - send");
+  }
+  close (sv[0]);
+  waitpid (child, NULL, 0);
+  elapsed = (now_ns () - start) / 1e9;
+
+  printf ("%-22d %14.0f %14.0f\n", batch, iterations / elapsed,
+          (cpu_time () - cpu) * 1e9 / iterations);
+}
+
+
+// Cost of one send per chunk against one sendmsg per batch of chunks.
+static void bench_batch ()
+{
+  printf ("\nbatch: %d byte chunks per second over a stream socket, %d chunks\n",
+          BENCH_CHUNK_SIZE, iterations);
+  printf ("%-22s %14s %14s\n", "chunks per call", "chunks/s", "sender cpu ns");
+  run_batch (1);
+  run_batch (4);
+  run_batch (16);
+  run_batch (64);
+}
+
+
+// Connect to the sink of the zerocopy benchmark: sink_address, or else a child
+// process reading on a loopback port, whose pid goes to CHILD (0 otherwise).
+static int zc_connect (pid_t* child)
+{
+  struct sockaddr_in addr;
+  socklen_t len = sizeof (addr);
+  char host[64];
+  const char* colon;
+  static char sink[256 * 1024];
+  int fd, lfd, cfd;
+
+  memset (&addr, 0, sizeof (addr));
+  addr.sin_family = AF_INET;
+  *child = 0;
+  if (sink_address != NULL) {
+    colon = strrchr (sink_address, ':');
+    if (colon == NULL || colon - sink_address >= (int) sizeof (host))
+      print_usage (1);
+    memcpy (host, sink_address, colon - sink_address);
+    host[colon - sink_address] = '\0';
+    addr.sin_port = htons (atoi (colon + 1));
+    if (inet_pton (AF_INET, host, &addr.sin_addr) != 1)
+      print_usage (1);
+  }
+  else {
+    addr.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+    if ((lfd = socket (AF_INET, SOCK_STREAM, 0)) == -1 ||
+        bind (lfd, (struct sockaddr*) &addr, sizeof (addr)) == -1 || listen (lfd, 1) == -1 ||
+        getsockname (lfd, (struct sockaddr*) &addr, &len) == -1)
+      system_error ("bench - sink socket");
+    *child = fork ();
+    if (*child == -1)
+      system_error ("bench - fork");
+    if (*child == 0) {
+      if ((cfd = accept (lfd, NULL, NULL)) == -1)
+        _exit (1);
+      while (read (cfd, sink, sizeof (sink)) > 0)
+        ;
+      _exit (0);
+    }
+    close (lfd);
+  }
+
+  if ((fd = socket (AF_INET, SOCK_STREAM, 0)) == -1 ||
+      connect (fd, (struct sockaddr*) &addr, sizeof (addr)) == -1)
+    system_error ("bench - connect to the sink");
+  return fd;
+}
+
+
+// Read the zero-copy completions queued on FD. Returns how many sends they cover and
+// adds those the kernel copied after all to *COPIED.
+static uint32_t zc_reap (int fd, uint64_t* copied)
+{
+  char control[128];
+  struct msghdr msg;
+  struct cmsghdr* cm;
+  struct sock_extended_err* serr;
+  uint32_t done = 0;
+
+  for (;;) {
+    memset (&msg, 0, sizeof (msg));
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof (control);
+    if (recvmsg (fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) == -1)
+      return done;
+    for (cm = CMSG_FIRSTHDR (&msg); cm != NULL; cm = CMSG_NXTHDR (&msg, cm)) {
+      serr = (struct sock_extended_err*) CMSG_DATA (cm);
+      if (cm->cmsg_level != SOL_IP || cm->cmsg_type != IP_RECVERR ||
+          serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY || serr->ee_errno != 0)
+        continue;
+      done += serr->ee_data - serr->ee_info + 1;
+      if (serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+        *copied += serr->ee_data - serr->ee_info + 1;
+    }
+  }
+}
+
+
+// Send chunks of SIZE bytes over TCP to the sink, with MSG_ZEROCOPY if ZC, and print
+// the row: throughput, sender CPU per chunk, and the share of zero-copy sends the
+// kernel had to copy.
+static void run_zerocopy (uint32_t size, int zc)
+{
+  uint64_t count = iterations, i, sent = 0, done = 0, copied = 0;
+  uint64_t start;
+  double elapsed, cpu;
+  struct pollfd pfd;
+  uint8_t* bufs;
+  ssize_t n;
+  size_t off;
+  pid_t child;
+  int fd, on = 1;
+
+  if ((uint64_t) count * size > BENCH_ZC_BYTES)
+    count = BENCH_ZC_BYTES / size;
+  bufs = mmap (NULL, (size_t) BENCH_ZC_BUFFERS * size, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (bufs == MAP_FAILED)
+    system_error ("bench - mmap");
+  memset (bufs, 0x5A, (size_t) BENCH_ZC_BUFFERS * size);
+
+  fd = zc_connect (&child);
+  if (zc && setsockopt (fd, SOL_SOCKET, SO_ZEROCOPY, &on, sizeof (on)) == -1) {
+    printf ("%-10u %-10s SO_ZEROCOPY not supported: %s\n", size, "zerocopy", strerror (errno));
+    close (fd);
+    if (child != 0)
+      waitpid (child, NULL, 0);
+    munmap (bufs, (size_t) BENCH_ZC_BUFFERS * size);
+    return;
+  }
+
+  cpu = cpu_time ();
+  start = now_ns ();
+  for (i = 0; i < count; i++) {
+    // Wait for the kernel to let go of the buffer about to be reused.
+    while (zc && sent - done >= BENCH_ZC_BUFFERS) {
+      pfd.fd = fd;
+      pfd.events = 0;
+      poll (&pfd, 1, -1);
+      done += zc_reap (fd, &copied);
+    }
+    for (off = 0; off < size; off += n) {
+      n = send (fd, bufs + (i % BENCH_ZC_BUFFERS) * size + off, size - off, zc ? MSG_ZEROCOPY : 0);
+      if (n == -1 && errno == ENOBUFS) {
+        // Out of option memory for the notifications: reap some first.
+        done += zc_reap (fd, &copied);
+        n = 0;
+        continue;
+      }
+      if (n <= 0)
+        system_error ("bench - send");
+      if (zc)
+        sent++;
+    }
+  }
+  while (zc && done < sent) {
+    pfd.fd = fd;
+    pfd.events = 0;
+    poll (&pfd, 1, -1);
+    done += zc_reap (fd, &copied);
+  }
+  close (fd);
+  if (child != 0)
+    waitpid (child, NULL, 0);
+  elapsed = (now_ns () - start) / 1e9;
+  cpu = cpu_time () - cpu;
+
+  if (zc)
+    printf ("%-10u %-10s %12.0f %14.0f %12.0f%%\n", size, "zerocopy", count * size / elapsed / 1e6,
+            cpu * 1e9 / count, sent > 0 ? 100.0 * copied / sent : 0.0);
+  else
+    printf ("%-10u %-10s %12.0f %14.0f %13s\n", size, "copy", count * size / elapsed / 1e6,
+            cpu * 1e9 / count, "-");
+  munmap (bufs, (size_t) BENCH_ZC_BUFFERS * size);
+}
+
+
+// Plain send against MSG_ZEROCOPY for growing chunk sizes.
+static void bench_zerocopy ()
+{
+  static const uint32_t sizes[] = { 4096, 16384, 32768, 65536, 262144 };
+  unsigned i;
+
+  printf ("\nzerocopy: TCP send to %s, %d chunks (at most %llu MB) per row\n",
+          sink_address != NULL ? sink_address : "a loopback child", iterations,
+          (unsigned long long) (BENCH_ZC_BYTES >> 20));
+  printf ("%-10s %-10s %12s %14s %13s\n", "bytes", "mode", "MB/s", "sender cpu ns", "copied");
+  for (i = 0; i < sizeof (sizes) / sizeof (sizes[0]); i++) {
+    run_zerocopy (sizes[i], 0);
+    run_zerocopy (sizes[i], 1);
+  }
+}
+
+
+// Connect a loopback TCP pair for the uring benchmark and return the receiving end.
+// A child process, whose pid goes to CHILD, writes COUNT framed messages of SIZE
+// bytes into the other end as fast as it can, one per write (with TCP_NODELAY) if
+// SINGLE, else as many as fit into BENCH_URING_WRITE bytes.
+static int uring_pair (uint32_t size, uint64_t count, int single, pid_t* child)
+{
+  static uint8_t chunk[BENCH_URING_WRITE + ISC_FRAME_HDR_SIZE + BENCH_URING_BUF_SIZE];
+  struct sockaddr_in addr;
+  socklen_t len = sizeof (addr);
+  uint32_t per_write = BENCH_URING_WRITE / (ISC_FRAME_HDR_SIZE + size), k;
+  uint64_t sent;
+  size_t off;
+  ssize_t n;
+  int lfd, fd, on = 1;
+
+  if (per_write == 0 || single)
+    per_write = 1;
+  memset (&addr, 0, sizeof (addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+  if ((lfd = socket (AF_INET, SOCK_STREAM, 0)) == -1 ||
+      bind (lfd, (struct sockaddr*) &addr, sizeof (addr)) == -1 || listen (lfd, 1) == -1 ||
+      getsockname (lfd, (struct sockaddr*) &addr, &len) == -1)
+    system_error ("bench - listening socket");
+
+  *child = fork ();
+  if (*child == -1)
+    system_error ("bench - fork");
+  if (*child == 0) {
+    close (lfd);
+    if ((fd = socket (AF_INET, SOCK_STREAM, 0)) == -1 ||
+        connect (fd, (struct sockaddr*) &addr, sizeof (addr)) == -1 ||
+        (single && setsockopt (fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof (on)) == -1))
+      _exit (1);
+    memset (chunk, 0x5A, sizeof (chunk));
+    for (sent = 0; sent < count; sent += k) {
+      k = count - sent < per_write ? count - sent : per_write;
+      for (off = 0; off < k; off++)
+        isc_frame_encode ((struct isc_frame_hdr*) (chunk + off * (ISC_FRAME_HDR_SIZE + size)),
+                          size, ISC_CHANNEL_DATA, 0, sent + off);
+      for (off = 0; off < k * (ISC_FRAME_HDR_SIZE + size); off += n)
+        if ((n = write (fd, chunk + off, k * (ISC_FRAME_HDR_SIZE + size) - off)) <= 0)
+          _exit (1);
+    }
+    _exit (0);
+  }
+
+  if ((fd = accept (lfd, NULL, NULL)) == -1)
+    system_error ("bench - accept");
+  close (lfd);
+  return fd;
+}
+
+
+// Read BYTES from FD the way sckt_server does: wait with epoll, then recv until the
+// socket is drained. Returns the system calls made.
+static uint64_t recv_epoll (int fd, uint64_t bytes)
+{
+  static uint8_t buf[2 * (ISC_FRAME_HDR_SIZE + ISC_FRAME_MAX)];
+  struct epoll_event ev;
+  uint64_t got = 0, calls = 0;
+  ssize_t n;
+  int epfd;
+
+  if ((epfd = epoll_create (1)) == -1)
+    system_error ("bench - epoll_create");
+  ev.events = EPOLLIN | EPOLLET;
+  ev.data.fd = fd;
+  if (epoll_ctl (epfd, EPOLL_CTL_ADD, fd, &ev) == -1)
+    system_error ("bench - epoll_ctl");
+
+  while (got < bytes) {
+    calls++;
+    if (epoll_wait (epfd, &ev, 1, -1) == -1 && errno != EINTR)
+      system_error ("bench - epoll_wait");
+    // Drain the socket; the sender closes it after the last message.
+    while (got < bytes) {
+      calls++;
+      if ((n = recv (fd, buf, sizeof (buf), MSG_DONTWAIT)) > 0)
+        got += n;
+      else if (n == -1 && (errno == EAGAIN || errno == EINTR))
+        break;
+      else
+        system_error ("bench - recv");
+    }
+  }
+  close (epfd);
+  return calls;
+}
+
+
+// Read BYTES from FD the way uring_server does: through a multishot receive into a
+// ring of provided buffers, one io_uring_enter per round of completions. Returns the
+// system calls made.
+static uint64_t recv_uring (int fd, uint64_t bytes)
+{
+  struct uring ring;
+  struct io_uring_buf_ring* br;
+  struct io_uring_sqe* sqe;
+  struct io_uring_cqe* cqe;
+  uint8_t* bufs;
+  uint64_t got = 0;
+  unsigned returned, i;
+  int bid;
+  bool armed = false;
+
+  if (uring_init (&ring, 64, IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN) == -1 &&
+      uring_init (&ring, 64, 0) == -1)
+    system_error ("bench - io_uring setup");
+  if (uring_register (&ring, IORING_REGISTER_FILES, &fd, 1) == -1)
+    system_error ("bench - io_uring fixed file");
+  bufs = xmalloc ((size_t) BENCH_URING_BUFS * BENCH_URING_BUF_SIZE);
+  if ((br = uring_buf_ring_setup (&ring, BENCH_URING_BUFS, 0)) == NULL)
+    system_error ("bench - io_uring buffer ring");
+  for (i = 0; i < BENCH_URING_BUFS; i++)
+    uring_buf_ring_add (br, BENCH_URING_BUFS, bufs + (size_t) i * BENCH_URING_BUF_SIZE,
+                        BENCH_URING_BUF_SIZE, i, i);
+  uring_buf_ring_advance (br, BENCH_URING_BUFS);
+
+  while (got < bytes) {
+    if (!armed) {
+      sqe = uring_get_sqe (&ring);
+      sqe->opcode = IORING_OP_RECV;
+      sqe->fd = 0;
+      sqe->flags = IOSQE_FIXED_FILE | IOSQE_BUFFER_SELECT;
+      sqe->ioprio = IORING_RECV_MULTISHOT;
+      sqe->buf_group = 0;
+      armed = true;
+    }
+    if (uring_submit (&ring, 1, -1) == -1)
+      system_error ("bench - io_uring_enter");
+    for (returned = 0; (cqe = uring_peek_cqe (&ring)) != NULL; uring_cqe_seen (&ring)) {
+      if (!(cqe->flags & IORING_CQE_F_MORE))
+        armed = false;
+      if (cqe->res == 0 && got >= bytes)
+        break;
+      if (cqe->res == 0 || (cqe->res < 0 && cqe->res != -ENOBUFS)) {
+        errno = -cqe->res;
+        system_error ("bench - io_uring receive");
+      }
+      if (cqe->res > 0)
+        got += cqe->res;
+      if (cqe->flags & IORING_CQE_F_BUFFER) {
+        bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+        uring_buf_ring_add (br, BENCH_URING_BUFS, bufs + (size_t) bid * BENCH_URING_BUF_SIZE,
+                            BENCH_URING_BUF_SIZE, bid, returned++);
+      }
+    }
+    uring_buf_ring_advance (br, returned);
+  }
+  uring_exit (&ring);
+  uring_buf_ring_free (br, BENCH_URING_BUFS);
+  free (bufs);
+  return ring.enters;
+}
+
+
+// Receive framed messages of SIZE bytes, sent one per write if SINGLE, with epoll
+// or, if URING, with io_uring and print the row: message rate, and receiver system
+// calls and CPU per message.
+static void run_uring (uint32_t size, int single, int uring)
+{
+  uint64_t count = iterations, calls, start;
+  double elapsed, cpu;
+  pid_t child;
+  int fd;
+
+  fd = uring_pair (size, count, single, &child);
+  cpu = cpu_time ();
+  start = now_ns ();
+  if (uring)
+    calls = recv_uring (fd, count * (ISC_FRAME_HDR_SIZE + size));
+  else
+    calls = recv_epoll (fd, count * (ISC_FRAME_HDR_SIZE + size));
+  elapsed = (now_ns () - start) / 1e9;
+  cpu = cpu_time () - cpu;
+  close (fd);
+  waitpid (child, NULL, 0);
+
+  printf ("%-10u %-10s %-8s %14.0f %18.3f %16.0f\n", size, single ? "1" : "batched",
+          uring ? "uring" : "epoll", count / elapsed,
+          (double) calls / count, cpu * 1e9 / count);
+}
+
+
+// epoll and recv against a multishot io_uring receive, for growing message sizes.
+static void bench_uring ()
+{
+  static const uint32_t sizes[] = { 64, 512, 4096, 16384 };
+  unsigned i;
+  int single;
+
+  printf ("\nuring: framed messages received over loopback TCP, %d messages per row\n", iterations);
+  printf ("%-10s %-10s %-8s %14s %18s %16s\n", "bytes", "per write", "mode", "messages/s",
+          "syscalls/message", "receiver cpu ns");
+  for (i = 0; i < sizeof (sizes) / sizeof (sizes[0]); i++) {
+    for (single = 1; single >= 0; single--) {
+      run_uring (sizes[i], single, 0);
+      run_uring (sizes[i], single, 1);
+    }
+  }
+}
+
+
+// Exchange datagrams of SIZE bytes over a loopback UDP socket pair, BENCH_UDP_BATCH
+// at a time: sent one sendto each and read one recv each or, if MMSG, sent with one
+// sendmmsg and read with one recvmmsg per batch, as the sckt modules do with udp.
+// Prints the row: datagram rate, system calls and CPU per datagram, and losses.
+static void run_udp (uint32_t size, int mmsg)
+{
+  static uint8_t bufs[BENCH_UDP_BATCH][ISC_DGRAM_MAX_MTU];
+  struct mmsghdr msgs[BENCH_UDP_BATCH];
+  struct iovec iov[BENCH_UDP_BATCH];
+  struct sockaddr_in addr;
+  socklen_t len = sizeof (addr);
+  uint64_t count = iterations, sent = 0, got = 0, calls = 0, start;
+  double elapsed, cpu;
+  int rfd, sfd, i, k, n;
+
+  memset (&addr, 0, sizeof (addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+  if ((rfd = socket (AF_INET, SOCK_DGRAM, 0)) == -1 ||
+      bind (rfd, (struct sockaddr*) &addr, sizeof (addr)) == -1 ||
+      getsockname (rfd, (struct sockaddr*) &addr, &len) == -1 ||
+      (sfd = socket (AF_INET, SOCK_DGRAM, 0)) == -1 ||
+      connect (sfd, (struct sockaddr*) &addr, sizeof (addr)) == -1)
+    system_error ("bench - udp sockets");
+
+  memset (msgs, 0, sizeof (msgs));
+  for (i = 0; i < BENCH_UDP_BATCH; i++) {
+    memset (bufs[i], 0x5A, size);
+    iov[i].iov_base = bufs[i];
+    msgs[i].msg_hdr.msg_iov = &iov[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+  }
+
+  cpu = cpu_time ();
+  start = now_ns ();
+  while (sent < count) {
+    k = count - sent < BENCH_UDP_BATCH ? count - sent : BENCH_UDP_BATCH;
+    for (i = 0; i < k; i++)
+      iov[i].iov_len = size;
+    if (mmsg) {
+      calls++;
+      if (sendmmsg (sfd, msgs, k, 0) != k)
+        system_error ("bench - sendmmsg");
+    }
+    else {
+      for (i = 0; i < k; i++, calls++)
+        if (send (sfd, bufs[i], size, 0) != size)
+          system_error ("bench - send");
+    }
+    sent += k;
+
+    // Loopback delivers at once; whatever isn't there now was lost.
+    for (i = 0; i < k; i++)
+      iov[i].iov_len = sizeof (bufs[i]);
+    if (mmsg) {
+      for (i = 0; i < k; i += n, calls++)
+        if ((n = recvmmsg (rfd, msgs + i, k - i, MSG_DONTWAIT, NULL)) <= 0)
+          break;
+      got += i;
+    }
+    else {
+      for (i = 0; i < k; i++, calls++)
+        if (recv (rfd, bufs[i], sizeof (bufs[i]), MSG_DONTWAIT) <= 0)
+          break;
+      got += i;
+    }
+  }
+  elapsed = (now_ns () - start) / 1e9;
+  cpu = cpu_time () - cpu;
+  close (sfd);
+  close (rfd);
+
+  printf ("%-10u %-12s %14.0f %19.3f %14.0f %10llu\n", size, mmsg ? "sendmmsg" : "send",
+          count / elapsed, (double) calls / count, cpu * 1e9 / count,
+          (unsigned long long) (count - got));
+}
+
+
+// One system call per datagram against sendmmsg and recvmmsg batches, for datagrams
+// up to the payload of a 1500 byte MTU.
+static void bench_udp ()
+{
+  static const uint32_t sizes[] = { 64, 512, 1500 - ISC_DGRAM_OVERHEAD };
+  unsigned i;
+
+  printf ("\nudp: datagrams over loopback, %d per row, %d per batch\n", iterations, BENCH_UDP_BATCH);
+  printf ("%-10s %-12s %14s %19s %14s %10s\n", "bytes", "mode", "datagrams/s",
+          "syscalls/datagram", "cpu ns", "lost");
+  for (i = 0; i < sizeof (sizes) / sizeof (sizes[0]); i++) {
+    run_udp (sizes[i], 0);
+    run_udp (sizes[i], 1);
+  }
+}
+
+
+// The transports of the unix benchmark: loopback TCP as sckt uses it, SOCK_SEQPACKET
+// as unix uses it, and SOCK_SEQPACKET with the payload in a memfd shared by both ends
+enum unix_mode { UNIX_TCP, UNIX_SEQPACKET, UNIX_SHARED };
+static const char* const unix_mode_names[] = { "tcp", "seqpacket", "shared" };
+
+// A buffer shared by the two processes of the unix benchmark, laid out as the one
+// unix_client hands to unix_server: the head, then SIZE bytes of data. POS is where
+// the sender puts the next message.
+struct unix_shared {
+  uint8_t* mem;
+  size_t size;
+  uint64_t pos;
+};
+
+
+// Connect a pair of sockets for MODE: a loopback TCP connection with TCP_NODELAY, or
+// a SOCK_SEQPACKET socket pair.
+static void unix_pair (enum unix_mode mode, int fds[2])
+{
+  struct sockaddr_in addr;
+  socklen_t len = sizeof (addr);
+  int lfd, on = 1;
+
+  if (mode != UNIX_TCP) {
+    if (socketpair (AF_UNIX, SOCK_SEQPACKET, 0, fds) == -1)
+      system_error ("bench - socketpair");
+    return;
+  }
+  memset (&addr, 0, sizeof (addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+  if ((lfd = socket (AF_INET, SOCK_STREAM, 0)) == -1 ||
+      bind (lfd, (struct sockaddr*) &addr, sizeof (addr)) == -1 || listen (lfd, 1) == -1 ||
+      getsockname (lfd, (struct sockaddr*) &addr, &len) == -1 ||
+      (fds[0] = socket (AF_INET, SOCK_STREAM, 0)) == -1 ||
+      connect (fds[0], (struct sockaddr*) &addr, sizeof (addr)) == -1 ||
+      (fds[1] = accept (lfd, NULL, NULL)) == -1)
+    system_error ("bench - tcp pair");
+  close (lfd);
+  setsockopt (fds[0], IPPROTO_TCP, TCP_NODELAY, &on, sizeof (on));
+  setsockopt (fds[1], IPPROTO_TCP, TCP_NODELAY, &on, sizeof (on));
+}
+
+
+// Send K messages of SIZE bytes from PAYLOAD over FD as MODE does, numbered from SEQ:
+// one sendmsg of headers and payloads over TCP, one sendmmsg of packets otherwise.
+// In the shared buffer SH, a message goes where unix_client would put it, or inline
+// while there is no room.
+static void unix_send (int fd, enum unix_mode mode, const uint8_t* payload, uint32_t size,
+                       uint64_t seq, int k, struct unix_shared* sh)
+{
+  static struct isc_frame_hdr hdr[BENCH_UDP_BATCH];
+  static struct isc_shared_ref ref[BENCH_UDP_BATCH];
+  static struct iovec iov[BENCH_UDP_BATCH][2];
+  struct mmsghdr msgs[BENCH_UDP_BATCH];
+  struct msghdr msg;
+  uint64_t pos, head;
+  int i, n;
+
+  memset (msgs, 0, sizeof (msgs));
+  for (i = 0; i < k; i++) {
+    iov[i][0].iov_base = &hdr[i];
+    iov[i][0].iov_len = ISC_FRAME_HDR_SIZE;
+    iov[i][1].iov_base = (void*) payload;
+    iov[i][1].iov_len = size;
+    isc_frame_encode (&hdr[i], size, ISC_CHANNEL_DATA, 0, seq + i);
+    if (mode == UNIX_SHARED) {
+      pos = sh->pos;
+      if (pos % sh->size + size > sh->size)
+        pos += sh->size - pos % sh->size;
+      head = __atomic_load_n (&((struct isc_shared_hdr*) sh->mem)->head, __ATOMIC_ACQUIRE);
+      if (pos + size - head <= sh->size) {
+        memcpy (sh->mem + ISC_SHARED_DATA + pos % sh->size, payload, size);
+        ref[i].pos = htobe64 (pos);
+        ref[i].len = htobe32 (size);
+        isc_frame_encode (&hdr[i], sizeof (ref[i]), ISC_CHANNEL_DATA, ISC_FLAG_SHARED, seq + i);
+        iov[i][1].iov_base = &ref[i];
+        iov[i][1].iov_len = sizeof (ref[i]);
+        sh->pos = pos + size;
+      }
+    }
+    msgs[i].msg_hdr.msg_iov = iov[i];
+    msgs[i].msg_hdr.msg_iovlen = 2;
+  }
+
+  if (mode == UNIX_TCP) {
+    memset (&msg, 0, sizeof (msg));
+    msg.msg_iov = iov[0];
+    msg.msg_iovlen = 2 * k;
+    if (sendmsg (fd, &msg, 0) != (ssize_t) k * (ISC_FRAME_HDR_SIZE + size))
+      system_error ("bench - sendmsg");
+    return;
+  }
+  for (i = 0; i < k; i += n)
+    if ((n = sendmmsg (fd, msgs + i, k - i, 0)) <= 0)
+      system_error ("bench - sendmmsg");
+}
+
+
+// Read COUNT messages of SIZE bytes from FD as the MODE server does and copy each
+// payload to DST, as a server hands it on: a stream read in large chunks over TCP,
+// packets read with recvmmsg otherwise, taking a shared payload from SH and moving
+// its head on. Returns the system calls made.
+static uint64_t unix_receive (int fd, enum unix_mode mode, uint32_t size, uint64_t count,
+                              struct unix_shared* sh, uint8_t* dst)
+{
+  static uint8_t bufs[BENCH_UDP_BATCH][ISC_FRAME_HDR_SIZE + ISC_FRAME_MAX];
+  struct mmsghdr msgs[BENCH_UDP_BATCH];
+  struct iovec iov[BENCH_UDP_BATCH];
+  struct isc_frame_hdr hdr;
+  struct isc_shared_ref ref;
+  uint64_t bytes = count * (ISC_FRAME_HDR_SIZE + size), got = 0, calls = 0;
+  uint8_t* payload;
+  ssize_t n;
+  int i;
+
+  if (mode == UNIX_TCP) {
+    // Split the stream into frames; a partial one moves to the front for the next read.
+    uint8_t* buf = bufs[0];
+    size_t fill = 0, off;
+
+    while (got < bytes) {
+      calls++;
+      if ((n = recv (fd, buf + fill, sizeof (bufs) - fill, 0)) <= 0)
+        system_error ("bench - recv");
+      fill += n;
+      for (off = 0; fill - off >= ISC_FRAME_HDR_SIZE; off += ISC_FRAME_HDR_SIZE + hdr.len) {
+        isc_frame_decode (buf + off, &hdr);
+        if (fill - off < ISC_FRAME_HDR_SIZE + hdr.len)
+          break;
+        memcpy (dst, buf + off + ISC_FRAME_HDR_SIZE, hdr.len);
+        got += ISC_FRAME_HDR_SIZE + hdr.len;
+      }
+      memmove (buf, buf + off, fill - off);
+      fill -= off;
+    }
+    return calls;
+  }
+
+  memset (msgs, 0, sizeof (msgs));
+  for (i = 0; i < BENCH_UDP_BATCH; i++) {
+    iov[i].iov_base = bufs[i];
+    iov[i].iov_len = sizeof (bufs[i]);
+    msgs[i].msg_hdr.msg_iov = &iov[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+  }
+  while (count > 0) {
+    calls++;
+    if ((n = recvmmsg (fd, msgs, count < BENCH_UDP_BATCH ? count : BENCH_UDP_BATCH, MSG_WAITFORONE, NULL)) <= 0)
+      system_error ("bench - recvmmsg");
+    for (i = 0; i < n; i++) {
+      isc_frame_decode (bufs[i], &hdr);
+      payload = bufs[i] + ISC_FRAME_HDR_SIZE;
+      if (hdr.flags & ISC_FLAG_SHARED) {
+        memcpy (&ref, payload, sizeof (ref));
+        ref.pos = be64toh (ref.pos);
+        ref.len = be32toh (ref.len);
+        memcpy (dst, sh->mem + ISC_SHARED_DATA + ref.pos % sh->size, ref.len);
+        __atomic_store_n (&((struct isc_shared_hdr*) sh->mem)->head, ref.pos + ref.len, __ATOMIC_RELEASE);
+      }
+      else
+        memcpy (dst, payload, hdr.len);
+    }
+    count -= n;
+  }
+  return calls;
+}
+
+
+// Stream messages of SIZE bytes from a child process over MODE, and ping-pong one
+// at a time, answered by a bare frame header. Prints the row: message rate and
+// throughput, receiver system calls per message, and round trip times in ns.
+static void run_unix (uint32_t size, enum unix_mode mode)
+{
+  static uint8_t payload[ISC_FRAME_MAX], dst[ISC_FRAME_MAX + ISC_FRAME_HDR_SIZE];
+  struct unix_shared sh;
+  struct isc_frame_hdr ack;
+  uint64_t count = iterations, rounds = iterations / 10, sent, calls, start, *samples;
+  double elapsed, sum = 0;
+  pid_t child;
+  int fds[2], memfd = -1, k;
+
+  if ((uint64_t) count * size > BENCH_ZC_BYTES)
+    count = BENCH_ZC_BYTES / size;
+  if (rounds == 0)
+    rounds = 1;
+  samples = xmalloc (rounds * sizeof (samples[0]));
+  memset (payload, 0x5A, sizeof (payload));
+  memset (&sh, 0, sizeof (sh));
+  if (mode == UNIX_SHARED) {
+    sh.size = 4 * 1024 * 1024;
+    if ((memfd = memfd_create ("bench_unix", MFD_CLOEXEC)) == -1 ||
+        ftruncate (memfd, ISC_SHARED_DATA + sh.size) == -1 ||
+        (sh.mem = mmap (NULL, ISC_SHARED_DATA + sh.size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                        memfd, 0)) == MAP_FAILED)
+      system_error ("bench - shared buffer");
+    close (memfd);
+  }
+  unix_pair (mode, fds);
+
+  // The child sends the stream once told to go, then echoes the round trips.
+  isc_frame_encode (&ack, 0, ISC_CHANNEL_DATA, 0, 0);
+  child = fork ();
+  if (child == -1)
+    system_error ("bench - fork");
+  if (child == 0) {
+    close (fds[1]);
+    unix_receive (fds[0], mode, 0, 1, &sh, dst);
+    for (sent = 0; sent < count; sent += k) {
+      k = count - sent < BENCH_UDP_BATCH ? count - sent : BENCH_UDP_BATCH;
+      unix_send (fds[0], mode, payload, size, sent, k, &sh);
+    }
+    for (sent = 0; sent < rounds; sent++) {
+      unix_receive (fds[0], mode, size, 1, &sh, dst);
+      if (send (fds[0], &ack, sizeof (ack), 0) != sizeof (ack))
+        _exit (1);
+    }
+    _exit (0);
+  }
+  close (fds[0]);
+
+  start = now_ns ();
+  if (send (fds[1], &ack, sizeof (ack), 0) != sizeof (ack))
+    system_error ("bench - send");
+  calls = unix_receive (fds[1], mode, size, count, &sh, dst);
+  elapsed = (now_ns () - start) / 1e9;
+  for (sent = 0; sent < rounds; sent++) {
+    start = now_ns ();
+    unix_send (fds[1], mode, payload, size, sent, 1, &sh);
+    unix_receive (fds[1], mode, 0, 1, &sh, dst);
+    samples[sent] = now_ns () - start;
+    sum += samples[sent];
+  }
+  close (fds[1]);
+  waitpid (child, NULL, 0);
+  if (sh.mem != NULL)
+    munmap (sh.mem, ISC_SHARED_DATA + sh.size);
+
+  qsort (samples, rounds, sizeof (samples[0]), cmp_u64);
+  printf ("%-10u %-10s %14.0f %10.0f %18.3f %10.0f %10llu %10llu\n", size, unix_mode_names[mode],
+          count / elapsed, count * size / elapsed / 1e6, (double) calls / count, sum / rounds,
+          (unsigned long long) samples[rounds / 2], (unsigned long long) samples[(rounds * 99) / 100]);
+  free (samples);
+}
+
+
+// Loopback TCP against Unix seqpacket sockets, with and without the shared buffer,
+// for growing message sizes.
+static void bench_unix ()
+{
+  static const uint32_t sizes[] = { 64, 4096, 16384, 32768, 65536 };
+  unsigned i;
+
+  printf ("\nunix: framed messages from a child process, %d (at most %llu MB) streamed and %d round trips per row\n",
+          iterations, (unsigned long long) (BENCH_ZC_BYTES >> 20), iterations / 10 > 0 ? iterations / 10 : 1);
+  printf ("%-10s %-10s %14s %10s %18s %10s %10s %10s\n", "bytes", "mode", "messages/s", "MB/s",
+          "syscalls/message", "rtt avg", "rtt p50", "rtt p99");
+  for (i = 0; i < sizeof (sizes) / sizeof (sizes[0]); i++) {
+    run_unix (sizes[i], UNIX_TCP);
+    run_unix (sizes[i], UNIX_SEQPACKET);
+    run_unix (sizes[i], UNIX_SHARED);
+  }
+}
+
+
+// Connect a loopback TCP pair tuned as PROFILE says: the listening socket as
+// sckt_server tunes it, the connecting one as sckt_client does.
+static void profile_pair (const char* profile, int fds[2])
+{
+  struct sckt_tuning t = sckt_tuning;
+  struct sockaddr_in addr;
+  socklen_t len = sizeof (addr);
+  int lfd;
+
+  sckt_tune_set_option (&t, "sckt_profile", profile);
+  memset (&addr, 0, sizeof (addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+  if ((lfd = socket (AF_INET, SOCK_STREAM, 0)) == -1)
+    system_error ("bench - socket");
+  sckt_tune_socket (&t, lfd, true, "bench");
+  if (bind (lfd, (struct sockaddr*) &addr, sizeof (addr)) == -1 || listen (lfd, t.listenq) == -1 ||
+      getsockname (lfd, (struct sockaddr*) &addr, &len) == -1 ||
+      (fds[0] = socket (AF_INET, SOCK_STREAM, 0)) == -1)
+    system_error ("bench - tcp pair");
+  sckt_tune_socket (&t, fds[0], true, "bench");
+  if (connect (fds[0], (struct sockaddr*) &addr, sizeof (addr)) == -1 ||
+      (fds[1] = accept (lfd, NULL, NULL)) == -1)
+    system_error ("bench - tcp pair");
+  close (lfd);
+}
+
+
+// Stream messages of SIZE bytes from a child process over a loopback TCP pair tuned
+// as PROFILE says, and ping-pong one at a time, answered by a bare frame header, the
+// receiver re-arming quick acks before each round trip. Prints the row: message rate and
+// throughput, round trip times in ns, and the buffers of the receiving socket.
+static void run_profile (uint32_t size, const char* profile)
+{
+  static uint8_t payload[ISC_FRAME_MAX], dst[ISC_FRAME_MAX + ISC_FRAME_HDR_SIZE];
+  struct sckt_tuning t = sckt_tuning;
+  struct isc_frame_hdr ack;
+  uint64_t count = iterations, rounds = iterations / 10, sent, start, *samples;
+  double elapsed, sum = 0;
+  socklen_t len = sizeof (int);
+  int fds[2], k, sndbuf, rcvbuf;
+  pid_t child;
+
+  if ((uint64_t) count * size > BENCH_ZC_BYTES)
+    count = BENCH_ZC_BYTES / size;
+  if (rounds == 0)
+    rounds = 1;
+  samples = xmalloc (rounds * sizeof (samples[0]));
+  memset (payload, 0x5A, sizeof (payload));
+  sckt_tune_set_option (&t, "sckt_profile", profile);
+  profile_pair (profile, fds);
+
+  // The child sends the stream once told to go, then echoes the round trips.
+  isc_frame_encode (&ack, 0, ISC_CHANNEL_DATA, 0, 0);
+  child = fork ();
+  if (child == -1)
+    system_error ("bench - fork");
+  if (child == 0) {
+    close (fds[1]);
+    unix_receive (fds[0], UNIX_TCP, 0, 1, NULL, dst);
+    for (sent = 0; sent < count; sent += k) {
+      k = count - sent < BENCH_UDP_BATCH ? count - sent : BENCH_UDP_BATCH;
+      unix_send (fds[0], UNIX_TCP, payload, size, sent, k, NULL);
+    }
+    for (sent = 0; sent < rounds; sent++) {
+      unix_receive (fds[0], UNIX_TCP, size, 1, NULL, dst);
+      if (send (fds[0], &ack, sizeof (ack), 0) != sizeof (ack))
+        _exit (1);
+    }
+    _exit (0);
+  }
+  close (fds[0]);
+
+  start = now_ns ();
+  if (send (fds[1], &ack, sizeof (ack), 0) != sizeof (ack))
+    system_error ("bench - send");
+  sckt_tune_rearm (&t, fds[1]);
+  unix_receive (fds[1], UNIX_TCP, size, count, NULL, dst);
+  elapsed = (now_ns () - start) / 1e9;
+  for (sent = 0; sent < rounds; sent++) {
+    start = now_ns ();
+    unix_send (fds[1], UNIX_TCP, payload, size, sent, 1, NULL);
+    sckt_tune_rearm (&t, fds[1]);
+    unix_receive (fds[1], UNIX_TCP, 0, 1, NULL, dst);
+    samples[sent] = now_ns () - start;
+    sum += samples[sent];
+  }
+  if (getsockopt (fds[1], SOL_SOCKET, SO_SNDBUF, &sndbuf, &len) == -1 ||
+      getsockopt (fds[1], SOL_SOCKET, SO_RCVBUF, &rcvbuf, &len) == -1)
+    sndbuf = rcvbuf = -1;
+  close (fds[1]);
+  waitpid (child, NULL, 0);
+
+  qsort (samples, rounds, sizeof (samples[0]), cmp_u64);
+  printf ("%-10u %-11s %14.0f %10.0f %10.0f %10llu %10llu %10d %10d\n", size, profile,
+          count / elapsed, count * size / elapsed / 1e6, sum / rounds,
+          (unsigned long long) samples[rounds / 2], (unsigned long long) samples[(rounds * 99) / 100],
+          sndbuf, rcvbuf);
+  free (samples);
+}
+
+
+// The socket tuning profiles of the sckt modules against each other on loopback.
+static void bench_profile ()
+{
+  static const uint32_t sizes[] = { 64, 1024, 16384, 65536 };
+  static const char* const profiles[] = { "default", "latency", "throughput", "lowmem" };
+  unsigned i, j;
+
+  // The options the kernel refuses are reported on stderr.
+  if (main_log_fd == NULL)
+    main_log_fd = stderr;
+  printf ("\nprofile: framed messages from a child process over loopback TCP, %d (at most %llu MB) streamed and %d round trips per row\n",
+          iterations, (unsigned long long) (BENCH_ZC_BYTES >> 20), iterations / 10 > 0 ? iterations / 10 : 1);
+  printf ("%-10s %-11s %14s %10s %10s %10s %10s %10s %10s\n", "bytes", "profile", "messages/s", "MB/s",
+          "rtt avg", "rtt p50", "rtt p99", "sndbuf", "rcvbuf");
+  for (i = 0; i < sizeof (sizes) / sizeof (sizes[0]); i++)
+    for (j = 0; j < sizeof (profiles) / sizeof (profiles[0]); j++)
+      run_profile (sizes[i], profiles[j]);
+}
+
+
+// How the messages of the crc benchmark are checked: not at all, with the crc32
+// instructions (isc_crc32c) or with tables (isc_crc32c_sw)
+enum crc_mode { CRC_OFF, CRC_HW, CRC_SW };
+static const char* const crc_mode_names[] = { "off", "hw", "table" };
+
+// The CRC32C of the LEN bytes at BUF as MODE computes it
+static uint32_t crc_of (enum crc_mode mode, const uint8_t* buf, uint32_t len)
+{
+  return mode == CRC_SW ? isc_crc32c_sw (0, buf, len) : isc_crc32c (0, buf, len);
+}
+
+
+// Checksum BENCH_CRC_BYTES in messages of SIZE bytes with the instructions and with
+// the tables. Prints the row: time per message in ns and throughput of each, and the
+// share of a core each takes at the line rate of 1 Gbit/s.
+static void run_crc (uint32_t size)
+{
+  static uint8_t buf[ISC_FRAME_MAX];
+  // Where the results go, so that the compiler keeps the loops
+  static volatile uint32_t sink;
+  uint64_t count = BENCH_CRC_BYTES / size, i, start;
+  double elapsed[2];
+  int mode;
+
+  for (i = 0; i < sizeof (buf); i++)
+    buf[i] = i * 31 + (i >> 8);
+  for (mode = CRC_HW; mode <= CRC_SW; mode++) {
+    start = now_ns ();
+    for (i = 0; i < count; i++)
+      sink = crc_of (mode, buf + (i & 7), size - (i & 7) / 4);
+    elapsed[mode - CRC_HW] = (now_ns () - start) / 1e9;
+  }
+  printf ("%-10u %10.1f %10.0f %10.2f %10.1f %10.0f %10.2f\n", size, elapsed[0] / count * 1e9,
+          count * size / elapsed[0] / 1e6, 125e6 * elapsed[0] / (count * size) * 100,
+          elapsed[1] / count * 1e9, count * size / elapsed[1] / 1e6,
+          125e6 * elapsed[1] / (count * size) * 100);
+}
+
+
+// Send K messages of SIZE bytes from PAYLOAD over FD with one sendmsg, numbered from
+// SEQ, each with the CRC of its payload between its header and its payload unless
+// MODE is CRC_OFF, as sckt_client frames them.
+static void crc_send (int fd, enum crc_mode mode, const uint8_t* payload, uint32_t size, uint64_t seq, int k)
+{
+  static struct { struct isc_frame_hdr hdr; uint32_t crc; } head[BENCH_UDP_BATCH];
+  static struct iovec iov[2 * BENCH_UDP_BATCH];
+  uint32_t head_len = ISC_FRAME_HDR_SIZE + (mode != CRC_OFF ? ISC_FRAME_CRC_SIZE : 0);
+  struct msghdr msg;
+  int i;
+
+  for (i = 0; i < k; i++) {
+    if (mode == CRC_OFF)
+      isc_frame_encode (&head[i].hdr, size, ISC_CHANNEL_DATA, 0, seq + i);
+    else {
+      head[i].crc = htobe32 (crc_of (mode, payload, size));
+      isc_frame_encode (&head[i].hdr, ISC_FRAME_CRC_SIZE + size, ISC_CHANNEL_DATA, ISC_FLAG_CRC, seq + i);
+    }
+    iov[2 * i].iov_base = &head[i];
+    iov[2 * i].iov_len = head_len;
+    iov[2 * i + 1].iov_base = (void*) payload;
+    iov[2 * i + 1].iov_len = size;
+  }
+  memset (&msg, 0, sizeof (msg));
+  msg.msg_iov = iov;
+  msg.msg_iovlen = 2 * k;
+  if (sendmsg (fd, &msg, 0) != (ssize_t) k * (head_len + size))
+    system_error ("bench - sendmsg");
+}
+
+
+// Read COUNT messages of SIZE bytes sent by crc_send from FD, check the CRC of each
+// one which has it as MODE computes it, and copy its payload to DST, as sckt_server
+// hands it on. Returns the messages which failed the check.
+static uint64_t crc_receive (int fd, enum crc_mode mode, uint32_t size, uint64_t count, uint8_t* dst)
+{
+  static uint8_t buf[2 * (ISC_FRAME_HDR_SIZE + ISC_FRAME_CRC_SIZE + ISC_FRAME_MAX)];
+  struct isc_frame_hdr hdr;
+  uint64_t got = 0, failed = 0;
+  size_t fill = 0, off;
+  uint8_t* payload;
+  uint32_t len, crc;
+  ssize_t n;
+
+  while (got < count) {
+    if ((n = recv (fd, buf + fill, sizeof (buf) - fill, 0)) <= 0)
+      system_error ("bench - recv");
+    fill += n;
+    for (off = 0; fill - off >= ISC_FRAME_HDR_SIZE; off += ISC_FRAME_HDR_SIZE + hdr.len) {
+      isc_frame_decode (buf + off, &hdr);
+      if (fill - off < ISC_FRAME_HDR_SIZE + hdr.len)
+        break;
+      payload = buf + off + ISC_FRAME_HDR_SIZE;
+      len = hdr.len;
+      if (hdr.flags & ISC_FLAG_CRC) {
+        memcpy (&crc, payload, sizeof (crc));
+        payload += ISC_FRAME_CRC_SIZE;
+        len -= ISC_FRAME_CRC_SIZE;
+        if (crc_of (mode, payload, len) != be32toh (crc))
+          failed++;
+      }
+      memcpy (dst, payload, len);
+      got++;
+    }
+    memmove (buf, buf + off, fill - off);
+    fill -= off;
+  }
+  return failed;
+}
+
+
+// Stream messages of SIZE bytes from a child process over loopback TCP, checked as
+// MODE says. Prints the row: message rate, throughput and the throughput lost
+// against BASE, the rate without a CRC (0 while that is measured). Returns the rate.
+static double run_crc_stream (uint32_t size, enum crc_mode mode, double base)
+{
+  static uint8_t payload[ISC_FRAME_MAX], dst[ISC_FRAME_MAX];
+  uint64_t count = iterations, sent, start, failed;
+  double elapsed, rate;
+  pid_t child;
+  int fds[2], k;
+
+  if ((uint64_t) count * size > BENCH_ZC_BYTES)
+    count = BENCH_ZC_BYTES / size;
+  for (k = 0; k < ISC_FRAME_MAX; k++)
+    payload[k] = k * 31 + (k >> 8);
+  unix_pair (UNIX_TCP, fds);
+  child = fork ();
+  if (child == -1)
+    system_error ("bench - fork");
+  if (child == 0) {
+    close (fds[1]);
+    for (sent = 0; sent < count; sent += k) {
+      k = count - sent < BENCH_UDP_BATCH ? count - sent : BENCH_UDP_BATCH;
+      crc_send (fds[0], mode, payload, size, sent, k);
+    }
+    _exit (0);
+  }
+  close (fds[0]);
+
+  start = now_ns ();
+  failed = crc_receive (fds[1], mode, size, count, dst);
+  elapsed = (now_ns () - start) / 1e9;
+  close (fds[1]);
+  waitpid (child, NULL, 0);
+
+  rate = count / elapsed;
+  printf ("%-10u %-8s %14.0f %10.0f %10.1f%s\n", size, crc_mode_names[mode], rate, rate * size / 1e6,
+          base > 0 ? (1 - rate / base) * 100 : 0.0, failed > 0 ? "  CRC MISMATCH" : "");
+  return rate;
+}
+
+
+// The CRC32C on its own and on the way over loopback TCP, for growing message sizes.
+static void bench_crc ()
+{
+  static const uint32_t sizes[] = { 64, 512, 4096, 16384, 65536 };
+  double base;
+  unsigned i;
+
+  printf ("\ncrc: CRC32C on %s (check value %08X, expected E3069283), %llu MB per row\n",
+          isc_crc32c_impl (), isc_crc32c (0, "123456789", 9), (unsigned long long) (BENCH_CRC_BYTES >> 20));
+  printf ("%-10s %10s %10s %10s %10s %10s %10s\n", "bytes", "hw ns", "hw MB/s", "hw 1G %",
+          "table ns", "table MB/s", "table 1G %");
+  for (i = 0; i < sizeof (sizes) / sizeof (sizes[0]); i++)
+    run_crc (sizes[i]);
+
+  printf ("\ncrc: framed messages from a child process over loopback TCP, %d (at most %llu MB) per row\n",
+          iterations, (unsigned long long) (BENCH_ZC_BYTES >> 20));
+  printf ("%-10s %-8s %14s %10s %10s\n", "bytes", "crc", "messages/s", "MB/s", "cost %");
+  for (i = 0; i < sizeof (sizes) / sizeof (sizes[0]); i++) {
+    base = run_crc_stream (sizes[i], CRC_OFF, 0);
+    run_crc_stream (sizes[i], CRC_HW, base);
+    run_crc_stream (sizes[i], CRC_SW, base);
+  }
+}
+
+
+// Main entry
+int main (int argc, char* const argv[])
+{
+  const char* test = NULL;
+  int next_option;
+
+  program_name = argv[0];
+
+  do {
+    next_option = getopt_long (argc, argv, short_options, long_options, NULL);
+
+    switch (next_option) {
+      case 'h':
+        print_usage (0);
+
+      case 't':
+        test = optarg;
+        break;
+
+      case 'n':
+        iterations = atoi (optarg);
+        if (iterations <= 0)
+          print_usage (1);
+        break;
+
+      case 's':
+        spin_us = atoi (optarg);
+        break;
+
+      case 'a':
+        sink_address = optarg;
+        break;
+
+      case '?':
+        print_usage (1);
+
+      case -1:
+        break;
+
+      default:
+        abort ();
+    }
+  } while (next_option != -1);
+
+  if (test != NULL && strcmp (test, "notify") != 0 && strcmp (test, "wait") != 0 &&
+      strcmp (test, "mpsc") != 0 && strcmp (test, "broadcast") != 0 &&
+      strcmp (test, "record") != 0 && strcmp (test, "batch") != 0 &&
+      strcmp (test, "zerocopy") != 0 && strcmp (test, "uring") != 0 &&
+      strcmp (test, "udp") != 0 && strcmp (test, "unix") != 0 &&
+      strcmp (test, "profile") != 0 && strcmp (test, "crc") != 0)
+    print_usage (1);
+
+  if (test == NULL || strcmp (test, "notify") == 0)
+    bench_notify ();
+  if (test == NULL || strcmp (test, "wait") == 0)
+    bench_wait ();
+  if (test == NULL || strcmp (test, "mpsc") == 0)
+    bench_mpsc ();
+  if (test == NULL || strcmp (test, "broadcast") == 0)
+    bench_broadcast ();
+  if (test == NULL || strcmp (test, "record") == 0)
+    bench_record ();
+  if (test == NULL || strcmp (test, "batch") == 0)
+    bench_batch ();
+  if (test == NULL || strcmp (test, "zerocopy") == 0)
+    bench_zerocopy ();
+  if (test == NULL || strcmp (test, "uring") == 0)
+    bench_uring ();
+  if (test == NULL || strcmp (test, "udp") == 0)
+    bench_udp ();
+  if (test == NULL || strcmp (test, "unix") == 0)
+    bench_unix ();
+  if (test == NULL || strcmp (test, "profile") == 0)
+    bench_profile ();
+  if (test == NULL || strcmp (test, "crc") == 0)
+    bench_crc ();
+
+  return 0;
+}
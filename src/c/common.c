@@ -20,7 +20,11 @@
 #include <sys/types.h>
 #include <pthread.h>
 #include <fcntl.h>
+#include <limits.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <endian.h>
 #include "isc.h"
 
 
@@ -212,6 +216,63 @@ int binary_semaphore_post (int semid)
 }
 
 
+// /////////////////////////////////////////////////////////
+// F U T E X   N O T I F I C A T I O N
+// /////////////////////////////////////////////////////////
+
+// The futex word is shared between processes, so the non-private operations are used.
+static long futex (uint32_t* uaddr, int op, uint32_t val, const struct timespec* timeout)
+{
+  return syscall (SYS_futex, uaddr, op, val, timeout, NULL, 0);
+}
+
+uint32_t shm_notify_prepare_wait (struct shm_notify* notify)
+{
+  // Announce ourselves before the caller re-checks its condition, so a
+  // concurrent post either sees us or happens before the re-check.
+  __atomic_add_fetch (&notify->waiters, 1, __ATOMIC_SEQ_CST);
+  return __atomic_load_n (&notify->seq, __ATOMIC_SEQ_CST);
+}
+
+void shm_notify_cancel_wait (struct shm_notify* notify)
+{
+  __atomic_sub_fetch (&notify->waiters, 1, __ATOMIC_SEQ_CST);
+}
+
+int shm_notify_wait (struct shm_notify* notify, uint32_t ticket, double timeout)
+{
+  struct timespec ts;
+  int rval = 0;
+
+  ts.tv_sec = (time_t) timeout;
+  ts.tv_nsec = (long) ((timeout - ts.tv_sec) * 1e+9);
+
+  // The kernel only puts us to sleep if nobody posted since the ticket was taken.
+  // A timeout, an interrupting signal or a post that already happened are all
+  // ordinary ways to return; the caller re-checks its condition anyway.
+  if (futex (&notify->seq, FUTEX_WAIT, ticket, timeout > 0 ? &ts : NULL) == -1
+      && errno != EAGAIN && errno != EINTR && errno != ETIMEDOUT)
+    rval = -1;
+
+  shm_notify_cancel_wait (notify);
+  return rval;
+}
+
+int shm_notify_post (struct shm_notify* notify)
+{
+  // Order the caller's publication before the waiter check; this pairs with
+  // the waiter count increment in shm_notify_prepare_wait.
+  __atomic_thread_fence (__ATOMIC_SEQ_CST);
+
+  // Fast path: nobody is sleeping, so there is no syscall at all.
+  if (__atomic_load_n (&notify->waiters, __ATOMIC_RELAXED) == 0)
+    return 0;
+
+  __atomic_add_fetch (&notify->seq, 1, __ATOMIC_SEQ_CST);
+  return (int) futex (&notify->seq, FUTEX_WAKE, INT_MAX, NULL);
+}
+
+
 // /////////////////////////////////////////////////////////
 // S L E E P   &   T I M E
 // /////////////////////////////////////////////////////////
@@ -296,6 +357,15 @@ char *asctime1(const struct tm *timeptr)
 }
 
 
+// Seconds on the monotonic clock, for measuring intervals
+double get_monotonic_time ()
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
 // Return a character string representing the current date and time.
 char* get_timestamp ()
 {
@@ -328,3 +398,49 @@ char* get_timestamp ()
 
   return result;
 }
+
+
+// /////////////////////////////////////////////////////////
+// W I R E   F R A M I N G
+// /////////////////////////////////////////////////////////
+
+void isc_frame_encode (struct isc_frame_hdr* wire, uint32_t len, uint16_t channel, uint16_t flags, uint64_t seq)
+{
+  wire->len = htobe32 (len);
+  wire->channel = htobe16 (channel);
+  wire->flags = htobe16 (flags);
+  wire->seq = htobe64 (seq);
+}
+
+void isc_frame_decode (const void* wire, struct isc_frame_hdr* hdr)
+{
+  // The header may sit at any offset of a receive buffer.
+  memcpy (hdr, wire, sizeof (*hdr));
+  hdr->len = be32toh (hdr->len);
+  hdr->channel = be16toh (hdr->channel);
+  hdr->flags = be16toh (hdr->flags);
+  hdr->seq = be64toh (hdr->seq);
+}
+
+void isc_dgram_encode (struct isc_dgram_hdr* wire, const struct isc_dgram_hdr* hdr)
+{
+  wire->seq = htobe64 (hdr->seq);
+  wire->len = htobe32 (hdr->len);
+  wire->offset = htobe32 (hdr->offset);
+  wire->channel = htobe16 (hdr->channel);
+  wire->flags = htobe16 (hdr->flags);
+  wire->frag = htobe16 (hdr->frag);
+  wire->frags = htobe16 (hdr->frags);
+}
+
+void isc_dgram_decode (const void* wire, struct isc_dgram_hdr* hdr)
+{
+  memcpy (hdr, wire, sizeof (*hdr));
+  hdr->seq = be64toh (hdr->seq);
+  hdr->len = be32toh (hdr->len);
+  hdr->offset = be32toh (hdr->offset);
+  hdr->channel = be16toh (hdr->channel);
+  hdr->flags = be16toh (hdr->flags);
+  hdr->frag = be16toh (hdr->frag);
+  hdr->frags = be16toh (hdr->frags);
+}
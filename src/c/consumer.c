@@ -6,10 +6,11 @@
  * @brief   consumer.c runs on the same machine as isc but on a different process. 
  *          It connects via shared memory to the server thread of Inter SoC 
  *          Communication (ISC) module and fetches data received data from that process.
+ *          Several consumers (e.g. a recorder and a control loop) may run at once;
+ *          each one reads every chunk from the same ring.
  */
 
 #include <sys/ipc.h>
-#include <sys/sem.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <stdio.h>
@@ -24,6 +25,7 @@
 #include <sys/shm.h>
 #include <stdint.h>
 #include <signal.h>
+#include <getopt.h>
 #include "isc.h"
 
 
@@ -31,12 +33,9 @@
  * C o n s t a n t s ,   v a r i a b l e s ,  f u n c t i o n s 
 ************************************************************************************/
 
-// Shared Memory Key and Binary Semaphore
-key_t cons_semkey;
-int cons_semid;
-key_t cons_shmkey;
-int cons_shmid;
-char *cons_shm;
+// Shared Memory segment and the slot ring inside it
+struct shm_segment cons_seg;
+struct shm_ring cons_ring;
 
 // The file to which to append the log string.
 const char* main_log_filename = "consumer.log";
@@ -53,35 +52,15 @@ void ipc_init ()
   printf("\nconsumer - ipc_init\n");
   fprintf(main_log_fd, "\n%s - INFO - consumer - ipc_init", get_timestamp ());
 
-  // Get unique key for xmit shared memory; The /tmp/cons_shmem_key file must exist!
-  if ((cons_shmkey = ftok("/tmp/cons_shmem_key", 'R')) == -1) {
-    system_error ("consumer - cons_shmem_key ftok");
+  // Create or attach the segment and the slot ring inside it;
+  // The /tmp/cons_shmem_key file must exist!
+  if (shm_ring_open (&cons_ring, &cons_seg, "/tmp/cons_shmem_key", CONS_RING_SLOTS, SHM_SLOT_SIZE) == -1) {
+    system_error ("consumer - shm_ring_open");
   }
 
-  // Create the segment
-  if ((cons_shmid = shmget(cons_shmkey, CONS_SHM_SIZE, 0644 | IPC_CREAT)) == -1) {
-    system_error ("consumer - Create the segment shmem");
-  }
-
-  // Attach to the segment to get a pointer to it
-  cons_shm = shmat(cons_shmid, (void *)0, 0);
-  if (cons_shm == (char *)(-1)) {
-    system_error ("consumer - Attach to the segment shmem");
-  }
-
-  // Get unique key for xmit semaphore
-  if ((cons_semkey = ftok("/tmp/cons_sem_key", 'R')) == (key_t) -1) {
-    system_error ("consumer - cons_sem_key ftok");
-  }
-
-  // Allocate xmit semaphore
-  if ((cons_semid = binary_semaphore_allocation (cons_semkey, 0644 | IPC_CREAT)) == -1 ) {
-    system_error ("consumer - binary_semaphore_allocation");
-  }
-
-  // Init xmit semaphore
-  if (binary_semaphore_initialize (cons_semid) == -1 ) {
-    system_error ("consumer - binary_semaphore_initialize");
+  // Read as one of possibly several consumers; every one of them sees every chunk.
+  if (shm_ring_join (&cons_ring) == -1) {
+    system_error ("consumer - shm_ring_join");
   }
 }
 
@@ -92,17 +71,10 @@ void ipc_cleanup ()
   printf ("\nconsumer - ipc_cleanup\n");
   fprintf (main_log_fd, "\n%s - INFO - consumer - ipc_cleanup", get_timestamp ());
 
-  if (binary_semaphore_deallocate(cons_semid) == -1) {
-    system_error ("consumer - binary_semaphore_deallocate");
-  }
-
-  // Detach from the xmit shared memory segment
-  if (shmdt(cons_shm) == -1) {
+  // Detach from the segment and deallocate it if this was the last consumer
+  if (shm_segment_close (&cons_seg, shm_ring_leave (&cons_ring) == 0) == -1) {
     system_error ("consumer - Detach from the xmit shmem");
   }
-
-  // Deallocate the xmit shared memory segment
-  shmctl (cons_shmid, IPC_RMID, 0); 
 }
 
 
@@ -127,7 +99,18 @@ void sigHandler(int sig)
 // Main entry
 int main(int argc, char *argv[])
 {
-  int s = 0, i, j = 0;
+  int s = 0, i, j = 0, c;
+  const struct shm_record_hdr *rec;
+  uint8_t *payload;
+  uint64_t lost = 0, overwritten = 0;
+
+  // Parse options; every -o KEY=VALUE configures the shared memory segment.
+  while ((c = getopt (argc, argv, "o:")) != -1) {
+    if (c != 'o' || !shm_seg_parse_option (optarg)) {
+      fprintf (stderr, "Usage: %s [ -o shm_option=value ]...\n", argv[0]);
+      exit (1);
+    }
+  }
 
   struct sigaction sa;
   memset (&sa, 0, sizeof (sa));
@@ -150,25 +133,40 @@ int main(int argc, char *argv[])
     if (sigusr1_count > 0)
       break;
 
-    s = binary_semaphore_wait (cons_semid);
-    // Check what happened
-    if (s == -1) {
-      if (errno == ETIMEDOUT) {
-        printf ("\nconsumer - sem_timedwait() timed out\n");
-        fprintf (main_log_fd, "\n%s - WARNING - consumer - sem_timedwait() timed out.", get_timestamp ());
-      }
-      else
-        ;//perror("sem_timedwait");
-    } else {
+    // Drain every record the isc has published so far
+    while ((rec = shm_ring_read_record (&cons_ring)) != NULL) {
+      payload = shm_ring_record_payload (&cons_ring, rec);
       printf ("\n%s - INFO - Reced(%i) - ", get_timestamp (), j);
-      fprintf (main_log_fd, "\n%s - INFO - consumer - Reced(%i) - ", get_timestamp (), j);
+      fprintf (main_log_fd, "\n%s - INFO - consumer - Reced(%i) - type %u, seq %llu, %u bytes - ", get_timestamp (), j,
+               rec->type, (unsigned long long) rec->seq, rec->len);
 #if 1
-      for (i = 0; i < CONS_TEST_REGION_SIZE; i++) {
-        fprintf (main_log_fd, "0x%X,", cons_shm[i] & 0x000000FF);
+      for (i = 0; i < rec->len; i++) {
+        fprintf (main_log_fd, "0x%X,", payload[i] & 0x000000FF);
       }
 #endif
+      // Dropped while we read it, the isc may have written over it; it is lost too.
+      if (!shm_ring_valid (&cons_ring, rec)) {
+        overwritten++;
+        fprintf (main_log_fd, "\n%s - WARNING - consumer - Reced(%i) was overwritten while read, lost", get_timestamp (), j);
+      }
+      shm_ring_release (&cons_ring);
       j++;
     }
+
+    // We fell behind the other consumers and were dropped; say how much we missed.
+    if (cons_ring.lost != lost) {
+      lost = cons_ring.lost;
+      fprintf (main_log_fd, "\n%s - WARNING - consumer - fell behind, %llu slots of records lost so far, %llu records overwritten while read",
+               get_timestamp (), (unsigned long long) lost, (unsigned long long) overwritten);
+    }
+
+    // The ring is empty; spin or sleep, as shm_wait says, until shmem_rec publishes more
+    s = shm_ring_await_data (&cons_ring, SHM_WAIT_TIMEOUT);
+    // Check what happened
+    if (s == -1) {
+      printf ("\nconsumer - shm_ring_await_data() failed\n");
+      fprintf (main_log_fd, "\n%s - WARNING - consumer - shm_ring_await_data() failed: %s.", get_timestamp (), strerror (errno));
+    }
   }
 
   printf ("\n");
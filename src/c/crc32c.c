@@ -0,0 +1,214 @@
+/**
+ * @file   crc32c.c
+ * @author Armin Zare Zadeh ali.a.zarezadeh@gmail.com
+ * @date   16 October 2026
+ * @version 0.1
+ * @brief   crc32c.c computes the CRC32C (Castagnoli) checksums with which the sckt
+ *          modules guard the payload of a message (see ISC_FLAG_CRC).
+ *
+ * - On x86-64 with SSE4.2, and on ARMv8 with the CRC extension, the crc32
+ *   instructions do the work, 8 bytes at a time, on three streams at once which are
+ *   combined after. Whether the CPU has them is found out at the first call, so the
+ *   isc runs on CPUs without them as well.
+ * - Elsewhere, tables do it 8 bytes at a time (slicing-by-8).
+ * - The checksum is that of iSCSI and ext4: reflected, with initial value and final
+ *   XOR of ~0. isc_crc32c (0, "123456789", 9) is 0xE3069283.
+ */
+
+#include <endian.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "isc.h"
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#define CRC_HARDWARE "sse4.2"
+#define CRC_TARGET __attribute__((target ("sse4.2")))
+#define crcHw8(crc, b) ((uint32_t) _mm_crc32_u8 ((crc), (b)))
+#define crcHw64(crc, v) ((uint32_t) _mm_crc32_u64 ((crc), (v)))
+#elif defined(__aarch64__)
+#include <arm_acle.h>
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#define CRC_HARDWARE "armv8"
+#define CRC_TARGET __attribute__((target ("+crc")))
+#define crcHw8(crc, b) __crc32cb ((crc), (b))
+#define crcHw64(crc, v) __crc32cd ((crc), (v))
+#endif
+
+
+/***********************************************************************************
+ * C o n s t a n t s ,   v a r i a b l e s ,  f u n c t i o n s
+************************************************************************************/
+
+// The Castagnoli polynomial, reflected
+#define CRC32C_POLY 0x82F63B78
+
+// The instructions run three CRCs at once over three blocks in a row, of CRC_LONG
+// bytes while there is enough data, then of CRC_SHORT bytes, and combine them after.
+#define CRC_LONG 8192
+#define CRC_SHORT 128
+
+// crcTable[0] is the CRC of every byte value; crcTable[k] that of the byte followed by
+// k zero bytes. crcLong and crcShort carry a CRC over CRC_LONG and CRC_SHORT zero
+// bytes, a table per byte of it.
+static uint32_t crcTable[8][256];
+static uint32_t crcLong[4][256];
+static uint32_t crcShort[4][256];
+
+// What isc_crc32c runs on, picked at the first call, and its name
+static pthread_once_t crcOnce = PTHREAD_ONCE_INIT;
+static uint32_t (*crcRun) (uint32_t crc, const uint8_t* p, size_t len);
+static const char* crcName;
+
+
+// Carry the (not inverted) CRC over the LEN bytes at P with the tables.
+static uint32_t crcTables (uint32_t crc, const uint8_t* p, size_t len)
+{
+  uint64_t v;
+  uint32_t hi;
+
+  for (; len > 0 && ((uintptr_t) p & 7) != 0; len--)
+    crc = crcTable[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+  for (; len >= 8; len -= 8, p += 8) {
+    memcpy (&v, p, sizeof (v));
+    v = le64toh (v) ^ crc;
+    hi = v >> 32;
+    crc = crcTable[7][v & 0xFF] ^ crcTable[6][(v >> 8) & 0xFF] ^
+          crcTable[5][(v >> 16) & 0xFF] ^ crcTable[4][(v >> 24) & 0xFF] ^
+          crcTable[3][hi & 0xFF] ^ crcTable[2][(hi >> 8) & 0xFF] ^
+          crcTable[1][(hi >> 16) & 0xFF] ^ crcTable[0][hi >> 24];
+  }
+  while (len-- > 0)
+    crc = crcTable[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+  return crc;
+}
+
+// Fill SHIFT with the operator which carries a CRC over LEN zero bytes.
+static void crcShiftInit (uint32_t shift[4][256], size_t len)
+{
+  uint32_t bit[32], c;
+  size_t i;
+  int j, k, n;
+
+  // It is linear: what it does to each bit of the CRC makes up the rest.
+  for (j = 0; j < 32; j++) {
+    for (c = 1U << j, i = 0; i < len; i++)
+      c = crcTable[0][c & 0xFF] ^ (c >> 8);
+    bit[j] = c;
+  }
+  for (k = 0; k < 4; k++)
+    for (n = 0; n < 256; n++)
+      for (shift[k][n] = 0, j = 0; j < 8; j++)
+        if (n & (1 << j))
+          shift[k][n] ^= bit[8 * k + j];
+}
+
+// Carry CRC over as many zero bytes as SHIFT was made for.
+static inline uint32_t crcShift (const uint32_t shift[4][256], uint32_t crc)
+{
+  return shift[0][crc & 0xFF] ^ shift[1][(crc >> 8) & 0xFF] ^ shift[2][(crc >> 16) & 0xFF] ^ shift[3][crc >> 24];
+}
+
+#ifdef CRC_HARDWARE
+// Carry the CRC over the LEN bytes at P with the crc32 instructions. One of them takes
+// three cycles before the next can use its result, but starts every cycle, so three
+// blocks in a row are done at once: the first carries CRC, the other two start from
+// 0, and each CRC is carried over the blocks behind it to make up the whole.
+CRC_TARGET
+static uint32_t crcHardware (uint32_t crc, const uint8_t* p, size_t len)
+{
+  const uint8_t* end;
+  uint64_t v0, v1, v2;
+  uint32_t c1, c2;
+
+  for (; len > 0 && ((uintptr_t) p & 7) != 0; len--)
+    crc = crcHw8 (crc, *p++);
+  for (; len >= 3 * CRC_LONG; len -= 3 * CRC_LONG, p += 2 * CRC_LONG) {
+    for (c1 = c2 = 0, end = p + CRC_LONG; p < end; p += 8) {
+      memcpy (&v0, p, sizeof (v0));
+      memcpy (&v1, p + CRC_LONG, sizeof (v1));
+      memcpy (&v2, p + 2 * CRC_LONG, sizeof (v2));
+      crc = crcHw64 (crc, v0);
+      c1 = crcHw64 (c1, v1);
+      c2 = crcHw64 (c2, v2);
+    }
+    crc = crcShift (crcLong, crcShift (crcLong, crc) ^ c1) ^ c2;
+  }
+  for (; len >= 3 * CRC_SHORT; len -= 3 * CRC_SHORT, p += 2 * CRC_SHORT) {
+    for (c1 = c2 = 0, end = p + CRC_SHORT; p < end; p += 8) {
+      memcpy (&v0, p, sizeof (v0));
+      memcpy (&v1, p + CRC_SHORT, sizeof (v1));
+      memcpy (&v2, p + 2 * CRC_SHORT, sizeof (v2));
+      crc = crcHw64 (crc, v0);
+      c1 = crcHw64 (c1, v1);
+      c2 = crcHw64 (c2, v2);
+    }
+    crc = crcShift (crcShort, crcShift (crcShort, crc) ^ c1) ^ c2;
+  }
+  for (; len >= 8; len -= 8, p += 8) {
+    memcpy (&v0, p, sizeof (v0));
+    crc = crcHw64 (crc, v0);
+  }
+  while (len-- > 0)
+    crc = crcHw8 (crc, *p++);
+  return crc;
+}
+#endif
+
+// Fill the tables and pick what isc_crc32c runs on.
+static void crcInit ()
+{
+  uint32_t c;
+  int n, k;
+
+  for (n = 0; n < 256; n++) {
+    for (c = n, k = 0; k < 8; k++)
+      c = (c & 1) ? (c >> 1) ^ CRC32C_POLY : c >> 1;
+    crcTable[0][n] = c;
+  }
+  for (n = 0; n < 256; n++)
+    for (c = crcTable[0][n], k = 1; k < 8; k++)
+      crcTable[k][n] = c = crcTable[0][c & 0xFF] ^ (c >> 8);
+
+  crcRun = crcTables;
+  crcName = "table";
+#if defined(__x86_64__)
+  if (!__builtin_cpu_supports ("sse4.2"))
+    return;
+#elif defined(__aarch64__)
+  if (!(getauxval (AT_HWCAP) & HWCAP_CRC32))
+    return;
+#endif
+#ifdef CRC_HARDWARE
+  crcShiftInit (crcLong, CRC_LONG);
+  crcShiftInit (crcShort, CRC_SHORT);
+  crcRun = crcHardware;
+  crcName = CRC_HARDWARE;
+#endif
+}
+
+
+// /////////////////////////////////////////////////////////
+// C H E C K S U M S
+// /////////////////////////////////////////////////////////
+
+uint32_t isc_crc32c (uint32_t crc, const void* buf, size_t len)
+{
+  pthread_once (&crcOnce, crcInit);
+  return ~crcRun (~crc, (const uint8_t*) buf, len);
+}
+
+uint32_t isc_crc32c_sw (uint32_t crc, const void* buf, size_t len)
+{
+  pthread_once (&crcOnce, crcInit);
+  return ~crcTables (~crc, (const uint8_t*) buf, len);
+}
+
+const char* isc_crc32c_impl ()
+{
+  pthread_once (&crcOnce, crcInit);
+  return crcName;
+}
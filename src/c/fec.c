@@ -0,0 +1,193 @@
+/**
+ * @file   fec.c
+ * @author Armin Zare Zadeh ali.a.zarezadeh@gmail.com
+ * @date   16 October 2026
+ * @version 0.1
+ * @brief   fec.c computes the parity datagrams of the forward error correction of
+ *          the UDP transport, and rebuilds lost datagrams from them (see
+ *          ISC_FLAG_FEC).
+ *
+ * - The code is a systematic Reed-Solomon erasure code over GF(2^8): parity row j
+ *   of a group is the sum over its data symbols i of coef (j, i) times symbol i.
+ * - The coefficients are a Cauchy matrix, 1 / (x_j + y_i) with x_j = 255 - j and
+ *   y_i = i, each column scaled so that row 0 is all ones. So the first parity is the
+ *   plain XOR of the group, and any K of the K + M symbols of a group give it back.
+ * - A region is multiplied with one lookup per byte in a 64K table of products.
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "isc.h"
+
+
+/***********************************************************************************
+ * C o n s t a n t s ,   v a r i a b l e s ,  f u n c t i o n s
+************************************************************************************/
+
+// The polynomial of GF(2^8), x^8 + x^4 + x^3 + x^2 + 1, whose root 2 generates it
+#define GF_POLY 0x11D
+
+// Powers of 2 (twice over, so that a sum of two logarithms needs no reduction), the
+// logarithms, and the products of every pair of elements
+static uint8_t gfExp[512];
+static uint8_t gfLog[256];
+static uint8_t gfMul[256][256];
+static pthread_once_t gfOnce = PTHREAD_ONCE_INIT;
+
+
+// Fill the tables.
+static void gfInit ()
+{
+  int a, b, x = 1;
+
+  for (a = 0; a < 255; a++) {
+    gfExp[a] = gfExp[a + 255] = x;
+    gfLog[x] = a;
+    x <<= 1;
+    if (x & 0x100)
+      x ^= GF_POLY;
+  }
+  for (a = 1; a < 256; a++)
+    for (b = 1; b < 256; b++)
+      gfMul[a][b] = gfExp[gfLog[a] + gfLog[b]];
+}
+
+// The inverse of A, which isn't 0
+static inline uint8_t gfInv (uint8_t a)
+{
+  return gfExp[255 - gfLog[a]];
+}
+
+// The coefficient of data symbol COL in parity row ROW
+static uint8_t fecCoef (int row, int col)
+{
+  if (row == 0)
+    return 1;
+  return gfMul[255 ^ col][gfInv ((255 - row) ^ col)];
+}
+
+// Add C times the LEN bytes at SRC to those at DST.
+static void fecMulAdd (uint8_t* dst, const uint8_t* src, uint8_t c, size_t len)
+{
+  const uint8_t* t = gfMul[c];
+  uint64_t a, b;
+
+  if (c == 0)
+    return;
+  if (c == 1) {
+    for (; len >= 8; len -= 8, dst += 8, src += 8) {
+      memcpy (&a, dst, sizeof (a));
+      memcpy (&b, src, sizeof (b));
+      a ^= b;
+      memcpy (dst, &a, sizeof (a));
+    }
+    while (len-- > 0)
+      *dst++ ^= *src++;
+    return;
+  }
+  while (len-- > 0)
+    *dst++ ^= t[*src++];
+}
+
+// Invert the N x N matrix A in place, by Gauss-Jordan elimination. Returns false if it
+// is singular, which a square part of a Cauchy matrix never is.
+static bool fecInvert (uint8_t* a, int n)
+{
+  uint8_t inv[ISC_FEC_MAX_M * ISC_FEC_MAX_M], t, c;
+  int i, j, r;
+
+  memset (inv, 0, n * n);
+  for (i = 0; i < n; i++)
+    inv[i * n + i] = 1;
+  for (i = 0; i < n; i++) {
+    for (r = i; r < n && a[r * n + i] == 0; r++)
+      ;
+    if (r == n)
+      return false;
+    for (j = 0; r != i && j < n; j++) {
+      t = a[i * n + j], a[i * n + j] = a[r * n + j], a[r * n + j] = t;
+      t = inv[i * n + j], inv[i * n + j] = inv[r * n + j], inv[r * n + j] = t;
+    }
+    c = gfInv (a[i * n + i]);
+    for (j = 0; j < n; j++) {
+      a[i * n + j] = gfMul[c][a[i * n + j]];
+      inv[i * n + j] = gfMul[c][inv[i * n + j]];
+    }
+    for (r = 0; r < n; r++) {
+      if (r == i || (c = a[r * n + i]) == 0)
+        continue;
+      for (j = 0; j < n; j++) {
+        a[r * n + j] ^= gfMul[c][a[i * n + j]];
+        inv[r * n + j] ^= gfMul[c][inv[i * n + j]];
+      }
+    }
+  }
+  memcpy (a, inv, n * n);
+  return true;
+}
+
+
+// /////////////////////////////////////////////////////////
+// P A R I T Y
+// /////////////////////////////////////////////////////////
+
+void isc_fec_add (uint8_t* parity, int row, int col, const void* src, size_t len)
+{
+  pthread_once (&gfOnce, gfInit);
+  fecMulAdd (parity, (const uint8_t*) src, fecCoef (row, col), len);
+}
+
+int isc_fec_recover (uint8_t* const* sym, bool* have, int k, int m, size_t len)
+{
+  uint8_t a[ISC_FEC_MAX_M * ISC_FEC_MAX_M], *out;
+  int miss[ISC_FEC_MAX_M], rows[ISC_FEC_MAX_M];
+  int i, j, b, n = 0, r = 0;
+
+  pthread_once (&gfOnce, gfInit);
+  for (i = 0; i < k; i++) {
+    if (!have[i] && n++ == m)
+      return -1;
+    if (!have[i])
+      miss[n - 1] = i;
+  }
+  for (j = 0; j < m && r < n; j++)
+    if (have[k + j])
+      rows[r++] = j;
+  if (n == 0 || r < n)
+    return n == 0 ? 0 : -1;
+
+  // What is left of each parity once the data which arrived is taken out of it goes
+  // in the place of a missing symbol.
+  for (b = 0; b < n; b++) {
+    memcpy (sym[miss[b]], sym[k + rows[b]], len);
+    for (i = 0; i < k; i++)
+      if (have[i])
+        fecMulAdd (sym[miss[b]], sym[i], fecCoef (rows[b], i), len);
+    for (i = 0; i < n; i++)
+      a[b * n + i] = fecCoef (rows[b], miss[i]);
+  }
+  if (!fecInvert (a, n))
+    return -1;
+
+  // The missing symbols are the inverse applied to those remainders. A single one
+  // needs only scaling, the plain XOR parity not even that.
+  if (n == 1) {
+    for (out = sym[miss[0]], i = 0; a[0] != 1 && i < (int) len; i++)
+      out[i] = gfMul[a[0]][out[i]];
+    have[miss[0]] = true;
+    return 1;
+  }
+  out = (uint8_t*) xmalloc (n * len);
+  memset (out, 0, n * len);
+  for (b = 0; b < n; b++)
+    for (i = 0; i < n; i++)
+      fecMulAdd (out + b * len, sym[miss[i]], a[b * n + i], len);
+  for (b = 0; b < n; b++) {
+    memcpy (sym[miss[b]], out + b * len, len);
+    have[miss[b]] = true;
+  }
+  free (out);
+  return n;
+}
@@ -11,7 +11,7 @@
  *          Each module is a shared library file and must define and export a function named 
  *          module_generate.
  * 
- * ipc.c contains two functions:
+ * ipc.c contains these functions:
  * 
  * - ipc_open attempts to load an ISC module with a given name. The name
  *   normally ends with the .so extension because ISC modules are implemented
@@ -24,6 +24,9 @@
  * - ipc_close closes the shared library corresponding to the ISC module and
  *   deallocates the struct ipc_module object.
  *
+ * - ipc_hand_on hands a received message on to the peer module of a server module,
+ *   the same way for every transport.
+ *
  *   ipc.c also defines a global variable module_dir. This is the path of the directory in
  *   which ipc_open attempts to find shared libraries corresponding to server modules.
  */
@@ -48,14 +51,21 @@ struct ipc_module* ipc_open (const char* module_name)
 {
   char* module_path;
   void* handle;
-  void (* ipc_init) (void (*ipc_rec)(unsigned char *buf, int bufSize), void (*ipc_xmit)(uint8_t *buf, int32_t bufSize));
+  void (* ipc_init) (void (*ipc_rec)(unsigned char *buf, int bufSize), void (*ipc_xmit)(uint8_t *buf, int32_t bufSize),
+                     struct ipc_module* peer);
   void (* ipc_cleanup) ();
   void (* ipc_stop) ();
   bool (* ipc_start) ();
   bool (* ipc_wait4Done) ();
   bool (* ipc_set_param) (const char* prtcl, const char *addr, int port);
   uint32_t (* ipc_xmit) (uint8_t *buf, int32_t bufSize);
+  uint32_t (* ipc_xmitv) (const struct iovec *iov, int32_t iovCnt);
   void (* ipc_rec) (uint8_t *buf, int32_t bufSize);
+  bool (* ipc_set_option) (const char* key, const char* value);
+  uint8_t* (* ipc_acquire) (int32_t *bufSize);
+  void (* ipc_commit) (uint8_t *buf, int32_t bufSize);
+  void (* ipc_release) (uint8_t *buf);
+  int32_t (* ipc_credits) ();
   struct ipc_module* module;
 
   // Construct the full path of the module shared library we'll try to
@@ -73,7 +83,8 @@ struct ipc_module* ipc_open (const char* module_name)
   }
 
   // Resolve the ipc_init symbol from the shared library.
-  ipc_init = (void (*) (void (*ipc_rec)(uint8_t *buf, int32_t bufSize), void (*ipc_xmit)(uint8_t *buf, int32_t bufSize))) dlsym (handle, "ipc_init");
+  ipc_init = (void (*) (void (*ipc_rec)(uint8_t *buf, int32_t bufSize), void (*ipc_xmit)(uint8_t *buf, int32_t bufSize),
+                        struct ipc_module* peer)) dlsym (handle, "ipc_init");
   // Make sure the symbol was found.
   if (ipc_init == NULL) {
     // The symbol is missing. While this is a shared library, it
@@ -143,6 +154,16 @@ struct ipc_module* ipc_open (const char* module_name)
     return NULL;
   }
 
+  // Resolve the ipc_xmitv symbol from the shared library.
+  ipc_xmitv = (uint32_t (*) (const struct iovec *iov, int32_t iovCnt)) dlsym (handle, "ipc_xmitv");
+  // Make sure the symbol was found.
+  if (ipc_xmitv == NULL) {
+    // The symbol is missing. While this is a shared library, it
+    // probably isn't a server module. Close up and indicate failure.
+    dlclose (handle);
+    return NULL;
+  }
+
   // Resolve the ipc_rec symbol from the shared library.
   ipc_rec = (void (*) (uint8_t *buf, int32_t bufSize)) dlsym (handle, "ipc_rec");
   // Make sure the symbol was found.
@@ -153,6 +174,56 @@ struct ipc_module* ipc_open (const char* module_name)
     return NULL;
   }
 
+  // Resolve the ipc_set_option symbol from the shared library.
+  ipc_set_option = (bool (*) (const char* key, const char* value)) dlsym (handle, "ipc_set_option");
+  // Make sure the symbol was found.
+  if (ipc_set_option == NULL) {
+    // The symbol is missing. While this is a shared library, it
+    // probably isn't a server module. Close up and indicate failure.
+    dlclose (handle);
+    return NULL;
+  }
+
+  // Resolve the ipc_acquire symbol from the shared library.
+  ipc_acquire = (uint8_t* (*) (int32_t *bufSize)) dlsym (handle, "ipc_acquire");
+  // Make sure the symbol was found.
+  if (ipc_acquire == NULL) {
+    // The symbol is missing. While this is a shared library, it
+    // probably isn't a server module. Close up and indicate failure.
+    dlclose (handle);
+    return NULL;
+  }
+
+  // Resolve the ipc_commit symbol from the shared library.
+  ipc_commit = (void (*) (uint8_t *buf, int32_t bufSize)) dlsym (handle, "ipc_commit");
+  // Make sure the symbol was found.
+  if (ipc_commit == NULL) {
+    // The symbol is missing. While this is a shared library, it
+    // probably isn't a server module. Close up and indicate failure.
+    dlclose (handle);
+    return NULL;
+  }
+
+  // Resolve the ipc_release symbol from the shared library.
+  ipc_release = (void (*) (uint8_t *buf)) dlsym (handle, "ipc_release");
+  // Make sure the symbol was found.
+  if (ipc_release == NULL) {
+    // The symbol is missing. While this is a shared library, it
+    // probably isn't a server module. Close up and indicate failure.
+    dlclose (handle);
+    return NULL;
+  }
+
+  // Resolve the ipc_credits symbol from the shared library.
+  ipc_credits = (int32_t (*) ()) dlsym (handle, "ipc_credits");
+  // Make sure the symbol was found.
+  if (ipc_credits == NULL) {
+    // The symbol is missing. While this is a shared library, it
+    // probably isn't a server module. Close up and indicate failure.
+    dlclose (handle);
+    return NULL;
+  }
+
   // Allocate and initialize a ipc_module object.
   module = (struct ipc_module*) xmalloc (sizeof (struct ipc_module));
   module->handle = handle;
@@ -164,7 +235,13 @@ struct ipc_module* ipc_open (const char* module_name)
   module->wait4Done_function = ipc_wait4Done;
   module->set_param_function = ipc_set_param;
   module->xmit_function = ipc_xmit;
+  module->xmitv_function = ipc_xmitv;
   module->rec_function = ipc_rec;
+  module->set_option_function = ipc_set_option;
+  module->acquire_function = ipc_acquire;
+  module->commit_function = ipc_commit;
+  module->release_function = ipc_release;
+  module->credits_function = ipc_credits;
 
   // Return it, indicating success.
   return module;
@@ -183,3 +260,28 @@ void ipc_close (struct ipc_module* module)
   // Deallocate the module object.
   free (module);
 }
+
+
+// Hand the message of LEN bytes at BUF on to PEER: into a record acquired from it if
+// it does flow control, else through REC. Returns false, leaving the message where it
+// is, while PEER has no room for it.
+bool ipc_hand_on (struct ipc_module* peer, void (*rec) (uint8_t *buf, int32_t bufSize), uint8_t* buf, uint32_t len)
+{
+  int32_t room = len, credits;
+  uint8_t *chunk;
+
+  credits = (peer != NULL) ? (*peer->credits_function) () : -1;
+  if (credits == 0)
+    return false;
+
+  if (credits < 0) {
+    rec (buf, len);
+    return true;
+  }
+
+  if ( (chunk = (*peer->acquire_function) (&room)) == NULL)
+    return false;
+  memcpy (chunk, buf, len);
+  (*peer->commit_function) (chunk, len);
+  return true;
+}
@@ -12,6 +12,9 @@
  *   process on the same machine as isc.
  * - In this implementation, the network server/client uses TCP socket for connection to 
  *   another SoC. It can be easily extended to other bus topologis like PCIe.
+ * - The socket modules are picked by the name of their transport: sckt_server/sckt_client
+ *   (epoll) by default, uring_server/uring_client (io_uring), or unix_server/unix_client
+ *   (Unix SOCK_SEQPACKET, on the same host).
  * - isc_run installs clean up as the signal handler for SIGCHLD. It acts as a destructor
  *   for the whole system. This function simply cleans up terminated process.
  * - To gently and safely shutdown the system, first the stop requets are sent to each
@@ -55,10 +58,9 @@ static char* ipc_name_shmem_rec = "shmem_rec";
 // IPC shmem xmitg
 static char* ipc_name_shmem_xmit = "shmem_xmit";
 
-// IPC socket client
-static char* ipc_name_sckt_client = "sckt_client";
-// IPC socket server
-static char* ipc_name_sckt_server = "sckt_server";
+// IPC socket client and server: the name of the transport followed by these
+static char* ipc_suffix_sckt_client = "_client";
+static char* ipc_suffix_sckt_server = "_server";
 
 // Inter Process Communication module: Shared Memory
 struct ipc_module* module_shmem = NULL;
@@ -125,6 +127,18 @@ static struct ipc_module* load_ipc_module (char* ipcName)
 }
 
 
+// Load the socket module of TRANSPORT ending in SUFFIX.
+static struct ipc_module* load_transport_module (const char* transport, const char* suffix)
+{
+  char ipc_name[48];
+
+  if (strlen (transport) + strlen (suffix) >= sizeof (ipc_name) || strchr (transport, '/') != NULL)
+    error (transport, "not a transport name");
+  snprintf (ipc_name, sizeof (ipc_name), "%s%s", transport, suffix);
+  return load_ipc_module (ipc_name);
+}
+
+
 // Interrupt handler to force the transmitter/received threads for safely finishing.
 void sigHandler(int sig)
 {
@@ -140,10 +154,31 @@ void sigHandler(int sig)
 }
 
 
+// Hand a key=value OPTION to whichever loaded module knows the key.
+static void apply_option (const char* option)
+{
+  char key[64];
+  const char* eq = strchr (option, '=');
+
+  if (eq == NULL || eq - option >= sizeof (key))
+    error (option, "options must be given as key=value");
+  memcpy (key, option, eq - option);
+  key[eq - option] = '\0';
+
+  if (!(*module_shmem->set_option_function) (key, eq + 1) &&
+      !(*module_sckt->set_option_function) (key, eq + 1))
+    error (option, "unknown option or malformed value");
+
+  fprintf(main_log_fd, "\n%s - INFO - isc - option %s", get_timestamp(), option);
+}
+
+
 // Main ISC core handler
-void isc_run (const char* net_prtcl, const char* dest_ip_addr, int dest_port, int is_client)
+void isc_run (const char* net_prtcl, const char* dest_ip_addr, int dest_port, int is_client,
+              const char* transport, char* const* options, int n_options)
 {
   bool ok = true;
+  int i;
   struct sigaction sa;
   memset (&sa, 0, sizeof (sa));
   sa.sa_handler = &sigHandler;
@@ -159,19 +194,27 @@ void isc_run (const char* net_prtcl, const char* dest_ip_addr, int dest_port, in
     fprintf(main_log_fd, "\n%s - INFO - isc - isc_run - server mode", get_timestamp());    // Loading IPC modules.
     // Loading IPC modules.
     module_shmem = load_ipc_module (ipc_name_shmem_rec);
-    module_sckt = load_ipc_module (ipc_name_sckt_server);
+    module_sckt = load_transport_module (transport, ipc_suffix_sckt_server);
+
+    for (i = 0; i < n_options; i++)
+      apply_option (options[i]);
 
-    (*module_shmem->init_function) (NULL, NULL);
-    (*module_sckt->init_function) (module_shmem->rec_function, NULL);
+    // The server reads straight into slots acquired from shmem_rec.
+    (*module_shmem->init_function) (NULL, NULL, module_sckt);
+    (*module_sckt->init_function) (module_shmem->rec_function, NULL, module_shmem);
   }
   else {  // Client Operation Mode
     printf("\nisc - isc_run in client mode");
     fprintf(main_log_fd, "\n%s - INFO - isc - isc_run - client mode", get_timestamp());    // Loading IPC modules.
     module_shmem = load_ipc_module (ipc_name_shmem_xmit);
-    module_sckt = load_ipc_module (ipc_name_sckt_client);
+    module_sckt = load_transport_module (transport, ipc_suffix_sckt_client);
+
+    for (i = 0; i < n_options; i++)
+      apply_option (options[i]);
 
-    (*module_sckt->init_function) (NULL, NULL);
-    (*module_shmem->init_function) (NULL, module_sckt->xmit_function);
+    // The client sends straight from the producer's slots and releases them to shmem_xmit.
+    (*module_sckt->init_function) (NULL, NULL, module_shmem);
+    (*module_shmem->init_function) (NULL, module_sckt->xmit_function, module_sckt);
   }
 
 
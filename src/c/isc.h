@@ -6,7 +6,9 @@
  * @brief   For simplicity, all exported functions and variables are declared in
  *          a single header file, isc.h, which is included by the other files.
  *          Functions that are intended for use within a single compilation unit 
- *          only are declared static and are not declared in isc.h.
+ *          only are declared static and are not declared in isc.h. The io_uring
+ *          layer is declared apart, in uring.h, as it needs the io_uring kernel
+ *          headers.
  */
 
 #ifndef ISC_H
@@ -14,8 +16,10 @@
 
 #include <netinet/in.h>
 #include <sys/types.h>
+#include <stdint.h>
 #include <stdbool.h>
 #include <pthread.h>
+#include <sys/uio.h>
 
 /*********************************************************************************** 
  * S y m b o l s   d e f i n e d   i n   c o m m o n . c . 
@@ -111,6 +115,34 @@ int binary_semaphore_wait (int semid);
  */
 int binary_semaphore_post (int semid);
 
+/* A wakeup primitive which lives inside a shared memory segment: a futex word
+ * bumped by every post, plus the number of threads sleeping on it so that a post
+ * costs no syscall while nobody waits. A zero filled struct is ready to use.
+ */
+struct shm_notify {
+  uint32_t seq;
+  uint32_t waiters;
+};
+
+/* Register as a waiter and return the ticket to pass to shm_notify_wait. The
+ * caller must re-check its wake condition after this call and either wait or
+ * cancel.
+ */
+uint32_t shm_notify_prepare_wait (struct shm_notify* notify);
+
+/* Drop a registration made by shm_notify_prepare_wait without sleeping.
+ */
+void shm_notify_cancel_wait (struct shm_notify* notify);
+
+/* Sleep until a post newer than TICKET arrives or TIMEOUT seconds pass (0 waits
+ * forever), then drop the registration. Returns -1 on failure.
+ */
+int shm_notify_wait (struct shm_notify* notify, uint32_t ticket, double timeout);
+
+/* Wake every waiter. Returns immediately, without a syscall, if nobody waits.
+ */
+int shm_notify_post (struct shm_notify* notify);
+
 
 void print_time ();
 
@@ -118,6 +150,182 @@ void print_time ();
  */
 char* get_timestamp ();
 
+/* Seconds on the monotonic clock; only differences between two calls mean anything.
+ */
+double get_monotonic_time ();
+
+/* Header in front of every message on an isc connection, so the receiver gets the
+ * messages back whole however TCP splits or merges the stream: LEN payload bytes
+ * follow on channel CHANNEL, SEQ numbers the messages of a connection from 0. FLAGS
+ * are the ISC_FLAG_ ones below; receivers ignore the ones they don't know.
+ */
+struct isc_frame_hdr {
+  uint32_t len;
+  uint16_t channel;
+  uint16_t flags;
+  uint64_t seq;
+};
+
+#define ISC_FRAME_HDR_SIZE ((uint32_t) sizeof (struct isc_frame_hdr))
+
+/* Largest message payload; a header announcing more is a protocol error. */
+#define ISC_FRAME_MAX SHM_MAX_RECORD
+
+/* Channel of the producer data */
+#define ISC_CHANNEL_DATA 0
+
+/* Channel of the messages a transport exchanges for itself; they aren't handed on */
+#define ISC_CHANNEL_CONTROL 1
+
+/* Flag of a message whose payload lies in the buffer shared over the connection: the
+ * message carries a struct isc_shared_ref to it instead. On ISC_CHANNEL_CONTROL, the
+ * message hands over the shared buffer itself, as a file descriptor (SCM_RIGHTS).
+ */
+#define ISC_FLAG_SHARED 0x0001
+
+/* Payload of a message flagged ISC_FLAG_SHARED, in network byte order: LEN bytes at
+ * position POS of the shared buffer, which lie at POS modulo its size and don't wrap.
+ */
+struct isc_shared_ref {
+  uint64_t pos;
+  uint32_t len;
+  uint32_t reserved;
+};
+
+/* Head of a shared buffer, in the byte order of the host; the data follows at
+ * ISC_SHARED_DATA. The receiver moves HEAD up to the position of the data it took
+ * out, which the sender may then reuse.
+ */
+struct isc_shared_hdr {
+  uint64_t head;
+};
+
+#define ISC_SHARED_DATA 64
+
+/* Flag of the message on ISC_CHANNEL_CONTROL which opens each of the connections a
+ * client stripes its messages over; its payload is a struct isc_stripe_hello.
+ */
+#define ISC_FLAG_STRIPE 0x0002
+
+/* Payload of a message flagged ISC_FLAG_STRIPE, in network byte order: the
+ * connection is stream STREAM of the STREAMS connections of session SESSION. Their
+ * messages are numbered in one sequence, and the receiver hands them on in its order.
+ */
+struct isc_stripe_hello {
+  uint64_t session;
+  uint16_t stream;
+  uint16_t streams;
+  uint32_t reserved;
+};
+
+/* Most connections a message stream is striped over */
+#define ISC_MAX_STREAMS 16
+
+/* Flags of the empty messages on ISC_CHANNEL_CONTROL which a client sends when it
+ * has had nothing to send for a while, to show that the link is alive, and when a
+ * stream of a session ends for good, rather than breaking off to be resumed.
+ */
+#define ISC_FLAG_HEARTBEAT 0x0004
+#define ISC_FLAG_BYE 0x0008
+
+/* Flag of the message on ISC_CHANNEL_CONTROL which carries a struct isc_ack. A client
+ * sends one on each of its connections to ask for acknowledgements; the server then
+ * answers over the same connections as it hands messages on.
+ */
+#define ISC_FLAG_ACK 0x0010
+
+/* Payload of a message flagged ISC_FLAG_ACK, in network byte order. From the client,
+ * WINDOW is the most messages it wants to have unacknowledged at a time. From the
+ * server, every message numbered below SEQ was handed on or given up, and WINDOW is
+ * the most it grants. Acknowledgements are cumulative: a later one covers the earlier.
+ */
+struct isc_ack {
+  uint64_t seq;
+  uint32_t window;
+  uint32_t reserved;
+};
+
+/* Flag of a message on ISC_CHANNEL_DATA whose payload is preceded by its CRC32C, in
+ * network byte order; LEN counts the ISC_FRAME_CRC_SIZE bytes of it. The receiver
+ * checks it and hands on the payload alone.
+ */
+#define ISC_FLAG_CRC 0x0020
+#define ISC_FRAME_CRC_SIZE 4
+
+/* Fill WIRE with a header in network byte order.
+ */
+void isc_frame_encode (struct isc_frame_hdr* wire, uint32_t len, uint16_t channel,
+                       uint16_t flags, uint64_t seq);
+
+/* Read the network byte order header at WIRE, which need not be aligned, into HDR.
+ */
+void isc_frame_decode (const void* wire, struct isc_frame_hdr* hdr);
+
+/* Header in front of every datagram of the UDP transport. A message too large for
+ * one datagram is cut into FRAGS fragments, numbered FRAG from 0; each carries the
+ * LEN bytes of the whole message, SEQ, CHANNEL and FLAGS as the frame header does,
+ * and the OFFSET of its part of the payload, which fills the rest of the datagram.
+ */
+struct isc_dgram_hdr {
+  uint64_t seq;
+  uint32_t len;
+  uint32_t offset;
+  uint16_t channel;
+  uint16_t flags;
+  uint16_t frag;
+  uint16_t frags;
+};
+
+#define ISC_DGRAM_HDR_SIZE ((uint32_t) sizeof (struct isc_dgram_hdr))
+
+/* Bytes of the IPv4 and UDP headers in front of a datagram on the link */
+#define ISC_DGRAM_OVERHEAD 28
+
+/* Smallest and largest MTU the UDP transport works with; at the smallest, the
+ * largest message takes fewer than ISC_DGRAM_MAX_FRAGS fragments.
+ */
+#define ISC_DGRAM_MIN_MTU 576
+#define ISC_DGRAM_MAX_MTU 65535
+#define ISC_DGRAM_MAX_FRAGS 256
+
+/* Fill WIRE with HDR in network byte order.
+ */
+void isc_dgram_encode (struct isc_dgram_hdr* wire, const struct isc_dgram_hdr* hdr);
+
+/* Read the network byte order header at WIRE, which need not be aligned, into HDR.
+ */
+void isc_dgram_decode (const void* wire, struct isc_dgram_hdr* hdr);
+
+/* Flag of a datagram whose header is followed by a struct isc_fec_hdr, ahead of the
+ * payload: it is one of the K data datagrams of a group of the forward error
+ * correction, or, on ISC_CHANNEL_FEC, one of its M parity datagrams. A parity datagram
+ * covers each data datagram of its group as a symbol: its length without the
+ * isc_fec_hdr, as 2 bytes in network order, then those bytes, padded with zeros to
+ * the longest of the group. LEN of the parity datagram is that symbol size, FRAG the
+ * parity row and FRAGS M; the other fields are 0. Any K of the K + M datagrams of a
+ * group give back the K data datagrams (see fec.c).
+ */
+#define ISC_FLAG_FEC 0x0040
+#define ISC_CHANNEL_FEC 2
+
+/* Follows the header of a datagram flagged ISC_FLAG_FEC: the datagram is number
+ * INDEX of group GROUP, in network byte order; data datagrams come first, numbered
+ * from 0 to K - 1, then the parity ones.
+ */
+struct isc_fec_hdr {
+  uint32_t group;
+  uint8_t index;
+  uint8_t k;
+  uint8_t m;
+  uint8_t reserved;
+};
+
+#define ISC_FEC_HDR_SIZE ((uint32_t) sizeof (struct isc_fec_hdr))
+
+/* Most data and parity datagrams in a group */
+#define ISC_FEC_MAX_K 128
+#define ISC_FEC_MAX_M 32
+
 
 /*********************************************************************************** 
  * S y m b o l s   d e f i n e d   i n   m o d u l e . c 
@@ -132,9 +340,13 @@ struct ipc_module {
   /* A name describing the module. 
    */
   const char* name;
-  /* The function is used to initialize the loadable IPC module.
+  /* The function is used to initialize the loadable IPC module. PEER is the module
+     on the other side of this one in the pipeline (may be NULL); buffers are
+     acquired from and released to it.
    */
-  void (* init_function) (void (*ipc_rec)(uint8_t *buf, int32_t bufSize), void (*ipc_xmit)(uint8_t *buf, int32_t bufSize));
+  void (* init_function) (void (*ipc_rec)(uint8_t *buf, int32_t bufSize),
+                          void (*ipc_xmit)(uint8_t *buf, int32_t bufSize),
+                          struct ipc_module* peer);
   /* The function is used to clean up the loadable IPC module footage from memory.
    */
   void (* cleanup_function) ();
@@ -142,6 +354,11 @@ struct ipc_module {
      shared memory, or PCIe) to another process.
    */
   uint32_t (* xmit_function) (uint8_t *buf, int32_t bufSize);
+  /* The function transmits IOVCNT chunks at once, with a single system call where the
+     interface allows it, and returns the number of bytes sent. The chunk buffers are
+     released to the peer one by one, in order, just as if each went through xmit.
+   */
+  uint32_t (* xmitv_function) (const struct iovec *iov, int32_t iovCnt);
   /* The function is used to receive data from PCIe and and then
      copy data footage into IPC module (i.e. shared memory) for processing in this SoC.
    */
@@ -150,6 +367,32 @@ struct ipc_module {
   bool (* wait4Done_function) ();
   bool (* set_param_function) (const char* prtcl, const char *addr, int port);
   void (* rec_function) (uint8_t *buf, int32_t bufSize);
+  /* The function is used to set a named option (key=value on the command line).
+     It returns false if the module doesn't know the key or the value is malformed.
+   */
+  bool (* set_option_function) (const char* key, const char* value);
+  /* Buffer leases, so a chunk can cross the isc without being copied:
+     - acquire lends a writable buffer of *bufSize bytes owned by the module. It
+       returns NULL, claiming nothing, if the module has no room for that many bytes
+       right now or doesn't lend buffers at all; the caller then falls back to rec.
+     - commit hands an acquired buffer back carrying bufSize bytes; a size of 0
+       abandons the lease.
+     - release gives back a buffer the module passed on through the xmit callback.
+       Whoever receives a buffer that way owns it until it calls release on the
+       module it came from (its peer), in the order the buffers were received. The
+       release may come from another thread than the xmit call, for instance once
+       the kernel is done with a zero-copy send.
+   */
+  uint8_t* (* acquire_function) (int32_t *bufSize);
+  void (* commit_function) (uint8_t *buf, int32_t bufSize);
+  void (* release_function) (uint8_t *buf);
+  /* The function returns how much room the module has right now (its credits), in
+     units of its own, or -1 if it doesn't do flow control; shmem_rec counts the free
+     slots of its ring, and a chunk may take several. A module feeding it stops reading
+     its input while it has no credits. Credits don't promise that the next chunk
+     fits: only acquire tells, by lending the buffer.
+   */
+  int32_t (* credits_function) ();
 };
 
 
@@ -169,22 +412,428 @@ extern struct ipc_module* ipc_open (const char* module_path);
 extern void ipc_close (struct ipc_module* module);
 
 
+/* Hand the message of LEN bytes at BUF, received by a server module, on to its PEER:
+ * copied into a record acquired from PEER if it does flow control, else passed to
+ * REC. Returns false, leaving the message where it is, while PEER has no room for it.
+ */
+extern bool ipc_hand_on (struct ipc_module* peer,
+                         void (*rec) (uint8_t *buf, int32_t bufSize),
+                         uint8_t* buf, uint32_t len);
+
+
 /* Make a 1K shared memory segment for producer */
 #define PROD_SHM_SIZE 512
 #define PROD_TEST_REGION_SIZE PROD_SHM_SIZE
 
 
 /* Make a 1K shared memory segment for consumer */
-#define CONS_SHM_SIZE 512 
+#define CONS_SHM_SIZE 512
 #define CONS_TEST_REGION_SIZE CONS_SHM_SIZE
 
 
+/* Payload bytes per slot of the producer and consumer shared memory rings, and the
+ * number of slots. A record takes as many adjacent slots as its payload needs, so a
+ * small message costs one slot while the rings still take records of
+ * SHM_MAX_RECORD bytes.
+ */
+#define SHM_SLOT_SIZE 64
+#define SHM_MAX_RECORD (64 * 1024)
+#define PROD_RING_SLOTS 4096
+#define CONS_RING_SLOTS 4096
+
+
+/* Longest single sleep, in seconds, of the threads waiting on a shared memory ring,
+ * so that stop requests are noticed even if no wakeup arrives.
+ */
+#define SHM_WAIT_TIMEOUT 0.1
+
+
+/***********************************************************************************
+ * S y m b o l s   d e f i n e d   i n   s h m e m _ s e g . c .
+************************************************************************************/
+
+/* Shared memory segment backends.
+ */
+enum shm_backend {
+  SHM_BACKEND_SYSV,
+  SHM_BACKEND_POSIX,
+  SHM_BACKEND_HUGETLBFS
+};
+
+/* How a consumer waits for data on an empty ring:
+ * - block: sleep on the futex at once. Costs no CPU, for power constrained boards.
+ * - spin: poll the ring until data arrives or the timeout passes. Lowest latency,
+ *   but burns a core.
+ * - spin_yield: poll for spin_us microseconds, then go on polling but yield the
+ *   CPU between polls.
+ * - adaptive: poll for up to spin_us microseconds while recent chunks arrived within
+ *   that time, and sleep on the futex once they no longer do or the poll runs out.
+ * With pause set, the poll loop relaxes the CPU (pause/yield instruction) between
+ * polls, which spares the sibling hyperthread and some power.
+ */
+enum shm_wait_mode {
+  SHM_WAIT_BLOCK,
+  SHM_WAIT_SPIN,
+  SHM_WAIT_SPIN_YIELD,
+  SHM_WAIT_ADAPTIVE
+};
+
+struct shm_wait_strategy {
+  enum shm_wait_mode mode;
+  uint32_t spin_us;
+  bool pause;
+};
+
+/* Run-time configuration of the shared memory segments. A zero size or slot size
+ * keeps the compile-time default of the segment.
+ */
+struct shm_seg_config {
+  enum shm_backend backend;
+  size_t size;
+  uint32_t slot_size;
+  bool huge_pages;
+  bool prefault;
+  bool lock;
+  const char* hugetlbfs_dir;
+  bool drop_laggards;
+  struct shm_wait_strategy wait;
+};
+
+extern struct shm_seg_config shm_config;
+
+/* A mapped shared memory segment.
+ */
+struct shm_segment {
+  void* base;
+  size_t size;
+  enum shm_backend backend;
+  int shmid;
+  char path[256];
+  bool huge;
+  bool locked;
+};
+
+/* Set the shm_config field named KEY (shm_backend, shm_size, shm_slot_size, shm_huge,
+ * shm_prefault, shm_mlock or shm_hugetlbfs_dir) from VALUE. Sizes take a K, M or G
+ * suffix; shm_slot_size is at most SHM_MAX_RECORD. Returns false if the key is
+ * unknown or the value malformed or out of range, leaving shm_config as it was.
+ */
+bool shm_seg_set_option (const char* key, const char* value);
+
+/* Like shm_seg_set_option, for an OPTION of the form key=value.
+ */
+bool shm_seg_parse_option (const char* option);
+
+/* Create or attach the segment named by the key file KEY_PATH according to shm_config.
+ * SIZE is used unless shm_config overrides it; an existing segment keeps its size.
+ * Returns -1 on failure.
+ */
+int shm_segment_open (struct shm_segment* seg, const char* key_path, size_t size);
+
+/* Unmap SEG, and remove it from the system if DESTROY is set.
+ */
+int shm_segment_close (struct shm_segment* seg, bool destroy);
+
+/* Payload bytes per ring slot: the configured shm_slot_size or DEFAULT_SIZE.
+ */
+uint32_t shm_segment_slot_size (uint32_t default_size);
+
+
+/***********************************************************************************
+ * S y m b o l s   d e f i n e d   i n   s h m e m _ r i n g . c .
+************************************************************************************/
+
+#define SHM_CACHE_LINE 64
+#define SHM_RING_MAGIC 0x524E4732  /* "RNG2" */
+
+/* Most consumer processes which can read one ring at the same time */
+#define SHM_RING_MAX_READERS 8
+
+/* Cursor of a consumer process reading a broadcast ring: the position of the oldest
+ * slot it still holds, its pid, and whether the entry is free, in use or dropped.
+ */
+struct shm_ring_reader {
+  uint64_t cursor;
+  uint32_t state;
+  int32_t pid;
+} __attribute__ ((aligned (SHM_CACHE_LINE)));
+
+/* Header at the start of a shared memory ring segment. The producer owned head and
+ * the consumer owned tail live on separate cache lines, as do the notifications
+ * the consumer sleeps on while the ring is empty and the producer while it is full.
+ * On a broadcast ring every reader owns a cursor instead and tail is the oldest
+ * cursor as last seen by the producer.
+ */
+struct shm_ring_hdr {
+  uint32_t magic;
+  uint32_t state;
+  uint32_t slot_count;
+  uint32_t slot_size;
+  uint64_t head __attribute__ ((aligned (SHM_CACHE_LINE)));
+  uint64_t tail __attribute__ ((aligned (SHM_CACHE_LINE)));
+  struct shm_notify data_ready __attribute__ ((aligned (SHM_CACHE_LINE)));
+  struct shm_notify space_ready __attribute__ ((aligned (SHM_CACHE_LINE)));
+  struct shm_ring_reader readers[SHM_RING_MAX_READERS];
+} __attribute__ ((aligned (SHM_CACHE_LINE)));
+
+/* Types of the records in a ring. Application types start at SHM_RECORD_DATA;
+ * padding fills the slots left at the end of the ring when a record doesn't fit
+ * there, and is never handed to the consumer.
+ */
+#define SHM_RECORD_PAD  0
+#define SHM_RECORD_DATA 1
+
+/* Header framing a record: LEN payload bytes of type TYPE, spanning SLOTS adjacent
+ * slots. SEQ is set to the ring position plus one once the record is published, so
+ * the consumer can tell a published record from one still being written by another
+ * producer; records are numbered in the order they were claimed.
+ */
+struct shm_record_hdr {
+  uint32_t len;
+  uint16_t type;
+  uint16_t slots;
+  uint64_t seq;
+};
+
+/* Process local handle to a ring living in shared memory.
+ */
+struct shm_ring {
+  struct shm_ring_hdr* hdr;
+  struct shm_record_hdr* records;
+  uint8_t* slots;
+  uint32_t slot_size;
+  uint32_t mask;
+  uint32_t pad;
+  uint32_t need;
+  uint64_t cached_tail;
+  uint64_t read;
+  int reader;
+  bool drop_laggards;
+  double stalled_since;
+  uint64_t lost;
+  struct shm_wait_strategy wait;
+  double avg_wait;
+};
+
+/* Size in bytes of a segment holding SLOT_COUNT slots of PAYLOAD_SIZE bytes each,
+ * plus the record headers. The headers live in an array of their own, so the
+ * payload of a record spanning several slots is contiguous.
+ */
+size_t shm_ring_segment_size (uint32_t slot_count, uint32_t payload_size);
+
+/* Attach RING to the segment at BASE. The first process to attach lays out the
+ * header, everyone else adopts the geometry stored in the segment. Returns -1 if
+ * the segment doesn't hold a ring.
+ */
+int shm_ring_attach (struct shm_ring* ring, void* base, uint32_t slot_count,
+                     uint32_t payload_size);
+
+/* Open the segment named by the key file KEY_PATH through shm_segment_open and attach
+ * RING to it. SLOT_COUNT and PAYLOAD_SIZE give the default geometry; shm_config may
+ * override both, and an existing segment keeps its own. Returns -1 on failure.
+ */
+int shm_ring_open (struct shm_ring* ring, struct shm_segment* seg, const char* key_path,
+                   uint32_t slot_count, uint32_t payload_size);
+
+/* Largest power of two number of slots of PAYLOAD_SIZE bytes fitting in SEG_SIZE bytes.
+ */
+uint32_t shm_ring_slots_for_size (size_t seg_size, uint32_t payload_size);
+
+/* Payload bytes per slot.
+ */
+uint32_t shm_ring_payload_size (const struct shm_ring* ring);
+
+/* Largest record the ring takes: the payload of half its slots, at most
+ * 65535 slots.
+ */
+uint32_t shm_ring_max_record (const struct shm_ring* ring);
+
+/* Producer: largest record which can be reserved right now, in bytes.
+ */
+uint32_t shm_ring_room (struct shm_ring* ring);
+
+/* Number of claimed or published slots which aren't released yet.
+ */
+uint32_t shm_ring_count (const struct shm_ring* ring);
+
+/* Producer: return the contiguous payload area of a record of up to LEN bytes, or
+ * NULL if the ring is too full right now. Fails with EMSGSIZE if LEN exceeds
+ * shm_ring_max_record.
+ */
+uint8_t* shm_ring_reserve (struct shm_ring* ring, uint32_t len);
+
+/* Producer: publish the reserved record holding LEN bytes (no more than were
+ * reserved) of type TYPE and wake the consumer if it sleeps.
+ */
+void shm_ring_publish (struct shm_ring* ring, uint32_t len, uint16_t type);
+
+/* Producer, one of many: claim room for a record of up to LEN bytes for this
+ * process, storing its ring position in POS. Returns its payload area, or NULL if
+ * the ring is too full (or, with EMSGSIZE, if LEN exceeds shm_ring_max_record).
+ * Any number of processes may claim records concurrently, but a ring written through
+ * shm_ring_claim must not also be written through shm_ring_reserve.
+ */
+uint8_t* shm_ring_claim (struct shm_ring* ring, uint32_t len, uint64_t* pos);
+
+/* Producer, one of many: publish the record claimed at POS holding LEN bytes (no more
+ * than were claimed) of type TYPE. The consumer sees records in the order they were
+ * claimed.
+ */
+void shm_ring_commit (struct shm_ring* ring, uint64_t pos, uint32_t len, uint16_t type);
+
+/* Producer: sleep until the ring has room for the record the last reserve or claim
+ * failed to get, or TIMEOUT seconds pass.
+ */
+int shm_ring_wait_space (struct shm_ring* ring, double timeout);
+
+/* Consumer: lease the next published record, returning its header, or NULL if there
+ * is nothing new. The record stays valid until it is released.
+ */
+const struct shm_record_hdr* shm_ring_read_record (struct shm_ring* ring);
+
+/* Consumer: payload of the record with header REC.
+ */
+uint8_t* shm_ring_record_payload (const struct shm_ring* ring,
+                                  const struct shm_record_hdr* rec);
+
+/* Consumer: whether the record with header REC, leased last, still held what was
+ * read from it. Call it once done reading the record, before releasing it or reading
+ * the next; a reader dropped meanwhile may have read slots the producer reused, and
+ * gets false.
+ */
+bool shm_ring_valid (const struct shm_ring* ring, const struct shm_record_hdr* rec);
+
+/* Consumer: like shm_ring_read_record, returning the payload of the record and
+ * storing its length in LEN.
+ */
+uint8_t* shm_ring_read (struct shm_ring* ring, uint32_t* len);
+
+/* Consumer: payload of the oldest leased record, or NULL if nothing is leased.
+ */
+uint8_t* shm_ring_oldest (struct shm_ring* ring);
+
+/* Consumer: give the oldest leased record back to the producer and wake the producer
+ * if it sleeps on a full ring. Records are released in the order they were read.
+ */
+void shm_ring_release (struct shm_ring* ring);
+
+/* Producer: number of slots which can be reserved right now.
+ */
+uint32_t shm_ring_free (struct shm_ring* ring);
+
+/* Consumer: sleep until the ring holds unread data or TIMEOUT seconds pass.
+ */
+int shm_ring_wait_data (struct shm_ring* ring, double timeout);
+
+/* Consumer: wait until the ring holds unread data or TIMEOUT seconds pass, the way
+ * RING->wait says (taken from shm_config by shm_ring_open).
+ */
+int shm_ring_await_data (struct shm_ring* ring, double timeout);
+
+/* Consumer: join the ring as one of several readers, each of which sees every record.
+ * The reader starts at the oldest record the ring still holds. The producer doesn't
+ * reuse a slot before every reader released it, unless RING->drop_laggards is set in
+ * the producer: then a reader which holds the ring full for a while, trailing the
+ * fastest reader by more than half the ring, is dropped. A dropped reader rejoins by
+ * itself on its next read and the slots it missed are added to RING->lost. Returns -1
+ * if all reader entries are taken. Readers and a plain consumer must not share a ring.
+ */
+int shm_ring_join (struct shm_ring* ring);
+
+/* Consumer: leave the readers of the ring. Returns the number of readers left.
+ */
+int shm_ring_leave (struct shm_ring* ring);
+
+
+/***********************************************************************************
+ * S y m b o l s   d e f i n e d   i n   s c k t _ t u n e . c .
+************************************************************************************/
+
+/* Socket options of the sckt modules, as named by PROFILE: TCP_NODELAY (-1 leaves the
+ * kernel's choice), TCP_QUICKACK re-armed after every read, SO_SNDBUF and SO_RCVBUF
+ * in bytes, SO_BUSY_POLL in microseconds, SO_PRIORITY (-1 leaves it), and
+ * TCP_NOTSENT_LOWAT in bytes, where 0 leaves the kernel's choice; plus the backlog
+ * of the listening socket.
+ */
+struct sckt_tuning {
+  const char* profile;
+  int nodelay;
+  int quickack;
+  int sndbuf;
+  int rcvbuf;
+  int busy_poll;
+  int priority;
+  int notsent_lowat;
+  int listenq;
+};
+
+/* The tuning of this isc instance, the default profile unless options say otherwise.
+ */
+extern struct sckt_tuning sckt_tuning;
+
+/* Set T from the option KEY=VALUE: sckt_profile (default, latency, throughput or
+ * lowmem) sets all of it, and sckt_nodelay, sckt_quickack, sckt_sndbuf, sckt_rcvbuf,
+ * sckt_busy_poll, sckt_priority, sckt_notsent_lowat or sckt_listenq one field.
+ * Returns false if the key is unknown or the value malformed.
+ */
+bool sckt_tune_set_option (struct sckt_tuning* t, const char* key, const char* value);
+
+/* Set the options of T on the socket FD, a TCP one if TCP, ahead of connect or listen.
+ * Options the kernel refuses are logged as warnings of MODULE.
+ */
+void sckt_tune_socket (const struct sckt_tuning* t, int fd, bool tcp, const char* module);
+
+/* Put the TCP socket FD back into quick ack mode after a read, if T asks for it.
+ */
+void sckt_tune_rearm (const struct sckt_tuning* t, int fd);
+
+/* Log the profile of T and the options in effect on the socket FD, as MODULE.
+ */
+void sckt_tune_log (const struct sckt_tuning* t, int fd, bool tcp, const char* module);
+
+
+/***********************************************************************************
+ * S y m b o l s   d e f i n e d   i n   c r c 3 2 c . c .
+************************************************************************************/
+
+/* The CRC32C of the LEN bytes at BUF, carried on from CRC, the CRC32C of the bytes in
+ * front of them (0 to start with). It runs on the SSE4.2 or ARMv8 crc32 instructions
+ * where the CPU has them; isc_crc32c_sw always runs on tables.
+ */
+uint32_t isc_crc32c (uint32_t crc, const void* buf, size_t len);
+uint32_t isc_crc32c_sw (uint32_t crc, const void* buf, size_t len);
+
+/* What isc_crc32c runs on: "sse4.2", "armv8" or "table".
+ */
+const char* isc_crc32c_impl ();
+
+
+/***********************************************************************************
+ * S y m b o l s   d e f i n e d   i n   f e c . c .
+************************************************************************************/
+
+/* Add the share of data symbol COL, the LEN bytes at SRC, to parity row ROW, the LEN
+ * bytes at PARITY, which start out as zeros. Row 0 is the XOR of the data symbols.
+ */
+void isc_fec_add (uint8_t* parity, int row, int col, const void* src, size_t len);
+
+/* Rebuild the data symbols of a group of K with M parity rows: SYM holds its K + M
+ * symbols of LEN bytes, data first, and HAVE tells which arrived. The missing data
+ * symbols are filled in and marked in HAVE. Returns how many, or -1 if more are
+ * missing than parity rows arrived.
+ */
+int isc_fec_recover (uint8_t* const* sym, bool* have, int k, int m, size_t len);
+
+
 /*********************************************************************************** 
  * S y m b o l s   d e f i n e d   i n   i s c . c . 
 ***********************************************************************************/
 
-/* Run the Inter SoC Communication kernel. 
+/* Run the Inter SoC Communication kernel. TRANSPORT names the socket modules
+ * loaded, TRANSPORT_server.so or TRANSPORT_client.so: "sckt" (epoll), "uring" or
+ * "unix" (Unix SOCK_SEQPACKET, on the same host).
  */
-extern void isc_run (const char* net_prtcl, const char* dest_ip_addr, int dest_port, int is_client);
+extern void isc_run (const char* net_prtcl, const char* dest_ip_addr, int dest_port, int is_client,
+                     const char* transport, char* const* options, int n_options);
 
 #endif /* ISC_H */
@@ -36,11 +36,14 @@ static const struct option long_options[] = {
   { "port", 0, NULL, 'p' },
   { "client", 0, NULL, 'c' },
   { "module-dir", 1, NULL, 'm' },
+  { "option", 1, NULL, 'o' },
+  { "transport", 1, NULL, 't' },
+  { "profile", 1, NULL, 'P' },
   { "verbose", 0, NULL, 'v' },
 };
 
 // Description of short options for getopt_long.
-static const char* const short_options = "h:l:a:p:c:m:v";
+static const char* const short_options = "h:l:a:p:c:m:o:t:P:v";
 
 // Usage summary text.
 static const char* const usage_template =
@@ -56,6 +59,16 @@ static const char* const usage_template =
   " (by default, use executable directory).\n"
   " -m, --module-dir DIR Load modules from specified directory\n"
   " (by default, use executable directory).\n"
+  " -o, --option KEY=VALUE Set a module option, may be repeated.\n"
+  " (e.g. shm_size=4M, shm_backend=sysv|posix|hugetlbfs, shm_slot_size,\n"
+  "  shm_huge=1, shm_prefault=1, shm_mlock=1, shm_hugetlbfs_dir=DIR).\n"
+  " -t, --transport NAME Socket transport modules: sckt (epoll), uring (io_uring)\n"
+  " or unix (Unix domain sockets, on the same host).\n"
+  " (by default, use sckt).\n"
+  " -P, --profile NAME Socket tuning profile of the sckt and uring transports:\n"
+  " default, latency, throughput or lowmem; -o sckt_... options override its\n"
+  " values. Not for unix.\n"
+  " (by default, use default).\n"
   " -v, --verbose Print verbose messages.\n";
 
 // Print usage information and exit. If IS_ERROR is nonzero, write to
@@ -89,6 +102,14 @@ int main (int argc, char* const argv[])
   // The destination server port number
   int dest_port = SERVER_PORT;
 
+  // The socket transport, which names the modules loaded
+  char* transport = "sckt";
+
+  // The key=value module options, in command line order, after the tuning profile
+  char** options = NULL;
+  int n_options = 0;
+  char* profile = NULL;
+
   // Open the main log file for writing. If it exists, append to it;
   // otherwise, create a new file.
   main_log_fd = fopen (main_log_filename, "w");
@@ -161,6 +182,24 @@ int main (int argc, char* const argv[])
         }
         break;
 
+      case 'o':
+        // User specified -o or --option.
+        {
+          options = (char**) xrealloc (options, (n_options + 1) * sizeof (char*));
+          options[n_options++] = xstrdup (optarg);
+        }
+        break;
+
+      case 't':
+        // User specified -t or --transport.
+        transport = xstrdup (optarg);
+        break;
+
+      case 'P':
+        // User specified -P or --profile.
+        profile = xstrdup (optarg);
+        break;
+
       case 'v':
         // User specified -v or --verbose.
         verbose = 1;
@@ -190,8 +229,22 @@ int main (int argc, char* const argv[])
   }
   fprintf (main_log_fd, "\n%s - INFO - main - modules will be loaded from %s.", get_timestamp(), module_dir);
 
+  // The profile goes first, so that the single options given with -o override it.
+  if (profile != NULL) {
+    // Unix domain sockets have none of the TCP options a profile sets.
+    if (strcmp (transport, "unix") == 0) {
+      fprintf (stderr, "error: -P applies to the TCP transports (sckt, uring) only, not to %s\n", transport);
+      fprintf (main_log_fd, "\n%s - ERROR - main - -P applies to the TCP transports only, not to %s.", get_timestamp(), transport);
+      exit (1);
+    }
+    options = (char**) xrealloc (options, (n_options + 1) * sizeof (char*));
+    memmove (options + 1, options, n_options++ * sizeof (char*));
+    options[0] = (char*) xmalloc (strlen ("sckt_profile=") + strlen (profile) + 1);
+    sprintf (options[0], "sckt_profile=%s", profile);
+  }
+
   // Run the isc.
-  isc_run (net_prtcl, dest_ip_addr, dest_port, is_client);
+  isc_run (net_prtcl, dest_ip_addr, dest_port, is_client, transport, options, n_options);
 
   return 0;
 }
@@ -6,10 +6,12 @@
  * @brief   producer.c runs on the same machine as isc but on a different process. 
  *          It connects via shared memory to the client thread of Inter SoC 
  *          Communication (ISC) module and feeds the produced data to that process.
+ *          Any number of producers may run at once; they share one ring.
+ *          Each message is published as one record of its own length (-s, 16 bytes
+ *          to 64 KB).
  */
 
 #include <sys/ipc.h>
-#include <sys/sem.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <stdio.h>
@@ -24,6 +26,7 @@
 #include <sys/shm.h>
 #include <stdint.h>
 #include <signal.h>
+#include <getopt.h>
 #include "isc.h"
 
 
@@ -36,12 +39,12 @@
 
 uint8_t *prod_test_buff = NULL;
 
-// Shared Memory Key and Binary Semaphore
-key_t prod_semkey;
-int prod_semid;
-key_t prod_shmkey;
-int prod_shmid;
-char *prod_shm;
+// Size of the test messages, in bytes
+static uint32_t msg_size = PROD_TEST_REGION_SIZE;
+
+// Shared Memory segment and the slot ring inside it
+struct shm_segment prod_seg;
+struct shm_ring prod_ring;
 
 // The file to which to append the log string.
 const char* main_log_filename = "producer.log";
@@ -54,34 +57,14 @@ void ipc_init ()
   printf("\nproducer:ipc_init\n");
   fprintf(main_log_fd, "\n%s - INFO - producer - ipc_init", get_timestamp ());
 
-  // Get unique key for shared memory; The /tmp/prod_shmem_key file must exist!
-  if ((prod_shmkey = ftok("/tmp/prod_shmem_key", 'R')) == -1){
-    system_error ("producer - prod_shmkey ftok");
-  }
-
-
-  // Create the segment
-  if ((prod_shmid = shmget(prod_shmkey, PROD_SHM_SIZE, 0644 | IPC_CREAT)) == -1) {
-    system_error ("producer - shmem create the segment");
-  }
-
-  // Attach to the segment to get a pointer to it
-  prod_shm = shmat(prod_shmid, (void *)0, 0);
-  if (prod_shm == (char *)(-1)) {
-    system_error ("producer - shmem attach to the segment");
-  }
-
-  // Get unique key for semaphore.
-  if ((prod_semkey = ftok("/tmp/prod_sem_key", 'R')) == (key_t) -1) {
-    system_error ("producer - prod_sem_key ftok");
-  }
-
-  if ((prod_semid = binary_semaphore_allocation (prod_semkey, 0644 | IPC_CREAT)) == -1 ) {
-    system_error ("producer - binary_semaphore_allocation");
+  // Create or attach the segment and the slot ring inside it;
+  // The /tmp/prod_shmem_key file must exist!
+  if (shm_ring_open (&prod_ring, &prod_seg, "/tmp/prod_shmem_key", PROD_RING_SLOTS, SHM_SLOT_SIZE) == -1) {
+    system_error ("producer - shm_ring_open");
   }
 
-  if (binary_semaphore_initialize (prod_semid) == -1 ) {
-    system_error ("producer - binary_semaphore_initialize: prod_semid");
+  if (shm_ring_max_record (&prod_ring) < msg_size) {
+    error ("producer", "the ring can't take a message this large");
   }
 }
 
@@ -92,10 +75,8 @@ void ipc_cleanup ()
   printf("\nproducer:ipc_cleanup\n");
   fprintf(main_log_fd, "\n%s - INFO - producer - ipc_cleanup", get_timestamp ());
 
-  //binary_semaphore_deallocate(prod_semid);
-
   // Detach from the segment
-  if (shmdt(prod_shm) == -1) {
+  if (shm_segment_close (&prod_seg, false) == -1) {
     system_error ("producer - Detach from the segment");
   }
 }
@@ -117,7 +98,20 @@ static void free_all(void)
 // Main entry
 int main(int argc, char *argv[])
 {
-  int i, j, init1 = 1;
+  int i, j, init1 = 1, c;
+  uint8_t *slot;
+  uint64_t pos;
+
+  // Parse options; -s BYTES sets the message size and every -o KEY=VALUE configures
+  // the shared memory segment.
+  while ((c = getopt (argc, argv, "s:o:")) != -1) {
+    if (c == 's' && (msg_size = atoi (optarg)) >= 1 && msg_size <= SHM_MAX_RECORD)
+      continue;
+    if (c != 'o' || !shm_seg_parse_option (optarg)) {
+      fprintf (stderr, "Usage: %s [ -s message_size ] [ -o shm_option=value ]...\n", argv[0]);
+      exit (1);
+    }
+  }
 
   atexit(free_all);
 
@@ -130,32 +124,40 @@ int main(int argc, char *argv[])
 
   ipc_init();
 
-  prod_test_buff = (uint8_t *) malloc(PROD_TEST_REGION_SIZE);
+  prod_test_buff = (uint8_t *) malloc(msg_size);
   if (!prod_test_buff) {
     system_error ("producer - can't alloc the prod_test_buff.");
   }
 
-  for (i = 0; i < PROD_TEST_REGION_SIZE-1; i++)
+  for (i = 0; i < msg_size-1; i++)
     prod_test_buff[i] = BUFFER_INIT1 + i;
-  prod_test_buff[PROD_TEST_REGION_SIZE-1] = '\0';
+  prod_test_buff[msg_size-1] = '\0';
 
   for (j = 0; j < 1; j++) {
-    strncpy (prod_shm, prod_test_buff, PROD_SHM_SIZE);
+    // Claim a record of our own; other producers may write to the ring at the same
+    // time. Wait for room if the isc has fallen behind.
+    while ((slot = shm_ring_claim (&prod_ring, msg_size, &pos)) == NULL)
+      shm_ring_wait_space (&prod_ring, SHM_WAIT_TIMEOUT);
 
-    binary_semaphore_post (prod_semid);
+    // The message is binary; copy all of it, zero bytes included.
+    memcpy (slot, prod_test_buff, msg_size);
 
+    // Log the record before publishing it; once published it may be sent and reused.
     printf ("\n%s - INFO - Xmited(%i) - ", get_timestamp (), j);
     fprintf (main_log_fd, "\n%s - INFO - producer - Xmited(%i) - ", get_timestamp (), j);
 #if 1    
-    for (i = 0; i < PROD_TEST_REGION_SIZE; i++)
-      fprintf (main_log_fd, "0x%X,", prod_shm[i] & 0x000000FF);
+    for (i = 0; i < msg_size; i++)
+      fprintf (main_log_fd, "0x%X,", slot[i] & 0x000000FF);
 #endif
+
+    // Publishing wakes the xmit thread only if it sleeps on an empty ring
+    shm_ring_commit (&prod_ring, pos, msg_size, SHM_RECORD_DATA);
     if (init1) {
-      for (i = 0; i < PROD_TEST_REGION_SIZE-1; i++)
+      for (i = 0; i < msg_size-1; i++)
         prod_test_buff[i] = prod_test_buff[i]+ BUFFER_INIT2 + i;
       init1 = 0;
     } else {
-      for (i = 0; i < PROD_TEST_REGION_SIZE-1; i++)
+      for (i = 0; i < msg_size-1; i++)
         prod_test_buff[i] = prod_test_buff[i] + BUFFER_INIT1 + i;
       init1 = 1;
     }
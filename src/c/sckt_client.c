@@ -11,8 +11,30 @@
  *          Internally, this module connects to the transmitter shared memory and
  *          connects to the sckt_server module externally.
  *          This module implements epoll socket client thread.
+ *          Whatever the socket doesn't take at once goes into a bounded outbound
+ *          queue, which the client thread drains as the socket becomes writable.
+ *          Optionally, large chunks are sent with MSG_ZEROCOPY straight from their
+ *          shared memory slot, which goes back to the producer only once the kernel
+ *          reports through the socket error queue that it is done with it.
+ *          With udp, the messages go out as datagrams (see struct isc_dgram_hdr),
+ *          cut into fragments which fit the MTU, in batches of one sendmmsg call.
+ *          Nothing is queued or sent again: a datagram the socket doesn't take is
+ *          lost, as is one the network loses, unless sckt_fec_k adds parity
+ *          datagrams from which the server rebuilds it (see ISC_FLAG_FEC).
+ *          Over tcp, the messages may be striped over several connections, each
+ *          with its own outbound queue; the server puts them back in order by
+ *          their sequence numbers (see struct isc_stripe_hello).
+ *          A broken link is reconnected, with exponential backoff, while the
+ *          messages queue up. Heartbeats and TCP keepalive make a dead link show
+ *          within sckt_dead_ms. With sckt_replay, the queues keep what the server's
+ *          TCP hasn't acknowledged yet and send it again on the new link.
+ *          With sckt_ack_window, the server acknowledges the messages it handed on
+ *          (see struct isc_ack): no more than the window it grants are in flight at a
+ *          time, replay keeps only what it didn't acknowledge, and the round trip
+ *          from ipc_xmitv to the acknowledgement is measured.
  */
 
+#define _GNU_SOURCE   // sendmmsg, getrandom
 
 #include <string.h>
 #include <sys/wait.h>
@@ -40,6 +62,20 @@
 #include <netdb.h>    // NI_MAXHOST, NI_MAXSERV
 #include <netinet/tcp.h>
 #include <sys/epoll.h>
+#include <time.h>
+#include <poll.h>
+#include <endian.h>
+#include <sys/random.h>
+#include <sys/ioctl.h>
+#include <linux/sockios.h>    // SIOCOUTQ
+#include <linux/errqueue.h>
+
+#ifndef MSG_ZEROCOPY
+#define MSG_ZEROCOPY 0x4000000
+#endif
+#ifndef SO_ZEROCOPY
+#define SO_ZEROCOPY 60
+#endif
 
 #include "isc.h"
 
@@ -50,8 +86,10 @@
 ************************************************************************************/
 #define MAXBUF 1024
 #define MAX_EPOLL_EVENTS 64
+// How long the client thread waits for events before it checks for ipc_stop, in
+// milliseconds; a datagram socket has no connection whose end would wake it.
+#define EPOLL_TIMEOUT 1000
 
-static const int MAXEVENTS = 128;
 #define IOBUFFSIZE 2048
 
 
@@ -63,9 +101,10 @@ static FILE *log_fd = NULL;
 // Client Thread Name
 static const char *threadNameClient  = "SocketClient";
 
-// Flag to indicate whether client is connected,
-// or if it is already connected, should continue
+// Flag to indicate whether the client runs, until ipc_stop, and whether its
+// connections to the server are up
 static bool Connected;
+static bool Linked;
 
 
 // Transport type TCP/UDP
@@ -76,9 +115,9 @@ static char *ServerAddr;
 static int ConnPort;
 // Socket address family
 static int AddrFamily;
+// SOCK_STREAM, or SOCK_DGRAM for udp
+static int SocketType;
 
-// Client socket file descriptor
-static int client_sockfd = 0;
 // Client process ID
 static pthread_t ClientProcID;
  
@@ -87,15 +126,231 @@ static pthread_t ClientProcID;
 static bool ClientProcActive;
 static void *scktClientThread(void *pArg);
 static void scktClientProc(); // In Listen mode, handles new connections and inbound data.
+struct scktStream;
+static void scktFlush(struct scktStream *st);
+static void txqPut(struct scktStream *st, const uint8_t *buf, size_t bufSize);
+static void txqSettle(struct scktStream *st);
+static void scktHeartbeat(struct scktStream *st, double now);
+static bool scktReceive(struct scktStream *st);
+static ssize_t scktSendIov(struct scktStream *st, struct iovec *iov, int cnt, int flags);
+static void scktDeadline(int fd);
+static bool scktSocketError(struct scktStream *st);
+static void scktReapZerocopy();
+static void holdRelease();
+static void udpError(int err);
 
 
 // Callback function to feed data to the next chain in pipeline
 void (*recCallbackFunctionType)(uint8_t *buf, int32_t bufSize);
 
+// The shared memory module on the other side of this one
+static struct ipc_module* peer;
+
+// Most messages per sendmsg: each takes two iovecs, its frame header and its
+// payload, and the kernel takes no more than 1024 (UIO_MAXIOV).
+#define MAX_FRAMES_PER_SEND 512
+
+// What goes in front of the payload of a message: its frame header and, under
+// sckt_crc, the CRC32C of the payload (see ISC_FLAG_CRC), txHeadLen bytes in all
+struct txHead {
+  struct isc_frame_hdr hdr;
+  uint32_t crc;
+};
+static bool crc = false;
+static uint32_t txHeadLen = ISC_FRAME_HDR_SIZE;
+
+// Frame headers and iovecs of the messages being sent, and the sequence number of
+// the next message, which runs across the connections
+static struct txHead txHdr[MAX_FRAMES_PER_SEND];
+static struct iovec txIov[2 * MAX_FRAMES_PER_SEND];
+static uint64_t txSeq;
+
+// What ipc_xmitv does with a message the full outbound queue has no room for: wait
+// for the client thread to drain the queue, or drop the message.
+enum txqPolicy { TXQ_BLOCK, TXQ_DROP };
+
+// Outbound queues (options sckt_txq_bytes, sckt_txq_policy), one per connection:
+// the bytes of the frames the socket didn't take yet, [head, tail) of a circular
+// buffer of size bytes. It is at least as large as one frame, so the rest of a
+// message the socket took only part of always fits into the empty queue. Both the
+// xmit thread and the client thread send from them, holding txqLock; txqRoom is
+// signalled whenever one shrinks.
+#define TXQ_MIN_SIZE (ISC_FRAME_HDR_SIZE + ISC_FRAME_CRC_SIZE + ISC_FRAME_MAX)
+static size_t txqSize = 1024 * 1024;
+static enum txqPolicy txqPolicy = TXQ_BLOCK;
+static pthread_mutex_t txqLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t txqRoom = PTHREAD_COND_INITIALIZER;
+
+// A connection to the server with its outbound queue, the bytes which went through
+// the queue and its peak fill, the messages sent or queued, with their bytes, and
+// when it last sent anything. txqMark is where a frame starts in the queue. With
+// sckt_replay it trails txqHead: the frames before it were acknowledged by the
+// server's TCP, or by the server itself, and only their room is free. Else it is at
+// or ahead of txqHead: the bytes before it finish a frame the socket took part of.
+// What the server sent is read into rx, rxFill bytes of a header and its ack; other
+// messages are skipped, rxSkip bytes still to go.
+struct scktStream {
+  int fd;
+  uint8_t *txq;
+  uint64_t txqHead;
+  uint64_t txqTail;
+  uint64_t txqMark;
+  uint64_t txqQueued;
+  uint64_t txqPeak;
+  uint64_t frames;
+  uint64_t bytes;
+  double lastTx;
+  uint8_t rx[ISC_FRAME_HDR_SIZE + sizeof(struct isc_ack)];
+  uint32_t rxFill;
+  uint32_t rxSkip;
+};
+
+// The connections the messages are striped over (sckt_streams), which stream the
+// next one goes to when they tie, and the session they make up. With one, no hello
+// goes out and the connection is what it always was, unless it is to be resumed
+// (useSession).
+static struct scktStream streams[ISC_MAX_STREAMS];
+static int nStreams = 1;
+static int txNext;
+static uint64_t sessionId;
+static bool useSession;
+
+// Reconnecting (sckt_reconnect_ms, sckt_reconnect_max_ms): the first retry waits
+// about reconnectMs, each further one twice as long, up to reconnectMaxMs; with 0
+// the client gives up at the first break. A link which leaves data unacknowledged,
+// or keepalive probes unanswered, for deadMs (sckt_dead_ms; 0 for the kernel
+// defaults) is dead; a stream which had nothing to send for heartbeatMs
+// (sckt_heartbeat_ms; 0 for never) sends a heartbeat, so that there is something
+// to acknowledge. With replay (sckt_replay) every message goes through the queue.
+static uint32_t reconnectMs = 100;
+static uint32_t reconnectMaxMs = 5000;
+static uint32_t deadMs = 3000;
+static uint32_t heartbeatMs = 1000;
+static bool replay = false;
+
+// Links lost, the time in total (seconds) until they were back, the bytes sent
+// again after a reconnect, frames cut short by a break, and the heartbeats sent
+static uint64_t linkDowns;
+static double linkDownTime;
+static uint64_t replayedBytes;
+static uint64_t cutFrames;
+static uint64_t heartbeats;
+
+// Acknowledgements (sckt_ack_window; 0 for none): each stream asks the server for a
+// window of ackWant messages. Once it answers on the link (ackActive), no more than
+// the window granted (ackWindow) may be unacknowledged, from ackedSeq, the first
+// message it didn't acknowledge, on. One message at a time (probeSeq) is timed from
+// ipc_xmitv to its acknowledgement.
+static uint32_t ackWant = 0;
+static bool ackActive;
+static uint32_t ackWindow;
+static uint64_t ackedSeq;
+static bool probing;
+static uint64_t probeSeq;
+static double probeTime;
+
+// Acknowledgements received, how often and for how long in total (seconds) ipc_xmitv
+// waited for the window, messages not sent again as the server had them, and the
+// round trips measured: their number, least, sum, most and smoothed (RFC 6298) times
+static uint64_t acksReceived;
+static uint64_t windowWaits;
+static double windowWaitTime;
+static uint64_t ackSkipped;
+static uint64_t rttCount;
+static double rttMin, rttSum, rttMax, rttSmooth;
+
+// The messages of a batch dealt out to each stream, MAX_FRAMES_PER_SEND apiece, and
+// their sequence numbers
+static struct iovec stripeIov[ISC_MAX_STREAMS * MAX_FRAMES_PER_SEND];
+static uint64_t stripeSeq[ISC_MAX_STREAMS * MAX_FRAMES_PER_SEND];
+
+// How long ipc_xmitv waits for room at a time before it checks the connection again
+#define TXQ_WAIT_TIMEOUT 0.1
+
+// How long the client waits at the end for the server to close the connections, in
+// milliseconds
+#define BYE_TIMEOUT 500
+
+// Messages dropped on overflow, and how often and for how long in total (seconds)
+// ipc_xmitv waited for room
+static uint64_t txqDropped;
+static uint64_t txqWaits;
+static double txqWaitTime;
+
+// Zero-copy sends (options sckt_zerocopy, sckt_zerocopy_min): payloads of at least
+// zcMin bytes leave with MSG_ZEROCOPY once the socket accepted SO_ZEROCOPY (zcActive).
+// The kernel numbers those sendmsg calls from 0; zcNext is the number of the next.
+// Which messages of the batch being sent went out that way, and their numbers:
+static bool zerocopy = false;
+static uint32_t zcMin = 32 * 1024;
+static bool zcActive;
+static uint32_t zcNext;
+static bool txZc[MAX_FRAMES_PER_SEND];
+static uint32_t txZcId[MAX_FRAMES_PER_SEND];
+
+// Slots passed on by the peer while zero-copy sends are on, in the order received,
+// as a circular array of holdSize entries. A slot goes back to the peer once it and
+// every slot before it are no longer waiting for the kernel (zc cleared).
+struct txHold {
+  uint8_t *buf;
+  uint32_t zcId;
+  bool zc;
+};
+static struct txHold *hold;
+static uint32_t holdSize;
+static uint32_t holdHead;
+static uint32_t holdCnt;
+
+// Zero-copy sendmsg calls and their bytes, completions reported, and how many of
+// those the kernel had to copy after all (loopback, no scatter-gather in the NIC)
+static uint64_t zcCalls;
+static uint64_t zcBytes;
+static uint64_t zcCompleted;
+static uint64_t zcCopied;
+
+// Most datagrams per sendmmsg, each with four iovecs: its header, its place in the
+// group of the forward error correction under sckt_fec_k, the CRC of the message in
+// the first fragment under sckt_crc, and its fragment of the payload
+#define UDP_BATCH 64
+
+// MTU of the link (sckt_udp_mtu), which bounds the datagrams with their IP and UDP
+// headers, and the datagrams being put together for the next sendmmsg
+static int udpMtu = 1500;
+static struct isc_dgram_hdr udpHdr[UDP_BATCH];
+static struct isc_fec_hdr udpFec[UDP_BATCH];
+static uint32_t udpCrc[UDP_BATCH];
+static struct iovec udpIov[4 * UDP_BATCH];
+static struct mmsghdr udpMsg[UDP_BATCH];
+
+// Forward error correction: groups of up to fecK data datagrams (sckt_fec_k, 0 for
+// none) with fecM parity datagrams each (sckt_fec_m). The group being sent, how many
+// data datagrams it has and how many of them went out, the parity rows summed up so
+// far over fecLen bytes, which are zeros beyond; the groups and parity datagrams sent.
+static uint32_t fecK = 0;
+static uint32_t fecM = 1;
+static uint32_t fecGroup;
+static uint32_t fecCount;
+static uint32_t fecIndex;
+static uint8_t *fecParity[ISC_FEC_MAX_M];
+static uint32_t fecLen;
+static uint64_t fecGroups;
+static uint64_t fecSent;
+
+// Datagrams sent and sendmmsg calls, datagrams dropped because the socket buffer was
+// full (sckt_txq_policy drop) or the send failed, and sends refused as nobody
+// listened on the port (reported by ICMP, for an earlier datagram)
+static uint64_t udpDatagrams;
+static uint64_t udpCalls;
+static uint64_t udpDropped;
+static uint64_t udpRefused;
+
 
 // Interface function as a constructor
-void ipc_init (void (*ipc_rec)(uint8_t *buf, int32_t bufSize), void (*ipc_xmit)(uint8_t *buf, int32_t bufSize))
+void ipc_init (void (*ipc_rec)(uint8_t *buf, int32_t bufSize), void (*ipc_xmit)(uint8_t *buf, int32_t bufSize),
+               struct ipc_module* ipc_peer)
 {
+  int i;
+
   if (verbose)
     printf("\nsckt_client - ipc_init\n");
   fprintf(main_log_fd, "\n%s - INFO - sckt_client - ipc_init", get_timestamp());
@@ -108,9 +363,30 @@ void ipc_init (void (*ipc_rec)(uint8_t *buf, int32_t bufSize), void (*ipc_xmit)(
   }
 
   recCallbackFunctionType = ipc_rec;
-  client_sockfd = 0;
+  peer = ipc_peer;
   Connected = false;
 
+  memset(streams, 0, sizeof(streams));
+  for (i = 0; i < nStreams; i++)
+    streams[i].txq = (uint8_t *) xmalloc(txqSize);
+  txNext = 0;
+  Linked = false;
+  linkDowns = replayedBytes = cutFrames = heartbeats = 0;
+  linkDownTime = 0;
+  txqDropped = txqWaits = 0;
+  txqWaitTime = 0;
+  ackActive = probing = false;
+  ackedSeq = 0;
+  acksReceived = windowWaits = ackSkipped = rttCount = 0;
+  windowWaitTime = rttMin = rttSum = rttMax = rttSmooth = 0;
+  zcActive = false;
+  zcNext = 0;
+  holdHead = holdCnt = 0;
+  zcCalls = zcBytes = zcCompleted = zcCopied = 0;
+  udpDatagrams = udpCalls = udpDropped = udpRefused = 0;
+  fecGroup = fecCount = fecIndex = fecLen = 0;
+  fecGroups = fecSent = 0;
+
   ClientProcActive = false;
 }
 
@@ -118,11 +394,74 @@ void ipc_init (void (*ipc_rec)(uint8_t *buf, int32_t bufSize), void (*ipc_xmit)(
 // Interface function as a destructor
 void ipc_cleanup ()
 {
+  struct scktStream *st;
+  uint64_t queued = 0, peak = 0;
+  int i;
+
   if (verbose)
     printf("\nsckt_client - ipc_cleanup\n");
   fprintf(main_log_fd, "\n%s - INFO - sckt_client - ipc_cleanup", get_timestamp());
+  for (i = 0; i < nStreams; i++) {
+    st = &streams[i];
+    if (nStreams > 1)
+      fprintf(main_log_fd, "\n%s - INFO - sckt_client - stream %d: %llu messages, %llu bytes, %llu bytes queued, peak %llu bytes",
+              get_timestamp(), i, (unsigned long long) st->frames, (unsigned long long) st->bytes,
+              (unsigned long long) st->txqQueued, (unsigned long long) st->txqPeak);
+    if (st->txqTail != st->txqHead)
+      fprintf(main_log_fd, "\n%s - WARNING - sckt_client - %llu queued bytes never sent",
+              get_timestamp(), (unsigned long long) (st->txqTail - st->txqHead));
+    queued += st->txqQueued;
+    if (st->txqPeak > peak)
+      peak = st->txqPeak;
+  }
+  fprintf(main_log_fd, "\n%s - INFO - sckt_client - outbound queue: %llu bytes queued, peak %llu bytes, %llu messages dropped, %llu waits for room taking %.3f s",
+          get_timestamp(), (unsigned long long) queued, (unsigned long long) peak,
+          (unsigned long long) txqDropped, (unsigned long long) txqWaits, txqWaitTime);
+  if (SocketType == SOCK_STREAM)
+    fprintf(main_log_fd, "\n%s - INFO - sckt_client - link: lost %llu times, down %.3f s in total, %llu bytes sent again, %llu messages cut short, %llu heartbeats",
+            get_timestamp(), (unsigned long long) linkDowns, linkDownTime, (unsigned long long) replayedBytes,
+            (unsigned long long) cutFrames, (unsigned long long) heartbeats);
+  if (ackWant > 0 && acksReceived == 0)
+    fprintf(main_log_fd, "\n%s - WARNING - sckt_client - the server sent no acknowledgements", get_timestamp());
+  else if (ackWant > 0) {
+    fprintf(main_log_fd, "\n%s - INFO - sckt_client - acknowledgements: %llu received, window %u, %llu waits for it taking %.3f s, %llu messages not sent again",
+            get_timestamp(), (unsigned long long) acksReceived, ackWindow, (unsigned long long) windowWaits,
+            windowWaitTime, (unsigned long long) ackSkipped);
+    if (rttCount > 0)
+      fprintf(main_log_fd, "\n%s - INFO - sckt_client - round trip to acknowledgement: %llu measured, min %.3f ms, avg %.3f ms, max %.3f ms, smoothed %.3f ms",
+              get_timestamp(), (unsigned long long) rttCount, rttMin * 1e3, rttSum / rttCount * 1e3,
+              rttMax * 1e3, rttSmooth * 1e3);
+  }
+  if (SocketType == SOCK_DGRAM)
+    fprintf(main_log_fd, "\n%s - INFO - sckt_client - udp: %llu datagrams in %llu sendmmsg calls, %llu dropped, %llu refused",
+            get_timestamp(), (unsigned long long) udpDatagrams, (unsigned long long) udpCalls,
+            (unsigned long long) udpDropped, (unsigned long long) udpRefused);
+  if (SocketType == SOCK_DGRAM && fecK > 0)
+    fprintf(main_log_fd, "\n%s - INFO - sckt_client - udp: %llu groups of up to %u datagrams, %llu parity datagrams",
+            get_timestamp(), (unsigned long long) fecGroups, fecK, (unsigned long long) fecSent);
+  for (i = 0; i < ISC_FEC_MAX_M; i++) {
+    free(fecParity[i]);
+    fecParity[i] = NULL;
+  }
+  if (zerocopy) {
+    fprintf(main_log_fd, "\n%s - INFO - sckt_client - zero-copy: %llu sends, %llu bytes, %llu completions, %llu copied by the kernel",
+            get_timestamp(), (unsigned long long) zcCalls, (unsigned long long) zcBytes,
+            (unsigned long long) zcCompleted, (unsigned long long) zcCopied);
+    if (zcCompleted > 0 && zcCopied == zcCompleted)
+      fprintf(main_log_fd, "\n%s - WARNING - sckt_client - the kernel copied every zero-copy send; sckt_zerocopy only adds overhead on this route",
+              get_timestamp());
+  }
 
-  if (client_sockfd>0) close(client_sockfd);
+  for (i = 0; i < ISC_MAX_STREAMS; i++) {
+    if (streams[i].fd > 0)
+      close(streams[i].fd);
+    streams[i].fd = 0;
+    free(streams[i].txq);
+    streams[i].txq = NULL;
+  }
+  free(hold);
+  hold = NULL;
+  holdSize = 0;
 
   // All done. Close the main log file.
   if (log_fd)
@@ -138,6 +477,8 @@ void ipc_stop()
   fprintf(main_log_fd, "\n%s - INFO - sckt_client - ipc_stop", get_timestamp());
 
   Connected = false;
+  // Let ipc_xmitv give up waiting for room
+  pthread_cond_broadcast(&txqRoom);
 }
   
 
@@ -166,18 +507,134 @@ bool ipc_set_param(const char* prtcl, const char *addr, int port)
     rval = false;
 
   if (rval) {
+    SocketType = (Protocol == IPPROTO_UDP) ? SOCK_DGRAM : SOCK_STREAM;
     ConnPort = port; // use PF_INET domain socket connection
     AddrFamily = AF_INET;
   }
 
   if (rval == true)
-    fprintf(main_log_fd, "\n%s - INFO - sckt_client - ipc_set_param - Protocol:%s, SocketType:SOCK_STREAM, ADDR:%s, PORT:%d.", get_timestamp(), prtcl, addr, ConnPort);
+    fprintf(main_log_fd, "\n%s - INFO - sckt_client - ipc_set_param - Protocol:%s, SocketType:%s, ADDR:%s, PORT:%d.", get_timestamp(), prtcl,
+            SocketType == SOCK_DGRAM ? "SOCK_DGRAM" : "SOCK_STREAM", addr, ConnPort);
   else
-    fprintf(main_log_fd, "\n%s - ERROR - sckt_client - ipc_set_param - Protocol:%s, SocketType:SOCK_STREAM, ADDR:%s, PORT:%d.", get_timestamp(), prtcl, addr, port);
+    fprintf(main_log_fd, "\n%s - ERROR - sckt_client - ipc_set_param - Protocol:%s, ADDR:%s, PORT:%d.", get_timestamp(), prtcl, addr, port);
   return (rval);
 }
 
 
+// Interface function to set a named configuration option
+bool ipc_set_option(const char* key, const char* value)
+{
+  char *end;
+  unsigned long n;
+
+  if (verbose)
+    printf("\nsckt_client - ipc_set_option\n");
+
+  if (sckt_tune_set_option(&sckt_tuning, key, value))
+    return true;
+  if (strcmp(key, "sckt_txq_bytes") == 0) {
+    n = strtoul(value, &end, 0);
+    if (*value == '\0' || *end != '\0' || n < TXQ_MIN_SIZE)
+      return false;
+    txqSize = n;
+    return true;
+  }
+  if (strcmp(key, "sckt_zerocopy") == 0) {
+    if (strcmp(value, "1") == 0)
+      zerocopy = true;
+    else if (strcmp(value, "0") == 0)
+      zerocopy = false;
+    else
+      return false;
+    return true;
+  }
+  if (strcmp(key, "sckt_zerocopy_min") == 0) {
+    n = strtoul(value, &end, 0);
+    if (*value == '\0' || *end != '\0' || n == 0 || n > ISC_FRAME_MAX)
+      return false;
+    zcMin = n;
+    return true;
+  }
+  if (strcmp(key, "sckt_txq_policy") == 0) {
+    if (strcmp(value, "block") == 0)
+      txqPolicy = TXQ_BLOCK;
+    else if (strcmp(value, "drop") == 0)
+      txqPolicy = TXQ_DROP;
+    else
+      return false;
+    return true;
+  }
+  if (strcmp(key, "sckt_udp_mtu") == 0) {
+    n = strtoul(value, &end, 0);
+    if (*value == '\0' || *end != '\0' || n < ISC_DGRAM_MIN_MTU || n > ISC_DGRAM_MAX_MTU)
+      return false;
+    udpMtu = n;
+    return true;
+  }
+  if (strcmp(key, "sckt_fec_k") == 0 || strcmp(key, "sckt_fec_m") == 0) {
+    n = strtoul(value, &end, 0);
+    if (*value == '\0' || *end != '\0')
+      return false;
+    if (strcmp(key, "sckt_fec_k") == 0 && n <= ISC_FEC_MAX_K)
+      fecK = n;
+    else if (strcmp(key, "sckt_fec_m") == 0 && n >= 1 && n <= ISC_FEC_MAX_M)
+      fecM = n;
+    else
+      return false;
+    return true;
+  }
+  if (strcmp(key, "sckt_reconnect_ms") == 0 || strcmp(key, "sckt_reconnect_max_ms") == 0 ||
+      strcmp(key, "sckt_dead_ms") == 0 || strcmp(key, "sckt_heartbeat_ms") == 0) {
+    n = strtoul(value, &end, 0);
+    if (*value == '\0' || *end != '\0' || n > 3600000)
+      return false;
+    if (strcmp(key, "sckt_reconnect_ms") == 0)
+      reconnectMs = n;
+    else if (strcmp(key, "sckt_reconnect_max_ms") == 0)
+      reconnectMaxMs = n;
+    else if (strcmp(key, "sckt_dead_ms") == 0)
+      deadMs = n;
+    else
+      heartbeatMs = n;
+    return true;
+  }
+  if (strcmp(key, "sckt_replay") == 0) {
+    if (strcmp(value, "1") == 0)
+      replay = true;
+    else if (strcmp(value, "0") == 0)
+      replay = false;
+    else
+      return false;
+    return true;
+  }
+  if (strcmp(key, "sckt_streams") == 0) {
+    n = strtoul(value, &end, 0);
+    if (*value == '\0' || *end != '\0' || n < 1 || n > ISC_MAX_STREAMS)
+      return false;
+    nStreams = n;
+    return true;
+  }
+  if (strcmp(key, "sckt_ack_window") == 0) {
+    n = strtoul(value, &end, 0);
+    if (*value == '\0' || *end != '\0' || n > UINT32_MAX)
+      return false;
+    ackWant = n;
+    return true;
+  }
+  if (strcmp(key, "sckt_crc") == 0) {
+    if (strcmp(value, "1") == 0)
+      crc = true;
+    else if (strcmp(value, "0") == 0)
+      crc = false;
+    else
+      return false;
+    txHeadLen = ISC_FRAME_HDR_SIZE + (crc ? ISC_FRAME_CRC_SIZE : 0);
+    return true;
+  }
+  return false;
+}
+
+
 // Interface function to start the thread 
 bool ipc_start()
 {
@@ -232,23 +689,18 @@ void *scktClientThread(void *pArg)
     printf("\nsckt_client - scktClientThread - clientproc started\n");
   fprintf(main_log_fd, "\n%s - INFO - sckt_client - clientproc started", get_timestamp());
 
+  // ClientProcActive stays set: ipc_start may not have seen it yet if the client
+  // gives up at once.
   ClientProcActive = true;
   scktClientProc();
-  ClientProcActive = false;
 
   fprintf(main_log_fd, "\n%s - INFO - sckt_client - clientproc exited", get_timestamp());
 }
 
 
-// Socket Clinet main thread process
-void scktClientProc()
+// Connect ST to the server. Returns false if the connect did not go through.
+static bool scktConnect(struct scktStream *st)
 {
-  if (verbose)
-    printf("\nsckt_client - scktClientProc starts");
-
-  // ///////////////////////////////////
-  // Connect Block Starts Here
-  {
   int len; 
   struct sockaddr_in address; // Server-side Network Address Structures 
   int result; 
@@ -256,7 +708,20 @@ void scktClientProc()
   if (verbose)
     printf("\nsckt_client - Trying to connect");
 
-  client_sockfd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0); // Set up client socket 
+  // Set up client socket. A datagram socket blocks while its buffer is full, unless
+  // the send says otherwise.
+  st->fd = socket(AF_INET, SocketType == SOCK_DGRAM ? SOCK_DGRAM : SOCK_STREAM | SOCK_NONBLOCK, 0);
+  sckt_tune_socket(&sckt_tuning, st->fd, SocketType == SOCK_STREAM, "sckt_client");
+  if (SocketType == SOCK_STREAM && deadMs > 0)
+    scktDeadline(st->fd);
+  if (zerocopy) {
+    int on = 1;
+
+    zcActive = (setsockopt(st->fd, SOL_SOCKET, SO_ZEROCOPY, &on, sizeof(on)) == 0);
+    if (!zcActive)
+      fprintf(main_log_fd, "\n%s - WARNING - sckt_client - SO_ZEROCOPY not supported, sending copies: %s",
+              get_timestamp(), strerror(errno));
+  }
   address.sin_family = AF_INET;
   address.sin_port = htons(ConnPort);
   if (inet_pton(AF_INET, ServerAddr, &address.sin_addr.s_addr) == 0) {
@@ -264,7 +729,7 @@ void scktClientProc()
     exit(errno);
   }
   len = sizeof(address); 
-  result = connect(client_sockfd, (struct sockaddr *)&address, len); 
+  result = connect(st->fd, (struct sockaddr *)&address, len); 
 
   int retVal = -1;
   socklen_t retValLen = sizeof(retVal);
@@ -274,6 +739,7 @@ void scktClientProc()
     if (verbose)
       printf("\nsckt_client - socket is ready for IO");
     fprintf(main_log_fd, "\n%s - INFO - sckt_client - socket is ready for IO", get_timestamp());
+    return true;
   }
   else if (errno == EINPROGRESS) {
     struct epoll_event newPeerConnectionEvent;
@@ -287,62 +753,306 @@ void scktClientProc()
       exit (2);
     }     
 
-    newPeerConnectionEvent.data.fd = client_sockfd;
+    newPeerConnectionEvent.data.fd = st->fd;
     newPeerConnectionEvent.events = EPOLLOUT | EPOLLIN | EPOLLERR;
 
-    if (epoll_ctl (epollFD, EPOLL_CTL_ADD, client_sockfd, &newPeerConnectionEvent) == -1) {
+    if (epoll_ctl (epollFD, EPOLL_CTL_ADD, st->fd, &newPeerConnectionEvent) == -1) {
       printf ("\nsckt_client - ERROR - Could not add the socket FD to the epoll FD list. Aborting!");
       fprintf(main_log_fd, "\n%s - ERROR - sckt_client - Could not add the socket FD to the epoll FD list. Aborting", get_timestamp());
       exit (2);
     }
 
-    numEvents = epoll_wait (epollFD, &processableEvents, 1, -1);
+    // A server out of reach doesn't answer at all.
+    numEvents = epoll_wait (epollFD, &processableEvents, 1, deadMs > 0 ? deadMs : -1);
+    close(epollFD);
 
+    if (numEvents == 0) {
+      fprintf(main_log_fd, "\n%s - ERROR - sckt_client - connect timed out", get_timestamp());
+      return false;
+    }
     if (numEvents < 0) {
       printf ("\nsckt_client - ERROR - Serious error in epoll setup: epoll_wait () returned < 0 status!");
       fprintf(main_log_fd, "\n%s - ERROR - sckt_client - Serious error in epoll setup: epoll_wait () returned < 0 status", get_timestamp());
       exit (2);
     }
 
-    if (getsockopt (client_sockfd, SOL_SOCKET, SO_ERROR, &retVal, &retValLen) < 0) {
+    if (getsockopt (st->fd, SOL_SOCKET, SO_ERROR, &retVal, &retValLen) < 0) {
       // ERROR, fail somehow, close socket
       printf ("\nsckt_client - ERROR - fail somehow, close socket!");
       fprintf(main_log_fd, "\n%s - ERROR - sckt_client - fail somehow, close socket", get_timestamp());
+      return false;
     }
 
     if (retVal != 0) {
       // ERROR: connect did not "go through"
       printf ("\nsckt_client - ERROR - connect did not go through!");
       fprintf(main_log_fd, "\n%s - ERROR - sckt_client - connect did not go through", get_timestamp());
+      return false;
     }   
+    return true;
   }
   else {
     // ERROR: connect did not "go through" for other non-recoverable reasons.
     printf ("\ndckt_client - ERROR - Connect did not go through for other non-recoverable reasons!");
     fprintf(main_log_fd, "\n%s - ERROR - sckt_client - connect did not go through for other non-recoverable reasons", get_timestamp());
+    return false;
+  }
+}
+
+
+// Send the hello which opens stream STREAM of the session on the new connection ST,
+// before anything else goes out on it. Returns false if the socket didn't take it.
+static bool scktHello(struct scktStream *st, int stream)
+{
+  struct iovec iov[2];
+  struct isc_frame_hdr hdr;
+  struct isc_stripe_hello hello;
+
+  isc_frame_encode(&hdr, sizeof(hello), ISC_CHANNEL_CONTROL, ISC_FLAG_STRIPE, 0);
+  memset(&hello, 0, sizeof(hello));
+  hello.session = htobe64(sessionId);
+  hello.stream = htobe16(stream);
+  hello.streams = htobe16(nStreams);
+  iov[0].iov_base = &hdr;
+  iov[0].iov_len = ISC_FRAME_HDR_SIZE;
+  iov[1].iov_base = &hello;
+  iov[1].iov_len = sizeof(hello);
+  return scktSendIov(st, iov, 2, 0) == ISC_FRAME_HDR_SIZE + sizeof(hello);
+}
+
+
+// Ask the server, on the new connection ST, to acknowledge what it hands on, within a
+// window of sckt_ack_window messages. Returns false if the socket didn't take it.
+static bool scktAckRequest(struct scktStream *st)
+{
+  struct iovec iov[2];
+  struct isc_frame_hdr hdr;
+  struct isc_ack ack;
+
+  isc_frame_encode(&hdr, sizeof(ack), ISC_CHANNEL_CONTROL, ISC_FLAG_ACK, 0);
+  memset(&ack, 0, sizeof(ack));
+  ack.window = htobe32(ackWant);
+  iov[0].iov_base = &hdr;
+  iov[0].iov_len = ISC_FRAME_HDR_SIZE;
+  iov[1].iov_base = &ack;
+  iov[1].iov_len = sizeof(ack);
+  return scktSendIov(st, iov, 2, 0) == ISC_FRAME_HDR_SIZE + sizeof(ack);
+}
+
+
+// Have the kernel take the connection FD for dead once data has gone unacknowledged
+// for sckt_dead_ms, or an idle one hasn't answered keepalive probes for about as long.
+static void scktDeadline(int fd)
+{
+  unsigned int timeout = deadMs;
+  int on = 1, probe = deadMs >= 6000 ? deadMs / 3000 : 1, cnt = deadMs >= 6000 ? 3 : 2;
+
+  if (setsockopt(fd, IPPROTO_TCP, TCP_USER_TIMEOUT, &timeout, sizeof(timeout)) == -1 ||
+      setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &on, sizeof(on)) == -1 ||
+      setsockopt(fd, IPPROTO_TCP, TCP_KEEPIDLE, &probe, sizeof(probe)) == -1 ||
+      setsockopt(fd, IPPROTO_TCP, TCP_KEEPINTVL, &probe, sizeof(probe)) == -1 ||
+      setsockopt(fd, IPPROTO_TCP, TCP_KEEPCNT, &cnt, sizeof(cnt)) == -1)
+    fprintf(main_log_fd, "\n%s - WARNING - sckt_client - can't set the dead link timeouts: %s",
+            get_timestamp(), strerror(errno));
+}
+
+
+// Connect every stream and have it watched by EPFD, its events carrying the stream
+// number; the streams of a session say hello first, then they ask for
+// acknowledgements if they are to. The queues go out on the new link from where the
+// last one left off. Returns false if a stream didn't connect.
+static bool scktLinkUp(int epfd)
+{
+  struct epoll_event ev;
+  int s;
+
+  for (s = 0; s < nStreams; s++) {
+    if (!scktConnect(&streams[s]))
+      return false;
+    if (useSession && !scktHello(&streams[s], s)) {
+      fprintf(main_log_fd, "\n%s - ERROR - sckt_client - stream %d didn't take its hello", get_timestamp(), s);
+      return false;
+    }
+    streams[s].rxFill = streams[s].rxSkip = 0;
+    if (ackWant > 0 && !scktAckRequest(&streams[s])) {
+      fprintf(main_log_fd, "\n%s - ERROR - sckt_client - stream %d didn't take its ack request", get_timestamp(), s);
+      return false;
+    }
+    // EPOLLOUT reports a socket becoming writable again after a send found it full,
+    // which is when its outbound queue is drained.
+    ev.data.u32 = s;
+    ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    // A datagram socket is never full for long, and it has no connection to lose.
+    if (SocketType == SOCK_DGRAM)
+      ev.events = EPOLLIN | EPOLLET;
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, streams[s].fd, &ev) == -1) {
+      fprintf(main_log_fd, "\n%s - ERROR - sckt_client - epoll_ctl_add failed: %s", get_timestamp(), strerror(errno));
+      return false;
+    }
   }
 
-  Connected = true;
+  pthread_mutex_lock(&txqLock);
+  Linked = true;
+  for (s = 0; s < nStreams; s++) {
+    streams[s].lastTx = get_monotonic_time();
+    scktFlush(&streams[s]);
   }
-  // Connect Block Ends Here
-  // ///////////////////////////////////
+  pthread_mutex_unlock(&txqLock);
+  return true;
+}
 
-  if (verbose)
-    printf("\nsckt_client - connected");
-  fprintf(main_log_fd, "\n%s - INFO - sckt_client - connected", get_timestamp());
 
+// Close the connections of the streams, after a break or at the end. With
+// sckt_replay, a stream goes on from its first frame the server didn't acknowledge;
+// else the rest of a frame the socket took part of is dropped, and what is in flight
+// counts as acknowledged, as it won't be sent again. The window applies again once
+// the server answers on the new link.
+static void scktLinkDown()
+{
+  struct scktStream *st;
+  uint32_t i;
+  int s;
+
+  pthread_mutex_lock(&txqLock);
+  Linked = false;
+  ackActive = probing = false;
+  if (!replay)
+    ackedSeq = txSeq;
+  for (s = 0; s < ISC_MAX_STREAMS; s++) {
+    st = &streams[s];
+    if (st->fd > 0)
+      close(st->fd);
+    st->fd = 0;
+    if (st->txq == NULL)
+      continue;
+    if (replay)
+      replayedBytes += st->txqHead - st->txqMark;
+    else if (st->txqMark > st->txqHead)
+      cutFrames++;
+    st->txqHead = st->txqMark;
+  }
+
+  // The kernel won't report on the zero-copy sends under way any more; their slots
+  // go back to the producer.
+  for (i = 0; i < holdCnt; i++)
+    hold[(holdHead + i) % holdSize].zc = false;
+  holdRelease();
+  zcActive = false;
+  zcNext = 0;
+  pthread_cond_broadcast(&txqRoom);
+  pthread_mutex_unlock(&txqLock);
+}
+
+
+// Wait about DELAY seconds before the next try to connect, unless the client is
+// stopped meanwhile. The wait is drawn from [DELAY/2, DELAY], so that clients which
+// lost the same server don't all come back at once.
+static void scktBackoff(double delay)
+{
+  double until = get_monotonic_time() + delay * (0.5 + 0.5 * (rand() / (RAND_MAX + 1.0)));
 
-  // ///////////////////////////////////
-  // Client Block Starts Here
-  struct epoll_event newPeerConnectionEvent;
+  while (Connected && get_monotonic_time() < until)
+    usleep(10000);
+}
+
+
+// Tell the server, on each stream whose queue went out whole, that it ends here.
+// With acknowledgements coming back, the client then waits a little for the server to
+// close the connections, reading what it still sends: closing a socket with data
+// unread resets the connection, which may take the bye with it.
+static void scktBye()
+{
+  struct isc_frame_hdr hdr;
+  struct pollfd pfd[ISC_MAX_STREAMS];
+  double until = get_monotonic_time() + BYE_TIMEOUT / 1000.0, now;
+  int s, open = 0;
+
+  // The server may be gone already; then it doesn't matter.
+  isc_frame_encode(&hdr, 0, ISC_CHANNEL_CONTROL, ISC_FLAG_BYE, 0);
+  pthread_mutex_lock(&txqLock);
+  for (s = 0; s < nStreams; s++)
+    if (streams[s].fd > 0 && streams[s].txqHead == streams[s].txqTail)
+      send(streams[s].fd, &hdr, ISC_FRAME_HDR_SIZE, MSG_DONTWAIT | MSG_NOSIGNAL);
+  pthread_mutex_unlock(&txqLock);
+  if (ackWant == 0)
+    return;
+
+  for (s = 0; s < nStreams; s++) {
+    pfd[s].fd = streams[s].fd > 0 ? streams[s].fd : -1;
+    pfd[s].events = POLLIN;
+    if (pfd[s].fd >= 0) {
+      shutdown(pfd[s].fd, SHUT_WR);
+      open++;
+    }
+  }
+  while (open > 0 && (now = get_monotonic_time()) < until &&
+         poll(pfd, nStreams, (int) ((until - now) * 1000) + 1) > 0) {
+    pthread_mutex_lock(&txqLock);
+    for (s = 0; s < nStreams; s++) {
+      if (pfd[s].fd >= 0 && pfd[s].revents != 0 && !scktReceive(&streams[s])) {
+        pfd[s].fd = -1;
+        open--;
+      }
+    }
+    pthread_mutex_unlock(&txqLock);
+  }
+}
+
+
+// Socket Clinet main thread process
+void scktClientProc()
+{
   struct epoll_event processableEvents[MAX_EPOLL_EVENTS];
-  
-  int EPFD = epoll_create(5);
+  struct scktStream *st;
+  double delay = 0, downSince = 0, now;
+  int s, e, cnt, EPFD;
+
+  if (verbose)
+    printf("\nsckt_client - scktClientProc starts");
 
-  if (EPFD == -1) {
+  txSeq = 0;
+  if (nStreams > 1 && SocketType == SOCK_DGRAM) {
+    fprintf(main_log_fd, "\n%s - WARNING - sckt_client - sckt_streams applies to tcp only", get_timestamp());
+    nStreams = 1;
+  }
+  if (replay && SocketType == SOCK_DGRAM) {
+    fprintf(main_log_fd, "\n%s - WARNING - sckt_client - sckt_replay applies to tcp only", get_timestamp());
+    replay = false;
+  }
+  if (zerocopy && SocketType == SOCK_DGRAM) {
+    fprintf(main_log_fd, "\n%s - WARNING - sckt_client - sckt_zerocopy applies to tcp only", get_timestamp());
+    zerocopy = false;
+  }
+  if (ackWant > 0 && SocketType == SOCK_DGRAM) {
+    fprintf(main_log_fd, "\n%s - WARNING - sckt_client - sckt_ack_window applies to tcp only", get_timestamp());
+    ackWant = 0;
+  }
+  if (zerocopy && (nStreams > 1 || replay)) {
+    fprintf(main_log_fd, "\n%s - WARNING - sckt_client - sckt_zerocopy applies to a single stream without sckt_replay only", get_timestamp());
+    zerocopy = false;
+  }
+  if (fecK > 0 && SocketType == SOCK_STREAM) {
+    fprintf(main_log_fd, "\n%s - WARNING - sckt_client - sckt_fec_k applies to udp only", get_timestamp());
+    fecK = 0;
+  }
+  for (s = 0; s < (int) (fecK > 0 ? fecM : 0); s++) {
+    fecParity[s] = (uint8_t *) xmalloc(udpMtu);
+    memset(fecParity[s], 0, udpMtu);
+  }
+  if (fecK > 0)
+    fprintf(main_log_fd, "\n%s - INFO - sckt_client - forward error correction: %u parity datagrams per group of up to %u",
+            get_timestamp(), fecM, fecK);
+  useSession = (nStreams > 1 || replay);
+  if (crc)
+    fprintf(main_log_fd, "\n%s - INFO - sckt_client - messages carry the CRC32C of their payload, computed with %s",
+            get_timestamp(), isc_crc32c_impl());
+  if (getrandom(&sessionId, sizeof(sessionId), 0) != sizeof(sessionId))
+    sessionId = ((uint64_t) getpid() << 32) ^ (uint64_t) (get_monotonic_time() * 1e9);
+  srand(sessionId);
+
+  if ( (EPFD = epoll_create(5)) == -1) {
     printf("\nsckt_client - ERROR - epoll_create failed, client thread exiting");
     fprintf(main_log_fd, "\n%s - ERROR - sckt_client - epoll_create failed, client thread exiting", get_timestamp());
-    Connected = false;
     return;
   }
 
@@ -350,102 +1060,1018 @@ void scktClientProc()
   #define EPOLLRDHUP 0x2000
   #endif
 
-  newPeerConnectionEvent.data.fd = client_sockfd;
-  newPeerConnectionEvent.events = EPOLLIN | EPOLLRDHUP | EPOLLET; // | EPOLLOUT
+  // Until ipc_stop, messages queue up while the link is down.
+  Connected = true;
+  while (Connected) {
+    // ///////////////////////////////////
+    // Connect Block Starts Here
+    if (!scktLinkUp(EPFD)) {
+      scktLinkDown();
+      if (reconnectMs == 0 || SocketType == SOCK_DGRAM)
+        break;
+      if (downSince == 0)
+        downSince = get_monotonic_time();
+      delay = delay == 0 ? reconnectMs / 1000.0 : 2 * delay;
+      if (delay > reconnectMaxMs / 1000.0)
+        delay = reconnectMaxMs / 1000.0;
+      scktBackoff(delay);
+      continue;
+    }
+    if (downSince > 0) {
+      fprintf(main_log_fd, "\n%s - INFO - sckt_client - link back after %.3f s", get_timestamp(),
+              get_monotonic_time() - downSince);
+      linkDownTime += get_monotonic_time() - downSince;
+    }
+    delay = downSince = 0;
+    if (verbose)
+      printf("\nsckt_client - connected");
+    fprintf(main_log_fd, "\n%s - INFO - sckt_client - connected", get_timestamp());
+    if (linkDowns == 0)
+      sckt_tune_log(&sckt_tuning, streams[0].fd, SocketType == SOCK_STREAM, "sckt_client");
+    if (nStreams > 1)
+      fprintf(main_log_fd, "\n%s - INFO - sckt_client - session %016llx striped over %d streams",
+              get_timestamp(), (unsigned long long) sessionId, nStreams);
+    // Connect Block Ends Here
+    // ///////////////////////////////////
+
+    // ///////////////////////////////////
+    // Client Block Starts Here
+    while (Connected && Linked) {
+      cnt = epoll_wait(EPFD, processableEvents, MAX_EPOLL_EVENTS,
+                       heartbeatMs > 0 && heartbeatMs < EPOLL_TIMEOUT ? heartbeatMs : EPOLL_TIMEOUT);
+
+      if (cnt == -1 && errno != EINTR) {
+        printf("\nsckt_client - ERROR - epoll fault");
+        fprintf(main_log_fd, "\n%s - ERROR - sckt_client - epoll fault", get_timestamp());
+        Connected = false;
+      }
+      for (e = 0; e < cnt && Connected && Linked; e++) {
+        uint32_t evt = processableEvents[e].events;
+        st = &streams[processableEvents[e].data.u32];
+        if (SocketType == SOCK_DGRAM) {
+          // ICMP reported an earlier datagram refused: nobody listens on the port
+          // (yet). That is no reason to stop sending.
+          if (evt & EPOLLERR) {
+            pthread_mutex_lock(&txqLock);
+            udpError(0);
+            pthread_mutex_unlock(&txqLock);
+          }
+        }
+        else if( evt & EPOLLRDHUP ) {
+          // remote shutdown. The other streams can't make up for this one.
+          Linked = false;
+          if (verbose)
+            printf("\nsckt_client - remote connection went away");
+          fprintf(main_log_fd, "\n%s - INFO - sckt_client - remote connection went away", get_timestamp());
+        }
+        else if( (evt & EPOLLHUP) || ((evt & EPOLLERR) && scktSocketError(st)) ) {
+          Linked = false;
+          printf("\nsckt_client - ERROR - connection failed");
+          fprintf(main_log_fd, "\n%s - ERROR - sckt_client - connection failed", get_timestamp());
+        }
+        else {
+          if(evt & EPOLLERR) {
+            // Zero-copy completions are waiting in the error queue.
+            pthread_mutex_lock(&txqLock);
+            scktReapZerocopy();
+            holdRelease();
+            pthread_mutex_unlock(&txqLock);
+          }
+          if(evt & EPOLLIN) {
+            if (verbose)
+              printf("\nsckt_client - Client socket epoll RX triggered!");
+            // Acknowledgements came in
+            pthread_mutex_lock(&txqLock);
+            if (ackWant > 0 && !scktReceive(st)) {
+              Linked = false;
+              fprintf(main_log_fd, "\n%s - INFO - sckt_client - remote connection went away", get_timestamp());
+            }
+            pthread_mutex_unlock(&txqLock);
+          }
+          if(evt & EPOLLOUT) {
+            if (verbose)
+              printf("\nsckt_client - Client socket epoll TX triggered!");
+            // Send on what the xmit thread queued
+            pthread_mutex_lock(&txqLock);
+            scktFlush(st);
+            pthread_mutex_unlock(&txqLock);
+          }
+        }
+      }
 
-  if (epoll_ctl(EPFD, EPOLL_CTL_ADD, client_sockfd, &newPeerConnectionEvent) == -1) {
-    printf("\nsckt_client - ERROR - epoll_ctl_add failed, client thread exiting");
-    fprintf(main_log_fd, "\n%s - ERROR - sckt_client - epoll_ctl_add failed, client thread exiting", get_timestamp());
-    Connected = false;
-    return;
+      // Take note of what the server acknowledged, and show an idle link alive.
+      if (SocketType == SOCK_STREAM && Linked) {
+        now = get_monotonic_time();
+        pthread_mutex_lock(&txqLock);
+        for (s = 0; s < nStreams; s++) {
+          txqSettle(&streams[s]);
+          scktHeartbeat(&streams[s], now);
+        }
+        pthread_mutex_unlock(&txqLock);
+      }
+    }
+    // Client Block Ends Here
+    // ///////////////////////////////////
+
+    if (Connected) {
+      linkDowns++;
+      downSince = get_monotonic_time();
+      fprintf(main_log_fd, "\n%s - WARNING - sckt_client - link to the server lost%s", get_timestamp(),
+              reconnectMs > 0 ? ", reconnecting" : "");
+      if (reconnectMs == 0)
+        Connected = false;
+    }
+    else if (useSession)
+      scktBye();
+    scktLinkDown();
   }
+  // Nothing will drain the queues any more; let ipc_xmitv stop waiting for room.
+  Connected = false;
+  pthread_cond_broadcast(&txqRoom);
+  close(EPFD);
 
-  // now wait for data Rx events
-  while (Connected) {
-    int cnt = epoll_wait(EPFD, &processableEvents, MAXEVENTS, -1);
+  fprintf(main_log_fd, "\n%s - INFO - sckt_client - Client exiting", get_timestamp());
+  if (verbose)
+    printf("\nsckt_client - scktClientProc exiting");
+}
+
+
+// Whether the socket of ST has a pending error, which the call clears
+static bool scktSocketError (struct scktStream *st)
+{
+  int err = 0;
+  socklen_t len = sizeof(err);
+
+  if (getsockopt(st->fd, SOL_SOCKET, SO_ERROR, &err, &len) == -1)
+    return true;
+  if (err != 0)
+    fprintf(main_log_fd, "\n%s - ERROR - sckt_client - socket error: %s", get_timestamp(), strerror(err));
+  return err != 0;
+}
+
+
+// Take note of the acknowledgement ACK, with txqLock held: every message before its
+// sequence number arrived, which ends the round trip measured if it covers that one,
+// and opens the window for as many more.
+static void scktAcked (const struct isc_ack *ack)
+{
+  uint64_t seq = be64toh(ack->seq);
+  double rtt;
+
+  if (acksReceived++ == 0)
+    fprintf(main_log_fd, "\n%s - INFO - sckt_client - the server acknowledges, window %u of %u asked for",
+            get_timestamp(), be32toh(ack->window), ackWant);
+  ackActive = true;
+  ackWindow = be32toh(ack->window);
+  if (ackWindow == 0)
+    ackWindow = ackWant;
+  // A server which started over knows less than its predecessor did.
+  if (seq > ackedSeq && seq <= txSeq)
+    ackedSeq = seq;
+
+  if (probing && ackedSeq > probeSeq) {
+    rtt = get_monotonic_time() - probeTime;
+    rttSmooth = rttCount == 0 ? rtt : 0.875 * rttSmooth + 0.125 * rtt;
+    if (rttCount == 0 || rtt < rttMin)
+      rttMin = rtt;
+    if (rtt > rttMax)
+      rttMax = rtt;
+    rttSum += rtt;
+    rttCount++;
+    probing = false;
+  }
+  pthread_cond_broadcast(&txqRoom);
+}
 
-    if (cnt == -1 && errno != EINTR) {
-      printf("\nsckt_client - ERROR - epoll fault");
-      fprintf(main_log_fd, "\n%s - ERROR - sckt_client - epoll fault", get_timestamp());
-      Connected = false;
+
+// Read what the server sent on ST until the socket is drained, with txqLock held, and
+// take its acknowledgements; it sends nothing else the client knows of. Returns false
+// if the server closed the connection or it broke.
+static bool scktReceive (struct scktStream *st)
+{
+  struct isc_frame_hdr hdr;
+  struct isc_ack ack;
+  uint8_t buf[MAXBUF];
+  ssize_t n, i, take, want;
+
+  for (;;) {
+    if ( (n = recv(st->fd, buf, sizeof(buf), MSG_DONTWAIT)) == 0)
+      return false;
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      if (errno == EAGAIN || errno == EWOULDBLOCK)
+        return true;
+      fprintf(main_log_fd, "\n%s - ERROR - sckt_client - socket read error: %s", get_timestamp(), strerror(errno));
+      return false;
     }
-    else if(cnt) {
-      uint32_t evt = processableEvents[0].events;
-      if( evt & EPOLLRDHUP ) {
-        // remote shutdown.
-        Connected = false;
-        if (verbose)
-          printf("\nsckt_client - remote connection went away");
-        fprintf(main_log_fd, "\n%s - INFO - sckt_client - remote connection went away", get_timestamp());
+
+    for (i = 0; i < n; i += take) {
+      if (st->rxSkip > 0) {
+        take = st->rxSkip < n - i ? st->rxSkip : n - i;
+        st->rxSkip -= take;
+        continue;
       }
-      else if(evt & EPOLLIN) {
-        if (verbose)
-          printf("\nsckt_client - Client socket epoll RX triggered!");
+      // The header first, then the ack it announces
+      want = st->rxFill < ISC_FRAME_HDR_SIZE ? ISC_FRAME_HDR_SIZE : sizeof(st->rx);
+      take = want - st->rxFill < n - i ? want - st->rxFill : n - i;
+      memcpy(st->rx + st->rxFill, buf + i, take);
+      if ( (st->rxFill += take) < want)
+        continue;
+      isc_frame_decode(st->rx, &hdr);
+      if (hdr.channel != ISC_CHANNEL_CONTROL || !(hdr.flags & ISC_FLAG_ACK) || hdr.len != sizeof(ack)) {
+        st->rxSkip = hdr.len;
+        st->rxFill = 0;
       }
-      else if(evt & EPOLLOUT) {
-        if (verbose)
-          printf("\nsckt_client - Client socket epoll TX triggered!");
-//        write(client_sockfd, ..., ...); 
+      else if (st->rxFill == sizeof(st->rx)) {
+        memcpy(&ack, st->rx + ISC_FRAME_HDR_SIZE, sizeof(ack));
+        scktAcked(&ack);
+        st->rxFill = 0;
       }
-      else //if( (evt & EPOLLHUP) || (evt & EPOLLERR) )
-        printf("\nsckt_client - ERROR - clientproc unhandled event");
     }
+  }
+}
+
 
+// Hold the slot BUF passed on by the peer, until the zero-copy send numbered ID is
+// complete if ZC is set, with txqLock held.
+static void holdPush (uint8_t *buf, bool zc, uint32_t id)
+{
+  struct txHold *grown;
+  uint32_t i;
+
+  if (holdCnt == holdSize) {
+    grown = (struct txHold *) xmalloc((holdSize ? 2 * holdSize : 1024) * sizeof(*grown));
+    for (i = 0; i < holdCnt; i++)
+      grown[i] = hold[(holdHead + i) % holdSize];
+    free(hold);
+    hold = grown;
+    holdSize = holdSize ? 2 * holdSize : 1024;
+    holdHead = 0;
   }
-  // Client Block Ends Here
-  // ///////////////////////////////////
+  hold[(holdHead + holdCnt) % holdSize].buf = buf;
+  hold[(holdHead + holdCnt) % holdSize].zc = zc;
+  hold[(holdHead + holdCnt) % holdSize].zcId = id;
+  holdCnt++;
+}
 
-  close(client_sockfd);
 
-  fprintf(main_log_fd, "\n%s - INFO - sckt_client - Client exiting", get_timestamp());
-  if (verbose)
-    printf("\nsckt_client - scktClientProc exiting");
+// Give the peer back the held slots the kernel is done with, oldest first, with
+// txqLock held.
+static void holdRelease ()
+{
+  while (holdCnt > 0 && !hold[holdHead].zc) {
+    if (peer != NULL)
+      (*peer->release_function) (hold[holdHead].buf);
+    holdHead = (holdHead + 1) % holdSize;
+    holdCnt--;
+  }
 }
 
 
-// Interface function to xmit data
-uint32_t ipc_xmit (uint8_t *buf, int32_t bufSize)
+// Read the zero-copy completions off the socket error queue and mark the slots they
+// free, with txqLock held. Each one covers the sends numbered lo to hi.
+static void scktReapZerocopy ()
 {
-  unsigned int totBytesWritten = 0;
-  int numWritten = 0;
-  int i;
+  char control[128];
+  struct msghdr msg;
+  struct cmsghdr *cm;
+  struct sock_extended_err *serr;
+  uint32_t lo, hi, i;
+  struct txHold *h;
+
+  for (;;) {
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    if (recvmsg(streams[0].fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) == -1) {
+      if (errno == EINTR)
+        continue;
+      break;
+    }
+    for (cm = CMSG_FIRSTHDR(&msg); cm != NULL; cm = CMSG_NXTHDR(&msg, cm)) {
+      if (!(cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR) &&
+          !(cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR))
+        continue;
+      serr = (struct sock_extended_err *) CMSG_DATA(cm);
+      if (serr->ee_errno != 0 || serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+        continue;
+      lo = serr->ee_info;
+      hi = serr->ee_data;
+      zcCompleted += hi - lo + 1;
+      if (serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+        zcCopied += hi - lo + 1;
+      for (i = 0; i < holdCnt; i++) {
+        h = &hold[(holdHead + i) % holdSize];
+        if (h->zc && h->zcId - lo <= hi - lo)
+          h->zc = false;
+      }
+    }
+  }
+}
 
-  if (verbose)
-    printf("\nsckt_server - ipc_xmit\n");
-  fprintf(main_log_fd, "\n%s - INFO - sckt_client - ipc_xmit", get_timestamp());
 
-  if (!Connected || client_sockfd <= 0) {
-    if (verbose)
-      printf("\nsckt_server - ipc_xmit Client Not Connected!\n");
-    fprintf(main_log_fd, "\n%s - INFO - sckt_client - ipc_xmit - Client Not Connected!", get_timestamp());
-    return 0;
+// Append the BUFSIZE bytes at BUF to the outbound queue of ST, which has room for
+// them.
+static void txqPut (struct scktStream *st, const uint8_t *buf, size_t bufSize)
+{
+  size_t at = st->txqTail % txqSize;
+  size_t n = bufSize < txqSize - at ? bufSize : txqSize - at;
+
+  memcpy(st->txq + at, buf, n);
+  memcpy(st->txq, buf + n, bufSize - n);
+  st->txqTail += bufSize;
+  if (st->txqTail - st->txqHead > st->txqPeak)
+    st->txqPeak = st->txqTail - st->txqHead;
+  st->txqQueued += bufSize;
+}
+
+
+// Room left in the outbound queue of ST
+static size_t txqFree (struct scktStream *st)
+{
+  return txqSize - (st->txqTail - (replay ? st->txqMark : st->txqHead));
+}
+
+
+// Move txqMark of ST on over the frames which are done with, with txqLock held: with
+// sckt_replay, those the server acknowledged or, if it never did, its TCP; else those
+// the socket took. Messages the server acknowledged which were still to be sent
+// again after a reconnect aren't. Once the server acknowledges, TCP doesn't count
+// even while it is down: a dying server's TCP acknowledges what it never hands on.
+static void txqSettle (struct scktStream *st)
+{
+  uint8_t raw[ISC_FRAME_HDR_SIZE];
+  struct isc_frame_hdr hdr;
+  uint64_t upto = st->txqHead, end;
+  bool acked = replay && acksReceived > 0;
+  size_t at, n;
+  int unacked;
+
+  if (acked)
+    upto = st->txqTail;
+  else if (replay) {
+    // Bytes the socket holds until the peer acknowledges them
+    if (!Linked || ioctl(st->fd, SIOCOUTQ, &unacked) == -1)
+      return;
+    upto -= unacked;
   }
+  while (st->txqMark < upto) {
+    at = st->txqMark % txqSize;
+    n = ISC_FRAME_HDR_SIZE < txqSize - at ? ISC_FRAME_HDR_SIZE : txqSize - at;
+    memcpy(raw, st->txq + at, n);
+    memcpy(raw + n, st->txq, ISC_FRAME_HDR_SIZE - n);
+    isc_frame_decode(raw, &hdr);
+    end = st->txqMark + ISC_FRAME_HDR_SIZE + hdr.len;
+    if (acked) {
+      // Control messages are done with once sent; they aren't acknowledged.
+      if (hdr.channel == ISC_CHANNEL_CONTROL ? end > st->txqHead : hdr.seq >= ackedSeq)
+        break;
+      if (end > st->txqHead) {
+        // Unless part of it went out already
+        if (st->txqHead != st->txqMark)
+          break;
+        st->txqHead = end;
+        ackSkipped++;
+      }
+    }
+    else if (replay && end > upto)
+      break;
+    st->txqMark = end;
+    if (replay)
+      pthread_cond_broadcast(&txqRoom);
+  }
+}
 
-  numWritten = send(client_sockfd, buf, bufSize, 0);
-  if (numWritten <= 0) {
-    if (numWritten == -1 && errno != EINTR) {
-      system_error("sckt_client - ipc_xmit - socket write error, aborting send");
-      return 0;  // some error
+
+// Queue a heartbeat on ST, with txqLock held, if the stream had nothing to send for
+// sckt_heartbeat_ms, as of NOW.
+static void scktHeartbeat (struct scktStream *st, double now)
+{
+  struct isc_frame_hdr hdr;
+
+  if (heartbeatMs == 0 || now - st->lastTx < heartbeatMs / 1000.0 || st->txqHead != st->txqTail ||
+      txqFree(st) < ISC_FRAME_HDR_SIZE)
+    return;
+  isc_frame_encode(&hdr, 0, ISC_CHANNEL_CONTROL, ISC_FLAG_HEARTBEAT, 0);
+  txqPut(st, (const uint8_t *) &hdr, ISC_FRAME_HDR_SIZE);
+  heartbeats++;
+  scktFlush(st);
+}
+
+
+// Send as much of the outbound queue of ST as its socket takes, with txqLock held.
+// The queue is left empty, or else the socket full, so that EPOLLOUT brings the
+// client thread back here once it drains. A broken connection takes the link down.
+static void scktFlush (struct scktStream *st)
+{
+  struct msghdr msg;
+  struct iovec iov[2];
+  ssize_t numWritten;
+  size_t at, len;
+
+  while (st->txqHead != st->txqTail && Linked) {
+    at = st->txqHead % txqSize;
+    len = st->txqTail - st->txqHead;
+    iov[0].iov_base = st->txq + at;
+    iov[0].iov_len = len < txqSize - at ? len : txqSize - at;
+    iov[1].iov_base = st->txq;
+    iov[1].iov_len = len - iov[0].iov_len;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = iov[1].iov_len > 0 ? 2 : 1;
+    numWritten = sendmsg(st->fd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (numWritten == -1 && errno == EINTR)
+      continue;
+    if (numWritten == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+      break;
+    if (numWritten <= 0) {
+      fprintf(main_log_fd, "\n%s - ERROR - sckt_client - socket write error: %s", get_timestamp(), strerror(errno));
+      Linked = false;
+      break;
     }
-    system_error("sckt_client - ipc_xmit - socket write error, num of written is less than zero");
+    st->txqHead += numWritten;
+    st->lastTx = get_monotonic_time();
+    txqSettle(st);
+    pthread_cond_broadcast(&txqRoom);
+  }
+}
+
+
+// Make room for LEN more bytes in the outbound queue of ST as txqPolicy says, with
+// txqLock held. Returns false if the message is to be dropped.
+static bool txqMakeRoom (struct scktStream *st, size_t len)
+{
+  struct timespec ts;
+  double since = 0;
+  bool room;
+
+  scktFlush(st);
+  if (txqFree(st) >= len)
+    return true;
+  if (txqPolicy == TXQ_DROP)
+    return false;
+
+  // Wait for the client thread to drain the queue.
+  txqWaits++;
+  since = get_monotonic_time();
+  while ( (room = txqFree(st) >= len) == false && Connected) {
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_nsec += (long) (TXQ_WAIT_TIMEOUT * 1e9);
+    if (ts.tv_nsec >= 1000000000L) {
+      ts.tv_sec++;
+      ts.tv_nsec -= 1000000000L;
+    }
+    pthread_cond_timedwait(&txqRoom, &txqLock, &ts);
+    txqSettle(st);
+  }
+  txqWaitTime += get_monotonic_time() - since;
+  return room;
+}
+
+
+// Send CNT iovecs from IOV over ST with one sendmsg taking FLAGS. Returns the bytes
+// the socket took, 0 if it is full, or -1 if the connection broke.
+static ssize_t scktSendIov (struct scktStream *st, struct iovec *iov, int cnt, int flags)
+{
+  struct msghdr msg;
+  ssize_t numWritten;
+
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = iov;
+  msg.msg_iovlen = cnt;
+  do {
+    numWritten = sendmsg(st->fd, &msg, flags | MSG_DONTWAIT | MSG_NOSIGNAL);
+  } while (numWritten == -1 && errno == EINTR);
+  if (numWritten == -1 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS))
+    return 0;
+  if (numWritten == -1) {
+    fprintf(main_log_fd, "\n%s - ERROR - sckt_client - socket write error: %s", get_timestamp(), strerror(errno));
+    Linked = false;
   }
   else
-    totBytesWritten += numWritten;
+    st->lastTx = get_monotonic_time();
+  return numWritten;
+}
+
+
+// Send the K framed messages set up in txIov straight to the socket of ST until it
+// is full. Payloads of at least zcMin bytes go with MSG_ZEROCOPY, on their own;
+// everything else, including their headers (txHdr is reused at once), is copied in
+// as few sendmsg calls as possible. Returns the bytes the socket took, or -1 if the
+// connection broke.
+static ssize_t scktSendDirect (struct scktStream *st, int32_t k)
+{
+  ssize_t total = 0, want, r;
+  int32_t i, first = 0, end, j;
+
+  if (!zcActive)
+    return scktSendIov(st, txIov, 2 * k, 0);
+
+  for (i = 0; i <= k; i++) {
+    if (i < k && txIov[2 * i + 1].iov_len < zcMin)
+      continue;
+    // The copied part: everything since the last zero-copy payload, up to and
+    // including the header of this one
+    end = i < k ? 2 * i + 1 : 2 * k;
+    for (j = first, want = 0; j < end; j++)
+      want += txIov[j].iov_len;
+    if (want > 0) {
+      if ( (r = scktSendIov(st, txIov + first, end - first, i < k ? MSG_MORE : 0)) < 0)
+        return -1;
+      total += r;
+      if (r < want)
+        return total;
+    }
+    if (i == k)
+      break;
+
+    if ( (r = scktSendIov(st, &txIov[2 * i + 1], 1, MSG_ZEROCOPY)) < 0)
+      return -1;
+    if (r > 0) {
+      txZc[i] = true;
+      txZcId[i] = zcNext++;
+      zcCalls++;
+      zcBytes += r;
+    }
+    total += r;
+    if (r < (ssize_t) txIov[2 * i + 1].iov_len)
+      return total;
+    first = 2 * i + 2;
+  }
+  return total;
+}
+
+
+// Hold the slots of the CNT messages at IOV while zero-copy sends are on. If SENT,
+// they are the messages set up in txIov, and those txZc marks wait for their
+// completion.
+static void holdBatch (const struct iovec *iov, int32_t cnt, bool sent)
+{
+  int32_t i;
+
+  if (!zerocopy)
+    return;
+  for (i = 0; i < cnt; i++)
+    holdPush((uint8_t *) iov[i].iov_base, sent && txZc[i], sent ? txZcId[i] : 0);
+}
+
+
+// Send the K messages of IOV, numbered SEQ, over ST, each behind its frame header
+// (and CRC), with as few sendmsg calls as possible, and queue what the socket doesn't take; the
+// call holds txqLock. While anything is queued, new messages queue up behind it, so
+// they go out in order. Returns the number of payload bytes sent or queued, or -1 if
+// the connection broke.
+static ssize_t scktSendStream (struct scktStream *st, const struct iovec *iov, const uint64_t *seq, int32_t k)
+{
+  ssize_t numWritten, payload = 0;
+  size_t skip, len;
+  bool partial;
+  int32_t i;
+
+  for (i = 0; i < k; i++) {
+    if (crc) {
+      txHdr[i].crc = htobe32(isc_crc32c(0, iov[i].iov_base, iov[i].iov_len));
+      isc_frame_encode(&txHdr[i].hdr, ISC_FRAME_CRC_SIZE + iov[i].iov_len, ISC_CHANNEL_DATA, ISC_FLAG_CRC, seq[i]);
+    }
+    else
+      isc_frame_encode(&txHdr[i].hdr, iov[i].iov_len, ISC_CHANNEL_DATA, 0, seq[i]);
+    txIov[2 * i].iov_base = &txHdr[i];
+    txIov[2 * i].iov_len = txHeadLen;
+    txIov[2 * i + 1] = iov[i];
+  }
 
   numWritten = 0;
+  for (i = 0; i < k; i++)
+    txZc[i] = false;
+  if (!replay && Linked && st->txqHead == st->txqTail && (numWritten = scktSendDirect(st, k)) < 0) {
+    holdBatch(iov, k, true);
+    return -1;
+  }
+
+  // Queue the messages the socket didn't take. A message it took part of goes on
+  // at once, whatever the policy: a frame must never be cut short.
+  for (i = 0, skip = numWritten; i < k; i++) {
+    len = txHeadLen + txIov[2 * i + 1].iov_len;
+    if (skip >= len) {
+      skip -= len;
+      payload += txIov[2 * i + 1].iov_len;
+      st->frames++;
+      st->bytes += txIov[2 * i + 1].iov_len;
+      continue;
+    }
+    if (skip == 0 && !txqMakeRoom(st, len)) {
+      if (txqDropped++ == 0)
+        fprintf(main_log_fd, "\n%s - WARNING - sckt_client - outbound queue full, messages dropped", get_timestamp());
+      continue;
+    }
+    partial = skip > 0;
+    if (skip < txHeadLen)
+      txqPut(st, (const uint8_t *) &txHdr[i] + skip, txHeadLen - skip);
+    skip = skip > txHeadLen ? skip - txHeadLen : 0;
+    txqPut(st, (const uint8_t *) txIov[2 * i + 1].iov_base + skip, txIov[2 * i + 1].iov_len - skip);
+    // The first whole frame comes after the rest of one the socket took part of.
+    if (partial)
+      st->txqMark = st->txqTail;
+    payload += txIov[2 * i + 1].iov_len;
+    st->frames++;
+    st->bytes += txIov[2 * i + 1].iov_len;
+    skip = 0;
+  }
+  holdBatch(iov, k, true);
+  return payload;
+}
+
 
-  fprintf(main_log_fd, "\n%s - INFO - sckt_client - sent = %d bytes", get_timestamp(), totBytesWritten);
+// Deal the K messages of IOV out to the streams and send each stream its share, with
+// txqLock held. A message goes to the stream with the fewest bytes waiting, counting
+// those dealt to it before; streams which tie take turns. Returns the number of
+// payload bytes sent or queued, or -1 if a connection broke.
+static ssize_t scktSendStriped (const struct iovec *iov, int32_t k)
+{
+  size_t load[ISC_MAX_STREAMS];
+  int32_t cnt[ISC_MAX_STREAMS];
+  ssize_t payload = 0, r;
+  int32_t i, j, s, at;
+
+  for (s = 0; s < nStreams; s++) {
+    load[s] = streams[s].txqTail - streams[s].txqHead;
+    cnt[s] = 0;
+  }
+  for (i = 0; i < k; i++) {
+    s = txNext;
+    for (j = 1; j < nStreams; j++)
+      if (load[(txNext + j) % nStreams] < load[s])
+        s = (txNext + j) % nStreams;
+    txNext = (s + 1) % nStreams;
+    at = s * MAX_FRAMES_PER_SEND + cnt[s]++;
+    stripeIov[at] = iov[i];
+    stripeSeq[at] = txSeq++;
+    load[s] += txHeadLen + iov[i].iov_len;
+  }
+  for (s = 0; s < nStreams; s++) {
+    if (cnt[s] == 0)
+      continue;
+    r = scktSendStream(&streams[s], stripeIov + s * MAX_FRAMES_PER_SEND, stripeSeq + s * MAX_FRAMES_PER_SEND, cnt[s]);
+    if (r < 0)
+      return -1;
+    payload += r;
+  }
+  return payload;
+}
+
+
+// How many of the next K messages may go out within the window the server granted,
+// with txqLock held. Under sckt_txq_policy block, the call waits for it to open if it
+// is full; under drop, the messages it has no room for are to be dropped. 0 means
+// that none may go, as the client stops.
+static int32_t scktWindow (int32_t k)
+{
+  struct timespec ts;
+  double since;
+
+  if (txSeq - ackedSeq >= ackWindow && txqPolicy == TXQ_BLOCK) {
+    windowWaits++;
+    since = get_monotonic_time();
+    while (ackActive && txSeq - ackedSeq >= ackWindow && Connected) {
+      clock_gettime(CLOCK_REALTIME, &ts);
+      ts.tv_nsec += (long) (TXQ_WAIT_TIMEOUT * 1e9);
+      if (ts.tv_nsec >= 1000000000L) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+      }
+      pthread_cond_timedwait(&txqRoom, &txqLock, &ts);
+    }
+    windowWaitTime += get_monotonic_time() - since;
+    if (!Connected)
+      return 0;
+  }
+  // The link broke meanwhile: its queue takes the messages until the next one is up.
+  if (!ackActive)
+    return k;
+  if (txSeq - ackedSeq >= ackWindow)
+    return 0;
+  return txSeq - ackedSeq + k <= ackWindow ? k : ackWindow - (txSeq - ackedSeq);
+}
+
+
+// Send the IOVCNT messages of IOV, MAX_FRAMES_PER_SEND at a time, over the one
+// connection or striped over several; the call holds txqLock. Once the server
+// acknowledges, no more go out than its window allows, and one of them at a time is
+// timed to its acknowledgement. Returns the number of payload bytes sent or queued.
+static size_t scktSendFrames (const struct iovec *iov, int32_t iovCnt)
+{
+  ssize_t r;
+  size_t payload = 0;
+  int32_t i, n, k;
+
+  for (n = 0; n < iovCnt; n += k) {
+    k = iovCnt - n < MAX_FRAMES_PER_SEND ? iovCnt - n : MAX_FRAMES_PER_SEND;
+    if (ackActive && (k = scktWindow(k)) == 0) {
+      if (txqDropped == 0)
+        fprintf(main_log_fd, "\n%s - WARNING - sckt_client - acknowledgement window full, messages dropped", get_timestamp());
+      txqDropped += iovCnt - n;
+      holdBatch(iov + n, iovCnt - n, false);
+      break;
+    }
+    if (ackActive && !probing) {
+      probing = true;
+      probeSeq = txSeq;
+      probeTime = get_monotonic_time();
+    }
+    if (nStreams > 1)
+      r = scktSendStriped(iov + n, k);
+    else {
+      for (i = 0; i < k; i++)
+        stripeSeq[i] = txSeq++;
+      r = scktSendStream(&streams[0], iov + n, stripeSeq, k);
+    }
+    if (r < 0) {
+      holdBatch(iov + n + k, iovCnt - n - k, false);
+      return payload;
+    }
+    payload += r;
+  }
+  for (i = 0; i < nStreams; i++)
+    scktFlush(&streams[i]);
+  return payload;
+}
 
-  fprintf(log_fd, "\n%s - INFO - sckt_client - ", get_timestamp());
 
+// Count and clear the pending error of the datagram socket, ERR if it isn't 0 (as
+// the failed send already cleared it), with txqLock held. Refusals are expected
+// while the server isn't up, so only the first one is logged.
+static void udpError (int err)
+{
+  socklen_t len = sizeof(err);
+
+  if (err == 0 && (getsockopt(streams[0].fd, SOL_SOCKET, SO_ERROR, &err, &len) == -1 || err == 0))
+    return;
+  if (err == ECONNREFUSED) {
+    if (udpRefused++ == 0)
+      fprintf(main_log_fd, "\n%s - WARNING - sckt_client - datagrams refused, nobody listens on port %d", get_timestamp(), ConnPort);
+  }
+  else
+    fprintf(main_log_fd, "\n%s - ERROR - sckt_client - socket error: %s", get_timestamp(), strerror(err));
+}
+
+
+// Send the K datagrams set up in udpMsg with as few sendmmsg calls as the socket
+// allows, with txqLock held. Under sckt_txq_policy block, a full socket buffer holds
+// the call up until the kernel has passed datagrams on; under drop, the datagrams it
+// has no room for are dropped, as are those a send fails for.
+static void udpSendBatch (int k)
+{
+  int sent = 0, r;
+
+  while (sent < k) {
+    r = sendmmsg(streams[0].fd, udpMsg + sent, k - sent, MSG_NOSIGNAL | (txqPolicy == TXQ_DROP ? MSG_DONTWAIT : 0));
+    if (r > 0) {
+      sent += r;
+      udpCalls++;
+      udpDatagrams += r;
+      continue;
+    }
+    if (r == -1 && errno == EINTR)
+      continue;
+    // The refusal of an earlier datagram is reported instead of sending this one,
+    // which goes on the next try.
+    if (r == -1 && errno == ECONNREFUSED) {
+      udpError(ECONNREFUSED);
+      continue;
+    }
+    if (r == -1 && errno != EAGAIN && errno != EWOULDBLOCK && errno != ENOBUFS)
+      fprintf(main_log_fd, "\n%s - ERROR - sckt_client - sendmmsg: %s", get_timestamp(), strerror(errno));
+    else if (udpDropped == 0)
+      fprintf(main_log_fd, "\n%s - WARNING - sckt_client - socket buffer full, datagrams dropped", get_timestamp());
+    udpDropped += k - sent;
+    break;
+  }
+}
+
+
+// Add the data datagram set up in slot K of the batch, the next of the group being
+// sent, to the parity rows.
+static void udpFecAdd (int k)
+{
+  struct iovec *v = &udpIov[4 * k];
+  uint32_t len = v[0].iov_len + v[2].iov_len + v[3].iov_len, at, j;
+  uint16_t size = htobe16(len);
+
+  for (j = 0; j < fecM; j++) {
+    isc_fec_add(fecParity[j], j, fecIndex, &size, sizeof(size));
+    at = sizeof(size) + v[0].iov_len;
+    isc_fec_add(fecParity[j] + sizeof(size), j, fecIndex, v[0].iov_base, v[0].iov_len);
+    isc_fec_add(fecParity[j] + at, j, fecIndex, v[2].iov_base, v[2].iov_len);
+    isc_fec_add(fecParity[j] + at + v[2].iov_len, j, fecIndex, v[3].iov_base, v[3].iov_len);
+  }
+  if (sizeof(size) + len > fecLen)
+    fecLen = sizeof(size) + len;
+}
+
+
+// Close the group being sent: put its parity datagrams in the batch behind the K
+// datagrams there, send them all, and start the parity rows over for the next group.
+static void udpFecClose (int k)
+{
+  struct isc_dgram_hdr hdr;
+  uint32_t j;
+
+  if (k + fecM > UDP_BATCH) {
+    udpSendBatch(k);
+    k = 0;
+  }
+  memset(&hdr, 0, sizeof(hdr));
+  hdr.channel = ISC_CHANNEL_FEC;
+  hdr.flags = ISC_FLAG_FEC;
+  hdr.len = fecLen;
+  hdr.frags = fecM;
+  for (j = 0; j < fecM; j++, k++) {
+    hdr.frag = j;
+    isc_dgram_encode(&udpHdr[k], &hdr);
+    udpFec[k].group = htobe32(fecGroup);
+    udpFec[k].index = fecCount + j;
+    udpFec[k].k = fecCount;
+    udpFec[k].m = fecM;
+    udpFec[k].reserved = 0;
+    udpIov[4 * k].iov_base = &udpHdr[k];
+    udpIov[4 * k].iov_len = ISC_DGRAM_HDR_SIZE;
+    udpIov[4 * k + 1].iov_base = &udpFec[k];
+    udpIov[4 * k + 1].iov_len = ISC_FEC_HDR_SIZE;
+    udpIov[4 * k + 2].iov_len = 0;
+    udpIov[4 * k + 3].iov_base = fecParity[j];
+    udpIov[4 * k + 3].iov_len = fecLen;
+    memset(&udpMsg[k], 0, sizeof(udpMsg[k]));
+    udpMsg[k].msg_hdr.msg_iov = &udpIov[4 * k];
+    udpMsg[k].msg_hdr.msg_iovlen = 4;
+  }
+  // The parity rows are reused for the next group once they are sent.
+  udpSendBatch(k);
+  for (j = 0; j < fecM; j++)
+    memset(fecParity[j], 0, fecLen);
+  fecGroups++;
+  fecSent += fecM;
+  fecGroup++;
+  fecIndex = fecLen = 0;
+}
+
+
+// Send the IOVCNT messages of IOV as datagrams, each cut into as many fragments as
+// the MTU requires, UDP_BATCH datagrams per sendmmsg; the call holds txqLock. Under
+// sckt_crc, the CRC of a message leads its first fragment. Under sckt_fec_k, the
+// datagrams go in groups of up to fecK, each followed by its parity datagrams; the
+// last group of the call is cut short rather than wait for more messages. The
+// fragments are copied into the socket buffer, so the slots may be reused after.
+// Returns the number of payload bytes sent or dropped.
+static size_t udpSendMessages (const struct iovec *iov, int32_t iovCnt)
+{
+  struct isc_dgram_hdr hdr;
+  uint32_t fragMax = udpMtu - ISC_DGRAM_OVERHEAD - ISC_DGRAM_HDR_SIZE;
+  uint32_t head = crc ? ISC_FRAME_CRC_SIZE : 0, sum = 0, fragLen, lead, left = 0;
+  size_t payload = 0;
+  int32_t i, k = 0;
+
+  // A parity datagram carries a whole data datagram with its length, so those leave
+  // room for that besides the isc_fec_hdr. The datagrams of the call are counted to
+  // size the groups.
+  if (fecK > 0) {
+    fragMax -= ISC_FEC_HDR_SIZE + sizeof(uint16_t) + ISC_DGRAM_HDR_SIZE;
+    for (i = 0; i < iovCnt; i++)
+      left += head + iov[i].iov_len > 0 ? (head + iov[i].iov_len + fragMax - 1) / fragMax : 1;
+  }
+  memset(&hdr, 0, sizeof(hdr));
+  hdr.channel = ISC_CHANNEL_DATA;
+  hdr.flags = (crc ? ISC_FLAG_CRC : 0) | (fecK > 0 ? ISC_FLAG_FEC : 0);
+  for (i = 0; i < iovCnt; i++) {
+    hdr.seq = txSeq++;
+    hdr.len = head + iov[i].iov_len;
+    hdr.frags = hdr.len > 0 ? (hdr.len + fragMax - 1) / fragMax : 1;
+    if (crc)
+      sum = htobe32(isc_crc32c(0, iov[i].iov_base, iov[i].iov_len));
+    for (hdr.frag = 0; hdr.frag < hdr.frags; hdr.frag++) {
+      if (k == UDP_BATCH) {
+        udpSendBatch(k);
+        k = 0;
+      }
+      hdr.offset = hdr.frag * fragMax;
+      fragLen = hdr.len - hdr.offset < fragMax ? hdr.len - hdr.offset : fragMax;
+      // The part of the CRC in this fragment: all of it in the first, as the smallest
+      // MTU leaves room for much more.
+      lead = hdr.offset < head ? head - hdr.offset : 0;
+      isc_dgram_encode(&udpHdr[k], &hdr);
+      udpCrc[k] = sum;
+      udpIov[4 * k].iov_base = &udpHdr[k];
+      udpIov[4 * k].iov_len = ISC_DGRAM_HDR_SIZE;
+      udpIov[4 * k + 1].iov_base = &udpFec[k];
+      udpIov[4 * k + 1].iov_len = fecK > 0 ? ISC_FEC_HDR_SIZE : 0;
+      udpIov[4 * k + 2].iov_base = &udpCrc[k];
+      udpIov[4 * k + 2].iov_len = lead;
+      udpIov[4 * k + 3].iov_base = (uint8_t *) iov[i].iov_base + hdr.offset + lead - head;
+      udpIov[4 * k + 3].iov_len = fragLen - lead;
+      memset(&udpMsg[k], 0, sizeof(udpMsg[k]));
+      udpMsg[k].msg_hdr.msg_iov = &udpIov[4 * k];
+      udpMsg[k].msg_hdr.msg_iovlen = 4;
+      if (fecK > 0) {
+        if (fecIndex == 0)
+          fecCount = left < fecK ? left : fecK;
+        udpFec[k].group = htobe32(fecGroup);
+        udpFec[k].index = fecIndex;
+        udpFec[k].k = fecCount;
+        udpFec[k].m = fecM;
+        udpFec[k].reserved = 0;
+        udpFecAdd(k);
+        fecIndex++;
+        left--;
+      }
+      k++;
+      if (fecK > 0 && fecIndex == fecCount) {
+        udpFecClose(k);
+        k = 0;
+      }
+    }
+    payload += iov[i].iov_len;
+  }
+  if (k > 0)
+    udpSendBatch(k);
+  return payload;
+}
+
+
+// Interface function to xmit a batch of chunks, each as one framed message, with a
+// single sendmsg, or with udp as datagrams. The slots go back to the peer once the socket or the outbound queue
+// holds a copy or, for zero-copy sends, once the kernel is done with them.
+uint32_t ipc_xmitv (const struct iovec *iov, int32_t iovCnt)
+{
+  size_t total;
+  int32_t i, j;
+
+  if (verbose)
+    printf("\nsckt_client - ipc_xmitv\n");
+  fprintf(main_log_fd, "\n%s - INFO - sckt_client - ipc_xmitv - %d chunks", get_timestamp(), iovCnt);
+
+  if (!Connected || (SocketType == SOCK_DGRAM && streams[0].fd <= 0)) {
+    if (verbose)
+      printf("\nsckt_client - ipc_xmitv Client Not Connected!\n");
+    fprintf(main_log_fd, "\n%s - INFO - sckt_client - ipc_xmitv - Client Not Connected!", get_timestamp());
+    // The chunks are dropped; hand their buffers back all the same, behind the ones
+    // still held.
+    pthread_mutex_lock(&txqLock);
+    if (zerocopy) {
+      holdBatch(iov, iovCnt, false);
+      holdRelease();
+    }
+    else if (peer != NULL)
+      for (i = 0; i < iovCnt; i++)
+        (*peer->release_function) (iov[i].iov_base);
+    pthread_mutex_unlock(&txqLock);
+    return 0;
+  }
+
+  // Log the chunks while they are surely ours: once sent, the client thread may hand
+  // a zero-copy slot back any time.
+  for (i = 0; i < iovCnt; i++) {
+    fprintf(log_fd, "\n%s - INFO - sckt_client - ", get_timestamp());
 #if 1
-//    printf("Shared memory contains: \"%s\"\n", prod_shm);
-   for (i = 0; i < bufSize; i++) {
-     fprintf(log_fd, "0x%X,", buf[i] & 0x000000FF);
-   }
+    for (j = 0; j < iov[i].iov_len; j++) {
+      fprintf(log_fd, "0x%X,", ((uint8_t *) iov[i].iov_base)[j] & 0x000000FF);
+    }
 #endif
+  }
+
+  pthread_mutex_lock(&txqLock);
+  if (SocketType == SOCK_DGRAM)
+    total = udpSendMessages(iov, iovCnt);
+  else
+    total = scktSendFrames(iov, iovCnt);
+  if (zerocopy) {
+    scktReapZerocopy();
+    holdRelease();
+  }
+  // Otherwise the whole batch has been copied into the socket buffer or the outbound
+  // queue, and the slots can be reused.
+  else if (peer != NULL)
+    for (i = 0; i < iovCnt; i++)
+      (*peer->release_function) (iov[i].iov_base);
+  pthread_mutex_unlock(&txqLock);
+
+  fprintf(main_log_fd, "\n%s - INFO - sckt_client - sent = %zu bytes", get_timestamp(), total);
+
+  return total;
+}
+
+
+// Interface function to xmit data
+uint32_t ipc_xmit (uint8_t *buf, int32_t bufSize)
+{
+  struct iovec iov;
+
+  if (verbose)
+    printf("\nsckt_client - ipc_xmit\n");
 
-  return totBytesWritten;
+  iov.iov_base = buf;
+  iov.iov_len = bufSize;
+  return ipc_xmitv(&iov, 1);
 }
 
 
@@ -454,3 +2080,31 @@ void ipc_rec (uint8_t *buf, int32_t bufSize)
 {
   system_error ("sckt_client - ipc_rec - Not implemented");
 }
+
+
+// Interface function to lend a buffer; this module doesn't lend buffers.
+uint8_t* ipc_acquire (int32_t *bufSize)
+{
+  return NULL;
+}
+
+
+// Interface function to report the chunks this module can take; it has no flow control.
+int32_t ipc_credits ()
+{
+  return -1;
+}
+
+
+// Interface function to commit an acquired buffer
+void ipc_commit (uint8_t *buf, int32_t bufSize)
+{
+  system_error ("sckt_client - ipc_commit - Not implemented");
+}
+
+
+// Interface function to release a buffer passed on through xmit
+void ipc_release (uint8_t *buf)
+{
+  system_error ("sckt_client - ipc_release - Not implemented");
+}
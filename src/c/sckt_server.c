@@ -8,8 +8,30 @@
  * @brief   The sckt_server.so module acts as a bridge between two isc system on different 
  *          SoC modules. This module implements a server socket transport in Linux based 
  *          on epoll.
+ *          Every connection carries framed messages (see struct isc_frame_hdr); the
+ *          bytes read are reassembled per connection and only whole messages are
+ *          handed on, one record each.
+ *          A pool of worker threads serves the port, each with a listening socket of
+ *          its own (SO_REUSEPORT) and an epoll set for the connections it accepts.
+ *          With udp, each worker has a datagram socket on the port instead. The
+ *          datagrams (see struct isc_dgram_hdr) are read in batches with recvmmsg,
+ *          the fragments of every message put together again per sender, and the
+ *          messages missing from a sender's sequence counted as lost.
+ *          A client may stripe its messages over several connections, which it
+ *          opens with a hello naming their session (see struct isc_stripe_hello).
+ *          Whichever workers serve them, the messages of a session are handed on
+ *          in the order of their sequence numbers; those which arrive early wait
+ *          in a reorder buffer. A session outlives a broken link for a while, so
+ *          that the client may reconnect and resume it, sending again what it
+ *          isn't sure arrived; what was handed on already is dropped then.
+ *          A client may ask for acknowledgements (see struct isc_ack): the server
+ *          then tells it over the same connections, as it hands messages on, how
+ *          far it got, so that the client can bound what is in flight and free what
+ *          it kept to send again.
  */
 
+#define _GNU_SOURCE   // sched_setaffinity, pthread_setname_np
+
 #include <string.h>
 #include <sys/wait.h>
 #include <sys/ipc.h>
@@ -36,6 +58,8 @@
 #include <netdb.h>    // NI_MAXHOST, NI_MAXSERV
 #include <netinet/tcp.h>
 #include <sys/epoll.h>
+#include <sched.h>
+#include <linux/sock_diag.h>    // SK_MEMINFO_DROPS
 
 #include "isc.h"
 
@@ -44,19 +68,36 @@
 /*********************************************************************************** 
  * C o n s t a n t s ,   v a r i a b l e s ,  f u n c t i o n s 
 ************************************************************************************/
-#define LISTENQ 20
-
-static const int EPOLL_MAXEVENTS = 128;
-static const EPOLL_TIMEOUT = 1000;
-#define IOBUFFSIZE 2048
+// Most events taken per epoll_wait, and how long it waits for them, in milliseconds
+#define EPOLL_MAXEVENTS 128
+#define EPOLL_TIMEOUT 1000
+// How often connections paused by backpressure are retried, in milliseconds
+#define BACKPRESSURE_RETRY 2
+#define MAX_PAUSED 64
+// Reassembly buffer of a connection: room for two of the largest messages, so a
+// whole one always fits behind a partly delivered one.
+#define CONN_BUFSIZE (2 * (ISC_FRAME_HDR_SIZE + ISC_FRAME_MAX))
+// Reassembly buffers come from a pool, in size classes doubling from RXBUF_MIN; the
+// last class is CONN_BUFSIZE. How often a worker frees the buffers it kept but
+// didn't need, in seconds.
+#define RXBUF_MIN 4096
+#define RXBUF_CLASSES 7
+#define RXPOOL_TRIM 1.0
+// Most datagrams read with one recvmmsg, and most senders a worker keeps track of
+#define UDP_BATCH 32
+#define UDP_MAX_PEERS 64
+// A message this far behind the one expected means that the sender started over;
+// so does a group of the forward error correction this far behind the one handed on.
+#define UDP_RESYNC 1024
+#define FEC_RESYNC 1024
 
 // The file to which to append the log string.
 static const char* log_filename = "sckt_server.log";
 static FILE *log_fd = NULL;
 
 
-// Thread Name
-const char *threadNameListen  = "SocketListener";
+// Thread Name; the worker number is appended.
+const char *threadNameListen  = "SocketListen";
 
 
 static bool isListening;    // ListenerProc thread is running if this is true..
@@ -64,27 +105,329 @@ static int Protocol;
 static int SocketType;
 static int ConnPort;
 static int AddrFamily;
-
-
-static pthread_t ListenerProcID;
+// MTU of the link the datagrams come over (sckt_udp_mtu); larger ones are cut short.
+static int udpMtu = 1500;
+// How long a group of the forward error correction waits for a datagram it misses,
+// to arrive or be rebuilt, before the ones behind it go on without it, in
+// milliseconds (sckt_fec_hold_ms)
+static uint32_t fecHoldMs = 10;
+
+
+// Reassembly state of a client connection: the bytes read but not handed on yet,
+// buf[start..end), and the sequence number the next message should carry (SEQ_ANY
+// until the first one), or the session it is a stream of, and which connection of
+// that stream it is. When it last received anything, and, once the client asked for
+// acknowledgements (acks), the window granted it, the last sequence number
+// acknowledged and the acknowledgement which didn't fit into the socket yet,
+// ackOut[ackOff..ackLen). Whether it is on the ready list, having spent its read
+// budget with data left, and since when it has had data waiting to be read (0 if
+// not), and what it read: bytes, recv calls, messages, the rounds it spent its
+// budget, and its read latencies, the times from epoll reporting data, or the
+// budget running out, to the worker reading on (least, sum and most). The buffer is
+// taken from the pool while there is something to read, of the size class bufClass
+// (NULL in between), and the class it grows to next is rxClass. Whether it waits for
+// the pool to have room (starved), and whether it went over the pool's limit to
+// finish a message (overdraft):
+struct scktConn {
+  uint8_t *buf;
+  int bufClass;
+  int rxClass;
+  bool starved;
+  bool overdraft;
+  uint32_t start;
+  uint32_t end;
+  uint64_t nextSeq;
+  struct scktSession *session;
+  int stream;
+  uint32_t gen;
+  double lastRx;
+  bool acks;
+  uint32_t window;
+  uint64_t acked;
+  uint8_t ackOut[ISC_FRAME_HDR_SIZE + sizeof(struct isc_ack)];
+  uint32_t ackLen;
+  uint32_t ackOff;
+  bool ready;
+  double readySince;
+  uint64_t rxBytes;
+  uint64_t rxCalls;
+  uint64_t rxFrames;
+  uint64_t budgetSpent;
+  uint64_t latencies;
+  double latencyMin;
+  double latencySum;
+  double latencyMax;
+};
+#define SEQ_ANY UINT64_MAX
+
+// Most messages a session holds back, counting from the next one due
+#define REORDER_SLOTS 4096
+
+// A message which arrived ahead of its turn
+struct scktHeld {
+  uint8_t *buf;
+  uint32_t len;
+  bool used;
+};
+
+// What a session knows of one of its streams: whether it said hello yet, how many
+// times it did (the connection of the last hello serves it), whether it said bye,
+// the highest sequence number it carried, and its messages, their bytes and how many
+// of them came ahead of their turn
+struct scktStreamState {
+  bool joined;
+  uint32_t gen;
+  bool ended;
+  bool seen;
+  uint64_t lastSeq;
+  uint64_t frames;
+  uint64_t bytes;
+  uint64_t early;
+};
+
+// The connections a client stripes its messages over, which different workers may
+// serve; everything is guarded by lock. The message due next (nextSeq) is handed on
+// as it arrives, later ones are held by their sequence number, up to REORDER_SLOTS
+// ahead and reorderBytes in all, until their turn. Each stream carries its messages
+// in order, so a missing one is given up once every stream has gone past it or
+// ended. Stalled tells that a message is due but the peer has no room for it. Once
+// its connections (open) are gone, a session which didn't end waits sckt_linger_ms
+// from idleSince for its streams to come back.
+struct scktSession {
+  uint64_t id;
+  int streams;
+  int open;
+  double idleSince;
+  pthread_mutex_t lock;
+  uint64_t nextSeq;
+  uint64_t maxSeq;
+  bool stalled;
+  struct scktHeld *held;
+  uint32_t heldCnt;
+  size_t heldBytes;
+  struct scktStreamState stream[ISC_MAX_STREAMS];
+  // Messages handed on, given up and received again, streams resumed, and the most
+  // held back at a time
+  uint64_t delivered;
+  uint64_t lost;
+  uint64_t duplicates;
+  uint64_t resumed;
+  uint32_t peakCnt;
+  size_t peakBytes;
+  struct scktSession *next;
+};
+
+// The forward error correction of a datagram sender (see ISC_FLAG_FEC). Its groups
+// are handed on one at a time, in order: group, of k data and m parity datagrams (k
+// is 0 until one of them arrives), from data datagram next on. Those which arrived,
+// or were rebuilt, are kept as symbols in sym, in room for symCnt of them; have marks
+// them, len tells the length of the data ones, got and parity count them, and
+// parityLen is the size of the parity. maxGroup is the latest group heard of: the
+// sender is done with the ones before it, so what they miss is lost for good. Since
+// when the group waits for a datagram it misses (0 if it doesn't), and whether it
+// gives those up, having waited sckt_fec_hold_ms (flush).
+struct scktFec {
+  bool started;
+  uint32_t group;
+  uint32_t maxGroup;
+  uint16_t k;
+  uint16_t m;
+  uint16_t next;
+  uint16_t got;
+  uint16_t parity;
+  uint32_t parityLen;
+  bool have[ISC_FEC_MAX_K + ISC_FEC_MAX_M];
+  uint32_t len[ISC_FEC_MAX_K];
+  uint8_t *sym;
+  uint32_t symCnt;
+  double waitSince;
+  bool flush;
+};
+
+// Reassembly state of a datagram sender: the message being put together, if any
+// (assembling), with the fragments which arrived marked in have, and the sequence
+// number the next message should carry; its forward error correction.
+struct scktPeer {
+  struct sockaddr_in addr;
+  uint64_t nextSeq;
+  bool assembling;
+  uint64_t seq;
+  uint32_t len;
+  uint16_t flags;
+  uint16_t frags;
+  uint16_t got;
+  uint64_t have[ISC_DGRAM_MAX_FRAGS / 64];
+  uint8_t *buf;
+  double lastSeen;
+  struct scktFec fec;
+};
+
+// Datagrams of the last recvmmsg, of which those from next on are still to be handled
+struct scktBatch {
+  struct mmsghdr msgs[UDP_BATCH];
+  struct iovec iov[UDP_BATCH];
+  struct sockaddr_in addr[UDP_BATCH];
+  uint8_t *bufs;
+  int count;
+  int next;
+};
+
+// A listener worker thread. Its connections and counters are touched by it alone.
+struct scktWorker {
+  int id;
+  int cpu;                   // CPU the thread is pinned to, or -1
+  pthread_t thread;
+  bool active;
+  // Connections by file descriptor
+  struct scktConn **conns;
+  int connsSize;
+  // Connections not read from while the peer has no credits, and how often and for
+  // how long in total (seconds) that happened
+  int paused[MAX_PAUSED];
+  int nPaused;
+  double pausedSince;
+  uint64_t backpressureCount;
+  double backpressureTime;
+  // Connections accepted, messages handed on, sequence gaps seen and connections
+  // dropped for bad framing
+  uint64_t accepted;
+  uint64_t framesDelivered;
+  uint64_t seqGaps;
+  uint64_t framingErrors;
+  // CRC checks made (see ISC_FLAG_CRC), once more for a message each time the peer
+  // had no room for it, and the messages which failed theirs
+  uint64_t crcChecked;
+  uint64_t crcErrors;
+  // Connections closed as they were silent for sckt_idle_ms, and when the worker
+  // last looked for them
+  uint64_t idleClosed;
+  double idleSweep;
+  // Acknowledgements sent, and those of them which had to wait for room in the socket
+  uint64_t acksSent;
+  uint64_t acksDeferred;
+  // Connections which spent their read budget with data left, to be read on in the
+  // next round, in turn; how often that happened, and the read latencies of all
+  // connections (see struct scktConn)
+  int *ready;
+  int nReady;
+  int readySize;
+  uint64_t budgetSpent;
+  uint64_t latencies;
+  double latencySum;
+  double latencyMax;
+  // Reassembly buffers freed by the worker's connections, kept for the next ones by
+  // size class, and the fewest kept since the last trim, which weren't needed; when
+  // it last trimmed them. Connections waiting for the pool to have room. Buffers
+  // taken, those of them allocated, grown, and freed unused; how often a connection
+  // waited for room or went over the limit, and the most the pool held.
+  uint8_t *rxFree[RXBUF_CLASSES];
+  uint32_t nRxFree[RXBUF_CLASSES];
+  uint32_t lowRxFree[RXBUF_CLASSES];
+  double rxTrim;
+  int *starved;
+  int nStarved;
+  int starvedSize;
+  uint64_t rxTaken;
+  uint64_t rxAllocated;
+  uint64_t rxGrown;
+  uint64_t rxTrimmed;
+  uint64_t rxStarved;
+  uint64_t rxOverdrafts;
+  size_t rxPeak;
+  // Datagram senders and the datagrams read; recvmmsg calls, datagrams cut short by
+  // the MTU, late or duplicate ones dropped, messages given up incomplete,
+  // messages lost altogether (the sequence gaps of all senders) and datagrams the
+  // kernel dropped as the socket buffer was full (SK_MEMINFO_DROPS)
+  struct scktPeer *peers[UDP_MAX_PEERS];
+  int nPeers;
+  struct scktBatch *batch;
+  uint64_t udpCalls;
+  uint64_t udpDatagrams;
+  uint64_t udpTruncated;
+  uint64_t udpLate;
+  uint64_t udpIncomplete;
+  uint64_t udpLost;
+  uint32_t udpOverflow;
+  // Forward error correction: groups seen, parity datagrams received, data datagrams
+  // rebuilt from them and given up, and groups of which nothing arrived; whether a
+  // sender waits for a datagram it misses.
+  uint64_t fecGroups;
+  uint64_t fecParity;
+  uint64_t fecRebuilt;
+  uint64_t fecLost;
+  uint64_t fecGroupsLost;
+  bool fecWaiting;
+};
+
+// Most worker threads, and the configured number (sckt_workers)
+#define SCKT_MAX_WORKERS 64
+static struct scktWorker workers[SCKT_MAX_WORKERS];
+static int nWorkers = 1;
+
+// How the workers are pinned (sckt_cpus): not at all, one each to the CPUs the isc
+// may run on when there are several, or to the CPUs listed, in turn.
+enum scktPinning { PIN_NONE, PIN_AUTO, PIN_LIST };
+static enum scktPinning pinning = PIN_AUTO;
+static int pinCpus[SCKT_MAX_WORKERS];
+static int nPinCpus;
+
+// Open sessions, the most bytes of messages one holds back (sckt_reorder_bytes), and
+// how long one waits for its streams to reconnect, in milliseconds (sckt_linger_ms)
+static struct scktSession *sessions;
+static pthread_mutex_t sessionsLock = PTHREAD_MUTEX_INITIALIZER;
+static size_t reorderBytes = 4 * 1024 * 1024;
+static uint32_t lingerMs = 10000;
+
+// How long a connection may stay silent before it is taken for dead, in milliseconds
+// (sckt_idle_ms), 0 for ever. Clients send heartbeats to stay within it.
+static uint32_t idleMs = 0;
+
+// Most messages a client may have unacknowledged (sckt_ack_window); a client asking
+// for more is granted this many.
+static uint32_t ackWindow = 4096;
+
+// What a connection may read per round of the worker before the others get their
+// turn (sckt_read_budget bytes, sckt_read_budget_msgs messages; 0 for no limit). It is
+// checked between reads, so a round may go over by one buffer.
+static uint32_t budgetBytes = 256 * 1024;
+static uint32_t budgetFrames = 1024;
+
+// Most bytes the reassembly buffers of all workers may take, in use or kept for reuse
+// (sckt_rx_pool_bytes), and what they take now. A connection which can't have a larger
+// buffer to finish the message it holds may take one over the limit, if no other
+// connection of the server does (rxOverdraft); so the server can't deadlock with
+// every buffer full of a partial message.
+static size_t rxPoolMax = 16 * 1024 * 1024;
+static size_t rxPoolBytes;
+static bool rxOverdraft;
 
   
 // Thread routines
-static bool bListenerProcActive;
 static void *scktListenerThread(void *pArg);
-static void scktListenerProc(); // In Listen mode, handles new connections and inbound data.
+static void scktListenerProc(struct scktWorker *w); // In Listen mode, handles new connections and inbound data.
 
 
 // local helpers
 static void setnonblocking(int sock);
+static ssize_t scktReadFrames(struct scktWorker *w, int sockfd, bool *paused, bool *spent, bool *starved);
+static ssize_t scktReadDatagrams(struct scktWorker *w, int sockfd, bool *paused);
+static void scktSessionLeave(struct scktWorker *w, struct scktConn *conn);
+static void scktSessionFree(struct scktSession *s, const char *how);
+static bool scktStreamEnd(struct scktWorker *w, struct scktConn *conn);
+static void scktAck(struct scktWorker *w, int sockfd);
 
 
 // Callback function to feed data to the next chain in pipeline
 void (*recCallbackFunctionType)(uint8_t *buf, int32_t bufSize);
 
+// The shared memory module on the other side of this one. Several workers call it
+// at once, so it has to lend its buffers per thread.
+static struct ipc_module* peer;
+
 
 // Interface function as a constructor
-void ipc_init (void (*ipc_rec)(uint8_t *buf, int32_t bufSize), void (*ipc_xmit)(uint8_t *buf, int32_t bufSize))
+void ipc_init (void (*ipc_rec)(uint8_t *buf, int32_t bufSize), void (*ipc_xmit)(uint8_t *buf, int32_t bufSize),
+               struct ipc_module* ipc_peer)
 {
   if (verbose)
     printf("\nsckt_server - ipc_init\n");
@@ -98,10 +441,10 @@ void ipc_init (void (*ipc_rec)(uint8_t *buf, int32_t bufSize), void (*ipc_xmit)(
   }
 
   recCallbackFunctionType = ipc_rec;
+  peer = ipc_peer;
+  memset(workers, 0, sizeof(workers));
 
   isListening = false;
-
-  bListenerProcActive = false;
  
   return;
 }
@@ -110,9 +453,100 @@ void ipc_init (void (*ipc_rec)(uint8_t *buf, int32_t bufSize), void (*ipc_xmit)(
 // Interface function as a destructor
 void ipc_cleanup ()
 {
+  struct scktSession *s;
+
+  uint64_t backpressureCount = 0, framesDelivered = 0, seqGaps = 0, framingErrors = 0;
+  uint64_t udpCalls = 0, udpDatagrams = 0, udpTruncated = 0, udpLate = 0, udpIncomplete = 0, udpLost = 0;
+  uint64_t udpOverflow = 0, acksSent = 0, acksDeferred = 0, budgetSpent = 0, latencies = 0;
+  uint64_t rxTaken = 0, rxAllocated = 0, rxGrown = 0, rxTrimmed = 0, rxStarved = 0, rxOverdrafts = 0;
+  uint64_t crcChecked = 0, crcErrors = 0;
+  uint64_t fecGroups = 0, fecParity = 0, fecRebuilt = 0, fecLost = 0, fecGroupsLost = 0;
+  double backpressureTime = 0, latencySum = 0, latencyMax = 0;
+  size_t rxPeak = 0;
+  struct scktWorker *w;
+  int i;
+
   if (verbose)
     printf("\nsckt_server - ipc_cleanup\n");
   fprintf(main_log_fd, "\n%s - INFO - sckt_server - ipc_cleanup", get_timestamp());
+  for (i = 0; i < nWorkers; i++) {
+    w = &workers[i];
+    fprintf(main_log_fd, "\n%s - INFO - sckt_server - worker %d: %llu connections, %llu messages handed on, %llu connections closed as silent",
+            get_timestamp(), i, (unsigned long long) w->accepted, (unsigned long long) w->framesDelivered,
+            (unsigned long long) w->idleClosed);
+    backpressureCount += w->backpressureCount;
+    backpressureTime += w->backpressureTime;
+    framesDelivered += w->framesDelivered;
+    seqGaps += w->seqGaps;
+    framingErrors += w->framingErrors;
+    crcChecked += w->crcChecked;
+    crcErrors += w->crcErrors;
+    udpCalls += w->udpCalls;
+    udpDatagrams += w->udpDatagrams;
+    udpTruncated += w->udpTruncated;
+    udpLate += w->udpLate;
+    udpIncomplete += w->udpIncomplete;
+    udpLost += w->udpLost;
+    udpOverflow += w->udpOverflow;
+    fecGroups += w->fecGroups;
+    fecParity += w->fecParity;
+    fecRebuilt += w->fecRebuilt;
+    fecLost += w->fecLost;
+    fecGroupsLost += w->fecGroupsLost;
+    acksSent += w->acksSent;
+    acksDeferred += w->acksDeferred;
+    budgetSpent += w->budgetSpent;
+    latencies += w->latencies;
+    latencySum += w->latencySum;
+    if (w->latencyMax > latencyMax)
+      latencyMax = w->latencyMax;
+    rxTaken += w->rxTaken;
+    rxAllocated += w->rxAllocated;
+    rxGrown += w->rxGrown;
+    rxTrimmed += w->rxTrimmed;
+    rxStarved += w->rxStarved;
+    rxOverdrafts += w->rxOverdrafts;
+    if (w->rxPeak > rxPeak)
+      rxPeak = w->rxPeak;
+  }
+  fprintf(main_log_fd, "\n%s - INFO - sckt_server - backpressure engaged %llu times, %.3f s in total",
+          get_timestamp(), (unsigned long long) backpressureCount, backpressureTime);
+  fprintf(main_log_fd, "\n%s - INFO - sckt_server - %llu messages handed on, %llu sequence gaps, %llu framing errors",
+          get_timestamp(), (unsigned long long) framesDelivered, (unsigned long long) seqGaps,
+          (unsigned long long) framingErrors);
+  if (crcChecked > 0)
+    fprintf(main_log_fd, "\n%s - INFO - sckt_server - %llu CRC checks made with %s, %llu messages failed",
+            get_timestamp(), (unsigned long long) crcChecked, isc_crc32c_impl(), (unsigned long long) crcErrors);
+  if (acksSent > 0)
+    fprintf(main_log_fd, "\n%s - INFO - sckt_server - %llu acknowledgements sent, %llu of them delayed as the socket was full",
+            get_timestamp(), (unsigned long long) acksSent, (unsigned long long) acksDeferred);
+  if (SocketType == SOCK_STREAM) {
+    fprintf(main_log_fd, "\n%s - INFO - sckt_server - read budget spent %llu times; read latency avg %.3f ms, max %.3f ms over %llu rounds",
+            get_timestamp(), (unsigned long long) budgetSpent, latencies ? latencySum / latencies * 1e3 : 0.0,
+            latencyMax * 1e3, (unsigned long long) latencies);
+    fprintf(main_log_fd, "\n%s - INFO - sckt_server - receive buffers: %llu taken, %llu of them allocated, %llu grown, %llu freed unused; at most %zu of %zu bytes held",
+            get_timestamp(), (unsigned long long) rxTaken, (unsigned long long) rxAllocated,
+            (unsigned long long) rxGrown, (unsigned long long) rxTrimmed, rxPeak, rxPoolMax);
+    fprintf(main_log_fd, "\n%s - INFO - sckt_server - receive buffers: connections waited %llu times for room, went over the limit %llu times",
+            get_timestamp(), (unsigned long long) rxStarved, (unsigned long long) rxOverdrafts);
+  }
+  // Sessions still waiting for their streams to come back
+  while ( (s = sessions) != NULL) {
+    sessions = s->next;
+    scktSessionFree(s, "given up");
+  }
+  if (SocketType == SOCK_DGRAM) {
+    fprintf(main_log_fd, "\n%s - INFO - sckt_server - udp: %llu datagrams in %llu recvmmsg calls, %llu cut short, %llu late or duplicate",
+            get_timestamp(), (unsigned long long) udpDatagrams, (unsigned long long) udpCalls,
+            (unsigned long long) udpTruncated, (unsigned long long) udpLate);
+    fprintf(main_log_fd, "\n%s - INFO - sckt_server - udp: %llu messages lost, %llu of them incomplete; %llu datagrams dropped by the kernel",
+            get_timestamp(), (unsigned long long) udpLost, (unsigned long long) udpIncomplete,
+            (unsigned long long) udpOverflow);
+    if (fecGroups > 0)
+      fprintf(main_log_fd, "\n%s - INFO - sckt_server - udp: forward error correction over %llu groups, %llu parity datagrams received; %llu datagrams rebuilt, %llu lost beyond repair, %llu groups lost whole",
+              get_timestamp(), (unsigned long long) fecGroups, (unsigned long long) fecParity,
+              (unsigned long long) fecRebuilt, (unsigned long long) fecLost, (unsigned long long) fecGroupsLost);
+  }
 
   // All done. Close the main log file.
   if (log_fd)
@@ -149,23 +583,159 @@ bool ipc_set_param(const char* prtcl, const char *addr, int port)
     rval = false;
 
   if (rval) {
-    SocketType = SOCK_STREAM;
+    SocketType = (Protocol == IPPROTO_UDP) ? SOCK_DGRAM : SOCK_STREAM;
     ConnPort = port; // use PF_INET domain socket connection
     AddrFamily = AF_INET;
   }
 
   if (rval == true)
-    fprintf(main_log_fd, "\n%s - INFO - sckt_server - ipc_set_param - Protocol:%s, SocketType:SOCK_STREAM, PORT:%d.", get_timestamp(), prtcl, ConnPort);
+    fprintf(main_log_fd, "\n%s - INFO - sckt_server - ipc_set_param - Protocol:%s, SocketType:%s, PORT:%d.", get_timestamp(), prtcl,
+            SocketType == SOCK_DGRAM ? "SOCK_DGRAM" : "SOCK_STREAM", ConnPort);
   else
-    fprintf(main_log_fd, "\n%s - ERROR - sckt_server - ipc_set_param - Protocol:%s, SocketType:SOCK_STREAM, PORT:%d.", get_timestamp(), prtcl, port);
+    fprintf(main_log_fd, "\n%s - ERROR - sckt_server - ipc_set_param - Protocol:%s, PORT:%d.", get_timestamp(), prtcl, port);
 
   return (rval);
 }
 
 
+// Interface function to set a named configuration option
+bool ipc_set_option(const char* key, const char* value)
+{
+  char *end;
+  const char *p;
+  unsigned long n;
+  int cnt = 0;
+
+  if (verbose)
+    printf("\nsckt_server - ipc_set_option\n");
+
+  if (sckt_tune_set_option(&sckt_tuning, key, value))
+    return true;
+  if (strcmp(key, "sckt_workers") == 0) {
+    n = strtoul(value, &end, 0);
+    if (*value == '\0' || *end != '\0' || n == 0 || n > SCKT_MAX_WORKERS)
+      return false;
+    nWorkers = n;
+    return true;
+  }
+  if (strcmp(key, "sckt_cpus") == 0) {
+    if (strcmp(value, "none") == 0)
+      pinning = PIN_NONE;
+    else if (strcmp(value, "auto") == 0)
+      pinning = PIN_AUTO;
+    else {
+      // A comma separated list of CPU numbers
+      for (p = value; cnt < SCKT_MAX_WORKERS; p = end + 1) {
+        n = strtoul(p, &end, 10);
+        if (end == p || n >= CPU_SETSIZE || (*end != ',' && *end != '\0'))
+          return false;
+        pinCpus[cnt++] = n;
+        if (*end == '\0')
+          break;
+      }
+      if (*end != '\0')
+        return false;
+      nPinCpus = cnt;
+      pinning = PIN_LIST;
+    }
+    return true;
+  }
+  if (strcmp(key, "sckt_udp_mtu") == 0) {
+    n = strtoul(value, &end, 0);
+    if (*value == '\0' || *end != '\0' || n < ISC_DGRAM_MIN_MTU || n > ISC_DGRAM_MAX_MTU)
+      return false;
+    udpMtu = n;
+    return true;
+  }
+  if (strcmp(key, "sckt_fec_hold_ms") == 0) {
+    n = strtoul(value, &end, 0);
+    if (*value == '\0' || *end != '\0' || n == 0 || n > 60000)
+      return false;
+    fecHoldMs = n;
+    return true;
+  }
+  if (strcmp(key, "sckt_linger_ms") == 0) {
+    n = strtoul(value, &end, 0);
+    if (*value == '\0' || *end != '\0' || n > 3600000)
+      return false;
+    lingerMs = n;
+    return true;
+  }
+  if (strcmp(key, "sckt_idle_ms") == 0) {
+    n = strtoul(value, &end, 0);
+    if (*value == '\0' || *end != '\0' || n > 3600000)
+      return false;
+    idleMs = n;
+    return true;
+  }
+  if (strcmp(key, "sckt_ack_window") == 0) {
+    n = strtoul(value, &end, 0);
+    if (*value == '\0' || *end != '\0' || n == 0 || n > UINT32_MAX)
+      return false;
+    ackWindow = n;
+    return true;
+  }
+  if (strcmp(key, "sckt_read_budget") == 0 || strcmp(key, "sckt_read_budget_msgs") == 0) {
+    n = strtoul(value, &end, 0);
+    if (*value == '\0' || *end != '\0' || n > UINT32_MAX)
+      return false;
+    if (strcmp(key, "sckt_read_budget") == 0)
+      budgetBytes = n;
+    else
+      budgetFrames = n;
+    return true;
+  }
+  if (strcmp(key, "sckt_reorder_bytes") == 0) {
+    // Room for the largest message at least
+    n = strtoul(value, &end, 0);
+    if (*value == '\0' || *end != '\0' || n < ISC_FRAME_MAX || n > 1UL << 30)
+      return false;
+    reorderBytes = n;
+    return true;
+  }
+  if (strcmp(key, "sckt_rx_pool_bytes") == 0) {
+    // Room for the largest buffer at least
+    n = strtoul(value, &end, 0);
+    if (*value == '\0' || *end != '\0' || n < CONN_BUFSIZE || n > 1UL << 30)
+      return false;
+    rxPoolMax = n;
+    return true;
+  }
+  return false;
+}
+
+
+// Pick the CPU of each worker as sckt_cpus says, -1 for none.
+static void scktPlaceWorkers()
+{
+  cpu_set_t allowed;
+  int i, cpu = -1;
+
+  if (pinning == PIN_AUTO && nWorkers > 1 && sched_getaffinity(0, sizeof(allowed), &allowed) == -1)
+    system_error("ipc_start - sched_getaffinity");
+
+  for (i = 0; i < nWorkers; i++) {
+    workers[i].cpu = -1;
+    if (pinning == PIN_LIST)
+      workers[i].cpu = pinCpus[i % nPinCpus];
+    else if (pinning == PIN_AUTO && nWorkers > 1) {
+      // The next CPU the isc may run on, starting over after the last one
+      do {
+        cpu = (cpu + 1) % CPU_SETSIZE;
+      } while (!CPU_ISSET(cpu, &allowed));
+      workers[i].cpu = cpu;
+    }
+  }
+}
+
+
 // Interface function to start the thread 
 bool ipc_start()
 {
+  struct scktWorker *w;
+  char name[16];
+  int i;
+
   if (verbose)
     printf("\nsckt_server - ipc_start\n");
   fprintf(main_log_fd, "\n%s - INFO - sckt_server - ipc_start", get_timestamp());
@@ -179,19 +749,24 @@ bool ipc_start()
 //  pthread_attr_setdetachstate(&thread_attribs,PTHREAD_CREATE_DETACHED);
   pthread_attr_setstacksize(&thread_attribs, 65536);
 
-  bListenerProcActive = true;
   isListening  = true;
-
-  if ( pthread_create(&ListenerProcID, &thread_attribs, scktListenerThread, NULL) ) {
-    isListening = false;
-    system_error("ipc_start - scktStartListener: error creating listener thread, aborting");
-  }
-  else {
-    pthread_setname_np(ListenerProcID, threadNameListen);
-    while(!bListenerProcActive) { usleep(100); } // wait for the thread to come up
+  scktPlaceWorkers();
+
+  for (i = 0; i < nWorkers; i++) {
+    w = &workers[i];
+    w->id = i;
+    w->active = false;
+    if ( pthread_create(&w->thread, &thread_attribs, scktListenerThread, w) ) {
+      isListening = false;
+      system_error("ipc_start - scktStartListener: error creating listener thread, aborting");
+    }
+    snprintf(name, sizeof(name), "%s%d", threadNameListen, i);
+    pthread_setname_np(w->thread, name);
+    while (!__atomic_load_n(&w->active, __ATOMIC_ACQUIRE)) { usleep(100); } // wait for the thread to come up
   }
    
   pthread_attr_destroy(&thread_attribs);
+  fprintf(main_log_fd, "\n%s - INFO - sckt_server - %d listener workers started", get_timestamp(), nWorkers);
 
   return (isListening);
 }
@@ -200,11 +775,14 @@ bool ipc_start()
 // Interface function to join the thread 
 bool ipc_wait4Done()
 {
+  int i;
+
   if (verbose)
     printf("\nsckt_server - ipc_wait4Done\n");
 
-  // Make sure the listener thread has finished.
-  if (pthread_join(ListenerProcID, NULL) != 0) return false;
+  // Make sure the listener threads have finished.
+  for (i = 0; i < nWorkers; i++)
+    if (pthread_join(workers[i].thread, NULL) != 0) return false;
 
   fprintf(main_log_fd, "\n%s - INFO - sckt_server - wait4Done - ListenerProc exited", get_timestamp());
 
@@ -229,39 +807,1490 @@ void setnonblocking(int sock)
 }
 
 
-// Socket listener main thread
+// Bytes of a reassembly buffer of the size class C
+static uint32_t scktRxSize(int c)
+{
+  return c < RXBUF_CLASSES - 1 ? (uint32_t) RXBUF_MIN << c : CONN_BUFSIZE;
+}
+
+
+// Count SIZE bytes more to the pool, if they fit into sckt_rx_pool_bytes or OVER is
+// set, and note the most it held. Returns false if they don't fit.
+static bool scktRxReserve(struct scktWorker *w, size_t size, bool over)
+{
+  size_t held = __atomic_load_n(&rxPoolBytes, __ATOMIC_RELAXED);
+
+  do {
+    if (!over && held + size > rxPoolMax)
+      return false;
+  } while (!__atomic_compare_exchange_n(&rxPoolBytes, &held, held + size, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+  if (held + size > w->rxPeak)
+    w->rxPeak = held + size;
+  return true;
+}
+
+
+// Free the buffers of the size class C which W keeps, all but KEEP of them.
+static void scktRxFree(struct scktWorker *w, int c, uint32_t keep)
+{
+  uint8_t *buf;
+
+  while (w->nRxFree[c] > keep) {
+    buf = w->rxFree[c];
+    w->rxFree[c] = *(uint8_t **) buf;
+    w->nRxFree[c]--;
+    free(buf);
+    __atomic_sub_fetch(&rxPoolBytes, scktRxSize(c), __ATOMIC_RELAXED);
+    w->rxTrimmed++;
+  }
+  if (w->lowRxFree[c] > w->nRxFree[c])
+    w->lowRxFree[c] = w->nRxFree[c];
+}
+
+
+// Once per RXPOOL_TRIM, free the buffers W kept which no connection asked for since
+// the last time, so that the pool shrinks again after a burst.
+static void scktRxTrim(struct scktWorker *w, double now)
+{
+  int c;
+
+  if (now - w->rxTrim < RXPOOL_TRIM)
+    return;
+  w->rxTrim = now;
+  for (c = 0; c < RXBUF_CLASSES; c++) {
+    scktRxFree(w, c, w->nRxFree[c] - w->lowRxFree[c]);
+    w->lowRxFree[c] = w->nRxFree[c];
+  }
+}
+
+
+// Take a buffer of the size class C for CONN: one W kept, else a new one if the pool
+// stays within its limit, to which end W first frees the buffers it kept of the other
+// classes. Failing that, a connection which NEEDS the buffer to finish the message it
+// holds goes over the limit, unless another one does already. NULL if CONN has to
+// wait for room.
+static uint8_t *scktRxTake(struct scktWorker *w, struct scktConn *conn, int c, bool needs)
+{
+  uint8_t *buf;
+  int i;
+
+  if ( (buf = w->rxFree[c]) != NULL) {
+    w->rxFree[c] = *(uint8_t **) buf;
+    if (--w->nRxFree[c] < w->lowRxFree[c])
+      w->lowRxFree[c] = w->nRxFree[c];
+    w->rxTaken++;
+    return buf;
+  }
+  if (!scktRxReserve(w, scktRxSize(c), false)) {
+    for (i = 0; i < RXBUF_CLASSES; i++)
+      scktRxFree(w, i, 0);
+    if (!scktRxReserve(w, scktRxSize(c), false)) {
+      if (!needs || (!conn->overdraft && __atomic_exchange_n(&rxOverdraft, true, __ATOMIC_ACQ_REL)))
+        return NULL;
+      if (!conn->overdraft)
+        w->rxOverdrafts++;
+      conn->overdraft = true;
+      scktRxReserve(w, scktRxSize(c), true);
+    }
+  }
+  w->rxTaken++;
+  w->rxAllocated++;
+  return (uint8_t *) xmalloc(scktRxSize(c));
+}
+
+
+// Give BUF of the size class C back to the pool: W keeps it for the next connection
+// which needs one, unless the pool is over its limit.
+static void scktRxGive(struct scktWorker *w, uint8_t *buf, int c)
+{
+  if (__atomic_load_n(&rxPoolBytes, __ATOMIC_RELAXED) > rxPoolMax) {
+    free(buf);
+    __atomic_sub_fetch(&rxPoolBytes, scktRxSize(c), __ATOMIC_RELAXED);
+    return;
+  }
+  *(uint8_t **) buf = w->rxFree[c];
+  w->rxFree[c] = buf;
+  w->nRxFree[c]++;
+}
+
+
+// Give the buffer of CONN back to the pool, along with what it holds, and end the
+// overdraft of CONN. It takes one again when it has something to read.
+static void scktRxRelease(struct scktWorker *w, struct scktConn *conn)
+{
+  if (conn->buf == NULL)
+    return;
+  scktRxGive(w, conn->buf, conn->bufClass);
+  conn->buf = NULL;
+  conn->start = conn->end = 0;
+  if (conn->overdraft) {
+    conn->overdraft = false;
+    __atomic_store_n(&rxOverdraft, false, __ATOMIC_RELEASE);
+  }
+}
+
+
+// Make room for the next read of CONN, whose buffer holds at most an incomplete
+// message, at its front: take a buffer if it has none, and a larger one if the message
+// doesn't fit, or to read more at a time (rxClass) if the pool has room. Returns false
+// if the connection has to wait for the pool.
+static bool scktRxFit(struct scktWorker *w, struct scktConn *conn)
+{
+  struct isc_frame_hdr hdr;
+  uint32_t need = 0, size = conn->buf != NULL ? scktRxSize(conn->bufClass) : 0;
+  uint8_t *buf;
+  int c = conn->rxClass;
+
+  // scktDeliver checked the length of the message.
+  if (conn->end >= ISC_FRAME_HDR_SIZE) {
+    isc_frame_decode(conn->buf, &hdr);
+    need = ISC_FRAME_HDR_SIZE + hdr.len;
+  }
+  while (scktRxSize(c) < need)
+    c++;
+  if (conn->buf != NULL && c <= conn->bufClass)
+    return true;
+  if ( (buf = scktRxTake(w, conn, c, need > size)) == NULL) {
+    // Reading more at a time waits for a better chance.
+    conn->rxClass = conn->buf != NULL ? conn->bufClass : 0;
+    return conn->buf != NULL && need <= size;
+  }
+  if (conn->buf != NULL) {
+    memcpy(buf, conn->buf, conn->end);
+    scktRxGive(w, conn->buf, conn->bufClass);
+    w->rxGrown++;
+  }
+  conn->buf = buf;
+  conn->bufClass = conn->rxClass = c;
+  return true;
+}
+
+
+// Set up the reassembly state of the new connection SOCKFD.
+static void scktConnOpen(struct scktWorker *w, int sockfd)
+{
+  struct scktConn *conn;
+  int size = w->connsSize;
+
+  if (sockfd >= w->connsSize) {
+    while (size <= sockfd)
+      size = size ? 2 * size : 64;
+    w->conns = (struct scktConn **) xrealloc(w->conns, size * sizeof(w->conns[0]));
+    memset(w->conns + w->connsSize, 0, (size - w->connsSize) * sizeof(w->conns[0]));
+    w->connsSize = size;
+  }
+  conn = (struct scktConn *) xmalloc(sizeof(*conn));
+  conn->buf = NULL;
+  conn->bufClass = conn->rxClass = 0;
+  conn->starved = conn->overdraft = false;
+  conn->start = conn->end = 0;
+  conn->nextSeq = SEQ_ANY;
+  conn->session = NULL;
+  conn->lastRx = get_monotonic_time();
+  conn->acks = false;
+  conn->acked = SEQ_ANY;
+  conn->ackLen = conn->ackOff = 0;
+  conn->ready = false;
+  conn->readySince = 0;
+  conn->rxBytes = conn->rxCalls = conn->rxFrames = conn->budgetSpent = conn->latencies = 0;
+  conn->latencyMin = conn->latencySum = conn->latencyMax = 0;
+  w->conns[sockfd] = conn;
+  w->accepted++;
+}
+
+
+// Close SOCKFD, log what it read, and drop its reassembly state, along with a partly
+// received message.
+static void scktConnClose(struct scktWorker *w, int sockfd)
+{
+  struct scktConn *conn = sockfd < w->connsSize ? w->conns[sockfd] : NULL;
+  int i;
+
+  if (conn != NULL) {
+    fprintf(main_log_fd, "\n%s - INFO - sckt_server - connection closed: %llu bytes in %llu reads, %llu messages, read budget spent %llu times",
+            get_timestamp(), (unsigned long long) conn->rxBytes, (unsigned long long) conn->rxCalls,
+            (unsigned long long) conn->rxFrames, (unsigned long long) conn->budgetSpent);
+    if (conn->latencies > 0)
+      fprintf(main_log_fd, ", read latency min %.3f ms, avg %.3f ms, max %.3f ms", conn->latencyMin * 1e3,
+              conn->latencySum / conn->latencies * 1e3, conn->latencyMax * 1e3);
+    if (conn->end > conn->start)
+      fprintf(main_log_fd, "\n%s - WARNING - sckt_server - connection closed with %u bytes of an incomplete message",
+              get_timestamp(), conn->end - conn->start);
+    if (conn->ready) {
+      for (i = 0; w->ready[i] != sockfd; i++)
+        ;
+      memmove(w->ready + i, w->ready + i + 1, (--w->nReady - i) * sizeof(w->ready[0]));
+    }
+    if (conn->starved) {
+      for (i = 0; w->starved[i] != sockfd; i++)
+        ;
+      memmove(w->starved + i, w->starved + i + 1, (--w->nStarved - i) * sizeof(w->starved[0]));
+    }
+    if (conn->session != NULL)
+      scktSessionLeave(w, conn);
+    scktRxRelease(w, conn);
+    free(conn);
+    w->conns[sockfd] = NULL;
+  }
+  close(sockfd);
+}
+
+
+// Hand the message of LEN bytes at BUF on to the shared memory module with
+// ipc_hand_on, then log it. Returns false, leaving the message where it is, while the
+// peer has no room for it.
+static bool scktHandOn(uint8_t *buf, uint32_t len)
+{
+  int i;
+
+  if (!ipc_hand_on(peer, recCallbackFunctionType, buf, len))
+    return false;
+
+  fprintf(log_fd, "\n%s - INFO - sckt_server - ", get_timestamp());
+
+#if 1
+  for (i = 0; i < len; i++) {
+    fprintf(log_fd, "0x%X,", buf[i] & 0x000000FF);
+  }
+#endif
+
+  return true;
+}
+
+
+// Whether every stream of S went past message SEQ or ended, so that it can't come
+// any more.
+static bool scktSessionPassed(struct scktSession *s, uint64_t seq)
+{
+  int i;
+
+  for (i = 0; i < s->streams; i++)
+    if (!s->stream[i].ended && !(s->stream[i].seen && s->stream[i].lastSeq > seq))
+      return false;
+  return true;
+}
+
+
+// Hand on the messages of S which are due, in turn, giving up those which can't come
+// any more. Called with S locked. Returns false, with S stalled, while the peer has
+// no room for the next one.
+static bool scktSessionDrain(struct scktWorker *w, struct scktSession *s)
+{
+  struct scktHeld *h;
+  uint64_t from;
+
+  for (;;) {
+    h = &s->held[s->nextSeq % REORDER_SLOTS];
+    if (!h->used) {
+      from = s->nextSeq;
+      while (s->nextSeq < s->maxSeq && !s->held[s->nextSeq % REORDER_SLOTS].used &&
+             scktSessionPassed(s, s->nextSeq))
+        s->nextSeq++;
+      if (s->nextSeq == from)
+        break;
+      fprintf(main_log_fd, "\n%s - WARNING - sckt_server - session %016llx lost messages %llu to %llu",
+              get_timestamp(), (unsigned long long) s->id, (unsigned long long) from,
+              (unsigned long long) s->nextSeq - 1);
+      s->lost += s->nextSeq - from;
+      w->seqGaps++;
+      continue;
+    }
+    if (h->len > 0 && !scktHandOn(h->buf, h->len)) {
+      __atomic_store_n(&s->stalled, true, __ATOMIC_RELEASE);
+      return false;
+    }
+    free(h->buf);
+    h->used = false;
+    s->heldCnt--;
+    s->heldBytes -= h->len;
+    s->nextSeq++;
+    s->delivered++;
+    w->framesDelivered++;
+  }
+  __atomic_store_n(&s->stalled, false, __ATOMIC_RELEASE);
+  return true;
+}
+
+
+// Log the statistics of session S, which ended as HOW says, and free it.
+void scktSessionFree(struct scktSession *s, const char *how)
+{
+  int i;
+
+  for (i = 0; i < s->streams; i++)
+    fprintf(main_log_fd, "\n%s - INFO - sckt_server - session %016llx stream %d: %llu messages, %llu bytes, %llu ahead of their turn",
+            get_timestamp(), (unsigned long long) s->id, i, (unsigned long long) s->stream[i].frames,
+            (unsigned long long) s->stream[i].bytes, (unsigned long long) s->stream[i].early);
+  fprintf(main_log_fd, "\n%s - INFO - sckt_server - session %016llx %s: %llu messages handed on in order, %llu lost, %llu received again, %llu streams resumed, at most %u (%zu bytes) held back",
+          get_timestamp(), (unsigned long long) s->id, how, (unsigned long long) s->delivered,
+          (unsigned long long) s->lost, (unsigned long long) s->duplicates, (unsigned long long) s->resumed,
+          s->peakCnt, s->peakBytes);
+  if (s->heldCnt > 0)
+    fprintf(main_log_fd, "\n%s - WARNING - sckt_server - session %016llx %s with %u messages held back",
+            get_timestamp(), (unsigned long long) s->id, how, s->heldCnt);
+  for (i = 0; i < REORDER_SLOTS; i++)
+    if (s->held[i].used)
+      free(s->held[i].buf);
+  free(s->held);
+  pthread_mutex_destroy(&s->lock);
+  free(s);
+}
+
+
+// Free the sessions which have waited longer than sckt_linger_ms for their streams
+// to come back, with sessionsLock held.
+static void scktSessionExpire()
+{
+  struct scktSession *s, **link = &sessions;
+  double now = get_monotonic_time();
+
+  while ( (s = *link) != NULL) {
+    if (s->open == 0 && now - s->idleSince >= lingerMs / 1000.0) {
+      *link = s->next;
+      scktSessionFree(s, "given up");
+    }
+    else
+      link = &s->next;
+  }
+}
+
+
+// Attach CONN to stream STREAM of the STREAMS of session ID, which its first stream
+// to say hello sets up. A stream which says hello again, having reconnected, is
+// served by CONN from now on. Returns false if the hello doesn't fit the session.
+static bool scktSessionJoin(struct scktWorker *w, struct scktConn *conn, uint64_t id, int stream, int streams)
+{
+  struct scktSession *s;
+  bool again;
+
+  pthread_mutex_lock(&sessionsLock);
+  scktSessionExpire();
+  for (s = sessions; s != NULL && s->id != id; s = s->next)
+    ;
+  if (s == NULL) {
+    s = xmalloc(sizeof(*s));
+    memset(s, 0, sizeof(*s));
+    s->id = id;
+    s->streams = streams;
+    s->held = xmalloc(REORDER_SLOTS * sizeof(*s->held));
+    memset(s->held, 0, REORDER_SLOTS * sizeof(*s->held));
+    pthread_mutex_init(&s->lock, NULL);
+    s->next = sessions;
+    sessions = s;
+  }
+  pthread_mutex_lock(&s->lock);
+  if (s->streams != streams) {
+    pthread_mutex_unlock(&s->lock);
+    pthread_mutex_unlock(&sessionsLock);
+    fprintf(main_log_fd, "\n%s - ERROR - sckt_server - stream %d of %d doesn't fit session %016llx",
+            get_timestamp(), stream, streams, (unsigned long long) id);
+    return false;
+  }
+  again = s->stream[stream].joined;
+  if (again)
+    s->resumed++;
+  s->stream[stream].joined = true;
+  s->stream[stream].ended = false;
+  s->open++;
+  conn->session = s;
+  conn->stream = stream;
+  conn->gen = ++s->stream[stream].gen;
+  pthread_mutex_unlock(&s->lock);
+  pthread_mutex_unlock(&sessionsLock);
+
+  fprintf(main_log_fd, "\n%s - INFO - sckt_server - stream %d of %d of session %016llx %s on worker %d",
+          get_timestamp(), stream, streams, (unsigned long long) id, again ? "resumes" : "starts", w->id);
+  return true;
+}
+
+
+// Detach CONN from its session. The session ends once its last connection goes and
+// every stream said bye; else it waits for its streams to come back.
+void scktSessionLeave(struct scktWorker *w, struct scktConn *conn)
+{
+  struct scktSession *s = conn->session, **link;
+  bool done = false;
+  int i;
+
+  pthread_mutex_lock(&sessionsLock);
+  pthread_mutex_lock(&s->lock);
+  if (--s->open == 0) {
+    for (i = 0, done = true; i < s->streams; i++)
+      done = done && s->stream[i].ended;
+    s->idleSince = get_monotonic_time();
+  }
+  if (done)
+    for (link = &sessions; *link != NULL; link = &(*link)->next)
+      if (*link == s) {
+        *link = s->next;
+        break;
+      }
+  pthread_mutex_unlock(&s->lock);
+  if (done)
+    scktSessionFree(s, "ended");
+  scktSessionExpire();
+  pthread_mutex_unlock(&sessionsLock);
+  conn->session = NULL;
+}
+
+
+// Take the control message HDR with its payload at BUF, which came over CONN. The
+// hello of a striped connection attaches it to its session, and its bye ends its
+// stream; an ack request has CONN acknowledge what is handed on, and heartbeats have
+// nothing to do. Returns 0 once done, 1 while the bye waits for the peer to take what
+// is due, and -1 if the message doesn't make sense.
+static int scktControl(struct scktWorker *w, struct scktConn *conn, const struct isc_frame_hdr *hdr, const uint8_t *buf)
+{
+  struct isc_stripe_hello hello;
+  struct isc_ack ack;
+  int stream, streams;
+
+  if (hdr->flags & ISC_FLAG_ACK) {
+    if (hdr->len != sizeof(ack)) {
+      fprintf(main_log_fd, "\n%s - ERROR - sckt_server - ack request of %u bytes", get_timestamp(), hdr->len);
+      return -1;
+    }
+    memcpy(&ack, buf, sizeof(ack));
+    conn->window = be32toh(ack.window);
+    if (conn->window == 0 || conn->window > ackWindow)
+      conn->window = ackWindow;
+    // Answered at once, even if there is nothing to acknowledge yet
+    conn->acks = true;
+    conn->acked = SEQ_ANY;
+    return 0;
+  }
+  if ((hdr->flags & ISC_FLAG_BYE) && conn->session != NULL)
+    return scktStreamEnd(w, conn) ? 0 : 1;
+  if (!(hdr->flags & ISC_FLAG_STRIPE))
+    return 0;
+  if (hdr->len != sizeof(hello) || conn->session != NULL) {
+    fprintf(main_log_fd, "\n%s - ERROR - sckt_server - unexpected stream hello", get_timestamp());
+    return -1;
+  }
+  memcpy(&hello, buf, sizeof(hello));
+  stream = be16toh(hello.stream);
+  streams = be16toh(hello.streams);
+  if (streams < 1 || streams > ISC_MAX_STREAMS || stream >= streams) {
+    fprintf(main_log_fd, "\n%s - ERROR - sckt_server - stream hello for stream %d of %d",
+            get_timestamp(), stream, streams);
+    return -1;
+  }
+  return scktSessionJoin(w, conn, be64toh(hello.session), stream, streams) ? 0 : -1;
+}
+
+
+// Take message HDR with its payload at BUF, which came over CONN, stream of a
+// session: hand it on if it is due, else hold it back until it is. Returns 1 while
+// it has to wait, either for room in the peer or, being too far ahead, in the reorder
+// buffer; else 0 (a message handed on or held already is dropped).
+static int scktStripe(struct scktWorker *w, struct scktConn *conn, const struct isc_frame_hdr *hdr, uint8_t *buf)
+{
+  struct scktSession *s = conn->session;
+  struct scktStreamState *st = &s->stream[conn->stream];
+  struct scktHeld *h;
+  int r = 1;
+
+  pthread_mutex_lock(&s->lock);
+  if (!st->seen || hdr->seq > st->lastSeq) {
+    st->lastSeq = hdr->seq;
+    st->seen = true;
+  }
+  if (hdr->seq >= s->maxSeq)
+    s->maxSeq = hdr->seq + 1;
+  if (!scktSessionDrain(w, s))
+    goto out;
+
+  if (hdr->seq < s->nextSeq ||
+      (hdr->seq - s->nextSeq < REORDER_SLOTS && s->held[hdr->seq % REORDER_SLOTS].used)) {
+    // Sent again after a reconnect
+    s->duplicates++;
+    pthread_mutex_unlock(&s->lock);
+    return 0;
+  } else if (hdr->seq == s->nextSeq) {
+    if (hdr->len > 0 && !scktHandOn(buf, hdr->len))
+      goto out;
+    s->nextSeq++;
+    s->delivered++;
+    w->framesDelivered++;
+    scktSessionDrain(w, s);
+    r = 0;
+  } else if (hdr->seq - s->nextSeq < REORDER_SLOTS && s->heldBytes + hdr->len <= reorderBytes) {
+    h = &s->held[hdr->seq % REORDER_SLOTS];
+    h->buf = NULL;
+    if (hdr->len > 0) {
+      h->buf = xmalloc(hdr->len);
+      memcpy(h->buf, buf, hdr->len);
+    }
+    h->len = hdr->len;
+    h->used = true;
+    if (++s->heldCnt > s->peakCnt)
+      s->peakCnt = s->heldCnt;
+    if ( (s->heldBytes += hdr->len) > s->peakBytes)
+      s->peakBytes = s->heldBytes;
+    st->early++;
+    r = 0;
+  }
+
+out:
+  if (r == 0) {
+    st->frames++;
+    st->bytes += hdr->len;
+  }
+  pthread_mutex_unlock(&s->lock);
+  return r;
+}
+
+
+// Mark the stream CONN as ended, as it said bye, and hand on what its session can
+// now. Returns false while the peer has no room for it.
+static bool scktStreamEnd(struct scktWorker *w, struct scktConn *conn)
+{
+  struct scktSession *s = conn->session;
+  bool done;
+
+  pthread_mutex_lock(&s->lock);
+  if (conn->gen == s->stream[conn->stream].gen)
+    s->stream[conn->stream].ended = true;
+  done = scktSessionDrain(w, s);
+  pthread_mutex_unlock(&s->lock);
+  return done;
+}
+
+
+// Whether the session of CONN has to wait for room in the peer. If so, it tries once
+// more to hand on what is due.
+static bool scktStalled(struct scktWorker *w, struct scktConn *conn)
+{
+  struct scktSession *s = conn->session;
+  bool stalled;
+
+  if (s == NULL || !__atomic_load_n(&s->stalled, __ATOMIC_ACQUIRE))
+    return false;
+  pthread_mutex_lock(&s->lock);
+  stalled = !scktSessionDrain(w, s);
+  pthread_mutex_unlock(&s->lock);
+  return stalled;
+}
+
+
+// Strip the CRC off message HDR, whose payload *BUF of *LEN bytes it leads if
+// flagged, and check the rest against it. Returns false if the message is too short
+// to carry one, or doesn't match it.
+static bool scktCrcCheck(struct scktWorker *w, const struct isc_frame_hdr *hdr, uint8_t **buf, uint32_t *len)
+{
+  uint32_t sum;
+
+  if (!(hdr->flags & ISC_FLAG_CRC))
+    return true;
+  if (*len < ISC_FRAME_CRC_SIZE) {
+    w->framingErrors++;
+    return false;
+  }
+  memcpy(&sum, *buf, sizeof(sum));
+  *buf += ISC_FRAME_CRC_SIZE;
+  *len -= ISC_FRAME_CRC_SIZE;
+  w->crcChecked++;
+  if (isc_crc32c(0, *buf, *len) == be32toh(sum))
+    return true;
+  w->crcErrors++;
+  return false;
+}
+
+
+// Hand on every whole message buffered for CONN. Returns 0 once only an incomplete
+// message (or nothing) is left, 1 if the peer has no room for the next one and -1 if
+// the stream isn't framed as it should be, or a message fails its CRC; the sender
+// sends it again over the next connection under sckt_replay.
+static int scktDeliver(struct scktWorker *w, struct scktConn *conn)
+{
+  struct isc_frame_hdr hdr;
+  uint8_t *payload;
+  uint32_t size;
+  int r;
+
+  if (scktStalled(w, conn))
+    return 1;
+  while (conn->end - conn->start >= ISC_FRAME_HDR_SIZE) {
+    isc_frame_decode(conn->buf + conn->start, &hdr);
+    if (hdr.len > ISC_FRAME_MAX + (hdr.flags & ISC_FLAG_CRC ? ISC_FRAME_CRC_SIZE : 0)) {
+      fprintf(main_log_fd, "\n%s - ERROR - sckt_server - message of %u bytes announced, the connection is out of step",
+              get_timestamp(), hdr.len);
+      w->framingErrors++;
+      return -1;
+    }
+    size = ISC_FRAME_HDR_SIZE + hdr.len;
+    if (conn->end - conn->start < size)
+      break;
+    payload = conn->buf + conn->start + ISC_FRAME_HDR_SIZE;
+    if (hdr.channel != ISC_CHANNEL_CONTROL && !scktCrcCheck(w, &hdr, &payload, &hdr.len)) {
+      fprintf(main_log_fd, "\n%s - ERROR - sckt_server - message %llu failed its CRC check, the connection is dropped",
+              get_timestamp(), (unsigned long long) hdr.seq);
+      return -1;
+    }
+
+    if (hdr.channel == ISC_CHANNEL_CONTROL) {
+      if ( (r = scktControl(w, conn, &hdr, payload)) != 0) {
+        if (r > 0)
+          return 1;
+        w->framingErrors++;
+        return -1;
+      }
+    } else if (conn->session != NULL) {
+      if (scktStripe(w, conn, &hdr, payload) != 0)
+        return 1;
+    } else {
+      // An empty message has nothing to hand on.
+      if (hdr.len > 0 && !scktHandOn(payload, hdr.len))
+        return 1;
+
+      if (conn->nextSeq != SEQ_ANY && hdr.seq != conn->nextSeq) {
+        fprintf(main_log_fd, "\n%s - WARNING - sckt_server - message %llu received, %llu expected",
+                get_timestamp(), (unsigned long long) hdr.seq, (unsigned long long) conn->nextSeq);
+        w->seqGaps++;
+      }
+      conn->nextSeq = hdr.seq + 1;
+      w->framesDelivered++;
+    }
+    conn->start += size;
+    conn->rxFrames++;
+  }
+  // A stream may not run ahead while its session waits for the peer.
+  return scktStalled(w, conn) ? 1 : 0;
+}
+
+
+// Read the pending data of SOCKFD into its reassembly buffer and hand on every whole
+// message in it, until the socket is drained, as the edge triggered epoll reports
+// only new data, or until the connection has spent its read budget for the round;
+// then *SPENT is set and the rest waits for the next round. If the peer runs out of
+// room, handing on stops with *PAUSED set and the rest stays buffered or in the
+// socket, which in turn throttles the sender. If the pool has no room for the buffer,
+// *STARVED is set and the rest waits in the socket. A buffer which the drained socket
+// left empty goes back to the pool, and the next one is smaller if the connection
+// read little. Returns the result of the last read (0 at the end of the stream, -1
+// with EPROTO on bad framing), or 1 if the connection is fine but nothing (more) can
+// be read now. The time since the connection was found to have data counts as its
+// read latency.
+ssize_t scktReadFrames(struct scktWorker *w, int sockfd, bool *paused, bool *spent, bool *starved)
+{
+  struct scktConn *conn = w->conns[sockfd];
+  uint64_t bytes = conn->rxBytes, frames = conn->rxFrames;
+  double latency;
+  ssize_t n;
+  size_t room;
+  int r;
+
+  *paused = *spent = *starved = false;
+  if (conn->readySince > 0) {
+    latency = get_monotonic_time() - conn->readySince;
+    if (conn->latencies++ == 0 || latency < conn->latencyMin)
+      conn->latencyMin = latency;
+    if (latency > conn->latencyMax)
+      conn->latencyMax = latency;
+    conn->latencySum += latency;
+    w->latencies++;
+    w->latencySum += latency;
+    if (latency > w->latencyMax)
+      w->latencyMax = latency;
+    conn->readySince = 0;
+  }
+  sckt_tune_rearm(&sckt_tuning, sockfd);
+  for (;;) {
+    if ( (r = scktDeliver(w, conn)) != 0) {
+      if (r < 0) {
+        errno = EPROTO;
+        return -1;
+      }
+      *paused = true;
+      return 1;
+    }
+    if ((budgetBytes > 0 && conn->rxBytes - bytes >= budgetBytes) ||
+        (budgetFrames > 0 && conn->rxFrames - frames >= budgetFrames)) {
+      conn->budgetSpent++;
+      w->budgetSpent++;
+      conn->readySince = get_monotonic_time();
+      *spent = true;
+      return 1;
+    }
+
+    // Move the incomplete message left over to the front.
+    if (conn->start > 0) {
+      memmove(conn->buf, conn->buf + conn->start, conn->end - conn->start);
+      conn->end -= conn->start;
+      conn->start = 0;
+    }
+    if (!scktRxFit(w, conn)) {
+      conn->readySince = get_monotonic_time();
+      *starved = true;
+      return 1;
+    }
+
+    room = scktRxSize(conn->bufClass) - conn->end;
+    conn->rxCalls++;
+    if ( (n = recv(sockfd, conn->buf + conn->end, room, MSG_DONTWAIT)) < 0 && errno == EINTR)
+      continue;
+    // Drained; epoll reports what comes next.
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      if (conn->bufClass > 0 && conn->rxBytes - bytes < scktRxSize(conn->bufClass) / 4)
+        conn->rxClass = conn->bufClass - 1;
+      if (conn->end == 0)
+        scktRxRelease(w, conn);
+      return 1;
+    }
+    if (n <= 0)
+      return n;
+    // A full buffer, the next one is larger.
+    if ((size_t) n == room && conn->bufClass < RXBUF_CLASSES - 1)
+      conn->rxClass = conn->bufClass + 1;
+    conn->end += n;
+    conn->rxBytes += n;
+    conn->lastRx = get_monotonic_time();
+  }
+}
+
+
+// Send what is left of the acknowledgement of SOCKFD which didn't fit into its socket
+// before. Returns false while it still doesn't; EPOLLOUT tells when it may. A broken
+// connection is left for the next read to find.
+static bool scktAckFlush(struct scktWorker *w, int sockfd)
+{
+  struct scktConn *conn = w->conns[sockfd];
+  ssize_t n;
+
+  while (conn->ackOff < conn->ackLen) {
+    if ( (n = send(sockfd, conn->ackOut + conn->ackOff, conn->ackLen - conn->ackOff, MSG_DONTWAIT | MSG_NOSIGNAL)) < 0) {
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+    conn->ackOff += n;
+  }
+  conn->ackLen = conn->ackOff = 0;
+  return true;
+}
+
+
+// Acknowledge to the client of SOCKFD, if it asked for it, every message handed on so
+// far: those of its session, or those of the connection. Nothing goes out while that
+// is what the client knows already, or while the last acknowledgement still waits for
+// room in the socket; the newest goes out once it is through.
+void scktAck(struct scktWorker *w, int sockfd)
+{
+  struct scktConn *conn = sockfd < w->connsSize ? w->conns[sockfd] : NULL;
+  struct isc_ack ack;
+  uint64_t seq;
+
+  if (conn == NULL || !conn->acks || !scktAckFlush(w, sockfd))
+    return;
+  if (conn->session != NULL) {
+    pthread_mutex_lock(&conn->session->lock);
+    seq = conn->session->nextSeq;
+    pthread_mutex_unlock(&conn->session->lock);
+  }
+  else
+    seq = (conn->nextSeq == SEQ_ANY) ? 0 : conn->nextSeq;
+  if (seq == conn->acked)
+    return;
+
+  ack.seq = htobe64(seq);
+  ack.window = htobe32(conn->window);
+  ack.reserved = 0;
+  isc_frame_encode((struct isc_frame_hdr *) conn->ackOut, sizeof(ack), ISC_CHANNEL_CONTROL, ISC_FLAG_ACK, 0);
+  memcpy(conn->ackOut + ISC_FRAME_HDR_SIZE, &ack, sizeof(ack));
+  conn->ackLen = sizeof(conn->ackOut);
+  conn->acked = seq;
+  w->acksSent++;
+  if (!scktAckFlush(w, sockfd))
+    w->acksDeferred++;
+}
+
+
+// The reassembly state of the datagram sender ADDR, set up at its first datagram.
+// Once UDP_MAX_PEERS senders are known, the one heard from longest ago makes room.
+static struct scktPeer *scktPeerFind(struct scktWorker *w, const struct sockaddr_in *addr)
+{
+  struct scktPeer *p;
+  int i, oldest = 0;
+
+  for (i = 0; i < w->nPeers; i++) {
+    p = w->peers[i];
+    if (p->addr.sin_port == addr->sin_port && p->addr.sin_addr.s_addr == addr->sin_addr.s_addr)
+      return p;
+    if (p->lastSeen < w->peers[oldest]->lastSeen)
+      oldest = i;
+  }
+
+  if (w->nPeers < UDP_MAX_PEERS) {
+    p = w->peers[w->nPeers++] = (struct scktPeer *) xmalloc(sizeof(*p));
+    p->buf = NULL;
+    p->fec.sym = NULL;
+    p->fec.symCnt = 0;
+  }
+  else {
+    p = w->peers[oldest];
+    fprintf(main_log_fd, "\n%s - WARNING - sckt_server - too many datagram senders, %s:%d forgotten",
+            get_timestamp(), inet_ntoa(p->addr.sin_addr), ntohs(p->addr.sin_port));
+  }
+  p->addr = *addr;
+  p->nextSeq = 0;
+  p->assembling = false;
+  p->fec.started = false;
+  p->fec.waitSince = 0;
+  p->fec.flush = false;
+  fprintf(main_log_fd, "\n%s - INFO - sckt_server - datagrams from %s:%d on worker %d",
+          get_timestamp(), inet_ntoa(addr->sin_addr), ntohs(addr->sin_port), w->id);
+  return p;
+}
+
+
+// Hand on message SEQ of LEN bytes at BUF, which P sent with FLAGS, and count the
+// messages missing before it. One which fails its CRC is dropped, and counted lost
+// with the gap it leaves. Returns false while the peer has no room for it.
+static bool scktDatagramDeliver(struct scktWorker *w, struct scktPeer *p, uint64_t seq, uint16_t flags, uint8_t *buf, uint32_t len)
+{
+  struct isc_frame_hdr hdr;
+
+  hdr.flags = flags;
+  if (!scktCrcCheck(w, &hdr, &buf, &len)) {
+    if (w->crcErrors == 1)
+      fprintf(main_log_fd, "\n%s - ERROR - sckt_server - message %llu failed its CRC check and is dropped",
+              get_timestamp(), (unsigned long long) seq);
+    return true;
+  }
+  // An empty message has nothing to hand on.
+  if (len > 0 && !scktHandOn(buf, len))
+    return false;
+
+  if (seq != p->nextSeq) {
+    fprintf(main_log_fd, "\n%s - WARNING - sckt_server - message %llu received, %llu expected, %llu lost",
+            get_timestamp(), (unsigned long long) seq, (unsigned long long) p->nextSeq,
+            (unsigned long long) (seq - p->nextSeq));
+    w->seqGaps++;
+    w->udpLost += seq - p->nextSeq;
+  }
+  p->nextSeq = seq + 1;
+  w->framesDelivered++;
+  return true;
+}
+
+
+// Take the datagram of LEN bytes at BUF from ADDR, without its isc_fec_hdr if it had
+// one: hand it on if it holds a whole message, else add it to the message it is part
+// of and hand that on once complete. Late, duplicate and malformed datagrams are
+// dropped. Returns false while the peer has no room for the message; the same
+// datagram is to be offered again then, which finds its fragment already in place.
+static bool scktDatagramTake(struct scktWorker *w, const struct sockaddr_in *addr, uint8_t *buf, uint32_t len)
+{
+  struct isc_dgram_hdr hdr;
+  struct scktPeer *p;
+  uint32_t fragLen;
+
+  isc_dgram_decode(buf, &hdr);
+  fragLen = len - ISC_DGRAM_HDR_SIZE;
+  if (hdr.len > ISC_FRAME_MAX + (hdr.flags & ISC_FLAG_CRC ? ISC_FRAME_CRC_SIZE : 0) || hdr.frags == 0 || hdr.frags > ISC_DGRAM_MAX_FRAGS || hdr.frag >= hdr.frags ||
+      hdr.offset > hdr.len || fragLen > hdr.len - hdr.offset || (hdr.frags == 1 && fragLen != hdr.len)) {
+    if (w->framingErrors++ == 0)
+      fprintf(main_log_fd, "\n%s - ERROR - sckt_server - malformed datagram dropped", get_timestamp());
+    return true;
+  }
+
+  p = scktPeerFind(w, addr);
+  p->lastSeen = get_monotonic_time();
+  if (hdr.seq < p->nextSeq) {
+    if (p->nextSeq - hdr.seq <= UDP_RESYNC) {
+      w->udpLate++;
+      return true;
+    }
+    fprintf(main_log_fd, "\n%s - INFO - sckt_server - %s:%d started over at message %llu",
+            get_timestamp(), inet_ntoa(addr->sin_addr), ntohs(addr->sin_port), (unsigned long long) hdr.seq);
+    p->nextSeq = hdr.seq;
+    p->assembling = false;
+  }
+
+  if (p->assembling && hdr.seq != p->seq) {
+    if (hdr.seq < p->seq) {
+      w->udpLate++;
+      return true;
+    }
+    // A later message began: the one under way lost a fragment.
+    w->udpIncomplete++;
+    p->assembling = false;
+  }
+
+  // A whole message goes on straight from the receive buffer.
+  if (hdr.frags == 1)
+    return scktDatagramDeliver(w, p, hdr.seq, hdr.flags, buf + ISC_DGRAM_HDR_SIZE, hdr.len);
+
+  if (!p->assembling) {
+    if (p->buf == NULL)
+      p->buf = (uint8_t *) xmalloc(ISC_FRAME_CRC_SIZE + ISC_FRAME_MAX);
+    p->assembling = true;
+    p->seq = hdr.seq;
+    p->len = hdr.len;
+    p->flags = hdr.flags;
+    p->frags = hdr.frags;
+    p->got = 0;
+    memset(p->have, 0, sizeof(p->have));
+  }
+  else if (hdr.len != p->len || hdr.frags != p->frags) {
+    w->framingErrors++;
+    return true;
+  }
+
+  if (!(p->have[hdr.frag / 64] & (1ULL << (hdr.frag % 64)))) {
+    memcpy(p->buf + hdr.offset, buf + ISC_DGRAM_HDR_SIZE, fragLen);
+    p->have[hdr.frag / 64] |= 1ULL << (hdr.frag % 64);
+    p->got++;
+  }
+  if (p->got < p->frags)
+    return true;
+  if (!scktDatagramDeliver(w, p, p->seq, p->flags, p->buf, p->len))
+    return false;
+  p->assembling = false;
+  return true;
+}
+
+
+// Symbol I of the group F holds
+static inline uint8_t *scktFecSym(struct scktFec *f, int i)
+{
+  return f->sym + (size_t) i * (sizeof(uint16_t) + udpMtu - ISC_DGRAM_OVERHEAD);
+}
+
+
+// Let F wait for group GROUP, of which nothing arrived yet.
+static void scktFecStart(struct scktFec *f, uint32_t group)
+{
+  f->started = true;
+  f->group = group;
+  if (f->maxGroup < group)
+    f->maxGroup = group;
+  f->k = f->m = f->next = f->got = f->parity = 0;
+  f->parityLen = 0;
+  memset(f->have, 0, sizeof(f->have));
+  f->waitSince = 0;
+  f->flush = false;
+}
+
+
+// Rebuild the data datagrams the group of F misses from its parity, of which as many
+// arrived. A symbol whose length makes no sense stays missing.
+static void scktFecRebuild(struct scktWorker *w, struct scktFec *f)
+{
+  uint8_t *sym[ISC_FEC_MAX_K + ISC_FEC_MAX_M];
+  bool have[ISC_FEC_MAX_K + ISC_FEC_MAX_M];
+  uint32_t size;
+  int i;
+
+  for (i = 0; i < f->k + f->m; i++) {
+    sym[i] = scktFecSym(f, i);
+    have[i] = f->have[i];
+    // The parity covers each data symbol padded with zeros to its size.
+    if (i < f->k && f->have[i]) {
+      if (f->len[i] > f->parityLen) {
+        w->framingErrors++;
+        return;
+      }
+      memset(sym[i] + f->len[i], 0, f->parityLen - f->len[i]);
+    }
+  }
+  if (isc_fec_recover(sym, have, f->k, f->m, f->parityLen) <= 0)
+    return;
+  for (i = 0; i < f->k; i++) {
+    if (f->have[i])
+      continue;
+    size = (uint32_t) sym[i][0] << 8 | sym[i][1];
+    if (size < ISC_DGRAM_HDR_SIZE || sizeof(uint16_t) + size > f->parityLen) {
+      w->framingErrors++;
+      continue;
+    }
+    f->len[i] = sizeof(uint16_t) + size;
+    f->have[i] = true;
+    f->got++;
+    w->fecRebuilt++;
+  }
+}
+
+
+// Hand on the data datagrams of the groups of P in order, as far as they arrived or
+// were rebuilt. A group the sender is done with, or which waited sckt_fec_hold_ms,
+// gives up those it misses. Returns false while the peer has no room.
+static bool scktFecDrain(struct scktWorker *w, struct scktPeer *p)
+{
+  struct scktFec *f = &p->fec;
+  bool over;
+
+  for (;;) {
+    over = f->group != f->maxGroup || f->flush;
+    for (; f->next < f->k; f->next++) {
+      if (f->have[f->next]) {
+        if (!scktDatagramTake(w, &p->addr, scktFecSym(f, f->next) + sizeof(uint16_t), f->len[f->next] - sizeof(uint16_t)))
+          return false;
+        f->waitSince = 0;
+      }
+      else if (!over) {
+        if (f->waitSince == 0)
+          f->waitSince = get_monotonic_time();
+        return true;
+      }
+      else
+        w->fecLost++;
+    }
+    if (f->k == 0 && !over)
+      return true;
+    if (f->k == 0)
+      w->fecGroupsLost++;
+    scktFecStart(f, f->group + 1);
+  }
+}
+
+
+// Take the datagram of LEN bytes at BUF from P, flagged ISC_FLAG_FEC, with header HDR:
+// keep it in its group, rebuild what the group misses once enough parity arrived, and
+// hand on what is in order. Datagrams of a group already handed on are late. Returns
+// false while the peer has no room; the same datagram is to be offered again then,
+// which finds itself kept already.
+static bool scktFecDatagram(struct scktWorker *w, struct scktPeer *p, const struct isc_dgram_hdr *hdr,
+                            const uint8_t *buf, uint32_t len)
+{
+  struct scktFec *f = &p->fec;
+  struct isc_fec_hdr tag;
+  uint32_t group, size = len - ISC_FEC_HDR_SIZE;
+  uint8_t *sym;
+
+  memcpy(&tag, buf + ISC_DGRAM_HDR_SIZE, sizeof(tag));
+  group = be32toh(tag.group);
+  if (tag.k == 0 || tag.k > ISC_FEC_MAX_K || tag.m > ISC_FEC_MAX_M || tag.index >= tag.k + tag.m ||
+      (hdr->channel == ISC_CHANNEL_FEC) != (tag.index >= tag.k) ||
+      (tag.index >= tag.k && (size - ISC_DGRAM_HDR_SIZE != hdr->len || hdr->len < sizeof(uint16_t) + ISC_DGRAM_HDR_SIZE))) {
+    if (w->framingErrors++ == 0)
+      fprintf(main_log_fd, "\n%s - ERROR - sckt_server - malformed datagram dropped", get_timestamp());
+    return true;
+  }
+
+  if (tag.index >= tag.k)
+    w->fecParity++;
+  if (!f->started || (group < f->group && f->group - group > FEC_RESYNC)) {
+    f->maxGroup = group;
+    scktFecStart(f, group);
+  }
+  // The parity of a group handed on whole is left over as a rule.
+  if (group < f->group) {
+    if (tag.index < tag.k)
+      w->udpLate++;
+    return true;
+  }
+  // The sender is done with the groups before this one.
+  if (group > f->maxGroup)
+    f->maxGroup = group;
+  if (group > f->group && !scktFecDrain(w, p))
+    return false;
+
+  if (f->k == 0) {
+    f->k = tag.k;
+    f->m = tag.m;
+    w->fecGroups++;
+    if (f->symCnt < (uint32_t) f->k + f->m) {
+      f->symCnt = f->k + f->m;
+      f->sym = (uint8_t *) xrealloc(f->sym, scktFecSym(f, f->symCnt) - scktFecSym(f, 0));
+    }
+  }
+  else if (tag.k != f->k || tag.m != f->m) {
+    w->framingErrors++;
+    return true;
+  }
+
+  if (!f->have[tag.index]) {
+    sym = scktFecSym(f, tag.index);
+    if (tag.index < f->k) {
+      // The datagram without its isc_fec_hdr, behind its length
+      sym[0] = size >> 8;
+      sym[1] = size;
+      memcpy(sym + sizeof(uint16_t), buf, ISC_DGRAM_HDR_SIZE);
+      memcpy(sym + sizeof(uint16_t) + ISC_DGRAM_HDR_SIZE, buf + ISC_DGRAM_HDR_SIZE + ISC_FEC_HDR_SIZE,
+             size - ISC_DGRAM_HDR_SIZE);
+      f->len[tag.index] = sizeof(uint16_t) + size;
+      f->got++;
+    }
+    else {
+      if (f->parity > 0 && hdr->len != f->parityLen) {
+        w->framingErrors++;
+        return true;
+      }
+      memcpy(sym, buf + ISC_DGRAM_HDR_SIZE + ISC_FEC_HDR_SIZE, hdr->len);
+      f->parityLen = hdr->len;
+      f->parity++;
+    }
+    f->have[tag.index] = true;
+    if (f->got < f->k && f->parity >= f->k - f->got)
+      scktFecRebuild(w, f);
+  }
+  return scktFecDrain(w, p);
+}
+
+
+// Give up the datagrams the senders of W have waited sckt_fec_hold_ms for, and hand
+// on what is behind them. Whether some still wait is left in w->fecWaiting.
+static void scktFecSweep(struct scktWorker *w, double now)
+{
+  struct scktFec *f;
+  int i;
+
+  w->fecWaiting = false;
+  for (i = 0; i < w->nPeers; i++) {
+    f = &w->peers[i]->fec;
+    if (f->waitSince == 0)
+      continue;
+    if (now - f->waitSince >= fecHoldMs / 1000.0) {
+      f->flush = true;
+      scktFecDrain(w, w->peers[i]);
+    }
+    if (f->waitSince != 0)
+      w->fecWaiting = true;
+  }
+}
+
+
+// Take the datagram of LEN bytes at BUF from ADDR, received with recvmmsg FLAGS, on
+// to the forward error correction if it is flagged for it, else straight on. Returns
+// false while the peer has no room for what it completes; the same datagram is to be
+// offered again then.
+static bool scktDatagram(struct scktWorker *w, const struct sockaddr_in *addr, uint8_t *buf, uint32_t len, int flags)
+{
+  struct isc_dgram_hdr hdr;
+  struct scktPeer *p;
+
+  if (flags & MSG_TRUNC) {
+    if (w->udpTruncated++ == 0)
+      fprintf(main_log_fd, "\n%s - WARNING - sckt_server - datagram larger than sckt_udp_mtu %d dropped", get_timestamp(), udpMtu);
+    return true;
+  }
+  if (len < ISC_DGRAM_HDR_SIZE) {
+    w->framingErrors++;
+    return true;
+  }
+  isc_dgram_decode(buf, &hdr);
+  if (!(hdr.flags & ISC_FLAG_FEC))
+    return scktDatagramTake(w, addr, buf, len);
+  if (len < ISC_DGRAM_HDR_SIZE + ISC_FEC_HDR_SIZE) {
+    w->framingErrors++;
+    return true;
+  }
+  p = scktPeerFind(w, addr);
+  p->lastSeen = get_monotonic_time();
+  return scktFecDatagram(w, p, &hdr, buf, len);
+}
+
+
+// Read the datagrams pending on SOCKFD, UDP_BATCH at a time with recvmmsg, and take
+// them one by one until the socket is drained. If the peer runs out of room, *PAUSED
+// is set and the datagrams left over wait in the batch, and the ones behind them in
+// the socket, until scktResume reads on. Returns 1: errors don't end a datagram socket.
+ssize_t scktReadDatagrams(struct scktWorker *w, int sockfd, bool *paused)
+{
+  struct scktBatch *b = w->batch;
+  struct mmsghdr *m;
+  bool fresh = false;
+  int i, n;
+
+  *paused = false;
+  for (;;) {
+    for (; b->next < b->count; b->next++) {
+      m = &b->msgs[b->next];
+      if (!scktDatagram(w, &b->addr[b->next], b->iov[b->next].iov_base, m->msg_len, m->msg_hdr.msg_flags)) {
+        *paused = true;
+        return 1;
+      }
+    }
+    // A short batch just read drained the socket; the edge triggered epoll reports
+    // new data. One left over from a pause doesn't tell: the events were ignored.
+    if (fresh && b->count < UDP_BATCH) {
+      b->count = b->next = 0;
+      return 1;
+    }
+
+    for (i = 0; i < UDP_BATCH; i++) {
+      b->msgs[i].msg_hdr.msg_namelen = sizeof(b->addr[i]);
+      b->msgs[i].msg_hdr.msg_flags = 0;
+    }
+    b->count = b->next = 0;
+    if ( (n = recvmmsg(sockfd, b->msgs, UDP_BATCH, MSG_DONTWAIT, NULL)) < 0) {
+      if (errno == EINTR)
+        continue;
+      if (errno != EAGAIN && errno != EWOULDBLOCK)
+        fprintf(main_log_fd, "\n%s - ERROR - sckt_server - recvmmsg: %s", get_timestamp(), strerror(errno));
+      return 1;
+    }
+    w->udpCalls++;
+    w->udpDatagrams += n;
+    b->count = n;
+    fresh = true;
+  }
+}
+
+
+// Set up the recvmmsg batch of W: one receive buffer of an MTU's payload per datagram.
+static void scktBatchOpen(struct scktWorker *w)
+{
+  struct scktBatch *b;
+  size_t size = udpMtu - ISC_DGRAM_OVERHEAD;
+  int i;
+
+  b = w->batch = (struct scktBatch *) xmalloc(sizeof(*b));
+  memset(b, 0, sizeof(*b));
+  b->bufs = (uint8_t *) xmalloc(UDP_BATCH * size);
+  for (i = 0; i < UDP_BATCH; i++) {
+    b->iov[i].iov_base = b->bufs + i * size;
+    b->iov[i].iov_len = size;
+    b->msgs[i].msg_hdr.msg_name = &b->addr[i];
+    b->msgs[i].msg_hdr.msg_iov = &b->iov[i];
+    b->msgs[i].msg_hdr.msg_iovlen = 1;
+  }
+}
+
+
+// Drop the recvmmsg batch and the datagram senders of W, with the messages they
+// hadn't completed, and take the count of datagrams the kernel dropped on SOCKFD.
+static void scktBatchClose(struct scktWorker *w, int sockfd)
+{
+  uint32_t mem[SK_MEMINFO_VARS];
+  socklen_t len = sizeof(mem);
+  int i;
+
+  if (getsockopt(sockfd, SOL_SOCKET, SO_MEMINFO, mem, &len) == 0 && len > SK_MEMINFO_DROPS * sizeof(mem[0]))
+    w->udpOverflow = mem[SK_MEMINFO_DROPS];
+
+  for (i = 0; i < w->nPeers; i++) {
+    if (w->peers[i]->assembling) {
+      w->udpIncomplete++;
+      w->udpLost++;
+    }
+    free(w->peers[i]->buf);
+    free(w->peers[i]->fec.sym);
+    free(w->peers[i]);
+  }
+  w->nPeers = 0;
+  if (w->batch != NULL) {
+    free(w->batch->bufs);
+    free(w->batch);
+    w->batch = NULL;
+  }
+}
+
+
+// Whether SOCKFD is parked because of backpressure
+static bool scktIsPaused(struct scktWorker *w, int sockfd)
+{
+  int i;
+
+  for (i = 0; i < w->nPaused; i++) {
+    if (w->paused[i] == sockfd)
+      return true;
+  }
+  return false;
+}
+
+
+// Park SOCKFD until the peer has credits again and count the event.
+static void scktPause(struct scktWorker *w, int sockfd)
+{
+  if (w->nPaused == MAX_PAUSED) {
+    fprintf(main_log_fd, "\n%s - ERROR - sckt_server - too many connections under backpressure", get_timestamp());
+    return;
+  }
+  if (w->nPaused == 0)
+    w->pausedSince = get_monotonic_time();
+  w->paused[w->nPaused++] = sockfd;
+  w->backpressureCount++;
+}
+
+
+// Put SOCKFD, which spent its read budget, on the ready list for the next round.
+static void scktReady(struct scktWorker *w, int sockfd)
+{
+  if (w->nReady == w->readySize) {
+    w->readySize = w->readySize ? 2 * w->readySize : 64;
+    w->ready = (int *) xrealloc(w->ready, w->readySize * sizeof(w->ready[0]));
+  }
+  w->ready[w->nReady++] = sockfd;
+  w->conns[sockfd]->ready = true;
+}
+
+
+// Put SOCKFD, for which the pool has no room, on the list of those waiting for it.
+static void scktStarve(struct scktWorker *w, int sockfd)
+{
+  if (w->nStarved == w->starvedSize) {
+    w->starvedSize = w->starvedSize ? 2 * w->starvedSize : 64;
+    w->starved = (int *) xrealloc(w->starved, w->starvedSize * sizeof(w->starved[0]));
+  }
+  w->starved[w->nStarved++] = sockfd;
+  w->conns[sockfd]->starved = true;
+  w->rxStarved++;
+}
+
+
+// Read from the connection SOCKFD within its budget and act on the outcome: close it
+// once it ended or broke, park it under backpressure, put it on the ready list if it
+// has more to read or on the starved list if the pool had no room, and acknowledge
+// what was handed on.
+static void scktServe(struct scktWorker *w, int sockfd)
+{
+  bool paused, spent, starved;
+  ssize_t n;
+
+  if ( (n = scktReadFrames(w, sockfd, &paused, &spent, &starved)) <= 0) {
+    if (n < 0 && errno != ECONNRESET) {
+      printf("sckt_server - ERROR - read error\n");
+      fprintf(main_log_fd, "\n%s - ERROR - sckt_server - read error", get_timestamp());
+    }
+    scktConnClose(w, sockfd);
+    return;
+  }
+  if (paused)
+    scktPause(w, sockfd);
+  else if (spent)
+    scktReady(w, sockfd);
+  else if (starved)
+    scktStarve(w, sockfd);
+  scktAck(w, sockfd);
+}
+
+
+// Give the first CNT connections of the ready list another budget's worth of reads,
+// each in turn. Those which spend it again go to the back of the list.
+static void scktDrainReady(struct scktWorker *w, int cnt)
+{
+  int sockfd;
+
+  while (cnt-- > 0 && w->nReady > 0) {
+    sockfd = w->ready[0];
+    memmove(w->ready, w->ready + 1, --w->nReady * sizeof(w->ready[0]));
+    w->conns[sockfd]->ready = false;
+    scktServe(w, sockfd);
+  }
+}
+
+
+// Try the connections waiting for room in the pool again, each once; those for which
+// it still has none wait on.
+static void scktFeedStarved(struct scktWorker *w)
+{
+  int sockfd, turns = w->nStarved;
+
+  while (turns-- > 0 && w->nStarved > 0) {
+    sockfd = w->starved[0];
+    memmove(w->starved, w->starved + 1, --w->nStarved * sizeof(w->starved[0]));
+    w->conns[sockfd]->starved = false;
+    scktServe(w, sockfd);
+  }
+}
+
+
+// Read on from the parked connections while the peer has credits, each one once: the
+// credits left may still be too few for the next message of a connection, which then
+// is parked again. Connections which went away meanwhile are closed.
+static void scktResume(struct scktWorker *w)
+{
+  bool again;
+  int sockfd, turns = w->nPaused;
+
+  while (turns-- > 0 && w->nPaused > 0 && (*peer->credits_function) () != 0) {
+    sockfd = w->paused[0];
+    memmove(w->paused, w->paused + 1, --w->nPaused * sizeof(w->paused[0]));
+    if (w->nPaused == 0)
+      w->backpressureTime += get_monotonic_time() - w->pausedSince;
+
+    if (SocketType == SOCK_STREAM)
+      scktServe(w, sockfd);
+    else {
+      scktReadDatagrams(w, sockfd, &again);
+      if (again)
+        scktPause(w, sockfd);
+    }
+  }
+}
+
+
+// Close the connections of W which have been silent for sckt_idle_ms, taking their
+// link for dead, a few times per period. Those held back by backpressure, or waiting
+// for room in the pool, are not silent, just not read.
+static void scktIdleSweep(struct scktWorker *w)
+{
+  double now = get_monotonic_time();
+  int i;
+
+  if (now - w->idleSweep < idleMs / 4000.0)
+    return;
+  w->idleSweep = now;
+  for (i = 0; i < w->connsSize; i++) {
+    if (w->conns[i] == NULL || now - w->conns[i]->lastRx < idleMs / 1000.0 || scktIsPaused(w, i) ||
+        w->conns[i]->starved)
+      continue;
+    fprintf(main_log_fd, "\n%s - WARNING - sckt_server - connection silent for %.3f s, closing it",
+            get_timestamp(), now - w->conns[i]->lastRx);
+    w->idleClosed++;
+    scktConnClose(w, i);
+  }
+}
+
+
+// Socket listener worker thread; PARG is its struct scktWorker.
 void *scktListenerThread(void *pArg)
 {
+  struct scktWorker *w = (struct scktWorker *) pArg;
+  cpu_set_t cpus;
+
   if (verbose)
-    printf("\nsckt_server - scktListenerThread - listenerproc started\n");
-  fprintf(main_log_fd, "\n%s - INFO - sckt_server - listenerproc started", get_timestamp());
+    printf("\nsckt_server - scktListenerThread - listenerproc %d started\n", w->id);
+  fprintf(main_log_fd, "\n%s - INFO - sckt_server - listenerproc %d started", get_timestamp(), w->id);
+
+  if (w->cpu >= 0) {
+    CPU_ZERO(&cpus);
+    CPU_SET(w->cpu, &cpus);
+    if (sched_setaffinity(0, sizeof(cpus), &cpus) == -1)
+      fprintf(main_log_fd, "\n%s - WARNING - sckt_server - listenerproc %d not pinned to CPU %d: %s",
+              get_timestamp(), w->id, w->cpu, strerror(errno));
+    else
+      fprintf(main_log_fd, "\n%s - INFO - sckt_server - listenerproc %d pinned to CPU %d", get_timestamp(), w->id, w->cpu);
+  }
 
-  bListenerProcActive = true;
-  scktListenerProc();
+  __atomic_store_n(&w->active, true, __ATOMIC_RELEASE);
+  scktListenerProc(w);
   isListening = false;
-  bListenerProcActive = false;
+  __atomic_store_n(&w->active, false, __ATOMIC_RELEASE);
 
-  fprintf(main_log_fd, "\n%s - INFO - sckt_server - listenerproc exited", get_timestamp());
+  fprintf(main_log_fd, "\n%s - INFO - sckt_server - listenerproc %d exited", get_timestamp(), w->id);
+  return NULL;
 }
 
 
-// Socket listener main thread process
-void scktListenerProc()
+// Socket listener worker thread process. Every worker listens on the port itself;
+// with SO_REUSEPORT the kernel spreads the incoming connections over the workers,
+// and with udp the datagram senders, each of which sticks to one worker.
+void scktListenerProc(struct scktWorker *w)
 {
-  int i, listenfd, connfd, sockfd, epfd, nfds;
-  ssize_t n;
+  int i, listenfd, connfd, sockfd, epfd, nfds, ready, on = 1;
+  struct scktConn *conn;
+  double now;
+  bool bp;
   socklen_t clilen;
-  unsigned char buf[IOBUFFSIZE];
+  char str[INET_ADDRSTRLEN];
 
 //Declare variables for the epoll_event structure, ev for registering events, and array for returning events to process
 
-  struct epoll_event ev, events[20];
+  struct epoll_event ev, events[EPOLL_MAXEVENTS];
   //Generate epoll-specific file descriptors for processing accept s
 
   epfd = epoll_create(256);
   struct sockaddr_in clientaddr;
   struct sockaddr_in serveraddr;
-  listenfd = socket(AF_INET, SOCK_STREAM, (int)Protocol);
+  listenfd = socket(AF_INET, SocketType, (int)Protocol);
+  // Let every worker (and a restarted isc) bind the port
+  setsockopt(listenfd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+  setsockopt(listenfd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on));
+  // The connections accepted inherit the tuning of the listening socket.
+  sckt_tune_socket(&sckt_tuning, listenfd, SocketType == SOCK_STREAM, "sckt_server");
   //Set socket to non-blocking
 
   setnonblocking(listenfd);
@@ -282,102 +2311,130 @@ void scktListenerProc()
   serveraddr.sin_addr.s_addr = INADDR_ANY;
   serveraddr.sin_port = htons(ConnPort);
 
-  bind(listenfd, (struct sockaddr *)&serveraddr, sizeof(serveraddr));
-  listen(listenfd, LISTENQ);
+  if (bind(listenfd, (struct sockaddr *)&serveraddr, sizeof(serveraddr)) == -1 ||
+      (SocketType == SOCK_STREAM && listen(listenfd, sckt_tuning.listenq) == -1)) {
+    fprintf(main_log_fd, "\n%s - ERROR - sckt_server - listenerproc %d can't listen on port %d: %s",
+            get_timestamp(), w->id, ConnPort, strerror(errno));
+    close(listenfd);
+    close(epfd);
+    return;
+  }
+
+  if (w->id == 0) {
+    sckt_tune_log(&sckt_tuning, listenfd, SocketType == SOCK_STREAM, "sckt_server");
+    if (SocketType == SOCK_STREAM)
+      fprintf(main_log_fd, ", listen backlog %d", sckt_tuning.listenq);
+  }
 
+  if (SocketType == SOCK_DGRAM)
+    scktBatchOpen(w);
   isListening = true;
 
   while (isListening) {
     //Waiting for the epoll event to occur
 
-    nfds = epoll_wait(epfd, events, EPOLL_MAXEVENTS, EPOLL_TIMEOUT);
+    // Connections with more to read don't wait for new events.
+    nfds = epoll_wait(epfd, events, EPOLL_MAXEVENTS,
+                      w->nReady > 0 ? 0 : w->nPaused > 0 || w->nStarved > 0 ? BACKPRESSURE_RETRY :
+                      w->fecWaiting ? (int) fecHoldMs : EPOLL_TIMEOUT);
+    now = get_monotonic_time();
+    ready = w->nReady;
     //Handle all events that occur
 
     for (i = 0; i < nfds; ++i) {
-      if (events[i].data.fd == listenfd) {//If a new SOCKET user is detected to be connected to a bound SOCKET port, establish a new connection.
-            
-        connfd = accept(listenfd, (struct sockaddr *)&clientaddr, &clilen);
-        if (connfd < 0) {
-          perror("sckt_server - connfd<0");
-          exit(1);
+      if (events[i].data.fd == listenfd && SocketType == SOCK_DGRAM) {
+        // Datagrams arrived, unless they are held back anyway
+        if (!scktIsPaused(w, listenfd)) {
+          scktReadDatagrams(w, listenfd, &bp);
+          if (bp)
+            scktPause(w, listenfd);
         }
-        //setnonblocking(connfd);
-
-        char *str = inet_ntoa(clientaddr.sin_addr);
-        if (verbose)
-          printf("sckt_server - Accapt a connection from %s\n", str);
-        fprintf(main_log_fd, "\n%s - INFO - sckt_server - Accapt a connection from %s", get_timestamp(), str);
-        //Setting file descriptors for read operations
+      }
+      else if (events[i].data.fd == listenfd) {//If a new SOCKET user is detected to be connected to a bound SOCKET port, establish a new connection.
+
+        // The listener is edge triggered: take every connection queued on it.
+        for (;;) {
+          clilen = sizeof(clientaddr);
+          connfd = accept(listenfd, (struct sockaddr *)&clientaddr, &clilen);
+          if (connfd < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ECONNABORTED || errno == EINTR)
+              break;
+            perror("sckt_server - connfd<0");
+            exit(1);
+          }
+          setnonblocking(connfd);
 
-        ev.data.fd = connfd;
-        //Set Read Action Events for Annotation
+          inet_ntop(AF_INET, &clientaddr.sin_addr, str, sizeof(str));
+          if (verbose)
+            printf("sckt_server - Accapt a connection from %s on worker %d\n", str, w->id);
+          fprintf(main_log_fd, "\n%s - INFO - sckt_server - Accapt a connection from %s on worker %d", get_timestamp(), str, w->id);
+          scktConnOpen(w, connfd);
+          // Read events, and write events for the acknowledgements which have to
+          // wait for room in the socket
 
-        ev.events = EPOLLIN|EPOLLET;
-        //ev.events=EPOLLIN;
+          ev.data.fd = connfd;
+          ev.events = EPOLLIN|EPOLLOUT|EPOLLET;
 
-        //Register ev
+          //Register ev
 
-        epoll_ctl(epfd,EPOLL_CTL_ADD, connfd, &ev);
+          epoll_ctl(epfd,EPOLL_CTL_ADD, connfd, &ev);
+        }
       }
       else if (events[i].events & EPOLLIN) {//If the user is already connected and receives data, read in.
-        if ( (sockfd = events[i].data.fd) < 0)
+        sockfd = events[i].data.fd;
+        // scktResume reads on from a parked connection; its wait is backpressure.
+        if ( (conn = w->conns[sockfd]) == NULL || scktIsPaused(w, sockfd))
           continue;
-
-
-        if ( (n = read(sockfd, buf, IOBUFFSIZE)) < 0) {
-          if (errno == ECONNRESET) {
-            close(sockfd);
-            events[i].data.fd = -1;
-          } else
-            printf("sckt_server - ERROR - read error\n");
-            fprintf(main_log_fd, "\n%s - ERROR - sckt_server - read error", get_timestamp());
-        } else if (n == 0) {
-          close(sockfd);
-          events[i].data.fd = -1;
-        }
-        else {
-          fprintf(log_fd, "\n%s - INFO - sckt_server - ", get_timestamp());
-
-#if 1
-//    printf("Shared memory contains: \"%s\"\n", prod_shm);
-          for (i = 0; i < n; i++) {
-            fprintf(log_fd, "0x%X,", buf[i] & 0x000000FF);
-          }
-#endif
-          recCallbackFunctionType(buf, n);
-        }
-
-        // Setting file descriptors for write operations
-        ev.data.fd = sockfd;
-        // Set Write Action Events for Annotation
-
-        ev.events = EPOLLOUT | EPOLLET;
-        // Modify the event to be handled on sockfd to EPOLLOUT
-
-        // epoll_ctl(epfd,EPOLL_CTL_MOD,sockfd,&ev);
+        if (conn->readySince == 0)
+          conn->readySince = now;
+        // The ready and starved lists read on in their turn.
+        if (!conn->ready && !conn->starved)
+          scktServe(w, sockfd);
       }
-      else if(events[i].events&EPOLLOUT) { // If there is data to send
- 
-        sockfd = events[i].data.fd;
-
-        // ToDo: Implement the xmit functionality
-//      write(sockfd, ..., ...);
-        // Setting file descriptors for read operations
-
-        ev.data.fd = sockfd;
-        // Set Read Action Events for Annotation
-
-        ev.events = EPOLLIN|EPOLLET;
-        // Modify the event to be processed on sockfd to EPOLIN
-
-        epoll_ctl(epfd, EPOLL_CTL_MOD, sockfd, &ev);
+      else if (events[i].events & EPOLLOUT) { // Room for an acknowledgement which waits
+        scktAck(w, events[i].data.fd);
       }
     }
+
+    // Read on from the connections which had more than their budget last round
+    if (ready > 0)
+      scktDrainReady(w, ready);
+    // Those which waited for room in the pool, which the others may have made by now
+    if (w->nStarved > 0)
+      scktFeedStarved(w);
+    // Pick up the connections held back once the consumers have freed slots
+    if (w->nPaused > 0)
+      scktResume(w);
+    if (idleMs > 0 && SocketType == SOCK_STREAM)
+      scktIdleSweep(w);
+    // Datagrams which waited long enough for one before them
+    if (SocketType == SOCK_DGRAM)
+      scktFecSweep(w, get_monotonic_time());
+    scktRxTrim(w, now);
   }
 
+  // Drop the connections still open
+  for (i = 0; i < w->connsSize; i++)
+    if (w->conns[i] != NULL)
+      scktConnClose(w, i);
+  free(w->conns);
+  free(w->ready);
+  w->ready = NULL;
+  w->nReady = w->readySize = 0;
+  free(w->starved);
+  w->starved = NULL;
+  w->nStarved = w->starvedSize = 0;
+  for (i = 0; i < RXBUF_CLASSES; i++)
+    scktRxFree(w, i, 0);
+  if (SocketType == SOCK_DGRAM)
+    scktBatchClose(w, listenfd);
+  w->conns = NULL;
+  w->connsSize = 0;
+  w->nPaused = 0;
   close(listenfd);
+  close(epfd);
 
-  fprintf(main_log_fd, "\n%s - INFO - sckt_server - Listener exiting", get_timestamp());
+  fprintf(main_log_fd, "\n%s - INFO - sckt_server - Listener %d exiting", get_timestamp(), w->id);
 }
 
 
@@ -389,8 +2446,44 @@ uint32_t ipc_xmit (uint8_t *buf, int32_t bufSize)
 }
 
 
+// Interface function to xmit a batch of chunks
+uint32_t ipc_xmitv (const struct iovec *iov, int32_t iovCnt)
+{
+  system_error ("sckt_server - ipc_xmitv - Not implemented");
+  return 0;
+}
+
+
 // Interface function to receive data
 void ipc_rec (uint8_t *buf, int32_t bufSize)
 {
   system_error ("sckt_server - ipc_rec - Not implemented");
 }
+
+
+// Interface function to lend a buffer; this module doesn't lend buffers.
+uint8_t* ipc_acquire (int32_t *bufSize)
+{
+  return NULL;
+}
+
+
+// Interface function to report the chunks this module can take; it has no flow control.
+int32_t ipc_credits ()
+{
+  return -1;
+}
+
+
+// Interface function to commit an acquired buffer
+void ipc_commit (uint8_t *buf, int32_t bufSize)
+{
+  system_error ("sckt_server - ipc_commit - Not implemented");
+}
+
+
+// Interface function to release a buffer passed on through xmit
+void ipc_release (uint8_t *buf)
+{
+  system_error ("sckt_server - ipc_release - Not implemented");
+}
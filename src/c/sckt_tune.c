@@ -0,0 +1,181 @@
+/**
+ * @file   sckt_tune.c
+ * @author Armin Zare Zadeh ali.a.zarezadeh@gmail.com
+ * @date   16 October 2026
+ * @version 0.1
+ * @brief   sckt_tune.c holds the socket options the sckt modules set on their
+ *          sockets, as named tuning profiles which single options may override.
+ *
+ * - default: what the sckt modules always did. The kernel's choices stand, and the
+ *   listen backlog is 20.
+ * - latency: TCP_NODELAY, TCP_QUICKACK re-armed after every read, SO_BUSY_POLL of
+ *   50 us, SO_PRIORITY 6 and TCP_NOTSENT_LOWAT of 16K, so that little waits unsent
+ *   in the socket and the outbound queue keeps the rest.
+ * - throughput: socket buffers of 4M each way and a deep listen backlog.
+ * - lowmem: socket buffers of 64K each way and TCP_NOTSENT_LOWAT of 16K.
+ * - The buffers are asked for before connect or listen, so that TCP scales its
+ *   window to them. The kernel doubles what it is given and caps it at
+ *   net.core.wmem_max and rmem_max, so the effective values are read back and logged.
+ * - A socket option the kernel refuses, such as SO_BUSY_POLL without CAP_NET_ADMIN,
+ *   is logged as a warning and left out.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include "isc.h"
+
+
+/***********************************************************************************
+ * C o n s t a n t s ,   v a r i a b l e s ,  f u n c t i o n s
+************************************************************************************/
+
+// The profiles, the first of them the default
+static const struct sckt_tuning profiles[] = {
+  { "default",    -1, 0, 0,               0,               0,  -1, 0,         20 },
+  { "latency",     1, 1, 0,               0,               50,  6, 16 * 1024, 128 },
+  { "throughput", -1, 0, 4 * 1024 * 1024, 4 * 1024 * 1024, 0,  -1, 0,         1024 },
+  { "lowmem",     -1, 0, 64 * 1024,       64 * 1024,       0,  -1, 16 * 1024, 20 },
+};
+
+struct sckt_tuning sckt_tuning = { "default", -1, 0, 0, 0, 0, -1, 0, 20 };
+
+
+// Parse a byte count with an optional K or M suffix into *RESULT, at most 1G.
+static bool parse_bytes (const char* value, int* result)
+{
+  char* end;
+  unsigned long long n = strtoull (value, &end, 0);
+  int shift = 0;
+
+  switch (*end) {
+    case 'k': case 'K': shift = 10; end++; break;
+    case 'm': case 'M': shift = 20; end++; break;
+  }
+  // Checked before the shift, which could wrap a large count back into range
+  if (*value == '\0' || *end != '\0' || n > (1 << 30) >> shift)
+    return false;
+  *result = (int) (n << shift);
+  return true;
+}
+
+
+// Parse an integer from LO to HI into *RESULT.
+static bool parse_int (const char* value, int lo, int hi, int* result)
+{
+  char* end;
+  long n = strtol (value, &end, 0);
+
+  if (*value == '\0' || *end != '\0' || n < lo || n > hi)
+    return false;
+  *result = (int) n;
+  return true;
+}
+
+
+// Set the socket option LEVEL/NAME of FD to VALUE, or log why it can't be.
+static void tune (int fd, int level, int name, const char* what, int value, const char* module)
+{
+  if (setsockopt (fd, level, name, &value, sizeof (value)) == -1)
+    fprintf (main_log_fd, "\n%s - WARNING - %s - %s=%d not set: %s", get_timestamp (), module, what,
+             value, strerror (errno));
+}
+
+
+// The value of the socket option LEVEL/NAME of FD, or -1 if it can't be read
+static int tuned (int fd, int level, int name)
+{
+  int value;
+  socklen_t len = sizeof (value);
+
+  return getsockopt (fd, level, name, &value, &len) == 0 ? value : -1;
+}
+
+
+// /////////////////////////////////////////////////////////
+// C O N F I G U R A T I O N
+// /////////////////////////////////////////////////////////
+
+bool sckt_tune_set_option (struct sckt_tuning* t, const char* key, const char* value)
+{
+  int i;
+
+  if (strcmp (key, "sckt_profile") == 0) {
+    for (i = 0; i < sizeof (profiles) / sizeof (profiles[0]); i++) {
+      if (strcmp (value, profiles[i].profile) == 0) {
+        *t = profiles[i];
+        return true;
+      }
+    }
+    return false;
+  }
+  else if (strcmp (key, "sckt_nodelay") == 0)
+    return parse_int (value, 0, 1, &t->nodelay);
+  else if (strcmp (key, "sckt_quickack") == 0)
+    return parse_int (value, 0, 1, &t->quickack);
+  else if (strcmp (key, "sckt_sndbuf") == 0)
+    return parse_bytes (value, &t->sndbuf);
+  else if (strcmp (key, "sckt_rcvbuf") == 0)
+    return parse_bytes (value, &t->rcvbuf);
+  else if (strcmp (key, "sckt_busy_poll") == 0)
+    return parse_int (value, 0, 1000000, &t->busy_poll);
+  else if (strcmp (key, "sckt_priority") == 0)
+    return parse_int (value, 0, 7, &t->priority);
+  else if (strcmp (key, "sckt_notsent_lowat") == 0)
+    return parse_bytes (value, &t->notsent_lowat);
+  else if (strcmp (key, "sckt_listenq") == 0)
+    return parse_int (value, 1, 65535, &t->listenq);
+  return false;
+}
+
+
+// /////////////////////////////////////////////////////////
+// S O C K E T S
+// /////////////////////////////////////////////////////////
+
+void sckt_tune_socket (const struct sckt_tuning* t, int fd, bool tcp, const char* module)
+{
+  if (t->sndbuf > 0)
+    tune (fd, SOL_SOCKET, SO_SNDBUF, "SO_SNDBUF", t->sndbuf, module);
+  if (t->rcvbuf > 0)
+    tune (fd, SOL_SOCKET, SO_RCVBUF, "SO_RCVBUF", t->rcvbuf, module);
+  if (t->busy_poll > 0)
+    tune (fd, SOL_SOCKET, SO_BUSY_POLL, "SO_BUSY_POLL", t->busy_poll, module);
+  if (t->priority >= 0)
+    tune (fd, SOL_SOCKET, SO_PRIORITY, "SO_PRIORITY", t->priority, module);
+  if (!tcp)
+    return;
+  if (t->nodelay >= 0)
+    tune (fd, IPPROTO_TCP, TCP_NODELAY, "TCP_NODELAY", t->nodelay, module);
+  if (t->quickack > 0)
+    tune (fd, IPPROTO_TCP, TCP_QUICKACK, "TCP_QUICKACK", 1, module);
+  if (t->notsent_lowat > 0)
+    tune (fd, IPPROTO_TCP, TCP_NOTSENT_LOWAT, "TCP_NOTSENT_LOWAT", t->notsent_lowat, module);
+}
+
+
+void sckt_tune_rearm (const struct sckt_tuning* t, int fd)
+{
+  int on = 1;
+
+  // The kernel drops out of quick ack mode on its own; a failure changes nothing.
+  if (t->quickack > 0)
+    setsockopt (fd, IPPROTO_TCP, TCP_QUICKACK, &on, sizeof (on));
+}
+
+
+void sckt_tune_log (const struct sckt_tuning* t, int fd, bool tcp, const char* module)
+{
+  fprintf (main_log_fd, "\n%s - INFO - %s - profile %s: SO_SNDBUF=%d, SO_RCVBUF=%d, SO_BUSY_POLL=%d, SO_PRIORITY=%d",
+           get_timestamp (), module, t->profile, tuned (fd, SOL_SOCKET, SO_SNDBUF),
+           tuned (fd, SOL_SOCKET, SO_RCVBUF), tuned (fd, SOL_SOCKET, SO_BUSY_POLL),
+           tuned (fd, SOL_SOCKET, SO_PRIORITY));
+  if (tcp)
+    fprintf (main_log_fd, ", TCP_NODELAY=%d, TCP_QUICKACK=%d, TCP_NOTSENT_LOWAT=%d",
+             tuned (fd, IPPROTO_TCP, TCP_NODELAY), t->quickack > 0,
+             tuned (fd, IPPROTO_TCP, TCP_NOTSENT_LOWAT));
+}
@@ -7,12 +7,16 @@
  *          consumer process on the same machine as isc.
  *          This module connects the Inter SoC Communication (ISC) system to the consumer
  *          process via shared memory. 
+ *          Each chunk is written once into the ring as a record of just the bytes
+ *          received, however many consumer processes read it; its slots are reused
+ *          only once every consumer has released it.
+ *          Several threads may hand chunks in at once (the sckt_server workers): each
+ *          claims its records through a ring handle of its own.
 */
 
 #include <string.h>
 #include <sys/wait.h>
 #include <sys/ipc.h>
-#include <sys/sem.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <stdio.h>
@@ -42,17 +46,43 @@ FILE *log_fd = NULL;
 #define BUFFER_INIT1 0x01
 #define BUFFER_INIT2 0x02
 
-// Shared Memory Key and Binary Semaphore
-static key_t cons_semkey;
-static int cons_semid;
-static key_t cons_shmkey;
-static int cons_shmid;
-static char *cons_shm;
+// Shared Memory segment and the slot ring inside it
+static struct shm_segment cons_seg;
+static struct shm_ring cons_ring;
 static int init1 = 1;
 
+// The handle through which the calling thread writes the ring, a copy of cons_ring
+// taken when the thread first wrote the ring of generation cons_gen, and the position
+// of the record it has acquired
+static int cons_gen;
+static __thread struct shm_ring writer;
+static __thread int writer_gen;
+static __thread uint64_t lease_pos;
+
+// How long ipc_rec waits for the consumer to free a slot before dropping a chunk
+#define CONS_RING_FULL_TIMEOUT 0.1
+
+// Flow control counters: how often a slot was asked for while the ring was full, and
+// how many chunks ipc_rec had to drop after all
+static uint64_t credits_exhausted;
+static uint64_t chunks_dropped;
+
+
+// Return the ring handle of the calling thread. Each thread needs its own, as the
+// handle caches how far the consumers got and what the last failed claim waits for.
+static struct shm_ring* cons_writer ()
+{
+  if (writer_gen != cons_gen) {
+    writer = cons_ring;
+    writer_gen = cons_gen;
+  }
+  return &writer;
+}
+
 
 // Interface function as a constructor
-void ipc_init (void (*ipc_rec)(unsigned char *buf, int bufSize), void (*ipc_xmit)(uint8_t *buf, int32_t bufSize))
+void ipc_init (void (*ipc_rec)(uint8_t *buf, int32_t bufSize), void (*ipc_xmit)(uint8_t *buf, int32_t bufSize),
+               struct ipc_module* ipc_peer)
 {
   if (verbose)
     printf("\nshmem_rec - ipc_init\n");
@@ -70,30 +100,13 @@ void ipc_init (void (*ipc_rec)(unsigned char *buf, int bufSize), void (*ipc_xmit
 // C o n s u m e r
 /////////////////////////////////////////
 
-  // Get unique key for xmit shared memory
-  if ((cons_shmkey = ftok("/tmp/cons_shmem_key", 'R')) == -1) // Here the file must exist 
-    system_error ("ipc_init - cons_shmkey ftok");
+  // Create or attach the segment and the slot ring inside it
+  if (shm_ring_open (&cons_ring, &cons_seg, "/tmp/cons_shmem_key", CONS_RING_SLOTS, SHM_SLOT_SIZE) == -1) // Here the file must exist 
+    system_error ("ipc_init - cons_ring shm_ring_open");
 
-  // Create the segment
-  if ((cons_shmid = shmget(cons_shmkey, CONS_SHM_SIZE, 0644 | IPC_CREAT)) == -1)
-    system_error ("ipc_init - cons_shmid shmget");
-
-  // Attach to the segment to get a pointer to it
-  cons_shm = shmat(cons_shmid, (void *)0, 0);
-  if (cons_shm == (char *)(-1))
-    system_error ("ipc_init - cons_shm shmat");
-
-  // Get unique key for xmit semaphore
-  if ((cons_semkey = ftok("/tmp/cons_sem_key", 'R')) == (key_t) -1)
-    system_error ("ipc_init - cons_semkey ftok");
-
-  // Allocate xmit semaphore
-  if ((cons_semid = binary_semaphore_allocation (cons_semkey, 0644 | IPC_CREAT)) == -1 )
-    system_error ("ipc_init - cons_semid binary_semaphore_allocation");
-
-  // Init xmit semaphore
-  if (binary_semaphore_initialize (cons_semid) == -1 )
-    system_error ("ipc_init - cons_semid binary_semaphore_initialize");
+  credits_exhausted = 0;
+  chunks_dropped = 0;
+  cons_gen++;
 }
 
 
@@ -103,13 +116,15 @@ void ipc_cleanup ()
   if (verbose)
     printf("\nshmem_rec - ipc_cleanup\n");
   fprintf(main_log_fd, "\n%s - INFO - shmem_rec - ipc_cleanup", get_timestamp());
+  fprintf(main_log_fd, "\n%s - INFO - shmem_rec - consumer ring found full %llu times, %llu chunks dropped",
+          get_timestamp(), (unsigned long long) credits_exhausted, (unsigned long long) chunks_dropped);
 
 /////////////////////////////////////////
 // C o n s u m e r
 /////////////////////////////////////////
   // Detach from the segment
-  if (shmdt(cons_shm) == -1)
-    system_error ("ipc_cleanup - cons shmdt");
+  if (shm_segment_close(&cons_seg, false) == -1)
+    system_error ("ipc_cleanup - cons shm_segment_close");
 
   // All done. Close the main log file.
   if (log_fd)
@@ -125,18 +140,48 @@ uint32_t ipc_xmit (uint8_t *buf, int32_t bufSize)
 }
 
 
+// Interface function to xmit a batch of chunks
+uint32_t ipc_xmitv (const struct iovec *iov, int32_t iovCnt)
+{
+  system_error ("ipc_xmitv - shmem_rec - Not implemented");
+  return 0;
+}
+
+
 // Interface function to receive data
 void ipc_rec (uint8_t *buf, int32_t bufSize)
 {
   int i;
+  uint8_t *slot;
+  uint64_t pos;
+  bool waited = false;
+  struct shm_ring *ring = cons_writer();
+
   if (verbose)
     printf("\nshmem_rec - ipc_rec");
   fprintf(main_log_fd, "\n%s - INFO - shmem_rec - ipc_rec", get_timestamp());
 
-//  printf("\nshmem:ipc_rec:rec semaphore wait...\n");
-  memcpy(cons_shm, (const char *)buf, bufSize);
+  if (bufSize > (int32_t) shm_ring_max_record(&cons_ring)) {
+    fprintf(main_log_fd, "\n%s - WARNING - shmem_rec - ipc_rec - chunk of %d bytes truncated to the largest record", get_timestamp(), bufSize);
+    bufSize = shm_ring_max_record(&cons_ring);
+  }
+
+  // Wait for the consumer to free room rather than overwriting unread data
+  while ((slot = shm_ring_claim(ring, bufSize, &pos)) == NULL) {
+    if (waited) {
+      fprintf(main_log_fd, "\n%s - WARNING - shmem_rec - ipc_rec - consumer ring full, chunk dropped", get_timestamp());
+      __atomic_fetch_add(&chunks_dropped, 1, __ATOMIC_RELAXED);
+      return;
+    }
+    __atomic_fetch_add(&credits_exhausted, 1, __ATOMIC_RELAXED);
+    shm_ring_wait_space(ring, CONS_RING_FULL_TIMEOUT);
+    waited = true;
+  }
+
+  memcpy(slot, (const char *)buf, bufSize);
 
-  binary_semaphore_post(cons_semid);
+  // Publishing wakes the consumer only if it sleeps on an empty ring
+  shm_ring_commit(ring, pos, bufSize, SHM_RECORD_DATA);
 
   fprintf(log_fd, "\n%s - INFO - shmem_rec - ", get_timestamp());
 
@@ -158,6 +203,66 @@ void ipc_rec (uint8_t *buf, int32_t bufSize)
 }
 
 
+// Interface function to lend room for the next record of the consumer ring, so the
+// caller can fill it in place. If the ring can't take *bufSize bytes right now,
+// nothing is claimed: a shorter record would only reach the consumers as padding.
+// Each thread holds one record at a time.
+uint8_t* ipc_acquire (int32_t *bufSize)
+{
+  uint8_t *slot;
+
+  if ( (slot = shm_ring_claim(cons_writer(), *bufSize, &lease_pos)) == NULL)
+    __atomic_fetch_add(&credits_exhausted, 1, __ATOMIC_RELAXED);
+  return slot;
+}
+
+
+// Interface function to report the room the consumers left: the free slots of the
+// ring, of which a chunk takes one or more. Consumers hand credits back by releasing
+// the slots they have read.
+int32_t ipc_credits ()
+{
+  return shm_ring_free(cons_writer());
+}
+
+
+// Interface function to publish a slot filled by the caller of ipc_acquire
+void ipc_commit (uint8_t *buf, int32_t bufSize)
+{
+  int i;
+
+  // Nothing was written. The claim can't be taken back, as other threads may have
+  // claimed records behind it; it is published as padding the consumers skip.
+  if (bufSize == 0) {
+    shm_ring_commit(cons_writer(), lease_pos, 0, SHM_RECORD_PAD);
+    return;
+  }
+
+  if (verbose)
+    printf("\nshmem_rec - ipc_commit");
+  fprintf(main_log_fd, "\n%s - INFO - shmem_rec - ipc_commit", get_timestamp());
+
+  fprintf(log_fd, "\n%s - INFO - shmem_rec - ", get_timestamp());
+
+#if 1
+  for (i = 0; i < bufSize; i++) {
+    fprintf(log_fd, "0x%X,", buf[i]);
+  }
+#endif
+
+  // Publishing wakes the consumer only if it sleeps on an empty ring. The record
+  // keeps the slots claimed for it.
+  shm_ring_commit(cons_writer(), lease_pos, bufSize, SHM_RECORD_DATA);
+}
+
+
+// Interface function to release a buffer passed on through xmit
+void ipc_release (uint8_t *buf)
+{
+  system_error ("shmem_rec - ipc_release - Not implemented");
+}
+
+
 // Interface function to request stopping the thread
 void ipc_stop()
 {
@@ -175,6 +280,16 @@ bool ipc_set_param(const char* prtcl, const char *addr, int port)
 }
 
 
+// Interface function to set a named configuration option
+bool ipc_set_option(const char* key, const char* value)
+{
+  if (verbose)
+    printf("\nshmem_rec - ipc_set_option");
+  // The shared memory segment is the only thing configurable here.
+  return shm_seg_set_option(key, value);
+}
+
+
 // Interface function to start the thread 
 bool ipc_start()
 {
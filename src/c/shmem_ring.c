@@ -0,0 +1,748 @@
+/**
+ * @file   shmem_ring.c
+ * @author Armin Zare Zadeh ali.a.zarezadeh@gmail.com
+ * @date   15 October 2026
+ * @version 0.1
+ * @brief   shmem_ring.c implements a lock-free ring of variable length records which
+ *          lives inside a shared memory segment. It has a single consumer and either
+ *          a single producer or any number of producer processes.
+ *
+ * The segment starts with a struct shm_ring_hdr, followed by an array of slot_count
+ * record headers and then by slot_count payload slots. Each slot is a multiple of the
+ * cache line size. A record takes as many adjacent slots as its payload needs and
+ * is framed by the header of its first slot (length, type, sequence); since the
+ * headers are kept apart, its payload is one contiguous area. A record which would
+ * run past the end of the ring starts over at slot 0 and a padding record fills the
+ * slots it skipped.
+ * - The producer owns head and the consumer owns tail. Both are free running 64 bit
+ *   counters which are kept on their own cache line so the two processes never write
+ *   to the same line.
+ * - With several producers, each one claims a slot by advancing head with a compare
+ *   and swap and publishes it by storing its position in the record header. The
+ *   consumer only takes a record once its sequence matches, so records are drained
+ *   in the order they were claimed even if a later claimer finishes first.
+ * - The consumer leases records in order with shm_ring_read and hands them back in the
+ *   same order with shm_ring_release. Several records may be leased at once, e.g.
+ *   while they sit in a socket send queue, without copying them out of the segment.
+ * - A ring can also be read by several consumer processes at once, each of which sees
+ *   every slot (broadcast). Every reader joins with a cursor of its own in the header
+ *   and the producer gates the reuse of slots on the oldest cursor. Optionally a
+ *   reader which holds the ring full while the others have moved on is dropped; it
+ *   picks up again at the oldest slot still held and counts what it missed.
+ * - Whichever process attaches first lays out the header; the other one waits until the
+ *   header is marked ready and then adopts the geometry found in the segment.
+ * - Publishing and releasing never block. A side that finds the ring empty (or full)
+ *   may sleep on the futex based shm_notify in the header; the other side only pays
+ *   for a wakeup syscall while somebody actually sleeps.
+ */
+
+#include <errno.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "isc.h"
+
+
+/***********************************************************************************
+ * C o n s t a n t s ,   v a r i a b l e s ,  f u n c t i o n s
+************************************************************************************/
+
+// Values of shm_ring_hdr.state
+#define SHM_RING_FRESH        0
+#define SHM_RING_INITIALIZING 1
+#define SHM_RING_READY        2
+
+// Values of shm_ring_reader.state
+#define SHM_READER_FREE    0
+#define SHM_READER_JOINING 1
+#define SHM_READER_ACTIVE  2
+#define SHM_READER_DROPPED 3
+
+// How long a reader may hold a ring full before it is dropped as a laggard, in seconds
+#define SHM_LAGGARD_GRACE 0.01
+
+// Round SIZE up to a multiple of the cache line size.
+#define SHM_CACHE_ALIGN(size) \
+  (((size) + SHM_CACHE_LINE - 1) & ~((size_t) SHM_CACHE_LINE - 1))
+
+
+// Round a slot count up to the next power of two so the index can be masked.
+static uint32_t round_up_pow2 (uint32_t n)
+{
+  uint32_t p = 1;
+
+  while (p < n)
+    p <<= 1;
+  return p;
+}
+
+
+// Return the header of the record starting at free running index POS.
+static inline struct shm_record_hdr* ring_record (const struct shm_ring* ring, uint64_t pos)
+{
+  return &ring->records[pos & ring->mask];
+}
+
+
+// Return the payload area of the slot at free running index POS.
+static inline uint8_t* ring_payload (const struct shm_ring* ring, uint64_t pos)
+{
+  return ring->slots + (size_t) (pos & ring->mask) * ring->slot_size;
+}
+
+
+// Number of slots a record of LEN bytes takes; even an empty one takes a slot.
+static inline uint32_t ring_slots_for (const struct shm_ring* ring, uint32_t len)
+{
+  return len == 0 ? 1 : (len + ring->slot_size - 1) / ring->slot_size;
+}
+
+
+// Number of padding slots needed before a record of N slots starting at HEAD, so it
+// doesn't run past the end of the ring.
+static inline uint32_t ring_pad (const struct shm_ring* ring, uint64_t head, uint32_t n)
+{
+  uint32_t index = head & ring->mask;
+
+  return index + n > ring->mask + 1 ? ring->mask + 1 - index : 0;
+}
+
+
+// Position of the first leased record at or after POS, stepping over the padding the
+// consumer has already gone past.
+static inline uint64_t ring_skip_pad (const struct shm_ring* ring, uint64_t pos)
+{
+  struct shm_record_hdr* rec;
+
+  while (pos < ring->read && (rec = ring_record (ring, pos))->type == SHM_RECORD_PAD)
+    pos += rec->slots;
+  return pos;
+}
+
+
+// Return the position below which every slot may be reused: the tail of a plain
+// consumer or, on a broadcast ring, the oldest reader cursor. While the ring has no
+// room for NEED more slots after HEAD, readers whose process is gone are freed. If
+// DROP and drop_laggards are set, the slowest reader is dropped too when it trails the
+// fastest by over half the ring and has kept the ring full for SHM_LAGGARD_GRACE seconds.
+static uint64_t ring_gate (struct shm_ring* ring, uint64_t head, uint32_t need, bool drop)
+{
+  struct shm_ring_hdr* hdr = ring->hdr;
+  struct shm_ring_reader* slowest;
+  uint64_t gate, fastest, cursor, tail;
+  uint32_t active;
+  int i, n;
+
+  for (;;) {
+    gate = UINT64_MAX;
+    fastest = 0;
+    slowest = NULL;
+    for (i = 0, n = 0; i < SHM_RING_MAX_READERS; i++) {
+      if (__atomic_load_n (&hdr->readers[i].state, __ATOMIC_ACQUIRE) != SHM_READER_ACTIVE)
+        continue;
+      cursor = __atomic_load_n (&hdr->readers[i].cursor, __ATOMIC_ACQUIRE);
+      if (cursor < gate) {
+        gate = cursor;
+        slowest = &hdr->readers[i];
+      }
+      if (cursor > fastest)
+        fastest = cursor;
+      n++;
+    }
+    if (n == 0) {
+      gate = __atomic_load_n (&hdr->tail, __ATOMIC_SEQ_CST);
+      break;
+    }
+    if (head + need - gate <= ring->mask + 1) {
+      ring->stalled_since = 0;
+      break;
+    }
+
+    active = SHM_READER_ACTIVE;
+    if (kill (slowest->pid, 0) == -1 && errno == ESRCH)
+      __atomic_compare_exchange_n (&slowest->state, &active, SHM_READER_FREE,
+                                   false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+    else if (drop && ring->drop_laggards && fastest - gate > ring->mask / 2) {
+      // Give a reader which was merely descheduled the time to catch up.
+      if (ring->stalled_since == 0)
+        ring->stalled_since = get_monotonic_time ();
+      if (get_monotonic_time () - ring->stalled_since < SHM_LAGGARD_GRACE)
+        break;
+      __atomic_compare_exchange_n (&slowest->state, &active, SHM_READER_DROPPED,
+                                   false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+      ring->stalled_since = 0;
+    }
+    else
+      break;
+  }
+
+  // Keep tail at the oldest cursor; it is where readers join.
+  tail = __atomic_load_n (&hdr->tail, __ATOMIC_SEQ_CST);
+  while (tail < gate && !__atomic_compare_exchange_n (&hdr->tail, &tail, gate, true,
+                                                      __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST))
+    ;
+
+  // A reader which turned active after the scan may have started from an older tail.
+  // It moves up to this one once it sees it; until then, its cursor holds the gate.
+  for (i = 0; i < SHM_RING_MAX_READERS; i++) {
+    if (__atomic_load_n (&hdr->readers[i].state, __ATOMIC_SEQ_CST) != SHM_READER_ACTIVE)
+      continue;
+    cursor = __atomic_load_n (&hdr->readers[i].cursor, __ATOMIC_ACQUIRE);
+    if (cursor < gate)
+      gate = cursor;
+  }
+  return gate;
+}
+
+
+// Move the reader of RING to the oldest slot the ring still holds, counting the slots
+// it skips as lost, and mark it active again.
+static void ring_rejoin (struct shm_ring* ring)
+{
+  struct shm_ring_reader* r = &ring->hdr->readers[ring->reader];
+  uint64_t pos = __atomic_load_n (&ring->hdr->tail, __ATOMIC_SEQ_CST);
+
+  if (pos > ring->read)
+    ring->lost += pos - ring->read;
+  ring->read = pos;
+  __atomic_store_n (&r->cursor, pos, __ATOMIC_RELAXED);
+  __atomic_store_n (&r->state, SHM_READER_ACTIVE, __ATOMIC_SEQ_CST);
+
+  // A producer which scanned the readers before we were active moved the tail on
+  // without us, and then reuses the slots behind it; start from there.
+  pos = __atomic_load_n (&ring->hdr->tail, __ATOMIC_SEQ_CST);
+  if (pos > ring->read) {
+    ring->lost += pos - ring->read;
+    ring->read = pos;
+    __atomic_store_n (&r->cursor, pos, __ATOMIC_RELEASE);
+  }
+}
+
+
+// Whether the consumer of RING has something to look at: the record at its read
+// position is published, or was overtaken, or the reader was dropped; read sorts out
+// which.
+static inline bool ring_has_data (struct shm_ring* ring, int memorder)
+{
+  struct shm_record_hdr* rec = ring_record (ring, ring->read);
+
+  return (int64_t) (__atomic_load_n (&rec->seq, memorder) - (ring->read + 1)) >= 0 ||
+         (ring->reader >= 0 && ring->hdr->readers[ring->reader].state == SHM_READER_DROPPED);
+}
+
+
+// Tell the CPU we're in a spin loop.
+static inline void cpu_relax ()
+{
+#if defined (__x86_64__) || defined (__i386__)
+  __builtin_ia32_pause ();
+#elif defined (__aarch64__) || defined (__arm__)
+  __asm__ __volatile__ ("yield" ::: "memory");
+#endif
+}
+
+
+// Frame the record at position POS, spanning SLOTS slots, and mark it as published.
+static inline void ring_stamp (struct shm_ring* ring, uint64_t pos, uint32_t slots,
+                               uint32_t len, uint16_t type)
+{
+  struct shm_record_hdr* rec = ring_record (ring, pos);
+
+  rec->len = len;
+  rec->type = type;
+  rec->slots = slots;
+  __atomic_store_n (&rec->seq, pos + 1, __ATOMIC_RELEASE);
+}
+
+
+// Whether a record of N slots, after PAD slots of padding, fits after HEAD. The
+// tail is refreshed from the consumer's index if it looks like it doesn't.
+static inline bool ring_fits (struct shm_ring* ring, uint64_t head, uint32_t pad, uint32_t n)
+{
+  if (head + pad + n - ring->cached_tail <= ring->mask + 1)
+    return true;
+  ring->cached_tail = ring_gate (ring, head, pad + n, true);
+  if (head + pad + n - ring->cached_tail <= ring->mask + 1)
+    return true;
+  // Remember what we wait for; shm_ring_wait_space sleeps until it is there.
+  ring->need = pad + n;
+  return false;
+}
+
+
+// /////////////////////////////////////////////////////////
+// G E O M E T R Y
+// /////////////////////////////////////////////////////////
+
+// Size in bytes of a segment holding SLOT_COUNT slots of PAYLOAD_SIZE bytes each
+size_t shm_ring_segment_size (uint32_t slot_count, uint32_t payload_size)
+{
+  uint32_t n = round_up_pow2 (slot_count);
+
+  return SHM_CACHE_ALIGN (sizeof (struct shm_ring_hdr)) +
+         SHM_CACHE_ALIGN ((size_t) n * sizeof (struct shm_record_hdr)) +
+         (size_t) n * SHM_CACHE_ALIGN (payload_size);
+}
+
+
+// Number of slots of PAYLOAD_SIZE bytes fitting in SEG_SIZE bytes, as a power of two
+uint32_t shm_ring_slots_for_size (size_t seg_size, uint32_t payload_size)
+{
+  uint32_t n = 1;
+
+  if (seg_size < shm_ring_segment_size (1, payload_size))
+    return 0;
+  while (shm_ring_segment_size (n * 2, payload_size) <= seg_size)
+    n *= 2;
+  return n;
+}
+
+
+// Attach the local ring handle to the segment at BASE, laying out the header if
+// this process is the first one to attach.
+int shm_ring_attach (struct shm_ring* ring, void* base, uint32_t slot_count, uint32_t payload_size)
+{
+  struct shm_ring_hdr* hdr = (struct shm_ring_hdr*) base;
+  uint32_t expected = SHM_RING_FRESH;
+
+  if (__atomic_compare_exchange_n (&hdr->state, &expected, SHM_RING_INITIALIZING,
+                                   false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+    // We won the race; lay out an empty ring.
+    hdr->magic = SHM_RING_MAGIC;
+    hdr->slot_count = round_up_pow2 (slot_count);
+    hdr->slot_size = SHM_CACHE_ALIGN (payload_size);
+    __atomic_store_n (&hdr->head, 0, __ATOMIC_RELAXED);
+    __atomic_store_n (&hdr->tail, 0, __ATOMIC_RELAXED);
+    __atomic_store_n (&hdr->state, SHM_RING_READY, __ATOMIC_RELEASE);
+  }
+  else {
+    // Somebody else owns the layout; wait until it is published.
+    while (__atomic_load_n (&hdr->state, __ATOMIC_ACQUIRE) != SHM_RING_READY)
+      better_sleep (0.0001);
+  }
+
+  if (hdr->magic != SHM_RING_MAGIC) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  ring->hdr = hdr;
+  ring->records = (struct shm_record_hdr*) ((uint8_t*) base + SHM_CACHE_ALIGN (sizeof (struct shm_ring_hdr)));
+  ring->slots = (uint8_t*) ring->records + SHM_CACHE_ALIGN ((size_t) hdr->slot_count * sizeof (struct shm_record_hdr));
+  ring->slot_size = hdr->slot_size;
+  ring->mask = hdr->slot_count - 1;
+  ring->pad = 0;
+  ring->need = 1;
+  ring->cached_tail = __atomic_load_n (&hdr->tail, __ATOMIC_ACQUIRE);
+  ring->read = ring->cached_tail;
+  ring->reader = -1;
+  ring->drop_laggards = false;
+  ring->stalled_since = 0;
+  ring->lost = 0;
+  ring->wait.mode = SHM_WAIT_BLOCK;
+  ring->wait.spin_us = 0;
+  ring->wait.pause = false;
+  ring->avg_wait = 0;
+  return 0;
+}
+
+
+// Open the segment for KEY_PATH and attach RING to it
+int shm_ring_open (struct shm_ring* ring, struct shm_segment* seg, const char* key_path,
+                   uint32_t slot_count, uint32_t payload_size)
+{
+  uint32_t slots;
+
+  payload_size = shm_segment_slot_size (payload_size);
+  if (shm_segment_open (seg, key_path, shm_ring_segment_size (slot_count, payload_size)) == -1)
+    return -1;
+
+  // Use all of the segment, which may have been rounded up to huge pages.
+  if ((slots = shm_ring_slots_for_size (seg->size, payload_size)) == 0) {
+    errno = EINVAL;
+    return -1;
+  }
+  if (shm_ring_attach (ring, seg->base, slots, payload_size) == -1)
+    return -1;
+  ring->drop_laggards = shm_config.drop_laggards;
+  ring->wait = shm_config.wait;
+  return 0;
+}
+
+
+// Payload bytes per slot of RING
+uint32_t shm_ring_payload_size (const struct shm_ring* ring)
+{
+  return ring->slot_size;
+}
+
+
+// Largest record RING takes. Half the ring, so that it fits even after padding.
+uint32_t shm_ring_max_record (const struct shm_ring* ring)
+{
+  uint32_t slots = (ring->mask + 1) / 2;
+
+  if (slots > UINT16_MAX)
+    slots = UINT16_MAX;
+  if (slots == 0)
+    slots = 1;
+  return slots * ring->slot_size;
+}
+
+
+// Number of claimed or published slots which aren't released yet
+uint32_t shm_ring_count (const struct shm_ring* ring)
+{
+  uint64_t head = __atomic_load_n (&ring->hdr->head, __ATOMIC_ACQUIRE);
+  uint64_t tail = __atomic_load_n (&ring->hdr->tail, __ATOMIC_ACQUIRE);
+
+  return (uint32_t) (head - tail);
+}
+
+
+// /////////////////////////////////////////////////////////
+// P R O D U C E R   S I D E
+// /////////////////////////////////////////////////////////
+
+// Return the payload area of a record of up to LEN bytes, or NULL if the ring is
+// too full.
+uint8_t* shm_ring_reserve (struct shm_ring* ring, uint32_t len)
+{
+  uint64_t head = ring->hdr->head;
+  uint32_t n, pad;
+
+  if (len > shm_ring_max_record (ring)) {
+    errno = EMSGSIZE;
+    return NULL;
+  }
+  n = ring_slots_for (ring, len);
+  pad = ring_pad (ring, head, n);
+  if (!ring_fits (ring, head, pad, n))
+    return NULL;
+
+  ring->pad = pad;
+  return ring_payload (ring, head + pad);
+}
+
+
+// Publish the record returned by the last shm_ring_reserve carrying LEN bytes.
+void shm_ring_publish (struct shm_ring* ring, uint32_t len, uint16_t type)
+{
+  uint64_t head = ring->hdr->head;
+  uint32_t n = ring_slots_for (ring, len);
+
+  __atomic_store_n (&ring->hdr->head, head + ring->pad + n, __ATOMIC_RELAXED);
+  if (ring->pad > 0)
+    ring_stamp (ring, head, ring->pad, 0, SHM_RECORD_PAD);
+  ring_stamp (ring, head + ring->pad, n, len, type);
+  shm_notify_post (&ring->hdr->data_ready);
+}
+
+
+// Claim room for a record of up to LEN bytes among several producers and store its
+// position in POS. Return its payload area, or NULL if the ring is too full.
+uint8_t* shm_ring_claim (struct shm_ring* ring, uint32_t len, uint64_t* pos)
+{
+  uint64_t head = __atomic_load_n (&ring->hdr->head, __ATOMIC_RELAXED);
+  uint32_t n, pad;
+
+  if (len > shm_ring_max_record (ring)) {
+    errno = EMSGSIZE;
+    return NULL;
+  }
+  n = ring_slots_for (ring, len);
+  do {
+    pad = ring_pad (ring, head, n);
+    if (!ring_fits (ring, head, pad, n))
+      return NULL;
+    // A failed swap reloads head and the room check is done again.
+  } while (!__atomic_compare_exchange_n (&ring->hdr->head, &head, head + pad + n, true,
+                                         __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+  // The padding is ours too and can be published right away.
+  if (pad > 0)
+    ring_stamp (ring, head, pad, 0, SHM_RECORD_PAD);
+  // The size is fixed now: the next claim starts right after it.
+  ring_record (ring, head + pad)->slots = n;
+  *pos = head + pad;
+  return ring_payload (ring, head + pad);
+}
+
+
+// Publish the record claimed at POS carrying LEN bytes.
+void shm_ring_commit (struct shm_ring* ring, uint64_t pos, uint32_t len, uint16_t type)
+{
+  ring_stamp (ring, pos, ring_record (ring, pos)->slots, len, type);
+  shm_notify_post (&ring->hdr->data_ready);
+}
+
+
+// Number of slots which can be reserved right now
+uint32_t shm_ring_free (struct shm_ring* ring)
+{
+  uint64_t head = ring->hdr->head;
+
+  if (head - ring->cached_tail > ring->mask)
+    ring->cached_tail = ring_gate (ring, head, 1, true);
+  return head - ring->cached_tail > ring->mask ? 0 : ring->mask + 1 - (uint32_t) (head - ring->cached_tail);
+}
+
+
+// Largest record which can be reserved right now: it goes either in the free slots
+// up to the end of the ring or, after padding those, in the free slots at its start.
+uint32_t shm_ring_room (struct shm_ring* ring)
+{
+  uint64_t head = ring->hdr->head;
+  uint32_t free = shm_ring_free (ring);
+  uint32_t to_end = ring->mask + 1 - (uint32_t) (head & ring->mask);
+  uint32_t slots = free <= to_end ? free : (to_end > free - to_end ? to_end : free - to_end);
+  uint32_t max = shm_ring_max_record (ring);
+
+  return (uint64_t) slots * ring->slot_size < max ? slots * ring->slot_size : max;
+}
+
+// Sleep until the consumer frees a slot.
+int shm_ring_wait_space (struct shm_ring* ring, double timeout)
+{
+  struct shm_ring_hdr* hdr = ring->hdr;
+  uint32_t ticket = shm_notify_prepare_wait (&hdr->space_ready);
+  uint64_t head = __atomic_load_n (&hdr->head, __ATOMIC_RELAXED);
+
+  __atomic_thread_fence (__ATOMIC_SEQ_CST);
+  if (head + ring->need - ring_gate (ring, head, ring->need, false) <= ring->mask + 1) {
+    shm_notify_cancel_wait (&hdr->space_ready);
+    return 0;
+  }
+  // Wake up in time to drop a laggard the ring is waiting for.
+  if (ring->stalled_since != 0 && timeout > SHM_LAGGARD_GRACE)
+    timeout = SHM_LAGGARD_GRACE;
+  return shm_notify_wait (&hdr->space_ready, ticket, timeout);
+}
+
+
+// /////////////////////////////////////////////////////////
+// C O N S U M E R   S I D E
+// /////////////////////////////////////////////////////////
+
+// Lease the oldest published record which isn't leased yet. Return its header, or
+// NULL if there is nothing new. Padding is stepped over.
+const struct shm_record_hdr* shm_ring_read_record (struct shm_ring* ring)
+{
+  struct shm_record_hdr* rec;
+  uint64_t seq;
+
+  if (ring->reader >= 0 &&
+      __atomic_load_n (&ring->hdr->readers[ring->reader].state, __ATOMIC_ACQUIRE) == SHM_READER_DROPPED)
+    ring_rejoin (ring);
+
+  for (;;) {
+    // The record is ours once its producer has stamped it with our position.
+    rec = ring_record (ring, ring->read);
+    seq = __atomic_load_n (&rec->seq, __ATOMIC_ACQUIRE);
+    if (seq != ring->read + 1) {
+      // A reader stamped from a later lap has been overtaken by the producer.
+      if (ring->reader >= 0 && (int64_t) (seq - (ring->read + 1)) > 0)
+        ring_rejoin (ring);
+      return NULL;
+    }
+
+    ring->read += rec->slots;
+    if (rec->type != SHM_RECORD_PAD)
+      return rec;
+  }
+}
+
+
+// Payload of the record with header REC
+uint8_t* shm_ring_record_payload (const struct shm_ring* ring, const struct shm_record_hdr* rec)
+{
+  return ring->slots + (size_t) (rec - ring->records) * ring->slot_size;
+}
+
+
+// Whether the record with header REC, which the consumer of RING leased last, was
+// still its own when it was done reading it. A dropped reader's slots are reused
+// at once, so what it read from them may have been overwritten under it.
+bool shm_ring_valid (const struct shm_ring* ring, const struct shm_record_hdr* rec)
+{
+  uint64_t pos;
+
+  // Whatever the reads of the record saw, it was in place before these loads.
+  __atomic_thread_fence (__ATOMIC_ACQUIRE);
+  pos = __atomic_load_n (&rec->seq, __ATOMIC_RELAXED) - 1;
+  if (pos >= ring->read || (pos & ring->mask) != (uint64_t) (rec - ring->records))
+    return false;
+  return ring->reader < 0 ||
+         __atomic_load_n (&ring->hdr->readers[ring->reader].state, __ATOMIC_RELAXED) != SHM_READER_DROPPED;
+}
+
+
+// Lease the oldest published record which isn't leased yet. Return its payload
+// and store its length in LEN, or return NULL if there is nothing new.
+uint8_t* shm_ring_read (struct shm_ring* ring, uint32_t* len)
+{
+  const struct shm_record_hdr* rec = shm_ring_read_record (ring);
+
+  if (rec == NULL)
+    return NULL;
+  *len = rec->len;
+  return shm_ring_record_payload (ring, rec);
+}
+
+
+// Payload of the oldest leased record, or NULL if nothing is leased
+uint8_t* shm_ring_oldest (struct shm_ring* ring)
+{
+  uint64_t tail = ring->reader >= 0 ? ring->hdr->readers[ring->reader].cursor : ring->hdr->tail;
+
+  tail = ring_skip_pad (ring, tail);
+  if (tail == ring->read)
+    return NULL;
+  return ring_payload (ring, tail);
+}
+
+
+// Hand the oldest leased record back to the producer.
+void shm_ring_release (struct shm_ring* ring)
+{
+  struct shm_ring_reader* r;
+  uint64_t tail;
+
+  if (ring->reader < 0) {
+    tail = ring_skip_pad (ring, ring->hdr->tail);
+    __atomic_store_n (&ring->hdr->tail, tail + ring_record (ring, tail)->slots, __ATOMIC_RELEASE);
+  }
+  else {
+    // Leases taken before the reader was dropped are void.
+    r = &ring->hdr->readers[ring->reader];
+    tail = ring_skip_pad (ring, r->cursor);
+    if (tail < ring->read)
+      __atomic_store_n (&r->cursor, tail + ring_record (ring, tail)->slots, __ATOMIC_RELEASE);
+  }
+  shm_notify_post (&ring->hdr->space_ready);
+}
+
+
+// Sleep until the producer publishes a slot.
+int shm_ring_wait_data (struct shm_ring* ring, double timeout)
+{
+  struct shm_ring_hdr* hdr = ring->hdr;
+  uint32_t ticket = shm_notify_prepare_wait (&hdr->data_ready);
+
+  if (ring_has_data (ring, __ATOMIC_SEQ_CST)) {
+    shm_notify_cancel_wait (&hdr->data_ready);
+    return 0;
+  }
+  return shm_notify_wait (&hdr->data_ready, ticket, timeout);
+}
+
+
+// Poll RING for up to SECONDS. Returns true as soon as there is data. With YIELD
+// the CPU is given up between polls.
+static bool ring_poll (struct shm_ring* ring, double seconds, bool yield)
+{
+  double deadline = get_monotonic_time () + seconds;
+  uint32_t n;
+
+  for (n = 1; ; n++) {
+    if (ring_has_data (ring, __ATOMIC_ACQUIRE))
+      return true;
+    if (yield)
+      sched_yield ();
+    else if (ring->wait.pause)
+      cpu_relax ();
+    // Reading the clock costs more than a poll; do it every so often.
+    if ((n & 63) == 0 && get_monotonic_time () >= deadline)
+      return false;
+  }
+}
+
+
+// Wait for data the way the ring's wait strategy says.
+int shm_ring_await_data (struct shm_ring* ring, double timeout)
+{
+  double spin = ring->wait.spin_us / 1e6, start, waited;
+  int rval = 0;
+
+  switch (ring->wait.mode) {
+    case SHM_WAIT_SPIN:
+      ring_poll (ring, timeout, false);
+      return 0;
+
+    case SHM_WAIT_SPIN_YIELD:
+      if (spin > timeout)
+        spin = timeout;
+      if (!ring_poll (ring, spin, false))
+        ring_poll (ring, timeout - spin, true);
+      return 0;
+
+    case SHM_WAIT_ADAPTIVE:
+      // Poll only while chunks recently came in within the poll budget, and then for
+      // about twice as long as they took.
+      start = get_monotonic_time ();
+      if (ring->avg_wait < spin && ring_poll (ring, 2 * ring->avg_wait < spin ? 2 * ring->avg_wait : spin, false))
+        waited = get_monotonic_time () - start;
+      else {
+        rval = shm_ring_wait_data (ring, timeout);
+        waited = ring_has_data (ring, __ATOMIC_ACQUIRE) ? get_monotonic_time () - start : timeout;
+      }
+      // Moving average of how long data took to show up
+      ring->avg_wait += (waited - ring->avg_wait) / 8;
+      return rval;
+
+    default:
+      return shm_ring_wait_data (ring, timeout);
+  }
+}
+
+
+// /////////////////////////////////////////////////////////
+// B R O A D C A S T   R E A D E R S
+// /////////////////////////////////////////////////////////
+
+// Take a free reader entry and start at the oldest slot the ring holds.
+int shm_ring_join (struct shm_ring* ring)
+{
+  struct shm_ring_reader* r;
+  uint32_t expected;
+  int i;
+
+  for (i = 0; i < SHM_RING_MAX_READERS; i++) {
+    r = &ring->hdr->readers[i];
+    expected = SHM_READER_FREE;
+    if (__atomic_compare_exchange_n (&r->state, &expected, SHM_READER_JOINING,
+                                     false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+      r->pid = getpid ();
+      ring->reader = i;
+      ring->read = 0;
+      ring_rejoin (ring);
+      ring->lost = 0;
+      return 0;
+    }
+  }
+  errno = EBUSY;
+  return -1;
+}
+
+
+// Give the reader entry back and return the number of readers left.
+int shm_ring_leave (struct shm_ring* ring)
+{
+  int i, n = 0;
+
+  if (ring->reader >= 0) {
+    __atomic_store_n (&ring->hdr->readers[ring->reader].state, SHM_READER_FREE, __ATOMIC_RELEASE);
+    ring->reader = -1;
+    // The producer may be waiting for this reader only.
+    shm_notify_post (&ring->hdr->space_ready);
+  }
+
+  for (i = 0; i < SHM_RING_MAX_READERS; i++) {
+    if (__atomic_load_n (&ring->hdr->readers[i].state, __ATOMIC_ACQUIRE) != SHM_READER_FREE)
+      n++;
+  }
+  return n;
+}
@@ -0,0 +1,388 @@
+/**
+ * @file   shmem_seg.c
+ * @author Armin Zare Zadeh ali.a.zarezadeh@gmail.com
+ * @date   15 October 2026
+ * @version 0.1
+ * @brief   shmem_seg.c creates and attaches the shared memory segments used between the
+ *          isc and the producer/consumer processes.
+ *
+ * The backend and the size of the segments are run-time settings held in shm_config:
+ * - sysv: a System V segment keyed by ftok on the key file (the default). With huge
+ *   pages requested it is created with SHM_HUGETLB and falls back to normal pages if
+ *   the kernel has no huge pages to spare.
+ * - posix: a file in /dev/shm named after the key file, mapped shared.
+ * - hugetlbfs: a file in a hugetlbfs mount (by default /dev/hugepages). Falls back to
+ *   the posix backend if the mount is missing or has no free pages.
+ * Independently of the backend the segment can be prefaulted, so no page fault is
+ * taken on the hot path, and locked in RAM with mlock. Failing to lock is reported
+ * but not fatal.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ipc.h>
+#include <sys/mman.h>
+#include <sys/shm.h>
+#include <sys/stat.h>
+#include "isc.h"
+
+
+/***********************************************************************************
+ * C o n s t a n t s ,   v a r i a b l e s ,  f u n c t i o n s
+************************************************************************************/
+
+#ifndef SHM_HUGETLB
+#define SHM_HUGETLB 04000
+#endif
+
+// Directory holding the files of the posix backend
+#define SHM_POSIX_DIR "/dev/shm"
+
+// Run-time configuration of the shared memory segments
+struct shm_seg_config shm_config = {
+  .backend = SHM_BACKEND_SYSV,
+  .size = 0,
+  .slot_size = 0,
+  .huge_pages = false,
+  .prefault = false,
+  .lock = false,
+  .hugetlbfs_dir = "/dev/hugepages",
+  .drop_laggards = false,
+  .wait = { .mode = SHM_WAIT_BLOCK, .spin_us = 50, .pause = true },
+};
+
+static const char* backend_names[] = { "sysv", "posix", "hugetlbfs" };
+static const char* wait_names[] = { "block", "spin", "spin_yield", "adaptive" };
+
+
+// Return the system huge page size, as reported in /proc/meminfo.
+static size_t huge_page_size ()
+{
+  FILE* fp = fopen ("/proc/meminfo", "r");
+  char line[128];
+  size_t kb = 2048;
+
+  if (fp == NULL)
+    return kb * 1024;
+  while (fgets (line, sizeof (line), fp) != NULL) {
+    if (sscanf (line, "Hugepagesize: %zu kB", &kb) == 1)
+      break;
+  }
+  fclose (fp);
+  return kb * 1024;
+}
+
+
+// Round SIZE up to a multiple of ALIGN.
+static size_t round_up (size_t size, size_t align)
+{
+  return (size + align - 1) / align * align;
+}
+
+
+// Parse a byte count of at most MAX with an optional K, M or G suffix. Returns 0 on
+// error.
+static size_t parse_size (const char* value, unsigned long long max)
+{
+  char* end;
+  unsigned long long n;
+  int shift = 0;
+
+  // strtoull would skip blanks and take a sign, turning -1 into a huge count.
+  if (*value < '0' || *value > '9')
+    return 0;
+  errno = 0;
+  n = strtoull (value, &end, 0);
+  switch (*end) {
+    case 'k': case 'K': shift = 10; end++; break;
+    case 'm': case 'M': shift = 20; end++; break;
+    case 'g': case 'G': shift = 30; end++; break;
+  }
+  // Checked before the shift, which could wrap a large count back into range
+  if (errno == ERANGE || *end != '\0' || n > max >> shift)
+    return 0;
+  return (size_t) (n << shift);
+}
+
+
+// Parse a boolean option value.
+static bool parse_bool (const char* value, bool* result)
+{
+  if (strcmp (value, "1") == 0 || strcmp (value, "on") == 0 || strcmp (value, "yes") == 0)
+    *result = true;
+  else if (strcmp (value, "0") == 0 || strcmp (value, "off") == 0 || strcmp (value, "no") == 0)
+    *result = false;
+  else
+    return false;
+  return true;
+}
+
+
+// /////////////////////////////////////////////////////////
+// C O N F I G U R A T I O N
+// /////////////////////////////////////////////////////////
+
+bool shm_seg_set_option (const char* key, const char* value)
+{
+  int i;
+
+  if (strcmp (key, "shm_backend") == 0) {
+    for (i = 0; i < sizeof (backend_names) / sizeof (backend_names[0]); i++) {
+      if (strcmp (value, backend_names[i]) == 0) {
+        shm_config.backend = i;
+        return true;
+      }
+    }
+    return false;
+  }
+  else if (strcmp (key, "shm_size") == 0) {
+    size_t size = parse_size (value, SIZE_MAX);
+
+    if (size == 0)
+      return false;
+    shm_config.size = size;
+    return true;
+  }
+  else if (strcmp (key, "shm_slot_size") == 0) {
+    // A slot larger than the largest record would never be filled.
+    size_t size = parse_size (value, SHM_MAX_RECORD);
+
+    if (size == 0)
+      return false;
+    shm_config.slot_size = size;
+    return true;
+  }
+  else if (strcmp (key, "shm_huge") == 0)
+    return parse_bool (value, &shm_config.huge_pages);
+  else if (strcmp (key, "shm_prefault") == 0)
+    return parse_bool (value, &shm_config.prefault);
+  else if (strcmp (key, "shm_mlock") == 0)
+    return parse_bool (value, &shm_config.lock);
+  else if (strcmp (key, "shm_wait") == 0) {
+    for (i = 0; i < sizeof (wait_names) / sizeof (wait_names[0]); i++) {
+      if (strcmp (value, wait_names[i]) == 0) {
+        shm_config.wait.mode = i;
+        return true;
+      }
+    }
+    return false;
+  }
+  else if (strcmp (key, "shm_spin_us") == 0) {
+    char* end;
+    unsigned long us = strtoul (value, &end, 0);
+
+    if (*value == '\0' || *end != '\0' || us > UINT32_MAX)
+      return false;
+    shm_config.wait.spin_us = us;
+    return true;
+  }
+  else if (strcmp (key, "shm_spin_pause") == 0)
+    return parse_bool (value, &shm_config.wait.pause);
+  else if (strcmp (key, "shm_drop_laggards") == 0)
+    return parse_bool (value, &shm_config.drop_laggards);
+  else if (strcmp (key, "shm_hugetlbfs_dir") == 0) {
+    shm_config.hugetlbfs_dir = xstrdup (value);
+    return true;
+  }
+  return false;
+}
+
+
+bool shm_seg_parse_option (const char* option)
+{
+  char key[64];
+  const char* eq = strchr (option, '=');
+
+  if (eq == NULL || eq - option >= sizeof (key))
+    return false;
+  memcpy (key, option, eq - option);
+  key[eq - option] = '\0';
+  return shm_seg_set_option (key, eq + 1);
+}
+
+
+// /////////////////////////////////////////////////////////
+// B A C K E N D S
+// /////////////////////////////////////////////////////////
+
+// Create or attach the System V segment keyed by KEY_PATH.
+static int sysv_open (struct shm_segment* seg, const char* key_path, size_t size)
+{
+  struct shmid_ds ds;
+  key_t key;
+
+  if ((key = ftok (key_path, 'R')) == -1)
+    return -1;
+
+  seg->shmid = -1;
+  if (shm_config.huge_pages) {
+    seg->shmid = shmget (key, round_up (size, huge_page_size ()), 0644 | IPC_CREAT | SHM_HUGETLB);
+    if (seg->shmid == -1)
+      fprintf (main_log_fd, "\n%s - WARNING - shmem_seg - %s - no huge pages (%s), falling back to normal pages",
+               get_timestamp (), key_path, strerror (errno));
+    else
+      seg->huge = true;
+  }
+
+  if (seg->shmid == -1) {
+    seg->shmid = shmget (key, size, 0644 | IPC_CREAT);
+    // The segment already exists with a different size; adopt it as it is.
+    if (seg->shmid == -1 && errno == EINVAL)
+      seg->shmid = shmget (key, 0, 0644);
+    if (seg->shmid == -1)
+      return -1;
+  }
+
+  if (shmctl (seg->shmid, IPC_STAT, &ds) == -1)
+    return -1;
+  seg->size = ds.shm_segsz;
+
+  seg->base = shmat (seg->shmid, NULL, 0);
+  if (seg->base == (void*) -1) {
+    seg->base = NULL;
+    return -1;
+  }
+  return 0;
+}
+
+
+// Create or open the file NAME in DIR and map it shared. PAGE is the size the
+// file length must be a multiple of.
+static int file_open (struct shm_segment* seg, const char* dir, const char* name, size_t size, size_t page)
+{
+  struct stat st;
+  int fd;
+
+  snprintf (seg->path, sizeof (seg->path), "%s/%s", dir, name);
+  if ((fd = open (seg->path, O_RDWR | O_CREAT, 0644)) == -1)
+    return -1;
+
+  if (fstat (fd, &st) == -1)
+    goto fail;
+  if (st.st_size == 0) {
+    st.st_size = round_up (size, page);
+    if (ftruncate (fd, st.st_size) == -1)
+      goto fail;
+  }
+  seg->size = st.st_size;
+
+  seg->base = mmap (NULL, seg->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (seg->base == MAP_FAILED) {
+    seg->base = NULL;
+    goto fail;
+  }
+  close (fd);
+  return 0;
+
+fail:
+  close (fd);
+  return -1;
+}
+
+
+// Touch every page of the segment so later accesses don't fault. The pages are
+// written without changing their content, since a peer may already use them.
+static void prefault (struct shm_segment* seg)
+{
+  size_t page = seg->huge ? huge_page_size () : (size_t) sysconf (_SC_PAGESIZE);
+  size_t off;
+
+#ifdef MADV_POPULATE_WRITE
+  if (madvise (seg->base, seg->size, MADV_POPULATE_WRITE) == 0)
+    return;
+#endif
+  for (off = 0; off < seg->size; off += page)
+    __atomic_fetch_or ((uint8_t*) seg->base + off, 0, __ATOMIC_RELAXED);
+}
+
+
+// /////////////////////////////////////////////////////////
+// S E G M E N T S
+// /////////////////////////////////////////////////////////
+
+int shm_segment_open (struct shm_segment* seg, const char* key_path, size_t size)
+{
+  const char* name = strrchr (key_path, '/') ? strrchr (key_path, '/') + 1 : key_path;
+  int rval = -1;
+
+  memset (seg, 0, sizeof (*seg));
+  seg->shmid = -1;
+  seg->backend = shm_config.backend;
+  if (shm_config.size != 0)
+    size = shm_config.size;
+
+  switch (seg->backend) {
+    case SHM_BACKEND_HUGETLBFS:
+      rval = file_open (seg, shm_config.hugetlbfs_dir, name, size, huge_page_size ());
+      if (rval == 0) {
+        seg->huge = true;
+        break;
+      }
+      fprintf (main_log_fd, "\n%s - WARNING - shmem_seg - %s - hugetlbfs unusable (%s), falling back to %s",
+               get_timestamp (), seg->path, strerror (errno), SHM_POSIX_DIR);
+      seg->backend = SHM_BACKEND_POSIX;
+      // fall through
+    case SHM_BACKEND_POSIX:
+      rval = file_open (seg, SHM_POSIX_DIR, name, size, sysconf (_SC_PAGESIZE));
+      break;
+
+    default:
+      rval = sysv_open (seg, key_path, size);
+      break;
+  }
+  if (rval == -1)
+    return -1;
+
+  if (shm_config.prefault)
+    prefault (seg);
+
+  if (shm_config.lock) {
+    if (mlock (seg->base, seg->size) == 0)
+      seg->locked = true;
+    else
+      fprintf (main_log_fd, "\n%s - WARNING - shmem_seg - %s - mlock failed (%s), segment stays pageable",
+               get_timestamp (), key_path, strerror (errno));
+  }
+
+  fprintf (main_log_fd, "\n%s - INFO - shmem_seg - %s - backend:%s, size:%zu, huge pages:%d, prefaulted:%d, locked:%d",
+           get_timestamp (), key_path, backend_names[seg->backend], seg->size, seg->huge,
+           shm_config.prefault, seg->locked);
+  return 0;
+}
+
+
+int shm_segment_close (struct shm_segment* seg, bool destroy)
+{
+  int rval = 0;
+
+  if (seg->base == NULL)
+    return 0;
+
+  if (seg->locked)
+    munlock (seg->base, seg->size);
+
+  if (seg->backend == SHM_BACKEND_SYSV) {
+    rval = shmdt (seg->base);
+    if (destroy)
+      shmctl (seg->shmid, IPC_RMID, 0);
+  }
+  else {
+    rval = munmap (seg->base, seg->size);
+    if (destroy)
+      unlink (seg->path);
+  }
+
+  seg->base = NULL;
+  return rval;
+}
+
+
+uint32_t shm_segment_slot_size (uint32_t default_size)
+{
+  return shm_config.slot_size != 0 ? shm_config.slot_size : default_size;
+}
@@ -7,12 +7,17 @@
  *          producer process on the same machine as isc.
  *          This module connects the Inter SoC Communication (ISC) system to the producer 
  *          process via shared memory. 
+ *          Several producer processes may feed the same ring; each one claims its
+ *          slots atomically and the xmit thread forwards them in the order they
+ *          were claimed.
+ *          The xmit thread drains every chunk ready at once, up to xmit_batch chunks
+ *          or xmit_batch_bytes bytes, and hands them to the socket module in one
+ *          ipc_xmitv call.
 */
 
 #include <string.h>
 #include <sys/wait.h>
 #include <sys/ipc.h>
-#include <sys/sem.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <stdio.h>
@@ -39,14 +44,26 @@ FILE *log_fd = NULL;
 // P r o d u c e r
 ///////////////////////////////////////////////////////////////////////////////////
 
-// Shared Memory Key and Binary Semaphore
-static key_t prod_semkey;
-static int prod_semid;
-static key_t prod_shmkey;
-static int prod_shmid;
-static char *prod_shm;
+// Shared Memory segment and the slot ring inside it
+static struct shm_segment prod_seg;
+static struct shm_ring prod_ring;
 static bool stop;
 
+// Serializes reading the ring with ipc_release, which the socket module may call
+// from its own thread
+static pthread_mutex_t prod_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Upper bound of xmit_batch; the kernel takes no more iovecs per call (UIO_MAXIOV).
+#define XMIT_BATCH_MAX 1024
+
+// Most chunks and bytes forwarded in one batch (options xmit_batch, xmit_batch_bytes).
+// The byte limit may be overshot by the last chunk taken.
+static uint32_t xmit_batch = 32;
+static uint32_t xmit_batch_bytes = 64 * 1024;
+
+// The chunks of the batch being forwarded
+static struct iovec xmit_iov[XMIT_BATCH_MAX];
+
 
 // Xmitter process thread ID
 static pthread_t XmitProcID;
@@ -61,9 +78,13 @@ static void xmitProc(); // In Listen mode, handles new connections and inbound d
 // Callback function to feed data to the next chain in pipeline
 int32_t (*xmitCallbackFunction)(uint8_t *buf, int32_t bufSize);
 
+// The socket module on the other side of this one; batches go to its xmitv.
+static struct ipc_module* peer;
+
 
 // Interface function as a constructor
-void ipc_init (void (*ipc_rec)(unsigned char *buf, int bufSize), void (*ipc_xmit)(uint8_t *buf, int32_t bufSize))
+void ipc_init (void (*ipc_rec)(uint8_t *buf, int32_t bufSize), void (*ipc_xmit)(uint8_t *buf, int32_t bufSize),
+               struct ipc_module* ipc_peer)
 {
   if (verbose)
     printf("\nshmem_xmit - ipc_init\n");
@@ -81,6 +102,7 @@ void ipc_init (void (*ipc_rec)(unsigned char *buf, int bufSize), void (*ipc_xmit
     xmitCallbackFunction = ipc_xmit;
   else
     system_error ("shmem_xmit - xmitCallbackFunction is NULL");
+  peer = ipc_peer;
 
   stop = false;
   XmitProcActive = false;
@@ -89,30 +111,9 @@ void ipc_init (void (*ipc_rec)(unsigned char *buf, int bufSize), void (*ipc_xmit
 // P r o d u c e r
 /////////////////////////////////////////
 
-  // Get unique key for xmit shared memory
-  if ((prod_shmkey = ftok("/tmp/prod_shmem_key", 'R')) == -1) // Here the file must exist 
-    system_error ("shmem_xmit - prod_shmkey ftok");
-
-  // Create the segment
-  if ((prod_shmid = shmget(prod_shmkey, PROD_SHM_SIZE, 0644 | IPC_CREAT)) == -1)
-    system_error ("shmem_xmit - prod_shmid shmget");
-
-  // Attach to the segment to get a pointer to it
-  prod_shm = shmat(prod_shmid, (void *)0, 0);
-  if (prod_shm == (char *)(-1))
-    system_error ("shmem_xmit - prod_shm shmat");
-
-  // Get unique key for xmit semaphore
-  if ((prod_semkey = ftok("/tmp/prod_sem_key", 'R')) == (key_t) -1)
-    system_error ("shmem_xmit - prod_semkey ftok");
-
-  // Allocate xmit semaphore
-  if ((prod_semid = binary_semaphore_allocation (prod_semkey, 0644 | IPC_CREAT)) == -1 )
-    system_error ("shmem_xmit - prod_semid binary_semaphore_allocation");
-
-  // Init xmit semaphore
-  if (binary_semaphore_initialize (prod_semid) == -1 )
-    system_error ("shmem_xmit - xmit binary_semaphore_initialize");
+  // Create or attach the segment and the slot ring inside it
+  if (shm_ring_open (&prod_ring, &prod_seg, "/tmp/prod_shmem_key", PROD_RING_SLOTS, SHM_SLOT_SIZE) == -1) // Here the file must exist 
+    system_error ("shmem_xmit - prod_ring shm_ring_open");
 }
 
 
@@ -126,15 +127,9 @@ void ipc_cleanup ()
 /////////////////////////////////////////
 // P r o d u c e r
 /////////////////////////////////////////
-  if (binary_semaphore_deallocate(prod_semid) == -1)
-    system_error ("shmem_xmit - ipc_cleanup - prod binary_semaphore_deallocate");
-
-  // Detach from the xmit shared memory segment
-  if (shmdt(prod_shm) == -1)
-    system_error ("shmem_xmit - ipc_cleanup - prod shmdt");
-
-  // Deallocate the xmit shared memory segment
-  shmctl (prod_shmid, IPC_RMID, 0); 
+  // Detach from and deallocate the xmit shared memory segment
+  if (shm_segment_close(&prod_seg, true) == -1)
+    system_error ("shmem_xmit - ipc_cleanup - prod shm_segment_close");
 
   // All done. Close the main log file.
   if (log_fd)
@@ -150,6 +145,14 @@ uint32_t ipc_xmit (uint8_t *buf, int32_t bufSize)
 }
 
 
+// Interface function to xmit a batch of chunks
+uint32_t ipc_xmitv (const struct iovec *iov, int32_t iovCnt)
+{
+  system_error ("shmem_xmit - ipc_xmitv - Not implemented");
+  return 0;
+}
+
+
 // Interface function to receive data
 void ipc_rec (uint8_t *buf, int32_t bufSize)
 {
@@ -157,6 +160,40 @@ void ipc_rec (uint8_t *buf, int32_t bufSize)
 }
 
 
+// Interface function to lend a buffer; this module doesn't lend buffers.
+uint8_t* ipc_acquire (int32_t *bufSize)
+{
+  return NULL;
+}
+
+
+// Interface function to report the chunks this module can take; it has no flow control.
+int32_t ipc_credits ()
+{
+  return -1;
+}
+
+
+// Interface function to commit an acquired buffer
+void ipc_commit (uint8_t *buf, int32_t bufSize)
+{
+  system_error ("shmem_xmit - ipc_commit - Not implemented");
+}
+
+
+// Interface function to release a slot passed on through xmit; the slot goes back
+// to the producer. Slots must come back in the order they were sent.
+void ipc_release (uint8_t *buf)
+{
+  pthread_mutex_lock(&prod_lock);
+  if (buf != shm_ring_oldest(&prod_ring))
+    fprintf(main_log_fd, "\n%s - ERROR - shmem_xmit - ipc_release - slot released out of order", get_timestamp());
+  else
+    shm_ring_release(&prod_ring);
+  pthread_mutex_unlock(&prod_lock);
+}
+
+
 // Interface function to request stopping the thread
 void ipc_stop()
 {
@@ -164,6 +201,9 @@ void ipc_stop()
     printf("\nshmem_xmit - ipc_stop");
   fprintf(main_log_fd, "\n%s - INFO - shmem_xmit - ipc_stop", get_timestamp());
   stop = true;
+
+  // Kick the xmit thread out of its sleep on the ring
+  shm_notify_post(&prod_ring.hdr->data_ready);
 }
 
 
@@ -176,6 +216,35 @@ bool ipc_set_param(const char* prtcl, const char *addr, int port)
 }
 
 
+// Interface function to set a named configuration option
+bool ipc_set_option(const char* key, const char* value)
+{
+  char *end;
+  unsigned long n;
+
+  if (verbose)
+    printf("\nshmem_xmit - ipc_set_option");
+
+  if (strcmp(key, "xmit_batch") == 0 || strcmp(key, "xmit_batch_bytes") == 0) {
+    n = strtoul(value, &end, 0);
+    if (*value == '\0' || *end != '\0' || n == 0)
+      return false;
+    if (strcmp(key, "xmit_batch") == 0) {
+      if (n > XMIT_BATCH_MAX)
+        return false;
+      xmit_batch = n;
+    }
+    else if (n <= UINT32_MAX)
+      xmit_batch_bytes = n;
+    else
+      return false;
+    return true;
+  }
+  // Everything else configures the shared memory segment.
+  return shm_seg_set_option(key, value);
+}
+
+
 // Interface function to start the thread 
 bool ipc_start()
 {
@@ -241,38 +310,57 @@ void xmitProc()
 {
   if (verbose)
     printf("\nshmem_xmit - xmitProc starts");
-  int s = 0, i;
+  int s = 0, i, n;
+  uint8_t *slot;
+  uint32_t len, bytes;
 
   while (!stop) {
-//    printf("\nshmem:ipc_xmit:xmit semaphore wait...\n");
-    s = binary_semaphore_wait(prod_semid);
-    // Check what happened
-    if (s == -1) {
-      if (errno == ETIMEDOUT) {
-        printf("\nshmem_xmit - ipc_xmit: sem_timedwait() timed out\n");
-        fprintf (main_log_fd, "\n%s - WARNING - shmem_xmit - sem_timedwait() timed out", get_timestamp());
-      }
-      else
-        ;//perror("sem_timedwait");
-    } 
-    else {
+    // Lease every chunk the producer has published so far, up to a batch
+    n = 0;
+    bytes = 0;
+    while (!stop && n < xmit_batch && bytes < xmit_batch_bytes) {
+      pthread_mutex_lock(&prod_lock);
+      slot = shm_ring_read(&prod_ring, &len);
+      pthread_mutex_unlock(&prod_lock);
+      if (slot == NULL)
+        break;
       if (verbose)
         printf("\nshmem_xmit - ipc_xmit");
 
       fprintf(log_fd, "\n%s - INFO - shmem_xmit - ", get_timestamp());
 
 #if 1
-//    printf("Shared memory contains: \"%s\"\n", prod_shm);
-      for (i = 0; i < PROD_TEST_REGION_SIZE; i++) {
-        fprintf(log_fd, "0x%X,", prod_shm[i] & 0x000000FF);
+      for (i = 0; i < len; i++) {
+        fprintf(log_fd, "0x%X,", slot[i] & 0x000000FF);
       }
 #endif
-      
-      // Callback the next node in the pipeline chain
-      int32_t s = xmitCallbackFunction(prod_shm, PROD_TEST_REGION_SIZE);
-      if (s != PROD_TEST_REGION_SIZE)
+
+      xmit_iov[n].iov_base = slot;
+      xmit_iov[n].iov_len = len;
+      n++;
+      bytes += len;
+    }
+
+    if (n > 0) {
+      // Callback the next node in the pipeline chain. It sends straight from the
+      // slots and hands them back through ipc_release once it is done with them.
+      if (n == 1 || peer == NULL) {
+        for (i = 0; i < n; i++)
+          if (xmitCallbackFunction(xmit_iov[i].iov_base, xmit_iov[i].iov_len) != xmit_iov[i].iov_len)
+            printf ("\nshmem_xmit - Failed to write to the xmitter.");
+      }
+      else if ((*peer->xmitv_function) (xmit_iov, n) != bytes)
         printf ("\nshmem_xmit - Failed to write to the xmitter.");
+      // The ring may hold more; drain it before waiting.
+      continue;
+    }
 
+    // The ring is empty; spin or sleep, as shm_wait says, until the producer publishes more
+    s = shm_ring_await_data(&prod_ring, SHM_WAIT_TIMEOUT);
+    // Check what happened
+    if (s == -1) {
+      printf("\nshmem_xmit - ipc_xmit: shm_ring_await_data() failed\n");
+      fprintf (main_log_fd, "\n%s - WARNING - shmem_xmit - shm_ring_await_data() failed: %s", get_timestamp(), strerror(errno));
     }
   }
   if (verbose)
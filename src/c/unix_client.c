@@ -0,0 +1,607 @@
+/**
+ * @file   unix_client.c
+ * @author Armin Zare Zadeh ali.a.zarezadeh@gmail.com
+ * @date   16 October 2026
+ * @version 0.1
+ * @brief   The unix_client.so module sends the chunks of the producer to a
+ *          unix_server on the same host (isc -t unix), over a Unix domain socket of
+ *          type SOCK_SEQPACKET instead of the TCP loopback of sckt_client.so.
+ *          - Every message is one packet: its frame header (see struct
+ *            isc_frame_hdr) and the chunk, gathered straight from the slot of the
+ *            producer. The packets of a batch leave with one sendmmsg.
+ *          - Right after connecting, the client hands the server a buffer they then
+ *            share: a sealed memfd, passed with SCM_RIGHTS. A chunk of at least
+ *            unix_shared_min bytes is copied into that buffer, and its packet only
+ *            says where it is (see struct isc_shared_ref), so the kernel doesn't
+ *            copy it twice. The server moves the head of the buffer on as it hands
+ *            the messages on; while there is no room, chunks go inline.
+ *          - The socket blocks while the server is behind, which throttles the
+ *            producer; the client thread only watches for the server going away.
+ *          The slots of the producer go back to it once their batch is sent.
+ */
+
+#define _GNU_SOURCE   // sendmmsg, memfd_create, pthread_setname_np
+
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "isc.h"
+
+
+
+/***********************************************************************************
+ * C o n s t a n t s ,   v a r i a b l e s ,  f u n c t i o n s
+************************************************************************************/
+
+// How long the client thread sleeps at most, in milliseconds, so that stop requests
+// are noticed, and how long a send blocks at a time before the connection is checked
+// again
+#define POLL_TIMEOUT 100
+#define SEND_TIMEOUT_US 100000
+
+// Most packets sent with one sendmmsg
+#define UNIX_BATCH 32
+
+// The file to which to append the log string.
+static const char* log_filename = "unix_client.log";
+static FILE *log_fd = NULL;
+
+
+// Client Thread Name
+static const char *threadNameClient = "UnixClient";
+
+// Flag to indicate whether client is connected,
+// or if it is already connected, should continue
+static bool Connected;
+
+// Port number naming the socket, and the socket path (unix_path) if it has one
+static int ConnPort;
+static char *unixPath;
+
+// Client process ID
+static pthread_t ClientProcID;
+static bool ClientProcActive;
+
+// Thread routines
+static void *unixClientThread(void *pArg);
+static void unixClientProc();
+
+
+// Callback function to feed data to the next chain in pipeline
+void (*recCallbackFunctionType)(uint8_t *buf, int32_t bufSize);
+
+// The shared memory module on the other side of this one
+static struct ipc_module* peer;
+
+// The socket and everything below are guarded by txLock.
+static pthread_mutex_t txLock = PTHREAD_MUTEX_INITIALIZER;
+static int sockfd = -1;
+// Sequence number of the next message on the connection
+static uint64_t txSeq;
+
+// The buffer shared with the server (unix_shared_bytes of data, none if 0), and the
+// size from which chunks go through it (unix_shared_min). shPos is where the next
+// chunk goes, counting on from the start of the connection; the server has handed
+// on everything before the head.
+static size_t shSize = 4 * 1024 * 1024;
+static uint32_t shMin = 32 * 1024;
+static uint8_t *shMem;
+static uint64_t shPos;
+
+// The packets of a batch: the frame header and the chunk, or where it is in the
+// shared buffer.
+static struct isc_frame_hdr txHdr[UNIX_BATCH];
+static struct isc_shared_ref txRef[UNIX_BATCH];
+static struct iovec txIov[UNIX_BATCH][2];
+static struct mmsghdr txMsg[UNIX_BATCH];
+
+// Messages and bytes sent (of them through the shared buffer), sendmmsg calls,
+// chunks sent inline because the shared buffer was full, and messages dropped
+static uint64_t txFrames;
+static uint64_t txBytes;
+static uint64_t txShared;
+static uint64_t txCalls;
+static uint64_t txSharedFull;
+static uint64_t txDropped;
+
+
+// Interface function as a constructor
+void ipc_init (void (*ipc_rec)(uint8_t *buf, int32_t bufSize), void (*ipc_xmit)(uint8_t *buf, int32_t bufSize),
+               struct ipc_module* ipc_peer)
+{
+  if (verbose)
+    printf("\nunix_client - ipc_init\n");
+  fprintf(main_log_fd, "\n%s - INFO - unix_client - ipc_init", get_timestamp());
+
+  // Open the ipc log file for writing. If it exists, append to it;
+  // otherwise, create a new file.
+  log_fd = fopen (log_filename, "w");
+  if (log_fd == NULL) {
+    fprintf (stderr, "error: (%s) %s\n", "log_fd", strerror (errno));
+  }
+
+  recCallbackFunctionType = ipc_rec;
+  peer = ipc_peer;
+  Connected = false;
+
+  txFrames = txBytes = txShared = txCalls = txSharedFull = txDropped = 0;
+
+  ClientProcActive = false;
+}
+
+
+// Interface function as a destructor
+void ipc_cleanup ()
+{
+  if (verbose)
+    printf("\nunix_client - ipc_cleanup\n");
+  fprintf(main_log_fd, "\n%s - INFO - unix_client - ipc_cleanup", get_timestamp());
+  fprintf(main_log_fd, "\n%s - INFO - unix_client - %llu messages, %llu bytes in %llu sendmmsg calls, %llu through the shared buffer",
+          get_timestamp(), (unsigned long long) txFrames, (unsigned long long) txBytes,
+          (unsigned long long) txCalls, (unsigned long long) txShared);
+  fprintf(main_log_fd, "\n%s - INFO - unix_client - %llu chunks inline as the shared buffer was full, %llu messages dropped",
+          get_timestamp(), (unsigned long long) txSharedFull, (unsigned long long) txDropped);
+
+  free(unixPath);
+  unixPath = NULL;
+
+  // All done. Close the main log file.
+  if (log_fd)
+    fclose ((FILE*) log_fd);
+}
+
+
+// Interface function to request stopping the thread
+void ipc_stop()
+{
+  if (verbose)
+    printf("\nunix_client - ipc_stop\n");
+  fprintf(main_log_fd, "\n%s - INFO - unix_client - ipc_stop", get_timestamp());
+
+  Connected = false;
+}
+
+
+// Interface function to set configuration parameters. The packets arrive whole and
+// in order, as over tcp; the port names the socket unless unix_path does.
+bool ipc_set_param(const char* prtcl, const char *addr, int port)
+{
+  bool rval = true;
+
+  if (verbose)
+    printf("\nunix_client - ipc_set_param\n");
+
+  if (strcmp(prtcl, "tcp") != 0)
+    rval = false;
+
+  if (rval) {
+    ConnPort = port;
+    fprintf(main_log_fd, "\n%s - INFO - unix_client - ipc_set_param - Protocol:%s, SocketType:SOCK_SEQPACKET, PORT:%d.", get_timestamp(), prtcl, ConnPort);
+  }
+  else
+    fprintf(main_log_fd, "\n%s - ERROR - unix_client - ipc_set_param - Protocol:%s not supported, PORT:%d.", get_timestamp(), prtcl, port);
+  return (rval);
+}
+
+
+// Interface function to set a named configuration option
+bool ipc_set_option(const char* key, const char* value)
+{
+  char *end;
+  unsigned long n;
+
+  if (verbose)
+    printf("\nunix_client - ipc_set_option\n");
+
+  if (strcmp(key, "unix_path") == 0) {
+    if (*value == '\0' || strlen(value) >= sizeof(((struct sockaddr_un *) 0)->sun_path))
+      return false;
+    free(unixPath);
+    unixPath = strdup(value);
+    return true;
+  }
+
+  n = strtoul(value, &end, 0);
+  if (*value == '\0' || *end != '\0')
+    return false;
+  if (strcmp(key, "unix_shared_bytes") == 0) {
+    // Room for at least the largest message, or no shared buffer at all
+    if ((n != 0 && n < ISC_FRAME_MAX) || n > 1UL << 30)
+      return false;
+    shSize = n;
+    return true;
+  }
+  if (strcmp(key, "unix_shared_min") == 0) {
+    if (n > ISC_FRAME_MAX)
+      return false;
+    shMin = n;
+    return true;
+  }
+  return false;
+}
+
+
+// Interface function to start the thread
+bool ipc_start()
+{
+  if (verbose)
+    printf("\nunix_client - ipc_start\n");
+  fprintf(main_log_fd, "\n%s - INFO - unix_client - ipc_start", get_timestamp());
+  bool rval = false;
+
+
+  // ////////////////////////////////
+  // Create the thread
+  pthread_attr_t thread_attribs;
+  pthread_attr_init(&thread_attribs);
+  pthread_attr_setscope(&thread_attribs, PTHREAD_SCOPE_SYSTEM);
+  pthread_attr_setstacksize(&thread_attribs, 65536);
+
+  if (pthread_create(&ClientProcID, &thread_attribs, unixClientThread, NULL)) {
+    Connected = false;
+    system_error("unix_client - error creating client thread, aborting");
+  }
+  else {
+    pthread_setname_np(ClientProcID, threadNameClient);
+    while(!__atomic_load_n(&ClientProcActive, __ATOMIC_ACQUIRE)) { usleep(100); } // wait for the thread to come up
+    rval = true;
+  }
+
+  pthread_attr_destroy(&thread_attribs);
+
+  return (rval);
+}
+
+
+// Interface function to join the thread
+bool ipc_wait4Done()
+{
+  if (verbose)
+    printf("\nunix_client - ipc_wait4Done\n");
+
+  // Make sure the client thread has finished.
+  if (pthread_join(ClientProcID, NULL) != 0) return false;
+
+  fprintf(main_log_fd, "\n%s - INFO - unix_client - wait4Done - ClientProc exited", get_timestamp());
+
+  return true;
+}
+
+
+// Unix socket client main thread
+void *unixClientThread(void *pArg)
+{
+  if (verbose)
+    printf("\nunix_client - unixClientThread - clientproc started\n");
+  fprintf(main_log_fd, "\n%s - INFO - unix_client - clientproc started", get_timestamp());
+
+  // The flag stays set once the thread is up: a failing connect returns at once, and
+  // ipc_start must not miss that the thread came up.
+  __atomic_store_n(&ClientProcActive, true, __ATOMIC_RELEASE);
+  unixClientProc();
+
+  fprintf(main_log_fd, "\n%s - INFO - unix_client - clientproc exited", get_timestamp());
+  return NULL;
+}
+
+
+// Fill ADDR with the address of the server: unix_path, or else the abstract name
+// isc.PORT. Returns the length of the address.
+static socklen_t unixAddress(struct sockaddr_un *addr)
+{
+  memset(addr, 0, sizeof(*addr));
+  addr->sun_family = AF_UNIX;
+  if (unixPath != NULL) {
+    strcpy(addr->sun_path, unixPath);
+    return sizeof(*addr);
+  }
+  snprintf(addr->sun_path + 1, sizeof(addr->sun_path) - 1, "isc.%d", ConnPort);
+  return offsetof(struct sockaddr_un, sun_path) + 1 + strlen(addr->sun_path + 1);
+}
+
+
+// Set up the buffer to share with the server and hand it over on the connection.
+// The size is sealed, so the server may rely on it. Without it, every chunk goes
+// inline; that is no failure.
+static void unixShare()
+{
+  struct isc_frame_hdr hdr;
+  struct msghdr msg;
+  struct iovec iov;
+  struct cmsghdr *cm;
+  uint8_t ctrl[CMSG_SPACE(sizeof(int))];
+  void *mem = MAP_FAILED;
+  int fd;
+
+  shMem = NULL;
+  shPos = 0;
+  if (shSize == 0)
+    return;
+
+  fd = memfd_create("isc_unix", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+  if (fd == -1 || ftruncate(fd, ISC_SHARED_DATA + shSize) == -1 ||
+      fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) == -1 ||
+      (mem = mmap(NULL, ISC_SHARED_DATA + shSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED) {
+    fprintf(main_log_fd, "\n%s - WARNING - unix_client - no shared buffer: %s", get_timestamp(), strerror(errno));
+    if (fd != -1)
+      close(fd);
+    return;
+  }
+
+  isc_frame_encode(&hdr, 0, ISC_CHANNEL_CONTROL, ISC_FLAG_SHARED, 0);
+  iov.iov_base = &hdr;
+  iov.iov_len = ISC_FRAME_HDR_SIZE;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = ctrl;
+  msg.msg_controllen = sizeof(ctrl);
+  cm = CMSG_FIRSTHDR(&msg);
+  cm->cmsg_level = SOL_SOCKET;
+  cm->cmsg_type = SCM_RIGHTS;
+  cm->cmsg_len = CMSG_LEN(sizeof(int));
+  memcpy(CMSG_DATA(cm), &fd, sizeof(int));
+  if (sendmsg(sockfd, &msg, MSG_NOSIGNAL) == -1) {
+    fprintf(main_log_fd, "\n%s - WARNING - unix_client - shared buffer not handed over: %s", get_timestamp(), strerror(errno));
+    munmap(mem, ISC_SHARED_DATA + shSize);
+  }
+  else {
+    shMem = (uint8_t *) mem;
+    ((struct isc_shared_hdr *) shMem)->head = 0;
+    fprintf(main_log_fd, "\n%s - INFO - unix_client - sharing a buffer of %zu bytes", get_timestamp(), shSize);
+  }
+  // The server holds its own reference now.
+  close(fd);
+}
+
+
+// Unix socket client main thread process
+void unixClientProc()
+{
+  struct sockaddr_un addr;
+  socklen_t addrLen = unixAddress(&addr);
+  struct timeval tv = { 0, SEND_TIMEOUT_US };
+  struct pollfd pfd;
+  int fd;
+
+  if (verbose)
+    printf("\nunix_client - unixClientProc starts");
+
+  fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+  if (fd == -1 || connect(fd, (struct sockaddr *) &addr, addrLen) == -1) {
+    printf ("\nunix_client - ERROR - connect did not go through!");
+    fprintf(main_log_fd, "\n%s - ERROR - unix_client - connect to %s%s did not go through: %s", get_timestamp(),
+            unixPath != NULL ? "" : "@", unixPath != NULL ? unixPath : addr.sun_path + 1, strerror(errno));
+    if (fd != -1)
+      close(fd);
+    return;
+  }
+  // A send blocks while the server is behind, but not for good.
+  setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+  pthread_mutex_lock(&txLock);
+  sockfd = fd;
+  txSeq = 0;
+  unixShare();
+  Connected = true;
+  pthread_mutex_unlock(&txLock);
+
+  if (verbose)
+    printf("\nunix_client - connected");
+  fprintf(main_log_fd, "\n%s - INFO - unix_client - connected", get_timestamp());
+
+  pfd.fd = fd;
+  pfd.events = POLLRDHUP;
+  while (Connected) {
+    if (poll(&pfd, 1, POLL_TIMEOUT) > 0 && (pfd.revents & (POLLRDHUP | POLLHUP | POLLERR))) {
+      Connected = false;
+      if (verbose)
+        printf("\nunix_client - remote connection went away");
+      fprintf(main_log_fd, "\n%s - INFO - unix_client - remote connection went away", get_timestamp());
+    }
+  }
+
+  // Wait for a send under way, then tear the connection down.
+  pthread_mutex_lock(&txLock);
+  Connected = false;
+  close(sockfd);
+  sockfd = -1;
+  if (shMem != NULL)
+    munmap(shMem, ISC_SHARED_DATA + shSize);
+  shMem = NULL;
+  pthread_mutex_unlock(&txLock);
+
+  fprintf(main_log_fd, "\n%s - INFO - unix_client - Client exiting", get_timestamp());
+  if (verbose)
+    printf("\nunix_client - unixClientProc exiting");
+}
+
+
+// Copy the chunk of LEN bytes at BUF into the shared buffer if there is room, with
+// txLock held, and describe where it went in REF. A chunk never wraps around the
+// end of the buffer: it starts over at the beginning instead.
+static bool unixSharePut(const void *buf, uint32_t len, struct isc_shared_ref *ref)
+{
+  uint64_t pos = shPos, head;
+
+  if (pos % shSize + len > shSize)
+    pos += shSize - pos % shSize;
+  head = __atomic_load_n(&((struct isc_shared_hdr *) shMem)->head, __ATOMIC_ACQUIRE);
+  if (pos + len - head > shSize) {
+    txSharedFull++;
+    return false;
+  }
+  memcpy(shMem + ISC_SHARED_DATA + pos % shSize, buf, len);
+  ref->pos = htobe64(pos);
+  ref->len = htobe32(len);
+  ref->reserved = 0;
+  shPos = pos + len;
+  return true;
+}
+
+
+// Send the first K packets of the batch, with txLock held. A send timing out just
+// has the connection checked; a failing one takes it down and drops the rest.
+static void unixSendBatch(int k)
+{
+  int sent = 0, n;
+
+  while (sent < k && Connected) {
+    if ( (n = sendmmsg(sockfd, txMsg + sent, k - sent, MSG_NOSIGNAL)) < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+        continue;
+      fprintf(main_log_fd, "\n%s - ERROR - unix_client - socket send error: %s", get_timestamp(), strerror(errno));
+      Connected = false;
+      break;
+    }
+    txCalls++;
+    sent += n;
+  }
+  txDropped += k - sent;
+}
+
+
+// Interface function to xmit a batch of chunks, each as one framed message. Large
+// chunks are copied into the shared buffer, the others are sent from the slots of
+// the peer; up to UNIX_BATCH packets leave with one sendmmsg.
+uint32_t ipc_xmitv (const struct iovec *iov, int32_t iovCnt)
+{
+  size_t total = 0, pending = 0;
+  int32_t i, j, k = 0;
+  uint64_t frames = 0;
+
+  if (verbose)
+    printf("\nunix_client - ipc_xmitv\n");
+  fprintf(main_log_fd, "\n%s - INFO - unix_client - ipc_xmitv - %d chunks", get_timestamp(), iovCnt);
+
+  pthread_mutex_lock(&txLock);
+  if (!Connected) {
+    pthread_mutex_unlock(&txLock);
+    if (verbose)
+      printf("\nunix_client - ipc_xmitv Client Not Connected!\n");
+    fprintf(main_log_fd, "\n%s - INFO - unix_client - ipc_xmitv - Client Not Connected!", get_timestamp());
+    // The chunks are dropped; hand their buffers back all the same.
+    if (peer != NULL)
+      for (i = 0; i < iovCnt; i++)
+        (*peer->release_function) (iov[i].iov_base);
+    return 0;
+  }
+
+  for (i = 0; i < iovCnt; i++) {
+    // Dumping the chunk byte by byte costs more than sending it; only with -v.
+    if (verbose) {
+      fprintf(log_fd, "\n%s - INFO - unix_client - ", get_timestamp());
+      for (j = 0; j < iov[i].iov_len; j++)
+        fprintf(log_fd, "0x%X,", ((uint8_t *) iov[i].iov_base)[j] & 0x000000FF);
+    }
+
+    // An empty packet would read as the end of the connection, and one larger than
+    // a frame can't be taken.
+    if (iov[i].iov_len == 0)
+      continue;
+    if (iov[i].iov_len > ISC_FRAME_MAX) {
+      if (txDropped++ == 0)
+        fprintf(main_log_fd, "\n%s - WARNING - unix_client - message larger than a frame dropped", get_timestamp());
+      continue;
+    }
+
+    txIov[k][0].iov_base = &txHdr[k];
+    txIov[k][0].iov_len = ISC_FRAME_HDR_SIZE;
+    if (shMem != NULL && iov[i].iov_len >= shMin && unixSharePut(iov[i].iov_base, iov[i].iov_len, &txRef[k])) {
+      isc_frame_encode(&txHdr[k], sizeof(txRef[k]), ISC_CHANNEL_DATA, ISC_FLAG_SHARED, txSeq++);
+      txIov[k][1].iov_base = &txRef[k];
+      txIov[k][1].iov_len = sizeof(txRef[k]);
+      txShared++;
+    }
+    else {
+      isc_frame_encode(&txHdr[k], iov[i].iov_len, ISC_CHANNEL_DATA, 0, txSeq++);
+      txIov[k][1] = iov[i];
+    }
+    memset(&txMsg[k], 0, sizeof(txMsg[k]));
+    txMsg[k].msg_hdr.msg_iov = txIov[k];
+    txMsg[k].msg_hdr.msg_iovlen = 2;
+    pending += iov[i].iov_len;
+    frames++;
+
+    if (++k == UNIX_BATCH) {
+      unixSendBatch(k);
+      k = 0;
+    }
+  }
+  if (k > 0)
+    unixSendBatch(k);
+  if (Connected) {
+    total = pending;
+    txFrames += frames;
+    txBytes += pending;
+  }
+  pthread_mutex_unlock(&txLock);
+
+  // Every chunk has been sent or copied, and the slots can be reused.
+  if (peer != NULL)
+    for (i = 0; i < iovCnt; i++)
+      (*peer->release_function) (iov[i].iov_base);
+
+  fprintf(main_log_fd, "\n%s - INFO - unix_client - sent = %zu bytes", get_timestamp(), total);
+
+  return total;
+}
+
+
+// Interface function to xmit data
+uint32_t ipc_xmit (uint8_t *buf, int32_t bufSize)
+{
+  struct iovec iov;
+
+  if (verbose)
+    printf("\nunix_client - ipc_xmit\n");
+
+  iov.iov_base = buf;
+  iov.iov_len = bufSize;
+  return ipc_xmitv(&iov, 1);
+}
+
+
+// Interface function to receive data
+void ipc_rec (uint8_t *buf, int32_t bufSize)
+{
+  system_error ("unix_client - ipc_rec - Not implemented");
+}
+
+
+// Interface function to lend a buffer; this module doesn't lend buffers.
+uint8_t* ipc_acquire (int32_t *bufSize)
+{
+  return NULL;
+}
+
+
+// Interface function to report the chunks this module can take; it has no flow control.
+int32_t ipc_credits ()
+{
+  return -1;
+}
+
+
+// Interface function to commit an acquired buffer
+void ipc_commit (uint8_t *buf, int32_t bufSize)
+{
+  system_error ("unix_client - ipc_commit - Not implemented");
+}
+
+
+// Interface function to release a buffer passed on through xmit
+void ipc_release (uint8_t *buf)
+{
+  system_error ("unix_client - ipc_release - Not implemented");
+}
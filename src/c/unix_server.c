@@ -0,0 +1,803 @@
+/**
+ * @file   unix_server.c
+ * @author Armin Zare Zadeh ali.a.zarezadeh@gmail.com
+ * @date   16 October 2026
+ * @version 0.1
+ * @brief   The unix_server.so module serves isc clients on the same host (isc -t
+ *          unix) over a Unix domain socket of type SOCK_SEQPACKET, instead of the TCP
+ *          loopback of sckt_server.so. It hands the messages on to the shared memory
+ *          module the same way.
+ *          - A packet holds exactly one message behind its frame header (see struct
+ *            isc_frame_hdr), so there is nothing to reassemble: the packets are read
+ *            in batches with recvmmsg and handed on one by one.
+ *          - A client may hand over a buffer it shares with the server, a memfd
+ *            passed with SCM_RIGHTS. Large messages then stay in that buffer and the
+ *            packet only says where (see struct isc_shared_ref); the server copies
+ *            them straight from there into the consumer ring and tells the client
+ *            how far it got through the head of the buffer.
+ *          - One thread serves all the connections with epoll. While the consumers
+ *            have no room, the connection is parked and the rest of the batch waits
+ *            with it; the client is throttled as the socket fills.
+ */
+
+#define _GNU_SOURCE   // recvmmsg, pthread_setname_np
+
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+
+#include "isc.h"
+
+
+
+/***********************************************************************************
+ * C o n s t a n t s ,   v a r i a b l e s ,  f u n c t i o n s
+************************************************************************************/
+#define LISTENQ 20
+
+static const int EPOLL_MAXEVENTS = 64;
+// How long the thread sleeps at most, in milliseconds, so that stop requests are
+// noticed, and how often connections paused by backpressure are retried
+#define EPOLL_TIMEOUT 1000
+#define BACKPRESSURE_RETRY 2
+#define MAX_PAUSED 64
+
+// Most packets read with one recvmmsg, each of a frame header and a whole message
+#define UNIX_BATCH 32
+#define PACKET_SIZE (ISC_FRAME_HDR_SIZE + ISC_FRAME_MAX)
+
+// The file to which to append the log string.
+static const char* log_filename = "unix_server.log";
+static FILE *log_fd = NULL;
+
+
+// Thread Name
+static const char *threadNameListen = "UnixListen";
+
+static bool isListening;    // ListenerProc thread is running if this is true..
+static bool ListenerProcActive;
+static pthread_t ListenerProcID;
+static int ConnPort;
+
+// Socket path (unix_path), or NULL for the abstract name isc.PORT
+static char *unixPath;
+
+
+// A client connection: the sequence number its next message should carry, and the
+// buffer it shares, if any: shSize bytes of data behind the head at shMem.
+struct unixConn {
+  uint64_t nextSeq;
+  uint8_t *shMem;
+  size_t shSize;
+};
+
+// Connections by file descriptor
+static struct unixConn **conns;
+static int connsSize;
+
+// Packets of the last recvmmsg, of which those from next on are still to be handed
+// on; they came from connection fd. A file descriptor passed with a packet waits in
+// rights until the packet is handled.
+struct unixBatch {
+  struct mmsghdr msgs[UNIX_BATCH];
+  struct iovec iov[UNIX_BATCH];
+  uint8_t ctrl[UNIX_BATCH][CMSG_SPACE(sizeof(int))];
+  int rights[UNIX_BATCH];
+  uint8_t *bufs;
+  int count;
+  int next;
+  int fd;
+};
+static struct unixBatch batch;
+
+// Connections not read from while the peer has no credits, and since when
+static int paused[MAX_PAUSED];
+static int nPaused;
+static double pausedSince;
+
+// Connections accepted, messages handed on (of them from a shared buffer), sequence
+// gaps, connections dropped as out of step, packets read, recvmmsg calls, and how
+// often and for how long in total (seconds) backpressure held the connections
+static uint64_t accepted;
+static uint64_t framesDelivered;
+static uint64_t framesShared;
+static uint64_t seqGaps;
+static uint64_t framingErrors;
+static uint64_t packets;
+static uint64_t recvCalls;
+static uint64_t backpressureCount;
+static double backpressureTime;
+
+
+// Thread routines
+static void *unixListenerThread(void *pArg);
+static void unixListenerProc();
+
+
+// Callback function to feed data to the next chain in pipeline
+void (*recCallbackFunctionType)(uint8_t *buf, int32_t bufSize);
+
+// The shared memory module on the other side of this one
+static struct ipc_module* peer;
+
+
+// Interface function as a constructor
+void ipc_init (void (*ipc_rec)(uint8_t *buf, int32_t bufSize), void (*ipc_xmit)(uint8_t *buf, int32_t bufSize),
+               struct ipc_module* ipc_peer)
+{
+  if (verbose)
+    printf("\nunix_server - ipc_init\n");
+  fprintf(main_log_fd, "\n%s - INFO - unix_server - ipc_init", get_timestamp());
+
+  // Open the ipc log file for writing. If it exists, append to it;
+  // otherwise, create a new file.
+  log_fd = fopen (log_filename, "w");
+  if (log_fd == NULL) {
+    fprintf (stderr, "error: (%s) %s\n", "log_fd", strerror (errno));
+  }
+
+  recCallbackFunctionType = ipc_rec;
+  peer = ipc_peer;
+
+  accepted = framesDelivered = framesShared = seqGaps = framingErrors = 0;
+  packets = recvCalls = backpressureCount = 0;
+  backpressureTime = 0;
+
+  isListening = false;
+  ListenerProcActive = false;
+}
+
+
+// Interface function as a destructor
+void ipc_cleanup ()
+{
+  if (verbose)
+    printf("\nunix_server - ipc_cleanup\n");
+  fprintf(main_log_fd, "\n%s - INFO - unix_server - ipc_cleanup", get_timestamp());
+  fprintf(main_log_fd, "\n%s - INFO - unix_server - %llu connections, %llu messages handed on (%llu from shared buffers), %llu sequence gaps, %llu framing errors",
+          get_timestamp(), (unsigned long long) accepted, (unsigned long long) framesDelivered,
+          (unsigned long long) framesShared, (unsigned long long) seqGaps, (unsigned long long) framingErrors);
+  fprintf(main_log_fd, "\n%s - INFO - unix_server - %llu packets in %llu recvmmsg calls",
+          get_timestamp(), (unsigned long long) packets, (unsigned long long) recvCalls);
+  fprintf(main_log_fd, "\n%s - INFO - unix_server - backpressure engaged %llu times, %.3f s in total",
+          get_timestamp(), (unsigned long long) backpressureCount, backpressureTime);
+
+  free(unixPath);
+  unixPath = NULL;
+
+  // All done. Close the main log file.
+  if (log_fd)
+    fclose ((FILE*) log_fd);
+}
+
+
+// Interface function to request stopping the thread
+void ipc_stop()
+{
+  if (verbose)
+    printf("\nunix_server - ipc_stop\n");
+  fprintf(main_log_fd, "\n%s - INFO - unix_server - ipc_stop", get_timestamp());
+
+  isListening = false;
+}
+
+
+// Interface function to set configuration parameters. The packets arrive whole and
+// in order, as over tcp; the port names the socket unless unix_path does.
+bool ipc_set_param(const char* prtcl, const char *addr, int port)
+{
+  bool rval = true;
+
+  if (verbose)
+    printf("\nunix_server - ipc_set_param\n");
+
+  if (strcmp(prtcl, "tcp") != 0)
+    rval = false;
+
+  if (rval) {
+    ConnPort = port;
+    fprintf(main_log_fd, "\n%s - INFO - unix_server - ipc_set_param - Protocol:%s, SocketType:SOCK_SEQPACKET, PORT:%d.", get_timestamp(), prtcl, ConnPort);
+  }
+  else
+    fprintf(main_log_fd, "\n%s - ERROR - unix_server - ipc_set_param - Protocol:%s not supported, PORT:%d.", get_timestamp(), prtcl, port);
+
+  return (rval);
+}
+
+
+// Interface function to set a named configuration option
+bool ipc_set_option(const char* key, const char* value)
+{
+  if (verbose)
+    printf("\nunix_server - ipc_set_option\n");
+
+  if (strcmp(key, "unix_path") == 0) {
+    if (*value == '\0' || strlen(value) >= sizeof(((struct sockaddr_un *) 0)->sun_path))
+      return false;
+    free(unixPath);
+    unixPath = strdup(value);
+    return true;
+  }
+  return false;
+}
+
+
+// Interface function to start the thread
+bool ipc_start()
+{
+  if (verbose)
+    printf("\nunix_server - ipc_start\n");
+  fprintf(main_log_fd, "\n%s - INFO - unix_server - ipc_start", get_timestamp());
+
+
+  // ////////////////////////////////
+  // Create the thread
+  pthread_attr_t thread_attribs;
+  pthread_attr_init(&thread_attribs);
+  pthread_attr_setscope(&thread_attribs, PTHREAD_SCOPE_SYSTEM);
+  pthread_attr_setstacksize(&thread_attribs, 65536);
+
+  isListening = true;
+  if ( pthread_create(&ListenerProcID, &thread_attribs, unixListenerThread, NULL) ) {
+    isListening = false;
+    system_error("ipc_start - unix_server: error creating listener thread, aborting");
+  }
+  pthread_setname_np(ListenerProcID, threadNameListen);
+  // Wait for the thread to come up, or to give up listening
+  while (!__atomic_load_n(&ListenerProcActive, __ATOMIC_ACQUIRE) && isListening) { usleep(100); }
+
+  pthread_attr_destroy(&thread_attribs);
+
+  return (isListening);
+}
+
+
+// Interface function to join the thread
+bool ipc_wait4Done()
+{
+  if (verbose)
+    printf("\nunix_server - ipc_wait4Done\n");
+
+  // Make sure the listener thread has finished.
+  if (pthread_join(ListenerProcID, NULL) != 0) return false;
+
+  fprintf(main_log_fd, "\n%s - INFO - unix_server - wait4Done - ListenerProc exited", get_timestamp());
+
+  return true;
+}
+
+
+// Fill ADDR with the address of the socket: unix_path, or else the abstract name
+// isc.PORT. Returns the length of the address.
+static socklen_t unixAddress(struct sockaddr_un *addr)
+{
+  memset(addr, 0, sizeof(*addr));
+  addr->sun_family = AF_UNIX;
+  if (unixPath != NULL) {
+    strcpy(addr->sun_path, unixPath);
+    return sizeof(*addr);
+  }
+  // An abstract name starts with a null byte and leaves nothing behind in the file
+  // system; it is exactly as long as the address says.
+  snprintf(addr->sun_path + 1, sizeof(addr->sun_path) - 1, "isc.%d", ConnPort);
+  return offsetof(struct sockaddr_un, sun_path) + 1 + strlen(addr->sun_path + 1);
+}
+
+
+// Set up the state of the new connection SOCKFD.
+static void unixConnOpen(int sockfd)
+{
+  struct unixConn *conn;
+  int size = connsSize;
+
+  if (sockfd >= connsSize) {
+    while (size <= sockfd)
+      size = size ? 2 * size : 64;
+    conns = (struct unixConn **) xrealloc(conns, size * sizeof(conns[0]));
+    memset(conns + connsSize, 0, (size - connsSize) * sizeof(conns[0]));
+    connsSize = size;
+  }
+  conn = (struct unixConn *) xmalloc(sizeof(*conn));
+  memset(conn, 0, sizeof(*conn));
+  conns[sockfd] = conn;
+  accepted++;
+}
+
+
+// Whether SOCKFD is parked because of backpressure
+static bool unixIsPaused(int sockfd)
+{
+  int i;
+
+  for (i = 0; i < nPaused; i++) {
+    if (paused[i] == sockfd)
+      return true;
+  }
+  return false;
+}
+
+
+// Park SOCKFD until the peer has credits again and count the event.
+static void unixPause(int sockfd)
+{
+  if (unixIsPaused(sockfd))
+    return;
+  if (nPaused == MAX_PAUSED) {
+    fprintf(main_log_fd, "\n%s - ERROR - unix_server - too many connections under backpressure", get_timestamp());
+    return;
+  }
+  if (nPaused == 0)
+    pausedSince = get_monotonic_time();
+  paused[nPaused++] = sockfd;
+  backpressureCount++;
+}
+
+
+// Take SOCKFD off the parked connections.
+static void unixUnpause(int sockfd)
+{
+  int i;
+
+  for (i = 0; i < nPaused; i++) {
+    if (paused[i] == sockfd) {
+      memmove(paused + i, paused + i + 1, (--nPaused - i) * sizeof(paused[0]));
+      if (nPaused == 0)
+        backpressureTime += get_monotonic_time() - pausedSince;
+      return;
+    }
+  }
+}
+
+
+// Close the file descriptors passed with the packets of the batch not handled yet,
+// and empty it.
+static void unixBatchReset()
+{
+  int i;
+
+  for (i = 0; i < batch.count; i++) {
+    if (batch.rights[i] >= 0)
+      close(batch.rights[i]);
+    batch.rights[i] = -1;
+  }
+  batch.count = batch.next = 0;
+}
+
+
+// Close SOCKFD and drop its state, its shared buffer and what is left of its batch.
+static void unixConnClose(int sockfd)
+{
+  struct unixConn *conn = sockfd < connsSize ? conns[sockfd] : NULL;
+
+  if (batch.fd == sockfd) {
+    if (batch.next < batch.count)
+      fprintf(main_log_fd, "\n%s - WARNING - unix_server - connection closed with %d messages not handed on",
+              get_timestamp(), batch.count - batch.next);
+    unixBatchReset();
+    batch.fd = -1;
+  }
+  if (conn != NULL) {
+    if (conn->shMem != NULL)
+      munmap(conn->shMem, ISC_SHARED_DATA + conn->shSize);
+    free(conn);
+    conns[sockfd] = NULL;
+  }
+  unixUnpause(sockfd);
+  close(sockfd);
+}
+
+
+// Map the buffer FD which CONN shares. It has to be sealed, so that the client can't
+// cut it short under the server. Returns false if it can't be used.
+static bool unixShare(struct unixConn *conn, int fd)
+{
+  struct stat st;
+  int seals = fcntl(fd, F_GET_SEALS);
+  void *mem;
+
+  if (conn->shMem != NULL || seals == -1 || !(seals & F_SEAL_SHRINK) || fstat(fd, &st) == -1 ||
+      st.st_size <= ISC_SHARED_DATA + ISC_FRAME_MAX) {
+    fprintf(main_log_fd, "\n%s - ERROR - unix_server - shared buffer refused", get_timestamp());
+    return false;
+  }
+  mem = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (mem == MAP_FAILED) {
+    fprintf(main_log_fd, "\n%s - ERROR - unix_server - shared buffer not mapped: %s", get_timestamp(), strerror(errno));
+    return false;
+  }
+  conn->shMem = (uint8_t *) mem;
+  conn->shSize = st.st_size - ISC_SHARED_DATA;
+  fprintf(main_log_fd, "\n%s - INFO - unix_server - client shares a buffer of %zu bytes", get_timestamp(), conn->shSize);
+  return true;
+}
+
+
+// Hand the message of LEN bytes at BUF on to the shared memory module with
+// ipc_hand_on, then log it. Returns false, leaving the message where it is, while the
+// peer has no room for it.
+static bool unixHandOn(uint8_t *buf, uint32_t len)
+{
+  int i;
+
+  if (!ipc_hand_on(peer, recCallbackFunctionType, buf, len))
+    return false;
+
+  // The bytes of the message go to the log only with -v.
+  if (verbose) {
+    fprintf(log_fd, "\n%s - INFO - unix_server - ", get_timestamp());
+    for (i = 0; i < len; i++)
+      fprintf(log_fd, "0x%X,", buf[i] & 0x000000FF);
+  }
+
+  return true;
+}
+
+
+// Hand on packet I of the batch, LEN bytes at BUF from CONN: the message in it, or
+// the one it points to in the shared buffer, which is given back to the client once
+// handed on. Returns 0 once done with the packet, 1 if the peer has no room for the
+// message and -1 if the connection is out of step.
+static int unixPacket(struct unixConn *conn, int i, uint8_t *buf, uint32_t len)
+{
+  struct isc_frame_hdr hdr;
+  struct isc_shared_ref ref;
+  struct isc_shared_hdr *sh;
+  uint8_t *msg;
+  uint32_t msgLen;
+
+  if (len < ISC_FRAME_HDR_SIZE || (batch.msgs[i].msg_hdr.msg_flags & (MSG_TRUNC | MSG_CTRUNC)))
+    goto bad_packet;
+  isc_frame_decode(buf, &hdr);
+  if (hdr.len != len - ISC_FRAME_HDR_SIZE)
+    goto bad_packet;
+
+  if (hdr.channel == ISC_CHANNEL_CONTROL) {
+    // The client hands over its shared buffer.
+    if ((hdr.flags & ISC_FLAG_SHARED) && batch.rights[i] >= 0) {
+      if (!unixShare(conn, batch.rights[i]))
+        return -1;
+      close(batch.rights[i]);
+      batch.rights[i] = -1;
+    }
+    return 0;
+  }
+
+  msg = buf + ISC_FRAME_HDR_SIZE;
+  msgLen = hdr.len;
+  if (hdr.flags & ISC_FLAG_SHARED) {
+    if (conn->shMem == NULL || hdr.len != sizeof(ref))
+      goto bad_packet;
+    memcpy(&ref, msg, sizeof(ref));
+    ref.pos = be64toh(ref.pos);
+    ref.len = be32toh(ref.len);
+    if (ref.len > ISC_FRAME_MAX || ref.pos % conn->shSize + ref.len > conn->shSize)
+      goto bad_packet;
+    msg = conn->shMem + ISC_SHARED_DATA + ref.pos % conn->shSize;
+    msgLen = ref.len;
+  }
+  else if (hdr.len > ISC_FRAME_MAX)
+    goto bad_packet;
+
+  // An empty message has nothing to hand on.
+  if (msgLen > 0 && !unixHandOn(msg, msgLen))
+    return 1;
+
+  if (hdr.flags & ISC_FLAG_SHARED) {
+    // The client may fill that part of its buffer again.
+    sh = (struct isc_shared_hdr *) conn->shMem;
+    __atomic_store_n(&sh->head, ref.pos + ref.len, __ATOMIC_RELEASE);
+    framesShared++;
+  }
+  if (hdr.seq != conn->nextSeq) {
+    fprintf(main_log_fd, "\n%s - WARNING - unix_server - message %llu received, %llu expected",
+            get_timestamp(), (unsigned long long) hdr.seq, (unsigned long long) conn->nextSeq);
+    seqGaps++;
+  }
+  conn->nextSeq = hdr.seq + 1;
+  framesDelivered++;
+  return 0;
+
+bad_packet:
+  fprintf(main_log_fd, "\n%s - ERROR - unix_server - malformed packet of %u bytes, the connection is out of step",
+          get_timestamp(), len);
+  framingErrors++;
+  return -1;
+}
+
+
+// Take the file descriptors passed with the packets just read into the batch.
+static void unixTakeRights()
+{
+  struct cmsghdr *cm;
+  int i;
+
+  for (i = 0; i < batch.count; i++) {
+    batch.rights[i] = -1;
+    for (cm = CMSG_FIRSTHDR(&batch.msgs[i].msg_hdr); cm != NULL; cm = CMSG_NXTHDR(&batch.msgs[i].msg_hdr, cm))
+      if (cm->cmsg_level == SOL_SOCKET && cm->cmsg_type == SCM_RIGHTS && cm->cmsg_len == CMSG_LEN(sizeof(int)))
+        memcpy(&batch.rights[i], CMSG_DATA(cm), sizeof(int));
+  }
+}
+
+
+// Read the packets pending on SOCKFD, UNIX_BATCH at a time with recvmmsg, and hand
+// them on until the socket is drained. If the peer runs out of room, *PAUSED is set
+// and the packets left over wait in the batch, and the ones behind them in the
+// socket, until unixResume reads on. As long as they do, no other connection is
+// read either, and *PAUSED is set for it too. Returns 0 once the client closed the
+// connection, -1 (with EPROTO on bad framing) on error, or 1.
+static ssize_t unixReadPackets(int sockfd, bool *paused)
+{
+  struct unixConn *conn = conns[sockfd];
+  bool fresh = false;
+  int i, n, r;
+
+  *paused = false;
+  if (batch.next < batch.count && batch.fd != sockfd) {
+    *paused = true;
+    return 1;
+  }
+  batch.fd = sockfd;
+
+  for (;;) {
+    for (; batch.next < batch.count; batch.next++) {
+      // A packet of no length is the end of the connection.
+      if (batch.msgs[batch.next].msg_len == 0) {
+        unixBatchReset();
+        return 0;
+      }
+      r = unixPacket(conn, batch.next, batch.iov[batch.next].iov_base, batch.msgs[batch.next].msg_len);
+      if (r > 0) {
+        *paused = true;
+        return 1;
+      }
+      if (r < 0) {
+        unixBatchReset();
+        errno = EPROTO;
+        return -1;
+      }
+      packets++;
+    }
+    // A short batch just read drained the socket; the edge triggered epoll reports
+    // new packets. One left over from a pause doesn't tell: the events were ignored.
+    if (fresh && batch.count < UNIX_BATCH) {
+      unixBatchReset();
+      return 1;
+    }
+
+    unixBatchReset();
+    for (i = 0; i < UNIX_BATCH; i++) {
+      batch.msgs[i].msg_hdr.msg_controllen = sizeof(batch.ctrl[i]);
+      batch.msgs[i].msg_hdr.msg_flags = 0;
+    }
+    if ( (n = recvmmsg(sockfd, batch.msgs, UNIX_BATCH, MSG_DONTWAIT | MSG_CMSG_CLOEXEC, NULL)) < 0) {
+      if (errno == EINTR)
+        continue;
+      if (errno == EAGAIN || errno == EWOULDBLOCK)
+        return 1;
+      return -1;
+    }
+    recvCalls++;
+    batch.count = n;
+    unixTakeRights();
+    fresh = true;
+  }
+}
+
+
+// Read on from the parked connections while the peer has credits, each one once: the
+// credits left may still be too few for the next message of a connection, which then
+// is parked again. Connections which went away meanwhile are closed.
+static void unixResume()
+{
+  bool again;
+  ssize_t n;
+  int sockfd, turns = nPaused;
+
+  while (turns-- > 0 && nPaused > 0 && (*peer->credits_function) () != 0) {
+    sockfd = paused[0];
+    unixUnpause(sockfd);
+
+    n = unixReadPackets(sockfd, &again);
+    if (n <= 0) {
+      if (n < 0 && errno != ECONNRESET)
+        fprintf(main_log_fd, "\n%s - ERROR - unix_server - read error: %s", get_timestamp(), strerror(errno));
+      unixConnClose(sockfd);
+    }
+    else if (again)
+      unixPause(sockfd);
+  }
+}
+
+
+// Set up the receive buffers of the batch. Returns false on failure.
+static bool unixBatchOpen()
+{
+  int i;
+
+  memset(&batch, 0, sizeof(batch));
+  batch.fd = -1;
+  batch.bufs = mmap(NULL, (size_t) UNIX_BATCH * PACKET_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (batch.bufs == MAP_FAILED)
+    return false;
+  for (i = 0; i < UNIX_BATCH; i++) {
+    batch.iov[i].iov_base = batch.bufs + (size_t) i * PACKET_SIZE;
+    batch.iov[i].iov_len = PACKET_SIZE;
+    batch.msgs[i].msg_hdr.msg_iov = &batch.iov[i];
+    batch.msgs[i].msg_hdr.msg_iovlen = 1;
+    batch.msgs[i].msg_hdr.msg_control = batch.ctrl[i];
+    batch.rights[i] = -1;
+  }
+  return true;
+}
+
+
+// Unix socket listener thread
+void *unixListenerThread(void *pArg)
+{
+  if (verbose)
+    printf("\nunix_server - unixListenerThread - listenerproc started\n");
+  fprintf(main_log_fd, "\n%s - INFO - unix_server - listenerproc started", get_timestamp());
+
+  unixListenerProc();
+  isListening = false;
+  __atomic_store_n(&ListenerProcActive, false, __ATOMIC_RELEASE);
+
+  fprintf(main_log_fd, "\n%s - INFO - unix_server - listenerproc exited", get_timestamp());
+  return NULL;
+}
+
+
+// Unix socket listener thread process. The listening socket and the connections
+// share one edge triggered epoll set.
+void unixListenerProc()
+{
+  struct epoll_event ev, events[EPOLL_MAXEVENTS];
+  struct sockaddr_un addr;
+  socklen_t addrLen = unixAddress(&addr);
+  int i, listenfd, connfd, sockfd, epfd, nfds;
+  bool bp;
+  ssize_t n;
+
+  listenfd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  // A socket file left behind by an isc which didn't get to clean up
+  if (unixPath != NULL)
+    unlink(unixPath);
+  if (listenfd == -1 || bind(listenfd, (struct sockaddr *) &addr, addrLen) == -1 || listen(listenfd, LISTENQ) == -1) {
+    fprintf(main_log_fd, "\n%s - ERROR - unix_server - can't listen on %s%s: %s", get_timestamp(),
+            unixPath != NULL ? "" : "@", unixPath != NULL ? unixPath : addr.sun_path + 1, strerror(errno));
+    if (listenfd != -1)
+      close(listenfd);
+    return;
+  }
+  if ( (epfd = epoll_create1(EPOLL_CLOEXEC)) == -1 || !unixBatchOpen()) {
+    fprintf(main_log_fd, "\n%s - ERROR - unix_server - can't set up: %s", get_timestamp(), strerror(errno));
+    if (epfd != -1)
+      close(epfd);
+    close(listenfd);
+    return;
+  }
+  ev.data.fd = listenfd;
+  ev.events = EPOLLIN | EPOLLET;
+  epoll_ctl(epfd, EPOLL_CTL_ADD, listenfd, &ev);
+  nPaused = 0;
+
+  fprintf(main_log_fd, "\n%s - INFO - unix_server - listening on %s%s", get_timestamp(),
+          unixPath != NULL ? "" : "@", unixPath != NULL ? unixPath : addr.sun_path + 1);
+  __atomic_store_n(&ListenerProcActive, true, __ATOMIC_RELEASE);
+
+  while (isListening) {
+    nfds = epoll_wait(epfd, events, EPOLL_MAXEVENTS, nPaused > 0 ? BACKPRESSURE_RETRY : EPOLL_TIMEOUT);
+
+    for (i = 0; i < nfds; ++i) {
+      if (events[i].data.fd == listenfd) {
+        // Take every connection queued on the listener.
+        while ( (connfd = accept4(listenfd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+          if (verbose)
+            printf("unix_server - Accept a connection\n");
+          fprintf(main_log_fd, "\n%s - INFO - unix_server - Accept a connection", get_timestamp());
+          unixConnOpen(connfd);
+          ev.data.fd = connfd;
+          ev.events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+          epoll_ctl(epfd, EPOLL_CTL_ADD, connfd, &ev);
+        }
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != ECONNABORTED && errno != EINTR)
+          fprintf(main_log_fd, "\n%s - ERROR - unix_server - accept failed: %s", get_timestamp(), strerror(errno));
+        continue;
+      }
+
+      // Packets arrived, or the client went away; what it sent before is still
+      // handed on. A parked connection waits its turn.
+      sockfd = events[i].data.fd;
+      if (unixIsPaused(sockfd))
+        continue;
+      if ( (n = unixReadPackets(sockfd, &bp)) <= 0) {
+        if (n < 0 && errno != ECONNRESET)
+          fprintf(main_log_fd, "\n%s - ERROR - unix_server - read error: %s", get_timestamp(), strerror(errno));
+        unixConnClose(sockfd);
+      }
+      else if (bp)
+        unixPause(sockfd);
+    }
+
+    // Pick up the connections held back once the consumers have freed slots
+    if (nPaused > 0)
+      unixResume();
+  }
+
+  // Drop the connections still open
+  for (i = 0; i < connsSize; i++)
+    if (conns[i] != NULL)
+      unixConnClose(i);
+  free(conns);
+  conns = NULL;
+  connsSize = 0;
+  nPaused = 0;
+  munmap(batch.bufs, (size_t) UNIX_BATCH * PACKET_SIZE);
+  close(listenfd);
+  close(epfd);
+  if (unixPath != NULL)
+    unlink(unixPath);
+
+  fprintf(main_log_fd, "\n%s - INFO - unix_server - Listener exiting", get_timestamp());
+}
+
+
+// Interface function to xmit data
+uint32_t ipc_xmit (uint8_t *buf, int32_t bufSize)
+{
+  system_error ("unix_server - ipc_xmit - Not implemented");
+  return 0;
+}
+
+
+// Interface function to xmit a batch of chunks
+uint32_t ipc_xmitv (const struct iovec *iov, int32_t iovCnt)
+{
+  system_error ("unix_server - ipc_xmitv - Not implemented");
+  return 0;
+}
+
+
+// Interface function to receive data
+void ipc_rec (uint8_t *buf, int32_t bufSize)
+{
+  system_error ("unix_server - ipc_rec - Not implemented");
+}
+
+
+// Interface function to lend a buffer; this module doesn't lend buffers.
+uint8_t* ipc_acquire (int32_t *bufSize)
+{
+  return NULL;
+}
+
+
+// Interface function to report the chunks this module can take; it has no flow control.
+int32_t ipc_credits ()
+{
+  return -1;
+}
+
+
+// Interface function to commit an acquired buffer
+void ipc_commit (uint8_t *buf, int32_t bufSize)
+{
+  system_error ("unix_server - ipc_commit - Not implemented");
+}
+
+
+// Interface function to release a buffer passed on through xmit
+void ipc_release (uint8_t *buf)
+{
+  system_error ("unix_server - ipc_release - Not implemented");
+}
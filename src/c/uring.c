@@ -0,0 +1,260 @@
+/**
+ * @file   uring.c
+ * @author Armin Zare Zadeh ali.a.zarezadeh@gmail.com
+ * @date   16 October 2026
+ * @version 0.1
+ * @brief   uring.c is a thin layer over the io_uring system calls, just what the
+ *          uring transport modules need. liburing isn't required: the rings are
+ *          set up and mapped with the raw system calls.
+ *
+ * - The submission and completion rings are shared with the kernel. The caller fills
+ *   submission queue entries (SQEs) taken with uring_get_sqe, and uring_submit hands
+ *   all of them to the kernel with one io_uring_enter, optionally waiting for
+ *   completions in the same call.
+ * - Completion queue entries (CQEs) are read straight from the shared ring with
+ *   uring_peek_cqe and given back with uring_cqe_seen; that costs no system call.
+ * - The SQ index array is filled once with the identity, so an SQE is submitted just
+ *   by moving the tail.
+ * - A provided buffer ring (IORING_REGISTER_PBUF_RING) lets the kernel pick the
+ *   buffer a receive lands in, which is what multishot receives need.
+ * - uring_submit and uring_wait may run in different threads, but the SQ and CQ
+ *   sides each need one thread at a time (or a lock held by the caller).
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include "isc.h"
+#include "uring.h"
+
+
+/***********************************************************************************
+ * C o n s t a n t s ,   v a r i a b l e s ,  f u n c t i o n s
+************************************************************************************/
+
+// io_uring_enter, with the wait bounded by TIMEOUT seconds if it isn't negative
+static int uring_enter (struct uring* ring, unsigned to_submit, unsigned wait_nr, double timeout)
+{
+  struct io_uring_getevents_arg arg;
+  struct __kernel_timespec ts;
+  unsigned flags = wait_nr > 0 ? IORING_ENTER_GETEVENTS : 0;
+  int ret;
+
+  memset (&arg, 0, sizeof (arg));
+  if (wait_nr > 0 && timeout >= 0) {
+    ts.tv_sec = (long long) timeout;
+    ts.tv_nsec = (long long) ((timeout - ts.tv_sec) * 1e9);
+    arg.ts = (uint64_t) (uintptr_t) &ts;
+    flags |= IORING_ENTER_EXT_ARG;
+  }
+  ret = syscall (__NR_io_uring_enter, ring->fd, to_submit, wait_nr, flags,
+                 (flags & IORING_ENTER_EXT_ARG) ? (void*) &arg : NULL,
+                 (flags & IORING_ENTER_EXT_ARG) ? sizeof (arg) : 0);
+  __atomic_fetch_add (&ring->enters, 1, __ATOMIC_RELAXED);
+  return ret;
+}
+
+
+int uring_init (struct uring* ring, unsigned entries, unsigned flags)
+{
+  struct io_uring_params p;
+  unsigned i;
+  void* sq;
+  void* cq;
+
+  memset (ring, 0, sizeof (*ring));
+  memset (&p, 0, sizeof (p));
+  p.flags = flags;
+  ring->fd = syscall (__NR_io_uring_setup, entries, &p);
+  if (ring->fd < 0) {
+    ring->fd = -1;
+    return -1;
+  }
+  // Waits are bounded through IORING_ENTER_EXT_ARG, and completions must never be lost.
+  if (!(p.features & IORING_FEAT_EXT_ARG) || !(p.features & IORING_FEAT_NODROP)) {
+    close (ring->fd);
+    ring->fd = -1;
+    errno = ENOSYS;
+    return -1;
+  }
+
+  ring->flags = p.flags;
+  ring->sq_map_size = p.sq_off.array + p.sq_entries * sizeof (unsigned);
+  ring->cq_map_size = p.cq_off.cqes + p.cq_entries * sizeof (struct io_uring_cqe);
+  if (p.features & IORING_FEAT_SINGLE_MMAP) {
+    if (ring->cq_map_size > ring->sq_map_size)
+      ring->sq_map_size = ring->cq_map_size;
+    ring->cq_map_size = ring->sq_map_size;
+  }
+  sq = mmap (NULL, ring->sq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+             ring->fd, IORING_OFF_SQ_RING);
+  if (sq == MAP_FAILED)
+    goto fail;
+  ring->sq_map = sq;
+  if (p.features & IORING_FEAT_SINGLE_MMAP)
+    cq = sq;
+  else {
+    cq = mmap (NULL, ring->cq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+               ring->fd, IORING_OFF_CQ_RING);
+    if (cq == MAP_FAILED)
+      goto fail;
+  }
+  ring->cq_map = cq;
+  ring->sqes_size = p.sq_entries * sizeof (struct io_uring_sqe);
+  ring->sqes = mmap (NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                     ring->fd, IORING_OFF_SQES);
+  if (ring->sqes == MAP_FAILED) {
+    ring->sqes = NULL;
+    goto fail;
+  }
+
+  ring->sq_head = (unsigned*) ((char*) sq + p.sq_off.head);
+  ring->sq_tail = (unsigned*) ((char*) sq + p.sq_off.tail);
+  ring->sq_mask = *(unsigned*) ((char*) sq + p.sq_off.ring_mask);
+  ring->sq_entries = p.sq_entries;
+  ring->cq_head = (unsigned*) ((char*) cq + p.cq_off.head);
+  ring->cq_tail = (unsigned*) ((char*) cq + p.cq_off.tail);
+  ring->cq_mask = *(unsigned*) ((char*) cq + p.cq_off.ring_mask);
+  ring->cqes = (struct io_uring_cqe*) ((char*) cq + p.cq_off.cqes);
+  ring->sqe_tail = *ring->sq_tail;
+
+  // SQE i always sits in SQ slot i.
+  for (i = 0; i < p.sq_entries; i++)
+    ((unsigned*) ((char*) sq + p.sq_off.array))[i] = i;
+  return 0;
+
+fail:
+  uring_exit (ring);
+  return -1;
+}
+
+
+void uring_exit (struct uring* ring)
+{
+  if (ring->sqes != NULL)
+    munmap (ring->sqes, ring->sqes_size);
+  if (ring->cq_map != NULL && ring->cq_map != ring->sq_map)
+    munmap (ring->cq_map, ring->cq_map_size);
+  if (ring->sq_map != NULL)
+    munmap (ring->sq_map, ring->sq_map_size);
+  if (ring->fd >= 0)
+    close (ring->fd);
+  ring->sqes = NULL;
+  ring->sq_map = ring->cq_map = NULL;
+  ring->fd = -1;
+}
+
+
+struct io_uring_sqe* uring_get_sqe (struct uring* ring)
+{
+  struct io_uring_sqe* sqe;
+
+  if (ring->sqe_tail - __atomic_load_n (ring->sq_head, __ATOMIC_ACQUIRE) >= ring->sq_entries)
+    return NULL;
+  sqe = &ring->sqes[ring->sqe_tail & ring->sq_mask];
+  memset (sqe, 0, sizeof (*sqe));
+  ring->sqe_tail++;
+  return sqe;
+}
+
+
+int uring_submit (struct uring* ring, unsigned wait_nr, double timeout)
+{
+  unsigned pending;
+  int ret;
+
+  __atomic_store_n (ring->sq_tail, ring->sqe_tail, __ATOMIC_RELEASE);
+  pending = ring->sqe_tail - __atomic_load_n (ring->sq_head, __ATOMIC_ACQUIRE);
+  if (pending == 0 && wait_nr == 0)
+    return 0;
+
+  ret = uring_enter (ring, pending, wait_nr, timeout);
+  // Running out of time, or a signal, is no failure of the submission.
+  if (ret == -1 && (errno == ETIME || errno == EINTR) && wait_nr > 0)
+    return pending;
+  return ret;
+}
+
+
+int uring_wait (struct uring* ring, double timeout)
+{
+  int ret;
+
+  if (uring_peek_cqe (ring) != NULL)
+    return 0;
+  ret = uring_enter (ring, 0, 1, timeout);
+  if (ret == -1 && (errno == ETIME || errno == EINTR))
+    return 0;
+  return ret;
+}
+
+
+struct io_uring_cqe* uring_peek_cqe (struct uring* ring)
+{
+  unsigned head = *ring->cq_head;
+
+  if (head == __atomic_load_n (ring->cq_tail, __ATOMIC_ACQUIRE))
+    return NULL;
+  return &ring->cqes[head & ring->cq_mask];
+}
+
+
+void uring_cqe_seen (struct uring* ring)
+{
+  __atomic_store_n (ring->cq_head, *ring->cq_head + 1, __ATOMIC_RELEASE);
+}
+
+
+int uring_register (struct uring* ring, unsigned opcode, const void* arg, unsigned nr_args)
+{
+  return syscall (__NR_io_uring_register, ring->fd, opcode, arg, nr_args);
+}
+
+
+struct io_uring_buf_ring* uring_buf_ring_setup (struct uring* ring, unsigned entries, int bgid)
+{
+  struct io_uring_buf_reg reg;
+  struct io_uring_buf_ring* br;
+  size_t size = entries * sizeof (struct io_uring_buf);
+
+  br = mmap (NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (br == MAP_FAILED)
+    return NULL;
+  memset (&reg, 0, sizeof (reg));
+  reg.ring_addr = (uint64_t) (uintptr_t) br;
+  reg.ring_entries = entries;
+  reg.bgid = bgid;
+  if (uring_register (ring, IORING_REGISTER_PBUF_RING, &reg, 1) == -1) {
+    munmap (br, size);
+    return NULL;
+  }
+  br->tail = 0;
+  return br;
+}
+
+
+void uring_buf_ring_free (struct io_uring_buf_ring* br, unsigned entries)
+{
+  munmap (br, entries * sizeof (struct io_uring_buf));
+}
+
+
+void uring_buf_ring_add (struct io_uring_buf_ring* br, unsigned entries, void* addr, unsigned len,
+                         unsigned short bid, unsigned offset)
+{
+  struct io_uring_buf* buf = &br->bufs[(br->tail + offset) & (entries - 1)];
+
+  buf->addr = (uint64_t) (uintptr_t) addr;
+  buf->len = len;
+  buf->bid = bid;
+}
+
+
+void uring_buf_ring_advance (struct io_uring_buf_ring* br, unsigned count)
+{
+  __atomic_store_n (&br->tail, br->tail + count, __ATOMIC_RELEASE);
+}
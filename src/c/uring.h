@@ -0,0 +1,97 @@
+/*
+ * @file   uring.h
+ * @author Armin Zare Zadeh ali.a.zarezadeh@gmail.com
+ * @date   16 October 2026
+ * @version 0.1
+ * @brief   The io_uring layer of uring.c, kept out of isc.h so that only the uring
+ *          modules and the benchmark need the io_uring kernel headers to build.
+ */
+
+#ifndef URING_H
+#define URING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <linux/io_uring.h>
+
+
+
+/***********************************************************************************
+ * S y m b o l s   d e f i n e d   i n   u r i n g . c .
+************************************************************************************/
+
+/* Process local handle to an io_uring instance: the submission and completion rings
+ * shared with the kernel, set up with the raw system calls. ENTERS counts the
+ * io_uring_enter calls made through the handle.
+ */
+struct uring {
+  int fd;
+  unsigned flags;
+  unsigned* sq_head;
+  unsigned* sq_tail;
+  unsigned sq_mask;
+  unsigned sq_entries;
+  unsigned sqe_tail;
+  struct io_uring_sqe* sqes;
+  unsigned* cq_head;
+  unsigned* cq_tail;
+  unsigned cq_mask;
+  struct io_uring_cqe* cqes;
+  void* sq_map;
+  void* cq_map;
+  size_t sq_map_size;
+  size_t cq_map_size;
+  size_t sqes_size;
+  uint64_t enters;
+};
+
+/* Set up RING with ENTRIES submission queue entries and the IORING_SETUP_* FLAGS.
+ * Returns -1 with errno set if the kernel has no io_uring, or one too old for the
+ * uring modules (ENOSYS).
+ */
+int uring_init (struct uring* ring, unsigned entries, unsigned flags);
+
+/* Tear RING down. Requests still under way are cancelled by the kernel.
+ */
+void uring_exit (struct uring* ring);
+
+/* Take the next free SQE, cleared, or NULL if the submission queue is full.
+ */
+struct io_uring_sqe* uring_get_sqe (struct uring* ring);
+
+/* Submit the SQEs taken since the last submit with one io_uring_enter and wait for
+ * WAIT_NR completions, but no longer than TIMEOUT seconds unless it is negative.
+ * Returns the number of SQEs submitted, or -1 with errno set.
+ */
+int uring_submit (struct uring* ring, unsigned wait_nr, double timeout);
+
+/* Wait for a completion, or TIMEOUT seconds unless it is negative, without
+ * submitting anything, so that another thread may fill SQEs meanwhile. Returns -1
+ * with errno set on failure.
+ */
+int uring_wait (struct uring* ring, double timeout);
+
+/* The oldest unread CQE, or NULL if there is none, and marking it read.
+ */
+struct io_uring_cqe* uring_peek_cqe (struct uring* ring);
+void uring_cqe_seen (struct uring* ring);
+
+/* io_uring_register on RING.
+ */
+int uring_register (struct uring* ring, unsigned opcode, const void* arg, unsigned nr_args);
+
+/* Register a provided buffer ring of ENTRIES (a power of two) buffers as buffer
+ * group BGID. Returns NULL with errno set on failure.
+ */
+struct io_uring_buf_ring* uring_buf_ring_setup (struct uring* ring, unsigned entries, int bgid);
+void uring_buf_ring_free (struct io_uring_buf_ring* br, unsigned entries);
+
+/* Put the buffer BID of LEN bytes at ADDR into the OFFSET-th free entry past the tail
+ * of the provided buffer ring BR; advancing the tail by COUNT hands the buffers
+ * added to the kernel.
+ */
+void uring_buf_ring_add (struct io_uring_buf_ring* br, unsigned entries, void* addr, unsigned len,
+                         unsigned short bid, unsigned offset);
+void uring_buf_ring_advance (struct io_uring_buf_ring* br, unsigned count);
+
+#endif /* URING_H */
@@ -0,0 +1,732 @@
+/**
+ * @file   uring_client.c
+ * @author Armin Zare Zadeh ali.a.zarezadeh@gmail.com
+ * @date   16 October 2026
+ * @version 0.1
+ * @brief   The uring_client.so module is the io_uring alternative to sckt_client.so
+ *          (isc -t uring). It sends the chunks of the producer as framed messages
+ *          (see struct isc_frame_hdr) to uring_server or sckt_server.
+ *          - The frames are copied into a set of transmit buffers registered with
+ *            the ring, so the kernel doesn't map and pin the pages for every send,
+ *            and the socket is a fixed file of the ring.
+ *          - One write of a whole transmit buffer is under way at a time, so the
+ *            stream stays in order however the kernel completes it. Whatever
+ *            arrives meanwhile piles up in the next buffer and leaves with the next
+ *            write: the busier the link, the more messages each system call takes.
+ *          - The client thread sleeps in io_uring_enter for the completions and
+ *            starts the next write from there; it also connects through the ring and
+ *            keeps a poll armed which tells when the server goes away.
+ *          The slots of the producer go back to it as soon as they are copied.
+ */
+
+#define _GNU_SOURCE   // pthread_setname_np
+
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <time.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <netinet/tcp.h>
+
+#include "isc.h"
+#include "uring.h"
+
+
+
+/***********************************************************************************
+ * C o n s t a n t s ,   v a r i a b l e s ,  f u n c t i o n s
+************************************************************************************/
+
+// How long the client thread sleeps at most, in seconds, so that stop requests are
+// noticed, and how long ipc_xmitv waits for room at a time before it checks the
+// connection again
+#define URING_WAIT_TIMEOUT 0.1
+#define TX_WAIT_TIMEOUT 0.1
+
+// Fixed file of the socket
+#define SOCKET_SLOT 0
+
+// What a request is, as its user_data
+#define REQ_CONNECT 1
+#define REQ_WRITE   2
+#define REQ_POLL    3
+
+// The file to which to append the log string.
+static const char* log_filename = "uring_client.log";
+static FILE *log_fd = NULL;
+
+
+// Client Thread Name
+static const char *threadNameClient = "UringClient";
+
+// Flag to indicate whether client is connected,
+// or if it is already connected, should continue
+static bool Connected;
+
+// Transport type, server IP address and port number to connect to
+static int Protocol;
+static char *ServerAddr;
+static int ConnPort;
+
+// Client process ID
+static pthread_t ClientProcID;
+static bool ClientProcActive;
+
+// Thread routines
+static void *uringClientThread(void *pArg);
+static void uringClientProc();
+
+
+// Callback function to feed data to the next chain in pipeline
+void (*recCallbackFunctionType)(uint8_t *buf, int32_t bufSize);
+
+// The shared memory module on the other side of this one
+static struct ipc_module* peer;
+
+// The ring, shared by the xmit thread, which fills transmit buffers and submits
+// writes, and the client thread, which waits for their completions. Everything
+// below is guarded by txLock, except that the client thread sleeps in the kernel
+// without it; txRoom is signalled whenever a transmit buffer is freed.
+static struct uring ring;
+static pthread_mutex_t txLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t txRoom = PTHREAD_COND_INITIALIZER;
+// Submission queue entries (uring_entries)
+static uint32_t ringEntries = 64;
+
+// What ipc_xmitv does with a message no transmit buffer has room for: wait for the
+// writes under way, or drop the message (uring_tx_policy).
+enum txPolicy { TX_BLOCK, TX_DROP };
+static enum txPolicy txPolicy = TX_BLOCK;
+
+// Transmit buffers (uring_tx_buffers, uring_tx_buf_size): a circular array of
+// equal buffers registered with the ring. The buffers from txHead to txFill hold
+// frames not sent yet, the oldest sent from txSent on; txFill takes new frames. Each
+// is large enough for the largest frame.
+struct txBuf {
+  uint8_t *data;
+  uint32_t len;
+};
+static uint32_t txCount = 8;
+static uint32_t txSize = 256 * 1024;
+static uint8_t *txMem;
+static struct txBuf *txBufs;
+static uint64_t txHead;
+static uint64_t txFill;
+static uint32_t txSent;
+static bool txBusy;
+// Sequence number of the next message on the connection
+static uint64_t txSeq;
+
+// Messages and bytes sent, writes submitted, messages dropped on overflow, and how
+// often and for how long in total (seconds) ipc_xmitv waited for room
+static uint64_t txFrames;
+static uint64_t txBytes;
+static uint64_t txWrites;
+static uint64_t txDropped;
+static uint64_t txWaits;
+static double txWaitTime;
+
+
+// Interface function as a constructor
+void ipc_init (void (*ipc_rec)(uint8_t *buf, int32_t bufSize), void (*ipc_xmit)(uint8_t *buf, int32_t bufSize),
+               struct ipc_module* ipc_peer)
+{
+  if (verbose)
+    printf("\nuring_client - ipc_init\n");
+  fprintf(main_log_fd, "\n%s - INFO - uring_client - ipc_init", get_timestamp());
+
+  // Open the ipc log file for writing. If it exists, append to it;
+  // otherwise, create a new file.
+  log_fd = fopen (log_filename, "w");
+  if (log_fd == NULL) {
+    fprintf (stderr, "error: (%s) %s\n", "log_fd", strerror (errno));
+  }
+
+  recCallbackFunctionType = ipc_rec;
+  peer = ipc_peer;
+  Connected = false;
+  ring.fd = -1;
+
+  txMem = mmap(NULL, (size_t) txCount * txSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (txMem == MAP_FAILED)
+    system_error("uring_client - ipc_init - transmit buffers");
+  txBufs = (struct txBuf *) xmalloc(txCount * sizeof(txBufs[0]));
+  txHead = txFill = 0;
+  txSent = 0;
+  txBusy = false;
+  txFrames = txBytes = txWrites = txDropped = txWaits = 0;
+  txWaitTime = 0;
+
+  ClientProcActive = false;
+}
+
+
+// Interface function as a destructor
+void ipc_cleanup ()
+{
+  if (verbose)
+    printf("\nuring_client - ipc_cleanup\n");
+  fprintf(main_log_fd, "\n%s - INFO - uring_client - ipc_cleanup", get_timestamp());
+  fprintf(main_log_fd, "\n%s - INFO - uring_client - %llu messages, %llu bytes in %llu writes, %llu io_uring_enter calls",
+          get_timestamp(), (unsigned long long) txFrames, (unsigned long long) txBytes,
+          (unsigned long long) txWrites, (unsigned long long) ring.enters);
+  fprintf(main_log_fd, "\n%s - INFO - uring_client - %llu messages dropped, %llu waits for room taking %.3f s",
+          get_timestamp(), (unsigned long long) txDropped, (unsigned long long) txWaits, txWaitTime);
+
+  free(txBufs);
+  txBufs = NULL;
+  munmap(txMem, (size_t) txCount * txSize);
+
+  // All done. Close the main log file.
+  if (log_fd)
+    fclose ((FILE*) log_fd);
+}
+
+
+// Interface function to request stopping the thread
+void ipc_stop()
+{
+  if (verbose)
+    printf("\nuring_client - ipc_stop\n");
+  fprintf(main_log_fd, "\n%s - INFO - uring_client - ipc_stop", get_timestamp());
+
+  Connected = false;
+  // Let ipc_xmitv give up waiting for room
+  pthread_cond_broadcast(&txRoom);
+}
+
+
+// Interface function to set configuration parameters
+bool ipc_set_param(const char* prtcl, const char *addr, int port)
+{
+  bool rval = true;
+
+  if (verbose)
+    printf("\nuring_client - ipc_set_param\n");
+
+  if (addr != NULL)
+    ServerAddr = strdup(addr);
+  else
+    rval = false;
+
+  if (strcmp(prtcl, "tcp") == 0)
+    Protocol = IPPROTO_TCP;
+  else
+    rval = false;
+
+  if (rval) {
+    ConnPort = port;
+    fprintf(main_log_fd, "\n%s - INFO - uring_client - ipc_set_param - Protocol:%s, SocketType:SOCK_STREAM, ADDR:%s, PORT:%d.", get_timestamp(), prtcl, addr, ConnPort);
+  }
+  else
+    fprintf(main_log_fd, "\n%s - ERROR - uring_client - ipc_set_param - Protocol:%s not supported, ADDR:%s, PORT:%d.", get_timestamp(), prtcl, addr, port);
+  return (rval);
+}
+
+
+// Interface function to set a named configuration option
+bool ipc_set_option(const char* key, const char* value)
+{
+  char *end;
+  unsigned long n;
+
+  if (verbose)
+    printf("\nuring_client - ipc_set_option\n");
+
+  if (sckt_tune_set_option(&sckt_tuning, key, value))
+    return true;
+  if (strcmp(key, "uring_tx_policy") == 0) {
+    if (strcmp(value, "block") == 0)
+      txPolicy = TX_BLOCK;
+    else if (strcmp(value, "drop") == 0)
+      txPolicy = TX_DROP;
+    else
+      return false;
+    return true;
+  }
+
+  n = strtoul(value, &end, 0);
+  if (*value == '\0' || *end != '\0')
+    return false;
+  if (strcmp(key, "uring_entries") == 0) {
+    if (n < 8 || n > 32768)
+      return false;
+    ringEntries = n;
+    return true;
+  }
+  if (strcmp(key, "uring_tx_buffers") == 0) {
+    // One buffer is written while the next fills.
+    if (n < 2 || n > 1024)
+      return false;
+    txCount = n;
+    return true;
+  }
+  if (strcmp(key, "uring_tx_buf_size") == 0) {
+    if (n < ISC_FRAME_HDR_SIZE + ISC_FRAME_MAX || n > 1UL << 30)
+      return false;
+    txSize = n;
+    return true;
+  }
+  return false;
+}
+
+
+// Interface function to start the thread
+bool ipc_start()
+{
+  if (verbose)
+    printf("\nuring_client - ipc_start\n");
+  fprintf(main_log_fd, "\n%s - INFO - uring_client - ipc_start", get_timestamp());
+  bool rval = false;
+
+
+  // ////////////////////////////////
+  // Create the thread
+  pthread_attr_t thread_attribs;
+  pthread_attr_init(&thread_attribs);
+  pthread_attr_setscope(&thread_attribs, PTHREAD_SCOPE_SYSTEM);
+  pthread_attr_setstacksize(&thread_attribs, 65536);
+
+  if (pthread_create(&ClientProcID, &thread_attribs, uringClientThread, NULL)) {
+    Connected = false;
+    system_error("uring_client - error creating client thread, aborting");
+  }
+  else {
+    pthread_setname_np(ClientProcID, threadNameClient);
+    while(!__atomic_load_n(&ClientProcActive, __ATOMIC_ACQUIRE)) { usleep(100); } // wait for the thread to come up
+    rval = true;
+  }
+
+  pthread_attr_destroy(&thread_attribs);
+
+  return (rval);
+}
+
+
+// Interface function to join the thread
+bool ipc_wait4Done()
+{
+  if (verbose)
+    printf("\nuring_client - ipc_wait4Done\n");
+
+  // Make sure the client thread has finished.
+  if (pthread_join(ClientProcID, NULL) != 0) return false;
+
+  fprintf(main_log_fd, "\n%s - INFO - uring_client - wait4Done - ClientProc exited", get_timestamp());
+
+  return true;
+}
+
+
+// io_uring client main thread
+void *uringClientThread(void *pArg)
+{
+  if (verbose)
+    printf("\nuring_client - uringClientThread - clientproc started\n");
+  fprintf(main_log_fd, "\n%s - INFO - uring_client - clientproc started", get_timestamp());
+
+  __atomic_store_n(&ClientProcActive, true, __ATOMIC_RELEASE);
+  uringClientProc();
+  __atomic_store_n(&ClientProcActive, false, __ATOMIC_RELEASE);
+
+  fprintf(main_log_fd, "\n%s - INFO - uring_client - clientproc exited", get_timestamp());
+  return NULL;
+}
+
+
+// Set up the ring for the socket SOCKFD: register it as a fixed file and the transmit
+// buffers. Returns false on failure, having logged why.
+static bool uringSetup(int sockfd)
+{
+  struct iovec *iov;
+  uint32_t i;
+  bool ok;
+
+  if (uring_init(&ring, ringEntries, 0) == -1) {
+    fprintf(main_log_fd, "\n%s - ERROR - uring_client - io_uring setup failed: %s", get_timestamp(), strerror(errno));
+    return false;
+  }
+  if (uring_register(&ring, IORING_REGISTER_FILES, &sockfd, 1) == -1) {
+    fprintf(main_log_fd, "\n%s - ERROR - uring_client - registering the socket failed: %s", get_timestamp(), strerror(errno));
+    uring_exit(&ring);
+    return false;
+  }
+
+  iov = (struct iovec *) xmalloc(txCount * sizeof(iov[0]));
+  for (i = 0; i < txCount; i++) {
+    txBufs[i].data = txMem + (size_t) i * txSize;
+    txBufs[i].len = 0;
+    iov[i].iov_base = txBufs[i].data;
+    iov[i].iov_len = txSize;
+  }
+  ok = (uring_register(&ring, IORING_REGISTER_BUFFERS, iov, txCount) == 0);
+  free(iov);
+  if (!ok) {
+    fprintf(main_log_fd, "\n%s - ERROR - uring_client - registering the transmit buffers failed: %s", get_timestamp(), strerror(errno));
+    uring_exit(&ring);
+    return false;
+  }
+  return true;
+}
+
+
+// Connect to the server through the ring. Returns false if that fails.
+static bool uringConnect()
+{
+  struct sockaddr_in address;
+  struct io_uring_sqe *sqe;
+  struct io_uring_cqe *cqe;
+  int res = -ETIMEDOUT;
+
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_port = htons(ConnPort);
+  if (inet_pton(AF_INET, ServerAddr, &address.sin_addr.s_addr) == 0) {
+    perror(ServerAddr);
+    exit(errno);
+  }
+
+  sqe = uring_get_sqe(&ring);
+  sqe->opcode = IORING_OP_CONNECT;
+  sqe->fd = SOCKET_SLOT;
+  sqe->flags = IOSQE_FIXED_FILE;
+  sqe->addr = (uint64_t) (uintptr_t) &address;
+  sqe->off = sizeof(address);
+  sqe->user_data = REQ_CONNECT;
+  if (uring_submit(&ring, 1, -1) == -1)
+    res = -errno;
+  else if ( (cqe = uring_peek_cqe(&ring)) != NULL) {
+    res = cqe->res;
+    uring_cqe_seen(&ring);
+  }
+
+  if (res < 0) {
+    printf ("\nuring_client - ERROR - connect did not go through!");
+    fprintf(main_log_fd, "\n%s - ERROR - uring_client - connect did not go through: %s", get_timestamp(), strerror(-res));
+    return false;
+  }
+  return true;
+}
+
+
+// Queue a poll which completes once the server goes away.
+static void uringArmPoll()
+{
+  struct io_uring_sqe *sqe = uring_get_sqe(&ring);
+
+  sqe->opcode = IORING_OP_POLL_ADD;
+  sqe->fd = SOCKET_SLOT;
+  sqe->flags = IOSQE_FIXED_FILE;
+  sqe->poll32_events = POLLRDHUP | POLLHUP | POLLERR;
+  sqe->user_data = REQ_POLL;
+}
+
+
+// Start writing the oldest transmit buffer holding unsent frames unless a write is
+// under way, with txLock held. A buffer still filling is closed for the write and
+// the next one takes the frames from now on.
+static void uringKick()
+{
+  struct io_uring_sqe *sqe;
+  struct txBuf *b;
+  uint32_t idx;
+
+  if (txBusy || !Connected)
+    return;
+  idx = txHead % txCount;
+  b = &txBufs[idx];
+  if (b->len == txSent)
+    return;
+  if (txHead == txFill) {
+    txFill++;
+    txBufs[txFill % txCount].len = 0;
+  }
+
+  sqe = uring_get_sqe(&ring);
+  sqe->opcode = IORING_OP_WRITE_FIXED;
+  sqe->fd = SOCKET_SLOT;
+  sqe->flags = IOSQE_FIXED_FILE;
+  sqe->addr = (uint64_t) (uintptr_t) (b->data + txSent);
+  sqe->len = b->len - txSent;
+  sqe->buf_index = idx;
+  sqe->user_data = REQ_WRITE;
+  txBusy = true;
+  txWrites++;
+  if (uring_submit(&ring, 0, 0) == -1) {
+    fprintf(main_log_fd, "\n%s - ERROR - uring_client - io_uring_enter failed: %s", get_timestamp(), strerror(errno));
+    Connected = false;
+  }
+}
+
+
+// Handle the completions there are, with txLock held: a finished write frees its
+// buffer, or has the rest of it written, and the next write starts.
+static void uringReap()
+{
+  struct io_uring_cqe *cqe;
+  struct txBuf *b;
+
+  while ( (cqe = uring_peek_cqe(&ring)) != NULL) {
+    switch (cqe->user_data) {
+      case REQ_WRITE:
+        txBusy = false;
+        if (cqe->res < 0 && cqe->res != -EINTR && cqe->res != -EAGAIN) {
+          fprintf(main_log_fd, "\n%s - ERROR - uring_client - socket write error: %s", get_timestamp(), strerror(-cqe->res));
+          Connected = false;
+          break;
+        }
+        b = &txBufs[txHead % txCount];
+        if (cqe->res > 0)
+          txSent += cqe->res;
+        if (txSent == b->len) {
+          b->len = 0;
+          txSent = 0;
+          txHead++;
+          pthread_cond_broadcast(&txRoom);
+        }
+        break;
+
+      case REQ_POLL:
+        Connected = false;
+        if (verbose)
+          printf("\nuring_client - remote connection went away");
+        fprintf(main_log_fd, "\n%s - INFO - uring_client - remote connection went away", get_timestamp());
+        break;
+
+      default:
+        break;
+    }
+    uring_cqe_seen(&ring);
+  }
+  uringKick();
+}
+
+
+// io_uring client main thread process
+void uringClientProc()
+{
+  int sockfd;
+
+  if (verbose)
+    printf("\nuring_client - uringClientProc starts");
+
+  sockfd = socket(AF_INET, SOCK_STREAM, Protocol);
+  if (sockfd != -1)
+    sckt_tune_socket(&sckt_tuning, sockfd, true, "uring_client");
+  if (sockfd == -1 || !uringSetup(sockfd)) {
+    if (sockfd != -1)
+      close(sockfd);
+    return;
+  }
+
+  if (!uringConnect()) {
+    close(sockfd);
+    uring_exit(&ring);
+    return;
+  }
+  txSeq = 0;
+  uringArmPoll();
+
+  pthread_mutex_lock(&txLock);
+  Connected = true;
+  if (uring_submit(&ring, 0, 0) == -1)
+    Connected = false;
+  pthread_mutex_unlock(&txLock);
+
+  if (verbose)
+    printf("\nuring_client - connected");
+  fprintf(main_log_fd, "\n%s - INFO - uring_client - connected", get_timestamp());
+  sckt_tune_log(&sckt_tuning, sockfd, true, "uring_client");
+  // The ring holds its own reference to the socket.
+  close(sockfd);
+
+  // Wait for completions without the lock, so ipc_xmitv may go on filling buffers.
+  while (Connected) {
+    if (uring_wait(&ring, URING_WAIT_TIMEOUT) == -1) {
+      printf("\nuring_client - ERROR - io_uring fault");
+      fprintf(main_log_fd, "\n%s - ERROR - uring_client - io_uring_enter failed: %s", get_timestamp(), strerror(errno));
+      Connected = false;
+      break;
+    }
+    pthread_mutex_lock(&txLock);
+    uringReap();
+    pthread_mutex_unlock(&txLock);
+  }
+
+  // Nothing will be written any more; let ipc_xmitv stop waiting for room.
+  pthread_mutex_lock(&txLock);
+  Connected = false;
+  if (txFill != txHead || txBufs[txHead % txCount].len > txSent)
+    fprintf(main_log_fd, "\n%s - WARNING - uring_client - frames of %llu transmit buffers never sent",
+            get_timestamp(), (unsigned long long) (txFill - txHead + 1));
+  // Closing the ring cancels the write under way and closes the socket.
+  uring_exit(&ring);
+  pthread_cond_broadcast(&txRoom);
+  pthread_mutex_unlock(&txLock);
+
+  fprintf(main_log_fd, "\n%s - INFO - uring_client - Client exiting", get_timestamp());
+  if (verbose)
+    printf("\nuring_client - uringClientProc exiting");
+}
+
+
+// Make room for a frame of LEN bytes in the filling transmit buffer as txPolicy says,
+// with txLock held, moving on to the next buffer if need be. Returns false if the
+// message is to be dropped.
+static bool txMakeRoom(uint32_t len)
+{
+  struct timespec ts;
+  double since;
+
+  if (txBufs[txFill % txCount].len + len <= txSize)
+    return true;
+
+  // The filling buffer is full; take the next one once it is free.
+  if (txFill + 1 - txHead >= txCount) {
+    uringKick();
+    if (txPolicy == TX_DROP)
+      return false;
+    txWaits++;
+    since = get_monotonic_time();
+    while (txFill + 1 - txHead >= txCount && Connected) {
+      clock_gettime(CLOCK_REALTIME, &ts);
+      ts.tv_nsec += (long) (TX_WAIT_TIMEOUT * 1e9);
+      if (ts.tv_nsec >= 1000000000L) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+      }
+      pthread_cond_timedwait(&txRoom, &txLock, &ts);
+    }
+    txWaitTime += get_monotonic_time() - since;
+    if (!Connected)
+      return false;
+    // If the client thread wrote every other buffer meanwhile, it closed the full
+    // one for a write, and the frame goes in the empty one it opened.
+    if (txBufs[txFill % txCount].len + len <= txSize)
+      return true;
+  }
+  txFill++;
+  txBufs[txFill % txCount].len = 0;
+  return true;
+}
+
+
+// Interface function to xmit a batch of chunks, each as one framed message. They are
+// copied into the transmit buffers and the slots go back to the peer at once; at
+// most one io_uring_enter is made for the whole batch.
+uint32_t ipc_xmitv (const struct iovec *iov, int32_t iovCnt)
+{
+  struct isc_frame_hdr hdr;
+  struct txBuf *b;
+  size_t total = 0;
+  int32_t i, j;
+
+  if (verbose)
+    printf("\nuring_client - ipc_xmitv\n");
+  fprintf(main_log_fd, "\n%s - INFO - uring_client - ipc_xmitv - %d chunks", get_timestamp(), iovCnt);
+
+  pthread_mutex_lock(&txLock);
+  if (!Connected) {
+    pthread_mutex_unlock(&txLock);
+    if (verbose)
+      printf("\nuring_client - ipc_xmitv Client Not Connected!\n");
+    fprintf(main_log_fd, "\n%s - INFO - uring_client - ipc_xmitv - Client Not Connected!", get_timestamp());
+    // The chunks are dropped; hand their buffers back all the same.
+    if (peer != NULL)
+      for (i = 0; i < iovCnt; i++)
+        (*peer->release_function) (iov[i].iov_base);
+    return 0;
+  }
+
+  for (i = 0; i < iovCnt; i++) {
+    // Dumping the chunk byte by byte costs more than sending it; only with -v.
+    if (verbose) {
+      fprintf(log_fd, "\n%s - INFO - uring_client - ", get_timestamp());
+      for (j = 0; j < iov[i].iov_len; j++)
+        fprintf(log_fd, "0x%X,", ((uint8_t *) iov[i].iov_base)[j] & 0x000000FF);
+    }
+
+    if (!txMakeRoom(ISC_FRAME_HDR_SIZE + iov[i].iov_len)) {
+      if (txDropped++ == 0)
+        fprintf(main_log_fd, "\n%s - WARNING - uring_client - transmit buffers full, messages dropped", get_timestamp());
+      continue;
+    }
+    b = &txBufs[txFill % txCount];
+    isc_frame_encode(&hdr, iov[i].iov_len, ISC_CHANNEL_DATA, 0, txSeq++);
+    memcpy(b->data + b->len, &hdr, ISC_FRAME_HDR_SIZE);
+    memcpy(b->data + b->len + ISC_FRAME_HDR_SIZE, iov[i].iov_base, iov[i].iov_len);
+    b->len += ISC_FRAME_HDR_SIZE + iov[i].iov_len;
+    total += iov[i].iov_len;
+    txFrames++;
+    txBytes += iov[i].iov_len;
+  }
+
+  // The completions of the last write may be in already; the next one takes the
+  // whole batch. Once the connection is down the client thread tears the ring down.
+  if (Connected)
+    uringReap();
+  pthread_mutex_unlock(&txLock);
+
+  // Every chunk has been copied, and the slots can be reused.
+  if (peer != NULL)
+    for (i = 0; i < iovCnt; i++)
+      (*peer->release_function) (iov[i].iov_base);
+
+  fprintf(main_log_fd, "\n%s - INFO - uring_client - sent = %zu bytes", get_timestamp(), total);
+
+  return total;
+}
+
+
+// Interface function to xmit data
+uint32_t ipc_xmit (uint8_t *buf, int32_t bufSize)
+{
+  struct iovec iov;
+
+  if (verbose)
+    printf("\nuring_client - ipc_xmit\n");
+
+  iov.iov_base = buf;
+  iov.iov_len = bufSize;
+  return ipc_xmitv(&iov, 1);
+}
+
+
+// Interface function to receive data
+void ipc_rec (uint8_t *buf, int32_t bufSize)
+{
+  system_error ("uring_client - ipc_rec - Not implemented");
+}
+
+
+// Interface function to lend a buffer; this module doesn't lend buffers.
+uint8_t* ipc_acquire (int32_t *bufSize)
+{
+  return NULL;
+}
+
+
+// Interface function to report the chunks this module can take; it has no flow control.
+int32_t ipc_credits ()
+{
+  return -1;
+}
+
+
+// Interface function to commit an acquired buffer
+void ipc_commit (uint8_t *buf, int32_t bufSize)
+{
+  system_error ("uring_client - ipc_commit - Not implemented");
+}
+
+
+// Interface function to release a buffer passed on through xmit
+void ipc_release (uint8_t *buf)
+{
+  system_error ("uring_client - ipc_release - Not implemented");
+}
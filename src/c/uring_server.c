@@ -0,0 +1,932 @@
+/**
+ * @file   uring_server.c
+ * @author Armin Zare Zadeh ali.a.zarezadeh@gmail.com
+ * @date   16 October 2026
+ * @version 0.1
+ * @brief   The uring_server.so module is the io_uring alternative to sckt_server.so
+ *          (isc -t uring). It takes the same framed messages (see struct
+ *          isc_frame_hdr) and hands them on to the shared memory module the same way,
+ *          but the per message system calls of epoll are gone:
+ *          - one multishot accept on the listening socket takes every connection,
+ *            straight into the table of fixed files registered with the ring;
+ *          - one multishot receive per connection stays armed for the life of the
+ *            connection and reads into a ring of provided buffers registered with
+ *            the kernel, which picks a buffer for each completion;
+ *          - the thread sleeps in a single io_uring_enter, which also submits what
+ *            the last round queued, and then reads every completion from memory.
+ *          Messages lying whole in a receive buffer are handed on from it; only a
+ *          message split across buffers is gathered in a buffer of the connection.
+ *          While the consumers have no room, the connection keeps its receive
+ *          buffers. Once the provided buffers run out the kernel ends the receives,
+ *          the socket fills up and the sender is throttled; the receives are armed
+ *          again as buffers come back.
+ */
+
+#define _GNU_SOURCE   // pthread_setname_np
+
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <netinet/tcp.h>
+
+#include "isc.h"
+#include "uring.h"
+
+
+
+/***********************************************************************************
+ * C o n s t a n t s ,   v a r i a b l e s ,  f u n c t i o n s
+************************************************************************************/
+// How long the thread sleeps at most, in seconds, so that stop requests are noticed
+#define URING_WAIT_TIMEOUT 1.0
+// How often connections paused by backpressure are retried, in seconds
+#define BACKPRESSURE_RETRY 0.002
+
+// Fixed file table: the listening socket takes entry 0, connections the others.
+#define URING_MAX_CONNS 256
+#define LISTEN_SLOT 0
+
+// Buffer group of the provided receive buffers
+#define RX_BGID 0
+
+// What a request is, kept in the low byte of its user_data. A connection request
+// also carries the fixed file slot and the generation of the connection, so that
+// completions which arrive after the slot was reused are told apart.
+#define REQ_ACCEPT 1
+#define REQ_RECV   2
+#define REQ_CLOSE  3
+#define REQ_CANCEL 4
+#define REQ_DATA(type, slot, gen) ((uint64_t) (type) | ((uint64_t) (slot) << 8) | ((uint64_t) (gen) << 32))
+#define REQ_TYPE(data) ((data) & 0xFF)
+#define REQ_SLOT(data) (((data) >> 8) & 0xFFFFFF)
+#define REQ_GEN(data) ((uint32_t) ((data) >> 32))
+
+// The file to which to append the log string.
+static const char* log_filename = "uring_server.log";
+static FILE *log_fd = NULL;
+
+
+// Thread Name
+static const char *threadNameListen = "UringListen";
+
+static bool isListening;    // ListenerProc thread is running if this is true..
+static bool ListenerProcActive;
+static pthread_t ListenerProcID;
+static int Protocol;
+static int ConnPort;
+
+
+// Submission queue entries (uring_entries), and the number (uring_rx_buffers, a
+// power of two) and size (uring_rx_buf_size) of the provided receive buffers
+static uint32_t ringEntries = 256;
+static uint32_t rxCount = 256;
+static uint32_t rxSize = 16 * 1024;
+
+static struct uring ring;
+static struct io_uring_buf_ring *rxRing;
+static uint8_t *rxMem;
+// Receive buffers held by connections: bytes received into each, and the next one
+// held by the same connection, or -1
+static uint32_t *rxLen;
+static int32_t *rxNext;
+// Buffers added back since the ring tail was last advanced, and buffers the
+// kernel may use
+static uint32_t rxReturned;
+static uint32_t rxFree;
+
+// A client connection: the receive buffers it holds in the order received, the
+// first from offset off on, and a message split across them gathered in frame, part
+// bytes so far. armed tells whether its multishot receive is under way; eof, that
+// the peer closed its side.
+struct uringConn {
+  bool open;
+  bool armed;
+  bool eof;
+  uint32_t gen;
+  int32_t head;
+  int32_t tail;
+  uint32_t off;
+  uint8_t *frame;
+  uint32_t part;
+  uint64_t nextSeq;
+};
+static struct uringConn conns[URING_MAX_CONNS];
+static uint32_t connGen;
+static bool acceptArmed;
+
+// Connections whose messages wait for room in the consumer ring, and since when
+static int paused[URING_MAX_CONNS];
+static int nPaused;
+static double pausedSince;
+
+// Connections accepted, messages handed on, sequence gaps seen, connections dropped
+// for bad framing, completions read, receives ended for lack of buffers, and how
+// often and for how long in total (seconds) backpressure held the connections
+static uint64_t accepted;
+static uint64_t framesDelivered;
+static uint64_t seqGaps;
+static uint64_t framingErrors;
+static uint64_t completions;
+static uint64_t rxExhausted;
+static uint64_t backpressureCount;
+static double backpressureTime;
+
+
+// Thread routines
+static void *uringListenerThread(void *pArg);
+static void uringListenerProc();
+
+
+// Callback function to feed data to the next chain in pipeline
+void (*recCallbackFunctionType)(uint8_t *buf, int32_t bufSize);
+
+// The shared memory module on the other side of this one
+static struct ipc_module* peer;
+
+
+// Interface function as a constructor
+void ipc_init (void (*ipc_rec)(uint8_t *buf, int32_t bufSize), void (*ipc_xmit)(uint8_t *buf, int32_t bufSize),
+               struct ipc_module* ipc_peer)
+{
+  if (verbose)
+    printf("\nuring_server - ipc_init\n");
+  fprintf(main_log_fd, "\n%s - INFO - uring_server - ipc_init", get_timestamp());
+
+  // Open the ipc log file for writing. If it exists, append to it;
+  // otherwise, create a new file.
+  log_fd = fopen (log_filename, "w");
+  if (log_fd == NULL) {
+    fprintf (stderr, "error: (%s) %s\n", "log_fd", strerror (errno));
+  }
+
+  recCallbackFunctionType = ipc_rec;
+  peer = ipc_peer;
+  ring.fd = -1;
+
+  accepted = framesDelivered = seqGaps = framingErrors = 0;
+  completions = rxExhausted = backpressureCount = 0;
+  backpressureTime = 0;
+
+  isListening = false;
+  ListenerProcActive = false;
+}
+
+
+// Interface function as a destructor
+void ipc_cleanup ()
+{
+  if (verbose)
+    printf("\nuring_server - ipc_cleanup\n");
+  fprintf(main_log_fd, "\n%s - INFO - uring_server - ipc_cleanup", get_timestamp());
+  fprintf(main_log_fd, "\n%s - INFO - uring_server - %llu connections, %llu messages handed on, %llu sequence gaps, %llu framing errors",
+          get_timestamp(), (unsigned long long) accepted, (unsigned long long) framesDelivered,
+          (unsigned long long) seqGaps, (unsigned long long) framingErrors);
+  fprintf(main_log_fd, "\n%s - INFO - uring_server - %llu io_uring_enter calls for %llu completions, receive buffers ran out %llu times",
+          get_timestamp(), (unsigned long long) ring.enters, (unsigned long long) completions,
+          (unsigned long long) rxExhausted);
+  fprintf(main_log_fd, "\n%s - INFO - uring_server - backpressure engaged %llu times, %.3f s in total",
+          get_timestamp(), (unsigned long long) backpressureCount, backpressureTime);
+
+  // All done. Close the main log file.
+  if (log_fd)
+    fclose ((FILE*) log_fd);
+}
+
+
+// Interface function to request stopping the thread
+void ipc_stop()
+{
+  if (verbose)
+    printf("\nuring_server - ipc_stop\n");
+  fprintf(main_log_fd, "\n%s - INFO - uring_server - ipc_stop", get_timestamp());
+
+  isListening = false;
+}
+
+
+// Interface function to set configuration parameters
+bool ipc_set_param(const char* prtcl, const char *addr, int port)
+{
+  bool rval = true;
+
+  if (verbose)
+    printf("\nuring_server - ipc_set_param\n");
+
+  // Multishot receives work on a stream.
+  if (strcmp(prtcl, "tcp") == 0)
+    Protocol = IPPROTO_TCP;
+  else
+    rval = false;
+
+  if (rval) {
+    ConnPort = port;
+    fprintf(main_log_fd, "\n%s - INFO - uring_server - ipc_set_param - Protocol:%s, SocketType:SOCK_STREAM, PORT:%d.", get_timestamp(), prtcl, ConnPort);
+  }
+  else
+    fprintf(main_log_fd, "\n%s - ERROR - uring_server - ipc_set_param - Protocol:%s not supported, PORT:%d.", get_timestamp(), prtcl, port);
+
+  return (rval);
+}
+
+
+// Interface function to set a named configuration option
+bool ipc_set_option(const char* key, const char* value)
+{
+  char *end;
+  unsigned long n;
+
+  if (verbose)
+    printf("\nuring_server - ipc_set_option\n");
+
+  if (sckt_tune_set_option(&sckt_tuning, key, value))
+    return true;
+  n = strtoul(value, &end, 0);
+  if (*value == '\0' || *end != '\0')
+    return false;
+
+  if (strcmp(key, "uring_entries") == 0) {
+    if (n < 8 || n > 32768)
+      return false;
+    ringEntries = n;
+    return true;
+  }
+  if (strcmp(key, "uring_rx_buffers") == 0) {
+    if (n < 2 || n > 32768 || (n & (n - 1)) != 0)
+      return false;
+    rxCount = n;
+    return true;
+  }
+  if (strcmp(key, "uring_rx_buf_size") == 0) {
+    if (n < ISC_FRAME_HDR_SIZE || n > ISC_FRAME_HDR_SIZE + ISC_FRAME_MAX)
+      return false;
+    rxSize = n;
+    return true;
+  }
+  return false;
+}
+
+
+// Interface function to start the thread
+bool ipc_start()
+{
+  if (verbose)
+    printf("\nuring_server - ipc_start\n");
+  fprintf(main_log_fd, "\n%s - INFO - uring_server - ipc_start", get_timestamp());
+
+
+  // ////////////////////////////////
+  // Create the thread
+  pthread_attr_t thread_attribs;
+  pthread_attr_init(&thread_attribs);
+  pthread_attr_setscope(&thread_attribs, PTHREAD_SCOPE_SYSTEM);
+  pthread_attr_setstacksize(&thread_attribs, 65536);
+
+  isListening = true;
+  if ( pthread_create(&ListenerProcID, &thread_attribs, uringListenerThread, NULL) ) {
+    isListening = false;
+    system_error("ipc_start - uring_server: error creating listener thread, aborting");
+  }
+  pthread_setname_np(ListenerProcID, threadNameListen);
+  // Wait for the thread to come up, or to give up setting up the ring
+  while (!__atomic_load_n(&ListenerProcActive, __ATOMIC_ACQUIRE) && isListening) { usleep(100); }
+
+  pthread_attr_destroy(&thread_attribs);
+
+  return (isListening);
+}
+
+
+// Interface function to join the thread
+bool ipc_wait4Done()
+{
+  if (verbose)
+    printf("\nuring_server - ipc_wait4Done\n");
+
+  // Make sure the listener thread has finished.
+  if (pthread_join(ListenerProcID, NULL) != 0) return false;
+
+  fprintf(main_log_fd, "\n%s - INFO - uring_server - wait4Done - ListenerProc exited", get_timestamp());
+
+  return true;
+}
+
+
+// The next free SQE. A full submission queue is submitted first.
+static struct io_uring_sqe *uringSqe()
+{
+  struct io_uring_sqe *sqe;
+
+  if ( (sqe = uring_get_sqe(&ring)) == NULL) {
+    if (uring_submit(&ring, 0, 0) == -1)
+      system_error("uring_server - io_uring_enter");
+    if ( (sqe = uring_get_sqe(&ring)) == NULL)
+      system_error("uring_server - submission queue full");
+  }
+  return sqe;
+}
+
+
+// Queue the multishot accept of the listening socket. Connections go straight into
+// a free entry of the fixed file table.
+static void uringArmAccept()
+{
+  struct io_uring_sqe *sqe = uringSqe();
+
+  sqe->opcode = IORING_OP_ACCEPT;
+  sqe->fd = LISTEN_SLOT;
+  sqe->flags = IOSQE_FIXED_FILE;
+  sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+  sqe->file_index = IORING_FILE_INDEX_ALLOC;
+  sqe->user_data = REQ_DATA(REQ_ACCEPT, 0, 0);
+  acceptArmed = true;
+}
+
+
+// Queue the multishot receive of the connection in SLOT, into provided buffers.
+static void uringArmRecv(int slot)
+{
+  struct io_uring_sqe *sqe = uringSqe();
+
+  sqe->opcode = IORING_OP_RECV;
+  sqe->fd = slot;
+  sqe->flags = IOSQE_FIXED_FILE | IOSQE_BUFFER_SELECT;
+  sqe->ioprio = IORING_RECV_MULTISHOT;
+  sqe->buf_group = RX_BGID;
+  sqe->user_data = REQ_DATA(REQ_RECV, slot, conns[slot].gen);
+  conns[slot].armed = true;
+}
+
+
+// Give the receive buffer BID back to the kernel. The ring tail moves once per round.
+static void uringRecycle(int32_t bid)
+{
+  uring_buf_ring_add(rxRing, rxCount, rxMem + (size_t) bid * rxSize, rxSize, bid, rxReturned++);
+  rxFree++;
+}
+
+
+// Take N bytes off the front of the data held by CONN, giving back the receive
+// buffers used up.
+static void uringConsume(struct uringConn *conn, uint32_t n)
+{
+  int32_t bid;
+  uint32_t avail;
+
+  while (n > 0) {
+    bid = conn->head;
+    avail = rxLen[bid] - conn->off;
+    if (n < avail) {
+      conn->off += n;
+      return;
+    }
+    n -= avail;
+    conn->off = 0;
+    conn->head = rxNext[bid];
+    if (conn->head < 0)
+      conn->tail = -1;
+    uringRecycle(bid);
+  }
+}
+
+
+// Set up the connection accepted into SLOT.
+static void uringConnOpen(int slot)
+{
+  struct uringConn *conn = &conns[slot];
+
+  conn->open = true;
+  conn->armed = false;
+  conn->eof = false;
+  conn->gen = ++connGen;
+  conn->head = conn->tail = -1;
+  conn->off = 0;
+  conn->frame = (uint8_t *) xmalloc(ISC_FRAME_HDR_SIZE + ISC_FRAME_MAX);
+  conn->part = 0;
+  conn->nextSeq = 0;
+  accepted++;
+}
+
+
+// Whether the connection in SLOT is parked because of backpressure
+static bool uringIsPaused(int slot)
+{
+  int i;
+
+  for (i = 0; i < nPaused; i++) {
+    if (paused[i] == slot)
+      return true;
+  }
+  return false;
+}
+
+
+// Park the connection in SLOT until the peer has credits again and count the event.
+static void uringPause(int slot)
+{
+  if (uringIsPaused(slot))
+    return;
+  if (nPaused == 0)
+    pausedSince = get_monotonic_time();
+  paused[nPaused++] = slot;
+  backpressureCount++;
+}
+
+
+// Take the connection in SLOT off the parked ones.
+static void uringUnpause(int slot)
+{
+  int i;
+
+  for (i = 0; i < nPaused; i++) {
+    if (paused[i] == slot) {
+      memmove(paused + i, paused + i + 1, (--nPaused - i) * sizeof(paused[0]));
+      if (nPaused == 0)
+        backpressureTime += get_monotonic_time() - pausedSince;
+      return;
+    }
+  }
+}
+
+
+// Close the connection in SLOT, giving back the buffers it holds along with a partly
+// received message. Its receive is cancelled first if it is still under way.
+static void uringConnClose(int slot)
+{
+  struct uringConn *conn = &conns[slot];
+  struct io_uring_sqe *sqe;
+  uint32_t held = conn->part;
+  int32_t bid;
+
+  for (bid = conn->head; bid >= 0; bid = rxNext[bid])
+    held += rxLen[bid];
+  held -= conn->off;
+  if (held > 0)
+    fprintf(main_log_fd, "\n%s - WARNING - uring_server - connection closed with %u bytes of an incomplete message",
+            get_timestamp(), held);
+
+  while (conn->head >= 0) {
+    bid = conn->head;
+    conn->head = rxNext[bid];
+    uringRecycle(bid);
+  }
+  conn->tail = -1;
+  free(conn->frame);
+  conn->frame = NULL;
+  conn->open = false;
+  uringUnpause(slot);
+
+  if (conn->armed) {
+    sqe = uringSqe();
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->addr = REQ_DATA(REQ_RECV, slot, conn->gen);
+    sqe->user_data = REQ_DATA(REQ_CANCEL, slot, conn->gen);
+    conn->armed = false;
+  }
+  sqe = uringSqe();
+  sqe->opcode = IORING_OP_CLOSE;
+  sqe->file_index = slot + 1;
+  sqe->user_data = REQ_DATA(REQ_CLOSE, slot, conn->gen);
+}
+
+
+// Hand the message of LEN bytes at BUF on to the shared memory module with
+// ipc_hand_on, then log it. Returns false, leaving the message where it is, while the
+// peer has no room for it.
+static bool uringHandOn(uint8_t *buf, uint32_t len)
+{
+  int i;
+
+  if (!ipc_hand_on(peer, recCallbackFunctionType, buf, len))
+    return false;
+
+  // The bytes of the message go to the log only with -v.
+  if (verbose) {
+    fprintf(log_fd, "\n%s - INFO - uring_server - ", get_timestamp());
+    for (i = 0; i < len; i++)
+      fprintf(log_fd, "0x%X,", buf[i] & 0x000000FF);
+  }
+
+  return true;
+}
+
+
+// Account for the message with header HDR of CONN having been handed on.
+static void uringDelivered(struct uringConn *conn, const struct isc_frame_hdr *hdr)
+{
+  if (hdr->seq != conn->nextSeq) {
+    fprintf(main_log_fd, "\n%s - WARNING - uring_server - message %llu received, %llu expected",
+            get_timestamp(), (unsigned long long) hdr->seq, (unsigned long long) conn->nextSeq);
+    seqGaps++;
+  }
+  conn->nextSeq = hdr->seq + 1;
+  framesDelivered++;
+}
+
+
+// Hand on every whole message CONN holds. Returns 0 once only an incomplete message
+// (or nothing) is left, 1 if the peer has no room for the next one and -1 if the
+// stream isn't framed as it should be.
+static int uringDeliver(struct uringConn *conn)
+{
+  struct isc_frame_hdr hdr;
+  uint8_t *p;
+  uint32_t avail, want, n;
+
+  for (;;) {
+    // A message gathered from several buffers
+    if (conn->part >= ISC_FRAME_HDR_SIZE) {
+      isc_frame_decode(conn->frame, &hdr);
+      if (conn->part == ISC_FRAME_HDR_SIZE + hdr.len) {
+        if (hdr.len > 0 && !uringHandOn(conn->frame + ISC_FRAME_HDR_SIZE, hdr.len))
+          return 1;
+        uringDelivered(conn, &hdr);
+        conn->part = 0;
+        continue;
+      }
+    }
+    if (conn->head < 0)
+      return 0;
+
+    p = rxMem + (size_t) conn->head * rxSize + conn->off;
+    avail = rxLen[conn->head] - conn->off;
+
+    // A message lying whole in the buffer is handed on from there.
+    if (conn->part == 0 && avail >= ISC_FRAME_HDR_SIZE) {
+      isc_frame_decode(p, &hdr);
+      if (hdr.len > ISC_FRAME_MAX)
+        goto bad_frame;
+      if (avail >= ISC_FRAME_HDR_SIZE + hdr.len) {
+        if (hdr.len > 0 && !uringHandOn(p + ISC_FRAME_HDR_SIZE, hdr.len))
+          return 1;
+        uringDelivered(conn, &hdr);
+        uringConsume(conn, ISC_FRAME_HDR_SIZE + hdr.len);
+        continue;
+      }
+    }
+
+    // The message goes on in the next buffer: gather it, the header first.
+    want = ISC_FRAME_HDR_SIZE;
+    if (conn->part >= ISC_FRAME_HDR_SIZE) {
+      isc_frame_decode(conn->frame, &hdr);
+      want += hdr.len;
+    }
+    n = want - conn->part < avail ? want - conn->part : avail;
+    memcpy(conn->frame + conn->part, p, n);
+    conn->part += n;
+    uringConsume(conn, n);
+    if (conn->part == ISC_FRAME_HDR_SIZE) {
+      isc_frame_decode(conn->frame, &hdr);
+      if (hdr.len > ISC_FRAME_MAX)
+        goto bad_frame;
+    }
+  }
+
+bad_frame:
+  fprintf(main_log_fd, "\n%s - ERROR - uring_server - message of %u bytes announced, the connection is out of step",
+          get_timestamp(), hdr.len);
+  framingErrors++;
+  return -1;
+}
+
+
+// Hand on what the connection in SLOT holds and park it if the peer ran out of room.
+// A connection which is out of step, or whose peer closed and which has nothing
+// left, is closed.
+static void uringService(int slot)
+{
+  struct uringConn *conn = &conns[slot];
+  int r = uringDeliver(conn);
+
+  if (r < 0)
+    uringConnClose(slot);
+  else if (r > 0)
+    uringPause(slot);
+  else {
+    uringUnpause(slot);
+    if (conn->eof)
+      uringConnClose(slot);
+  }
+}
+
+
+// Handle the completion of a receive of the connection in SLOT.
+static void uringOnRecv(int slot, uint32_t gen, const struct io_uring_cqe *cqe)
+{
+  struct uringConn *conn = &conns[slot];
+  int32_t bid = -1;
+
+  if (cqe->flags & IORING_CQE_F_BUFFER) {
+    bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+    rxFree--;
+  }
+  // A late completion of a connection closed meanwhile
+  if (!conn->open || conn->gen != gen) {
+    if (bid >= 0)
+      uringRecycle(bid);
+    return;
+  }
+  if (!(cqe->flags & IORING_CQE_F_MORE))
+    conn->armed = false;
+
+  if (cqe->res > 0 && bid >= 0) {
+    rxLen[bid] = cqe->res;
+    rxNext[bid] = -1;
+    if (conn->tail >= 0)
+      rxNext[conn->tail] = bid;
+    else
+      conn->head = bid;
+    conn->tail = bid;
+    // A parked connection waits its turn; the data stays queued behind the rest.
+    if (!uringIsPaused(slot))
+      uringService(slot);
+    return;
+  }
+  if (bid >= 0)
+    uringRecycle(bid);
+
+  if (cqe->res == -ENOBUFS) {
+    // Out of receive buffers: the socket fills up until the receive is armed again.
+    if (rxExhausted++ == 0)
+      fprintf(main_log_fd, "\n%s - WARNING - uring_server - receive buffers ran out, uring_rx_buffers may be too few",
+              get_timestamp());
+    return;
+  }
+  if (cqe->res < 0 && cqe->res != -ECONNRESET && cqe->res != -ECANCELED)
+    fprintf(main_log_fd, "\n%s - ERROR - uring_server - read error: %s", get_timestamp(), strerror(-cqe->res));
+  if (cqe->res <= 0) {
+    // The peer is gone; what it sent before is still handed on.
+    conn->eof = true;
+    if (!uringIsPaused(slot))
+      uringService(slot);
+  }
+}
+
+
+// Handle the completion CQE.
+static void uringOnCompletion(const struct io_uring_cqe *cqe)
+{
+  uint64_t data = cqe->user_data;
+  int slot;
+
+  completions++;
+  switch (REQ_TYPE(data)) {
+    case REQ_ACCEPT:
+      if (!(cqe->flags & IORING_CQE_F_MORE))
+        acceptArmed = false;
+      if (cqe->res < 0) {
+        if (cqe->res != -ECANCELED)
+          fprintf(main_log_fd, "\n%s - WARNING - uring_server - accept failed: %s", get_timestamp(), strerror(-cqe->res));
+        break;
+      }
+      slot = cqe->res;
+      if (verbose)
+        printf("uring_server - Accept a connection into slot %d\n", slot);
+      fprintf(main_log_fd, "\n%s - INFO - uring_server - Accept a connection into slot %d", get_timestamp(), slot);
+      uringConnOpen(slot);
+      uringArmRecv(slot);
+      break;
+
+    case REQ_RECV:
+      uringOnRecv(REQ_SLOT(data), REQ_GEN(data), cqe);
+      break;
+
+    case REQ_CLOSE:
+      if (cqe->res < 0)
+        fprintf(main_log_fd, "\n%s - WARNING - uring_server - close failed: %s", get_timestamp(), strerror(-cqe->res));
+      break;
+
+    default:
+      break;
+  }
+}
+
+
+// Hand on the messages of the parked connections while the peer has credits, each
+// one once: the credits left may still be too few for the next message of a
+// connection, which then is parked again.
+static void uringResume()
+{
+  int slot, turns = nPaused;
+
+  while (turns-- > 0 && nPaused > 0 && (*peer->credits_function) () != 0) {
+    slot = paused[0];
+    uringUnpause(slot);
+    uringService(slot);
+  }
+}
+
+
+// Set up the listening socket, the ring, the fixed file table and the receive
+// buffers. Returns false on failure, having logged why.
+static bool uringSetup()
+{
+  struct sockaddr_in serveraddr;
+  int *files, listenfd, on = 1, i;
+  bool ok;
+
+  // Only this thread drives the ring; the kernel then runs the completion work when
+  // the thread enters it, instead of interrupting it.
+  if (uring_init(&ring, ringEntries, IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN) == -1 &&
+      uring_init(&ring, ringEntries, 0) == -1) {
+    fprintf(main_log_fd, "\n%s - ERROR - uring_server - io_uring setup failed: %s", get_timestamp(), strerror(errno));
+    return false;
+  }
+
+  listenfd = socket(AF_INET, SOCK_STREAM, Protocol);
+  setsockopt(listenfd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+  // The connections accepted inherit the tuning of the listening socket; they are
+  // fixed files without a descriptor, so TCP_QUICKACK is set once, not re-armed.
+  sckt_tune_socket(&sckt_tuning, listenfd, true, "uring_server");
+  memset(&serveraddr, 0, sizeof(serveraddr));
+  serveraddr.sin_family = AF_INET;
+  serveraddr.sin_addr.s_addr = INADDR_ANY;
+  serveraddr.sin_port = htons(ConnPort);
+  if (bind(listenfd, (struct sockaddr *)&serveraddr, sizeof(serveraddr)) == -1 ||
+      listen(listenfd, sckt_tuning.listenq) == -1) {
+    fprintf(main_log_fd, "\n%s - ERROR - uring_server - can't listen on port %d: %s",
+            get_timestamp(), ConnPort, strerror(errno));
+    close(listenfd);
+    uring_exit(&ring);
+    return false;
+  }
+  sckt_tune_log(&sckt_tuning, listenfd, true, "uring_server");
+  fprintf(main_log_fd, ", listen backlog %d", sckt_tuning.listenq);
+
+  // The listening socket and room for the connections; the ring keeps its own
+  // reference to the socket.
+  files = (int *) xmalloc(URING_MAX_CONNS * sizeof(files[0]));
+  files[LISTEN_SLOT] = listenfd;
+  for (i = 1; i < URING_MAX_CONNS; i++)
+    files[i] = -1;
+  ok = (uring_register(&ring, IORING_REGISTER_FILES, files, URING_MAX_CONNS) == 0);
+  free(files);
+  close(listenfd);
+  if (!ok) {
+    fprintf(main_log_fd, "\n%s - ERROR - uring_server - registering the fixed files failed: %s", get_timestamp(), strerror(errno));
+    uring_exit(&ring);
+    return false;
+  }
+
+  rxMem = mmap(NULL, (size_t) rxCount * rxSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (rxMem == MAP_FAILED || (rxRing = uring_buf_ring_setup(&ring, rxCount, RX_BGID)) == NULL) {
+    fprintf(main_log_fd, "\n%s - ERROR - uring_server - registering the receive buffers failed: %s", get_timestamp(), strerror(errno));
+    if (rxMem != MAP_FAILED)
+      munmap(rxMem, (size_t) rxCount * rxSize);
+    uring_exit(&ring);
+    return false;
+  }
+  rxLen = (uint32_t *) xmalloc(rxCount * sizeof(rxLen[0]));
+  rxNext = (int32_t *) xmalloc(rxCount * sizeof(rxNext[0]));
+  rxReturned = rxFree = 0;
+  for (i = 0; i < rxCount; i++)
+    uringRecycle(i);
+  uring_buf_ring_advance(rxRing, rxReturned);
+  rxReturned = 0;
+
+  memset(conns, 0, sizeof(conns));
+  nPaused = 0;
+  fprintf(main_log_fd, "\n%s - INFO - uring_server - listening on port %d, %u entries, %u receive buffers of %u bytes",
+          get_timestamp(), ConnPort, ring.sq_entries, rxCount, rxSize);
+  return true;
+}
+
+
+// Free what uringSetup set up and drop the connections still open.
+static void uringTeardown()
+{
+  int slot;
+
+  for (slot = 1; slot < URING_MAX_CONNS; slot++)
+    if (conns[slot].open)
+      uringConnClose(slot);
+  nPaused = 0;
+  // Closing the ring cancels whatever is still under way and closes the fixed files.
+  uring_exit(&ring);
+  uring_buf_ring_free(rxRing, rxCount);
+  munmap(rxMem, (size_t) rxCount * rxSize);
+  free(rxLen);
+  free(rxNext);
+  rxRing = NULL;
+}
+
+
+// io_uring listener thread
+void *uringListenerThread(void *pArg)
+{
+  if (verbose)
+    printf("\nuring_server - uringListenerThread - listenerproc started\n");
+  fprintf(main_log_fd, "\n%s - INFO - uring_server - listenerproc started", get_timestamp());
+
+  if (!uringSetup()) {
+    isListening = false;
+    return NULL;
+  }
+
+  __atomic_store_n(&ListenerProcActive, true, __ATOMIC_RELEASE);
+  uringListenerProc();
+  isListening = false;
+  uringTeardown();
+  __atomic_store_n(&ListenerProcActive, false, __ATOMIC_RELEASE);
+
+  fprintf(main_log_fd, "\n%s - INFO - uring_server - listenerproc exited", get_timestamp());
+  return NULL;
+}
+
+
+// io_uring listener thread process. Each round submits what the last one queued and
+// sleeps for completions in one system call, then handles every completion there is.
+void uringListenerProc()
+{
+  struct io_uring_cqe *cqe;
+  int slot;
+
+  uringArmAccept();
+
+  while (isListening) {
+    if (uring_submit(&ring, 1, nPaused > 0 ? BACKPRESSURE_RETRY : URING_WAIT_TIMEOUT) == -1 && errno != EBUSY) {
+      fprintf(main_log_fd, "\n%s - ERROR - uring_server - io_uring_enter failed: %s", get_timestamp(), strerror(errno));
+      break;
+    }
+
+    while ( (cqe = uring_peek_cqe(&ring)) != NULL) {
+      uringOnCompletion(cqe);
+      uring_cqe_seen(&ring);
+    }
+
+    // Pick up the connections held back once the consumers have freed slots
+    if (nPaused > 0)
+      uringResume();
+
+    // Hand the buffers given back to the kernel and arm the receives which ran out
+    // of them, and the accept if the kernel ended it.
+    if (rxReturned > 0) {
+      uring_buf_ring_advance(rxRing, rxReturned);
+      rxReturned = 0;
+    }
+    for (slot = 1; slot < URING_MAX_CONNS && rxFree > 0; slot++)
+      if (conns[slot].open && !conns[slot].armed && !conns[slot].eof)
+        uringArmRecv(slot);
+    if (!acceptArmed)
+      uringArmAccept();
+  }
+
+  fprintf(main_log_fd, "\n%s - INFO - uring_server - Listener exiting", get_timestamp());
+}
+
+
+// Interface function to xmit data
+uint32_t ipc_xmit (uint8_t *buf, int32_t bufSize)
+{
+  system_error ("uring_server - ipc_xmit - Not implemented");
+  return 0;
+}
+
+
+// Interface function to xmit a batch of chunks
+uint32_t ipc_xmitv (const struct iovec *iov, int32_t iovCnt)
+{
+  system_error ("uring_server - ipc_xmitv - Not implemented");
+  return 0;
+}
+
+
+// Interface function to receive data
+void ipc_rec (uint8_t *buf, int32_t bufSize)
+{
+  system_error ("uring_server - ipc_rec - Not implemented");
+}
+
+
+// Interface function to lend a buffer; this module doesn't lend buffers.
+uint8_t* ipc_acquire (int32_t *bufSize)
+{
+  return NULL;
+}
+
+
+// Interface function to report the chunks this module can take; it has no flow control.
+int32_t ipc_credits ()
+{
+  return -1;
+}
+
+
+// Interface function to commit an acquired buffer
+void ipc_commit (uint8_t *buf, int32_t bufSize)
+{
+  system_error ("uring_server - ipc_commit - Not implemented");
+}
+
+
+// Interface function to release a buffer passed on through xmit
+void ipc_release (uint8_t *buf)
+{
+  system_error ("uring_server - ipc_release - Not implemented");
+}